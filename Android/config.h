@@ -281,6 +281,15 @@
 
 #define USE_POLL 0
 
+/*
+ * USE_EPOLL:
+ *
+ * Use the epoll() calls provided on Linux to watch file descriptors,
+ * with a fallback to poll()
+ */
+
+#define USE_EPOLL 0
+
 /*
  * Do we have various image libraries?
  */
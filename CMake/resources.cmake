@@ -35,6 +35,7 @@ find_file(HAVE_SYS_SELECT_H sys/select.h)
 find_file(HAVE_SYS_STDTYPES_H sys/stdtypes.h)
 find_file(HAVE_X11_XREGION_H X11/Xregion.h)
 find_path(HAVE_XDBE_H Xdbe.h PATH_SUFFIXES X11/extensions extensions)
+find_path(HAVE_XSHM_H XShm.h PATH_SUFFIXES X11/extensions extensions)
 
 if (WIN32 AND NOT CYGWIN)
   # we don't use pthreads on Windows (except for Cygwin, see options.cmake)
@@ -113,7 +114,7 @@ mark_as_advanced(HAVE_LIBPNG_PNG_H HAVE_LOCALE_H HAVE_NDIR_H)
 mark_as_advanced(HAVE_OPENGL_GLU_H HAVE_PNG_H HAVE_PTHREAD_H)
 mark_as_advanced(HAVE_STDIO_H HAVE_STRINGS_H HAVE_SYS_DIR_H)
 mark_as_advanced(HAVE_SYS_NDIR_H HAVE_SYS_SELECT_H)
-mark_as_advanced(HAVE_SYS_STDTYPES_H HAVE_XDBE_H)
+mark_as_advanced(HAVE_SYS_STDTYPES_H HAVE_XDBE_H HAVE_XSHM_H)
 mark_as_advanced(HAVE_X11_XREGION_H)
 
 # where to find freetype headers
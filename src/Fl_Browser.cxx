@@ -32,13 +32,21 @@
 // so that the number of items in the browser and size of those items
 // is unlimited. The only problem is that the old browser used an
 // index number to identify a line, and it is slow to convert from/to
-// a pointer. I use a cache of the last match to try to speed this up.
+// a pointer.
+
+// To convert quickly, the lines are also nodes of a balanced binary
+// tree ordered by line number (a treap, using a hash of each line's
+// address as its priority). Each node stores the number of lines in
+// its subtree, so line number <-> pointer lookups, insertion and
+// removal are all O(log n). The linked list is still used to walk
+// the lines in order.
 
 // Also added the ability to "hide" a line. This sets its height to
 // zero, so the Fl_Browser_ cannot pick it.
 
 #define SELECTED 1
 #define NOTDISPLAYED 2
+#define BULK 4		// allocated in a block by add_lines(), not malloc()
 
 // WARNING:
 //       Fl_File_Chooser.cxx also has a definition of this structure (FL_BLINE).
@@ -48,6 +56,10 @@
 struct FL_BLINE {	// data is in a linked list of these
   FL_BLINE* prev;
   FL_BLINE* next;
+  FL_BLINE* parent;	// line number index tree
+  FL_BLINE* left;
+  FL_BLINE* right;
+  int count;		// number of lines in this subtree
   void* data;
   Fl_Image* icon;
   short length;		// sizeof(txt)-1, may be longer than string
@@ -55,6 +67,131 @@ struct FL_BLINE {	// data is in a linked list of these
   char txt[1];		// start of allocated array
 };
 
+// Line number index tree helpers
+
+static inline int tree_count(const FL_BLINE *l) {
+  return l ? l->count : 0;
+}
+
+// Pseudo random, but fixed, priority of a node
+static unsigned int tree_priority(const FL_BLINE *l) {
+  fl_uintptr_t v = (fl_uintptr_t)l;
+  unsigned int h = (unsigned int)(v ^ ((v >> 16) >> 16));
+  h ^= h >> 16; h *= 0x7feb352dU;
+  h ^= h >> 15; h *= 0x846ca68bU;
+  h ^= h >> 16;
+  return h;
+}
+
+// Recalculate the line count of a node, and adopt its children
+static inline void tree_update(FL_BLINE *l) {
+  l->count = 1 + tree_count(l->left) + tree_count(l->right);
+  if (l->left) l->left->parent = l;
+  if (l->right) l->right->parent = l;
+}
+
+// Join two trees; all lines of 'a' go before all lines of 'b'.
+// The caller must clear the parent of the returned root.
+static FL_BLINE *tree_merge(FL_BLINE *a, FL_BLINE *b) {
+  if (!a) return b;
+  if (!b) return a;
+  if (tree_priority(a) > tree_priority(b)) {
+    a->right = tree_merge(a->right, b);
+    tree_update(a);
+    return a;
+  }
+  b->left = tree_merge(a, b->left);
+  tree_update(b);
+  return b;
+}
+
+// Split tree 't' into its first 'n' lines 'a' and the rest 'b'.
+// The caller must clear the parents of both roots.
+static void tree_split(FL_BLINE *t, int n, FL_BLINE *&a, FL_BLINE *&b) {
+  if (!t) { a = b = 0; return; }
+  if (tree_count(t->left) < n) {
+    tree_split(t->right, n - tree_count(t->left) - 1, t->right, b);
+    a = t;
+  } else {
+    tree_split(t->left, n, a, t->left);
+    b = t;
+  }
+  tree_update(t);
+}
+
+// Put node 'n' in the place of node 'o' in the tree
+static void tree_replace(FL_BLINE *&root, FL_BLINE *o, FL_BLINE *n) {
+  n->parent = o->parent;
+  n->left   = o->left;
+  n->right  = o->right;
+  n->count  = o->count;
+  if (n->left) n->left->parent = n;
+  if (n->right) n->right->parent = n;
+  if (!n->parent) root = n;
+  else if (n->parent->left == o) n->parent->left = n;
+  else n->parent->right = n;
+}
+
+// Rotate node 'x' above its parent, keeping the order of the lines
+static void tree_rotate_up(FL_BLINE *&root, FL_BLINE *x) {
+  FL_BLINE *p = x->parent, *g = p->parent;
+  if (p->left == x) { p->left = x->right; x->right = p; }
+  else { p->right = x->left; x->left = p; }
+  tree_update(p);
+  tree_update(x);
+  x->parent = g;
+  if (!g) root = x;
+  else if (g->left == p) g->left = x;
+  else g->right = x;
+}
+
+// Rotate node 'x' up or down until the priorities around it are in heap
+// order again, after it was put in the place of another node
+static void tree_reheap(FL_BLINE *&root, FL_BLINE *x) {
+  while (x->parent && tree_priority(x->parent) < tree_priority(x))
+    tree_rotate_up(root, x);
+  for (;;) {
+    FL_BLINE *c = x->left;
+    if (x->right && (!c || tree_priority(x->right) > tree_priority(c))) c = x->right;
+    if (!c || tree_priority(c) <= tree_priority(x)) break;
+    tree_rotate_up(root, c);
+  }
+}
+
+// Build a tree from 'n' lines linked from 'l' in O(n), and return its root.
+// This makes a cartesian tree of the priorities, which is what inserting
+// the lines one by one would produce.
+static FL_BLINE *tree_build(FL_BLINE *l, int n) {
+  if (n <= 0) return 0;
+  FL_BLINE **stack = (FL_BLINE**)malloc(n * sizeof(FL_BLINE*));
+  int depth = 0;
+  for (int i = 0; i < n; i++, l = l->next) {
+    FL_BLINE *below = 0;
+    while (depth > 0 && tree_priority(stack[depth-1]) < tree_priority(l))
+      below = stack[--depth];
+    l->left = below;
+    l->right = 0;
+    if (depth > 0) stack[depth-1]->right = l;
+    stack[depth++] = l;
+  }
+  FL_BLINE *root = stack[0];
+  free(stack);
+  return root;
+}
+
+// Recalculate all counts and parents of a tree made by tree_build()
+static void tree_fix(FL_BLINE *t) {
+  if (!t) return;
+  tree_fix(t->left);
+  tree_fix(t->right);
+  tree_update(t);
+}
+
+// Free a line, unless it is part of a block made by add_lines()
+static void free_line(FL_BLINE *l) {
+  if (!(l->flags & BULK)) free(l);
+}
+
 /**
   Returns the very first item in the list.
   Example of use:
@@ -131,13 +268,10 @@ const char *Fl_Browser::item_text(void *item) const {
 /**
   Returns the item for specified \p line.
 
-  Note: This call is slow. It's fine for e.g. responding to user
-  clicks, but slow if called often, such as in a tight sorting loop.
-  Finding an item 'by line' involves a linear lookup on the internal
-  linked list. The performance hit can be significant if the browser's
-  contents is large, and the method is called often (e.g. during a sort).
-  If you're writing a subclass, use the protected methods item_first(),
-  item_next(), etc. to access the internal linked list more efficiently.
+  Finding an item 'by line' is a O(log n) lookup in the internal
+  line number index. If you're writing a subclass and want to visit
+  all items in order, the protected methods item_first(), item_next(),
+  etc. are still more efficient, as they follow the internal linked list.
 
   \param[in] line The line number of the item to return. (1 based)
   \retval item that was found.
@@ -145,25 +279,25 @@ const char *Fl_Browser::item_text(void *item) const {
   \see item_at(), find_line(), lineno()
 */
 FL_BLINE* Fl_Browser::find_line(int line) const {
-  int n; FL_BLINE* l;
-  if (line == cacheline) return cache;
-  if (cacheline && line > (cacheline/2) && line < ((cacheline+lines)/2)) {
-    n = cacheline; l = cache;
-  } else if (line <= (lines/2)) {
-    n = 1; l = first;
-  } else {
-    n = lines; l = last;
+  if (line < 1 || line > lines) return 0;
+  FL_BLINE* l = root;
+  while (l) {
+    int n = tree_count(l->left);
+    if (line <= n) {
+      l = l->left;
+    } else if (line == n+1) {
+      break;
+    } else {
+      line -= n+1;
+      l = l->right;
+    }
   }
-  for (; n < line && l; n++) l = l->next;
-  for (; n > line && l; n--) l = l->prev;
-  ((Fl_Browser*)this)->cacheline = line;
-  ((Fl_Browser*)this)->cache = l;
   return l;
 }
 
 /**
   Returns line number corresponding to \p item, or zero if not found.
-  Caveat: See efficiency note in find_line().
+  This is a O(log n) lookup in the internal line number index.
   \param[in] item The item to be found
   \returns The line number of the item, or 0 if not found.
   \see item_at(), find_line(), lineno()
@@ -171,33 +305,15 @@ FL_BLINE* Fl_Browser::find_line(int line) const {
 int Fl_Browser::lineno(void *item) const {
   FL_BLINE* l = (FL_BLINE*)item;
   if (!l) return 0;
-  if (l == cache) return cacheline;
-  if (l == first) return 1;
-  if (l == last) return lines;
-  if (!cache) {
-    ((Fl_Browser*)this)->cache = first;
-    ((Fl_Browser*)this)->cacheline = 1;
-  }
-  // assume it is near cache, search both directions:
-  FL_BLINE* b = cache->prev;
-  int bnum = cacheline-1;
-  FL_BLINE* f = cache->next;
-  int fnum = cacheline+1;
-  int n = 0;
-  for (;;) {
-    if (b == l) {n = bnum; break;}
-    if (f == l) {n = fnum; break;}
-    if (b) {b = b->prev; bnum--;}
-    if (f) {f = f->next; fnum++;}
+  int n = tree_count(l->left) + 1;
+  for (; l->parent; l = l->parent) {
+    if (l == l->parent->right) n += tree_count(l->parent->left) + 1;
   }
-  ((Fl_Browser*)this)->cache = l;
-  ((Fl_Browser*)this)->cacheline = n;
-  return n;
+  return (l == root) ? n : 0;
 }
 
 /**
   Removes the item at the specified \p line.
-  Caveat: See efficiency note in find_line().
   You must call redraw() to make any changes visible.
   \param[in] line The line number to be removed. (1 based) Must be in range!
   \returns Pointer to browser item that was removed (and is no longer valid).
@@ -207,8 +323,13 @@ FL_BLINE* Fl_Browser::_remove(int line) {
   FL_BLINE* ttt = find_line(line);
   deleting(ttt);
 
-  cacheline = line-1;
-  cache = ttt->prev;
+  FL_BLINE *a, *b;
+  tree_split(root, line-1, a, b);
+  tree_split(b, 1, ttt, b);
+  root = tree_merge(a, b);
+  if (root) root->parent = 0;
+  ttt->parent = ttt->left = ttt->right = 0;
+  ttt->count = 1;
   lines--;
   full_height_ -= item_height(ttt);
   if (ttt->prev) ttt->prev->next = ttt->next;
@@ -228,15 +349,13 @@ FL_BLINE* Fl_Browser::_remove(int line) {
 */
 void Fl_Browser::remove(int line) {
   if (line < 1 || line > lines) return;
-  free(_remove(line));
+  free_line(_remove(line));
 }
 
 /**
   Insert specified \p item above \p line.
   If \p line > size() then the line is added to the end.
 
-  Caveat: See efficiency note in find_line().
-
   \param[in] line  The new line will be inserted above this line (1 based).
   \param[in] item  The item to be added.
 */
@@ -263,8 +382,13 @@ void Fl_Browser::insert(int line, FL_BLINE* item) {
     item->prev->next = item;
     n->prev = item;
   }
-  cacheline = line;
-  cache = item;
+  // Add to the line number index
+  FL_BLINE *a, *b;
+  tree_split(root, line-1, a, b);
+  item->left = item->right = 0;
+  item->count = 1;
+  root = tree_merge(tree_merge(a, item), b);
+  root->parent = 0;
   lines++;
   full_height_ += item_height(item);
   redraw_line(item);
@@ -325,16 +449,17 @@ void Fl_Browser::text(int line, const char* newtext) {
   if (l > t->length) {
     FL_BLINE* n = (FL_BLINE*)malloc(sizeof(FL_BLINE)+l);
     replacing(t, n);
-    cache = n;
     n->data = t->data;
     n->icon = t->icon;
     n->length = (short)l;
-    n->flags = t->flags;
+    n->flags = t->flags & ~BULK;
     n->prev = t->prev;
     if (n->prev) n->prev->next = n; else first = n;
     n->next = t->next;
     if (n->next) n->next->prev = n; else last = n;
-    free(t);
+    tree_replace(root, t, n);
+    tree_reheap(root, n);
+    free_line(t);
     t = n;
   }
   strcpy(t->txt, newtext);
@@ -605,10 +730,10 @@ Fl_Browser::Fl_Browser(int X, int Y, int W, int H, const char *L)
   column_widths_ = no_columns;
   lines = 0;
   full_height_ = 0;
-  cacheline = 0;
   format_char_ = '@';
   column_char_ = '\t';
-  first = last = cache = 0;
+  first = last = root = 0;
+  bulk_ = 0;
 }
 
 /**
@@ -685,16 +810,93 @@ void Fl_Browser::textsize(Fl_Fontsize newSize) {
 void Fl_Browser::clear() {
   for (FL_BLINE* l = first; l;) {
     FL_BLINE* n = l->next;
-    free(l);
+    free_line(l);
     l = n;
   }
+  while (bulk_) {		// free blocks of lines made by add_lines()
+    void *n = *(void**)bulk_;
+    free(bulk_);
+    bulk_ = n;
+  }
   full_height_ = 0;
   first = 0;
   last = 0;
+  root = 0;
   lines = 0;
   new_list();
 }
 
+/**
+  Adds many lines to the end of the browser at once.
+
+  \p buf is split into lines at each newline (and NUL) character, and
+  each line is added like add() does, with a NULL data() pointer.
+  Text after the last newline, if any, is added as the last line.
+
+  This is much faster than calling add() for each line: all new lines
+  are allocated in a single block, and the line number index is built
+  in one O(n) pass. Memory of lines added this way is only released
+  by clear() or when the browser is destroyed, even if they are
+  removed earlier.
+
+  \param[in] buf The text of the lines to add.
+  \param[in] len The number of bytes in \p buf.
+  \returns The number of lines added.
+  \see add(), load(), clear()
+*/
+int Fl_Browser::add_lines(const char* buf, int len) {
+  if (!buf || len < 0) return 0;
+  // Pass 1: count lines and the space needed for them
+  const int align = sizeof(void*);
+  const char *end = buf + len, *p;
+  int n = 0;
+  size_t bytes = sizeof(void*);			// link to the next block
+  for (p = buf; p < end; ) {
+    const char *s = p;
+    while (p < end && *p != '\n' && *p) p++;
+    bytes += (sizeof(FL_BLINE) + (p - s) + align - 1) / align * align;
+    n++;
+    if (p < end) p++;				// skip the newline
+  }
+  if (!n) return 0;
+  char *block = (char*)malloc(bytes);
+  if (!block) return 0;
+  *(void**)block = bulk_;
+  bulk_ = block;
+  // Pass 2: make the lines, and link them to the end of the list
+  char *q = block + sizeof(void*);
+  FL_BLINE *head = 0, *prev = last;
+  for (p = buf; p < end; ) {
+    const char *s = p;
+    while (p < end && *p != '\n' && *p) p++;
+    int l = (int)(p - s);
+    if (p < end) p++;				// skip the newline
+    FL_BLINE *t = (FL_BLINE*)q;
+    q += (sizeof(FL_BLINE) + l + align - 1) / align * align;
+    t->length = (short)l;
+    t->flags = BULK;
+    memcpy(t->txt, s, l);
+    t->txt[l] = 0;
+    t->data = 0;
+    t->icon = 0;
+    t->prev = prev;
+    t->next = 0;
+    if (prev) prev->next = t; else first = t;
+    if (!head) head = t;
+    prev = t;
+    full_height_ += item_height(t);
+  }
+  last = prev;
+  lines += n;
+  // Index the new lines in O(n) and append them to the index
+  FL_BLINE *t = tree_build(head, n);
+  tree_fix(t);
+  root = tree_merge(root, t);
+  root->parent = 0;
+  redraw();
+  return n;
+}
+
 /**
   Adds a new line to the end of the browser.
 
@@ -837,6 +1039,13 @@ void Fl_Browser::swap(FL_BLINE *a, FL_BLINE *b) {
 
   if ( a == b || !a || !b) return;          // nothing to do
   swapping(a, b);
+  // Swap positions in the line number index
+  FL_BLINE tmp;
+  tree_replace(root, a, &tmp);
+  tree_replace(root, b, a);
+  tree_replace(root, &tmp, b);
+  tree_reheap(root, a);
+  tree_reheap(root, b);
   FL_BLINE *aprev  = a->prev;
   FL_BLINE *anext  = a->next;
   FL_BLINE *bprev  = b->prev;
@@ -867,9 +1076,6 @@ void Fl_Browser::swap(FL_BLINE *a, FL_BLINE *b) {
      if ( bprev ) bprev->next = a; else first = a;
      a->next = bnext;
   }
-  // Disable cache -- we played around with positions
-  cacheline = 0;
-  cache = 0;
 }
 
 /**
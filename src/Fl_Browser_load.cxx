@@ -19,6 +19,7 @@
 #include <FL/Fl.H>
 #include <FL/Fl_Browser.H>
 #include <stdio.h>
+#include <stdlib.h>
 #include <FL/fl_utf8.h>
 
 /**
@@ -28,31 +29,35 @@
   was any error in opening or reading the file, in which case errno
   is set to the system error.  The data() of each line is set
   to NULL.
+
+  The whole file is read into memory first, and then added with
+  add_lines(), so all lines are allocated at once.
   \param[in] filename The filename to load
   \returns 1 if OK, 0 on error (errno has reason)
-  \see add()
+  \see add(), add_lines()
 */
 int Fl_Browser::load(const char *filename) {
-#define MAXFL_BLINE 1024
-    char newtext[MAXFL_BLINE];
-    int c;
-    int i;
     clear();
     if (!filename || !(filename[0])) return 1;
     FILE *fl = fl_fopen(filename,"r");
     if (!fl) return 0;
-    i = 0;
-    do {
-	c = getc(fl);
-	if (c == '\n' || c <= 0 || i>=(MAXFL_BLINE-1)) {
-	    newtext[i] = 0;
-	    add(newtext);
-	    i = 0;
-	} else {
-	    newtext[i++] = c;
-	}
-    } while (c >= 0);
+    size_t len = 0, size = 65536, n;
+    char *buf = (char*)malloc(size), *nbuf;
+    int err = !buf;
+    while (!err && (n = fread(buf + len, 1, size - len, fl)) > 0) {
+	len += n;
+	if (len < size) continue;
+	if ((nbuf = (char*)realloc(buf, size * 2)) != NULL) {
+	    buf = nbuf; size *= 2;
+	} else err = 1;
+    }
+    if (ferror(fl)) err = 1;
     fclose(fl);
+    if (err) { free(buf); return 0; }
+    add_lines(buf, (int)len);
+    // for compatibility, text after the last newline is always a line
+    if (len == 0 || buf[len-1] == '\n' || buf[len-1] == 0) add("");
+    free(buf);
     return 1;
 }
 
@@ -57,6 +57,10 @@ struct FL_BLINE			// data is in a linked list of these
 {
   FL_BLINE	*prev;		// Previous item in list
   FL_BLINE	*next;		// Next item in list
+  FL_BLINE	*parent;	// Line number index tree
+  FL_BLINE	*left;
+  FL_BLINE	*right;
+  int		count;		// Number of lines in this subtree
   void		*data;		// Pointer to data (function)
   Fl_Image      *icon;		// Pointer to optional icon
   short		length;		// sizeof(txt)-1, may be longer than string
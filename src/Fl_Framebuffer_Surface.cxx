@@ -0,0 +1,123 @@
+//
+// "$Id$"
+//
+// Draw-to-memory code for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+#include <FL/Fl_Framebuffer_Surface.H>
+#include "drivers/PicoFB/Fl_PicoFB_Graphics_Driver.H"
+
+
+/** Constructor.
+ \param w and \param h give the size in pixels of the surface.
+ */
+Fl_Framebuffer_Surface::Fl_Framebuffer_Surface(int w, int h) :
+  Fl_Widget_Surface(new Fl_PicoFB_Graphics_Driver(w, h)) {
+}
+
+
+/** The destructor, which frees the pixels. */
+Fl_Framebuffer_Surface::~Fl_Framebuffer_Surface() {
+  delete (Fl_PicoFB_Graphics_Driver*)driver();
+}
+
+
+void Fl_Framebuffer_Surface::translate(int x, int y) {
+  ((Fl_PicoFB_Graphics_Driver*)driver())->translate_all(x, y);
+}
+
+
+void Fl_Framebuffer_Surface::untranslate() {
+  ((Fl_PicoFB_Graphics_Driver*)driver())->untranslate_all();
+}
+
+
+int Fl_Framebuffer_Surface::printable_rect(int *w, int *h) {
+  *w = this->w();
+  *h = this->h();
+  return 0;
+}
+
+
+/** Returns the width of the surface in pixels. */
+int Fl_Framebuffer_Surface::w() {
+  return ((Fl_PicoFB_Graphics_Driver*)driver())->w();
+}
+
+
+/** Returns the height of the surface in pixels. */
+int Fl_Framebuffer_Surface::h() {
+  return ((Fl_PicoFB_Graphics_Driver*)driver())->h();
+}
+
+
+/** Returns the pixels of the surface.
+ There are w() * h() pixels, row after row from the top. Each pixel is
+ an unsigned int 0xAARRGGBB in native byte order, with alpha always 0xff.
+ When threads() is not 0, what was drawn since the last call is drawn first.
+ */
+unsigned *Fl_Framebuffer_Surface::pixels() {
+  Fl_PicoFB_Graphics_Driver *d = (Fl_PicoFB_Graphics_Driver*)driver();
+  d->rasterize();
+  return d->pixels();
+}
+
+
+/** Sets the number of threads that draw the pixels.
+ With 0, the default, each drawing operation changes the pixels at once
+ in the calling thread. Otherwise drawing operations are recorded, then
+ drawn by tiles of 256 x 64 pixels in up to \p n threads, when pixels()
+ or image() are called, or when the surface stops being the current
+ drawing surface. The pixels are the same whatever the number of threads,
+ which can be more than 1 only on platforms with POSIX threads. Using
+ threads pays for surfaces of several million pixels.
+ */
+void Fl_Framebuffer_Surface::threads(int n) {
+  ((Fl_PicoFB_Graphics_Driver*)driver())->threads(n);
+}
+
+
+/** Returns the number of threads that draw the pixels. */
+int Fl_Framebuffer_Surface::threads() {
+  return ((Fl_PicoFB_Graphics_Driver*)driver())->threads();
+}
+
+
+void Fl_Framebuffer_Surface::end_current_(Fl_Surface_Device*) {
+  ((Fl_PicoFB_Graphics_Driver*)driver())->rasterize();
+}
+
+
+/** Returns a new image with the pixels of the surface.
+ The caller deletes the image when no longer needed.
+ */
+Fl_RGB_Image *Fl_Framebuffer_Surface::image() {
+  int W = w(), H = h();
+  const unsigned *p = pixels();
+  uchar *data = new uchar[W * H * 3], *q = data;
+  for (int i = W * H; i > 0; i--, p++) {
+    *q++ = (uchar)(*p >> 16);
+    *q++ = (uchar)(*p >> 8);
+    *q++ = (uchar)*p;
+  }
+  Fl_RGB_Image *image = new Fl_RGB_Image(data, W, H);
+  image->alloc_array = 1;
+  return image;
+}
+
+
+//
+// End of "$Id$".
+//
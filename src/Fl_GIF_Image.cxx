@@ -27,11 +27,12 @@
 #include <FL/Fl_GIF_Image.H>
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <FL/fl_utf8.h>
 #include "flstring.h"
 
-// Read a .gif file and convert it to a "xpm" format (actually my
-// modified one with compressed colormaps).
+// Read a .gif file and decode it directly to RGB(A) image data, one
+// frame at a time.
 
 // Extensively modified from original code for gif2ras by
 // Patrick J. Naughton of Sun Microsystems.  The original
@@ -67,9 +68,19 @@
 
 typedef unsigned char uchar;
 
-#define NEXTBYTE (uchar)getc(GifFile)
+#define NEXTBYTE (p < end ? *p++ : 0)
 #define GETSHORT(var) var = NEXTBYTE; var += NEXTBYTE << 8
 
+// Everything needed to decode one frame, found while scanning the file:
+struct Fl_GIF_Image::Frame {
+  int x, y, w, h;	// position and size on the logical screen
+  int delay;		// in 1/100 seconds
+  int colormap;		// file offset of the color table, -1 for a gray ramp
+  int colors;		// number of colors in the color table
+  int data;		// file offset of the LZW code size byte
+  uchar disposal, interlace, has_transparent, transparent_pixel;
+};
+
 /**
  The constructor loads the named GIF image.
 
@@ -81,9 +92,33 @@ typedef unsigned char uchar;
  GIF format could not be decoded, and ERR_NO_IMAGE if the image could not
  be loaded for another reason.
  */
-Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
+Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_RGB_Image(0,0,0),
+  gif_(0),
+  gif_size_(0),
+  frame_info_(0),
+  frames_(0),
+  frame_(-1),
+  loop_count_(-1),
+  previous_(0),
+  previous_size_(0)
+{
+  load_gif_(infname);
+  // a single frame is never decoded again:
+  if (frames_ < 2) {
+    delete[] gif_;
+    gif_ = 0;
+  }
+}
+
+Fl_GIF_Image::~Fl_GIF_Image() {
+  delete[] gif_;
+  delete[] previous_;
+  free(frame_info_);
+}
+
+// Read the file, find all frames, and decode the first one
+void Fl_GIF_Image::load_gif_(const char *infname) {
   FILE *GifFile;	// File to read
-  char **new_data;	// Data array
 
   if ((GifFile = fl_fopen(infname, "rb")) == NULL) {
     Fl::error("Fl_GIF_Image: Unable to open %s!", infname);
@@ -91,24 +126,36 @@ Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
     return;
   }
 
-  {char b[6];
-  if (fread(b,1,6,GifFile)<6) {
+  // The whole file is kept in memory so that frames can be decoded later
+  fseek(GifFile, 0, SEEK_END);
+  long size = ftell(GifFile);
+  fseek(GifFile, 0, SEEK_SET);
+  if (size < 6 || size > INT_MAX) {
     fclose(GifFile);
     ld(ERR_FILE_ACCESS);
     return; /* quit on eof */
   }
-  if (b[0]!='G' || b[1]!='I' || b[2] != 'F') {
-    fclose(GifFile);
+  gif_ = new uchar[size];
+  gif_size_ = (int)fread(gif_, 1, size, GifFile);
+  fclose(GifFile);
+  if (gif_size_ < 6) {
+    ld(ERR_FILE_ACCESS);
+    return;
+  }
+
+  const uchar *p = gif_;
+  const uchar *end = gif_ + gif_size_;
+  if (p[0]!='G' || p[1]!='I' || p[2] != 'F') {
     Fl::error("Fl_GIF_Image: %s is not a GIF file.\n", infname);
     ld(ERR_FORMAT);
     return;
   }
-  if (b[3]!='8' || b[4]>'9' || b[5]!= 'a')
-    Fl::warning("%s is version %c%c%c.",infname,b[3],b[4],b[5]);
-  }
+  if (p[3]!='8' || p[4]>'9' || p[5]!= 'a')
+    Fl::warning("%s is version %c%c%c.",infname,p[3],p[4],p[5]);
+  p += 6;
 
-  int Width; GETSHORT(Width);
-  int Height; GETSHORT(Height);
+  int ScreenWidth; GETSHORT(ScreenWidth);
+  int ScreenHeight; GETSHORT(ScreenHeight);
 
   uchar ch = NEXTBYTE;
   char HasColormap = ((ch & 0x80) != 0);
@@ -119,37 +166,26 @@ Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
   ch = NEXTBYTE; // Background Color index
   ch = NEXTBYTE; // Aspect ratio is N/64
 
-  // Read in global colormap:
-  uchar transparent_pixel = 0;
-  char has_transparent = 0;
-  uchar Red[256], Green[256], Blue[256]; /* color map */
+  // Global colormap, frames without a local one use it:
+  int Colormap = -1;
   if (HasColormap) {
-    for (int i=0; i < ColorMapSize; i++) {	
-      Red[i] = NEXTBYTE;
-      Green[i] = NEXTBYTE;
-      Blue[i] = NEXTBYTE;
-    }
+    Colormap = (int)(p - gif_);
+    p += (end - p < 3 * ColorMapSize) ? end - p : 3 * ColorMapSize;
   } else {
     Fl::warning("%s does not have a colormap.", infname);
-    for (int i = 0; i < ColorMapSize; i++)
-      Red[i] = Green[i] = Blue[i] = (uchar)(255 * i / (ColorMapSize-1));
   }
 
-  int CodeSize;		/* Code size, init from GIF header, increases... */
-  char Interlace;
+  // Graphic control extension, applies to the next image:
+  int delay = 0;
+  uchar disposal = 0, has_transparent = 0, transparent_pixel = 0;
+  int alloc_frames = 0;
 
-  for (;;) {
+  while (p < end) {
 
     int i = NEXTBYTE;
-    if (i<0) {
-      fclose(GifFile);
-      Fl::error("Fl_GIF_Image: %s - unexpected EOF",infname); 
-      w(0); h(0); d(0); ld(ERR_FORMAT);
-      return;
-    }
     int blocklen;
 
-    //  if (i == 0x3B) return 0;  eof code
+    if (i == 0x3B) break; // eof code
 
     if (i == 0x21) {		// a "gif extension"
 
@@ -158,60 +194,179 @@ Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
 
       if (ch==0xF9 && blocklen==4) { // Netscape animation extension
 
-	char bits;
-	bits = NEXTBYTE;
-	getc(GifFile); getc(GifFile); // GETSHORT(delay);
+	uchar bits = NEXTBYTE;
+	GETSHORT(delay);
 	transparent_pixel = NEXTBYTE;
-	if (bits & 1) has_transparent = 1;
+	has_transparent = bits & 1;
+	disposal = (bits >> 2) & 7;
 	blocklen = NEXTBYTE;
 
       } else if (ch == 0xFF) { // Netscape repeat count
-	;
+	if (blocklen == 11 && end - p >= 15 && !memcmp(p, "NETSCAPE2.0", 11) &&
+	    p[11] == 3 && p[12] == 1)
+	  loop_count_ = p[13] | (p[14] << 8);
 
       } else if (ch != 0xFE) { //Gif Comment
 	Fl::warning("%s: unknown gif extension 0x%02x.", infname, ch);
       }
     } else if (i == 0x2c) {	// an image
 
-      ch = NEXTBYTE; ch = NEXTBYTE; // GETSHORT(x_position);
-      ch = NEXTBYTE; ch = NEXTBYTE; // GETSHORT(y_position);
-      GETSHORT(Width);
-      GETSHORT(Height);
+      if (frames_ >= alloc_frames) {
+	alloc_frames = alloc_frames ? 2 * alloc_frames : 4;
+	frame_info_ = (Frame *)realloc(frame_info_, alloc_frames * sizeof(Frame));
+      }
+      Frame &f = frame_info_[frames_++];
+      GETSHORT(f.x);
+      GETSHORT(f.y);
+      GETSHORT(f.w);
+      GETSHORT(f.h);
       ch = NEXTBYTE;
-      Interlace = ((ch & 0x40) != 0);
-      if (ch&0x80) { 
-	// read local color map
-	int n = 2<<(ch&7);
-	for (i=0; i < n; i++) {	
-	  Red[i] = NEXTBYTE;
-	  Green[i] = NEXTBYTE;
-	  Blue[i] = NEXTBYTE;
-	}
+      f.interlace = ((ch & 0x40) != 0);
+      f.colormap = Colormap;
+      f.colors = ColorMapSize;
+      if (ch&0x80) {
+	// local color map
+	f.colormap = (int)(p - gif_);
+	f.colors = 2<<(ch&7);
+	p += (end - p < 3 * f.colors) ? end - p : 3 * f.colors;
       }
-      CodeSize = NEXTBYTE+1;
-      break; // okay, this is the image we want
+      f.data = (int)(p - gif_);
+      f.delay = delay;
+      f.disposal = disposal;
+      f.has_transparent = has_transparent;
+      f.transparent_pixel = transparent_pixel;
+      delay = 0; disposal = 0; has_transparent = 0;
+
+      ch = NEXTBYTE; // LZW code size
+      blocklen = NEXTBYTE;
     } else {
       Fl::warning("%s: unknown gif code 0x%02x", infname, i);
       blocklen = 0;
     }
 
     // skip the data:
-    while (blocklen>0) {while (blocklen--) {ch = NEXTBYTE;} blocklen=NEXTBYTE;}
+    while (blocklen>0) {
+      p += (end - p < blocklen) ? end - p : blocklen;
+      blocklen = NEXTBYTE;
+    }
   }
 
-  if (BitsPerPixel >= CodeSize)
-  {
-    // Workaround for broken GIF files...
-    BitsPerPixel = CodeSize - 1;
-    ColorMapSize = 1 << BitsPerPixel;
+  if (!frames_) {
+    Fl::error("Fl_GIF_Image: %s - unexpected EOF",infname);
+    w(0); h(0); d(0); ld(ERR_FORMAT);
+    return;
   }
 
-  uchar *Image = new uchar[Width*Height];
+  // A single image is loaded at its own size, ignoring its position, as
+  // it always was. Animations use the logical screen.
+  Frame &first = frame_info_[0];
+  int Width, Height;
+  if (frames_ == 1) {
+    first.x = first.y = 0;
+    Width = first.w;
+    Height = first.h;
+  } else {
+    Width = ScreenWidth > first.x + first.w ? ScreenWidth : first.x + first.w;
+    Height = ScreenHeight > first.y + first.h ? ScreenHeight : first.y + first.h;
+  }
+
+  w(Width);
+  h(Height);
+  d(frames_ > 1 || first.has_transparent ? 4 : 3);
+  if (!Width || !Height || ((size_t)w()) * h() * d() > max_size()) {
+    w(0); h(0); d(0); ld(ERR_FORMAT);
+    return;
+  }
+  array = new uchar[w() * h() * d()];
+  alloc_array = 1;
+  memset((uchar *)array, 0, w() * h() * d());
+  frame_ = 0;
+  draw_frame_(0);
+}
+
+// Restore the area of frame n as its disposal mode says
+void Fl_GIF_Image::dispose_frame_(int n) {
+  Frame &f = frame_info_[n];
+  int D = d(), LD = w() * D;
+  int X = f.x < w() ? f.x : w(), Y = f.y < h() ? f.y : h();
+  int W = (f.x + f.w < w() ? f.x + f.w : w()) - X;
+  int H = (f.y + f.h < h() ? f.y + f.h : h()) - Y;
+  uchar *q = (uchar *)array + Y * LD + X * D;
+  if (f.disposal == DISPOSE_BACKGROUND) {
+    for (int y = 0; y < H; y++, q += LD) memset(q, 0, W * D);
+  } else if (f.disposal == DISPOSE_PREVIOUS && previous_size_ &&
+	     previous_size_ == W * H * D) {
+    for (int y = 0; y < H; y++, q += LD) memcpy(q, previous_ + y * W * D, W * D);
+  }
+}
+
+// Decode frame n and draw it over the image data
+void Fl_GIF_Image::draw_frame_(int n) {
+  Frame &f = frame_info_[n];
+  const uchar *p = gif_ + f.data;
+  const uchar *end = gif_ + gif_size_;
+  int D = d(), LD = w() * D;
+  int i;
+
+  // Save the area the frame covers if it has to be restored afterwards:
+  if (f.disposal == DISPOSE_PREVIOUS) {
+    int X = f.x < w() ? f.x : w(), Y = f.y < h() ? f.y : h();
+    int W = (f.x + f.w < w() ? f.x + f.w : w()) - X;
+    int H = (f.y + f.h < h() ? f.y + f.h : h()) - Y;
+    if (previous_size_ < W * H * D) {
+      delete[] previous_;
+      previous_ = new uchar[W * H * D];
+    }
+    previous_size_ = W * H * D;
+    const uchar *q = array + Y * LD + X * D;
+    if (previous_size_)
+      for (int y = 0; y < H; y++, q += LD) memcpy(previous_ + y * W * D, q, W * D);
+  }
+
+  // Color map as pixels in the format of the image data:
+  uchar Pixel[256][4];	/* color map */
+  uchar Opaque[256];
+  memset(Pixel, 0, sizeof(Pixel));
+  for (i = 0; i < 256; i++) {
+    uchar r = 0, g = 0, b = 0;
+    if (i < f.colors) {
+      if (f.colormap < 0) {
+	r = g = b = (uchar)(255 * i / (f.colors-1));
+      } else if (f.colormap + 3 * i + 2 < gif_size_) {
+	r = gif_[f.colormap + 3 * i];
+	g = gif_[f.colormap + 3 * i + 1];
+	b = gif_[f.colormap + 3 * i + 2];
+      }
+    }
+    if (D < 3) {
+      // the image data was desaturate()'d
+      Pixel[i][0] = (uchar)((31 * r + 61 * g + 8 * b) / 100);
+      Pixel[i][1] = 255;
+    } else {
+      Pixel[i][0] = r;
+      Pixel[i][1] = g;
+      Pixel[i][2] = b;
+      Pixel[i][3] = 255;
+    }
+    Opaque[i] = !f.has_transparent || i != f.transparent_pixel;
+  }
+
+  int Width = f.w, Height = f.h;
+  if (!Width || !Height) return;
+  // Columns and rows of the frame that are inside the image:
+  int Columns = f.x >= w() ? 0 : (f.x + Width > w() ? w() - f.x : Width);
+  int Rows = f.y >= h() ? 0 : (f.y + Height > h() ? h() - f.y : Height);
+  uchar *Image = (uchar *)array + f.y * LD + f.x * D;
 
   int YC = 0, Pass = 0; /* Used to de-interlace the picture */
-  uchar *p = Image;
-  uchar *eol = p+Width;
+  int XC = 0;
+  uchar *q = Image;
 
+  int CodeSize = NEXTBYTE+1;	/* Code size, init from GIF header, increases... */
+  if (CodeSize < 2 || CodeSize > 12) {
+    Fl::error("Fl_GIF_Image: frame %d - bad LZW code size", n);
+    return;
+  }
   int InitCodeSize = CodeSize;
   int ClearCode = (1 << (CodeSize-1));
   int EOFCode = ClearCode + 1;
@@ -266,123 +421,118 @@ Fl_GIF_Image::Fl_GIF_Image(const char *infname) : Fl_Pixmap((char *const*)0) {
 
     if (CurCode == EOFCode) break;
 
-    uchar OutCode[1025]; // temporary array for reversing codes
+    uchar OutCode[4097]; // temporary array for reversing codes
     uchar *tp = OutCode;
-    int i;
     if (CurCode < FreeCode) i = CurCode;
-    else if (CurCode == FreeCode) {*tp++ = (uchar)FinChar; i = OldCode;}
-    else {Fl::error("Fl_GIF_Image: %s - LZW Barf!", infname); break;}
+    else if (CurCode == FreeCode && OldCode != ClearCode) {*tp++ = (uchar)FinChar; i = OldCode;}
+    else {Fl::error("Fl_GIF_Image: frame %d - LZW Barf!", n); break;}
 
-    while (i >= ColorMapSize) {*tp++ = Suffix[i]; i = Prefix[i];}
-    *tp++ = FinChar = i;
+    while (i >= ClearCode && tp < OutCode + sizeof(OutCode) - 1) {*tp++ = Suffix[i]; i = Prefix[i];}
+    if (i >= ClearCode) {Fl::error("Fl_GIF_Image: frame %d - LZW Barf!", n); break;}
+    *tp++ = (uchar)(FinChar = i);
     do {
-      *p++ = *--tp;
-      if (p >= eol) {
-	if (!Interlace) YC++;
-	else switch (Pass) {
-	case 0: YC += 8; if (YC >= Height) {Pass++; YC = 4;} break;
-	case 1: YC += 8; if (YC >= Height) {Pass++; YC = 2;} break;
-	case 2: YC += 4; if (YC >= Height) {Pass++; YC = 1;} break;
-	case 3: YC += 2; break;
+      uchar c = *--tp;
+      if (Opaque[c] && XC < Columns && YC < Rows) memcpy(q, Pixel[c], D);
+      q += D;
+      if (++XC >= Width) {
+	if (!f.interlace) YC++;
+	else {
+	  // passes start at rows 0, 4, 2, 1 and step 8, 8, 4, 2 rows,
+	  // short frames have empty passes
+	  YC += Pass < 2 ? 8 : 8 >> (Pass - 1);
+	  while (YC >= Height && Pass < 3) YC = 4 >> Pass++;
 	}
 	if (YC>=Height) YC=0; /* cheap bug fix when excess data */
-	p = Image + YC*Width;
-	eol = p+Width;
+	q = Image + YC*LD;
+	XC = 0;
       }
     } while (tp > OutCode);
 
-    if (OldCode != ClearCode) {
+    // a full table gets no more codes until the next clear code
+    if (OldCode != ClearCode && FreeCode < 4096) {
       Prefix[FreeCode] = (short)OldCode;
-      Suffix[FreeCode] = FinChar;
+      Suffix[FreeCode] = (uchar)FinChar;
       FreeCode++;
-      if (FreeCode > ReadMask) {
-	if (CodeSize < 12) {
-	  CodeSize++;
-	  ReadMask = (1 << CodeSize) - 1;
-	}
-	else FreeCode--;
+      if (FreeCode > ReadMask && CodeSize < 12) {
+	CodeSize++;
+	ReadMask = (1 << CodeSize) - 1;
       }
     }
     OldCode = CurCode;
   }
+}
 
-  // We are done reading the file, now convert to xpm:
+/**
+ Makes frame \p n the image data, starting at 0 for the first frame.
 
-  // allocate line pointer arrays:
-  w(Width);
-  h(Height);
-  d(1);
-  new_data = new char*[Height+2];
-
-  // transparent pixel must be zero, swap if it isn't:
-  if (has_transparent && transparent_pixel != 0) {
-    // swap transparent pixel with zero
-    p = Image+Width*Height;
-    while (p-- > Image) {
-      if (*p==transparent_pixel) *p = 0;
-      else if (!*p) *p = transparent_pixel;
-    }
-    uchar t;
-    t                        = Red[0];
-    Red[0]                   = Red[transparent_pixel];
-    Red[transparent_pixel]   = t;
-
-    t                        = Green[0];
-    Green[0]                 = Green[transparent_pixel];
-    Green[transparent_pixel] = t;
-
-    t                        = Blue[0];
-    Blue[0]                  = Blue[transparent_pixel];
-    Blue[transparent_pixel]  = t;
-  }
+ Frames are composed one after the other, so going forward from the
+ current frame only decodes the frames in between, going backwards
+ starts over at the first frame. The image must be redrawn afterwards.
 
-  // find out what colors are actually used:
-  uchar used[256]; uchar remap[256];
-  int i;
-  for (i = 0; i < ColorMapSize; i++) used[i] = 0;
-  p = Image+Width*Height;
-  while (p-- > Image) used[*p] = 1;
-
-  // remap them to start with printing characters:
-  int base = has_transparent && used[0] ? ' ' : ' '+1;
-  int numcolors = 0;
-  for (i = 0; i < ColorMapSize; i++) if (used[i]) {
-    remap[i] = (uchar)(base++);
-    numcolors++;
+ \returns 0 on success, -1 if there is no frame \p n
+ \see frames(), next_frame()
+ \version 1.4.0
+ */
+int Fl_GIF_Image::frame(int n) {
+  if (n < 0 || n >= frames_ || !array) return -1;
+  if (n == frame_) return 0;
+  if (n < frame_) {
+    memset((uchar *)array, 0, w() * h() * d());
+    frame_ = 0;
+    draw_frame_(0);
   }
-
-  // write the first line of xpm data (use suffix as temp array):
-  int length = sprintf((char*)(Suffix),
-		       "%d %d %d %d",Width,Height,-numcolors,1);
-  new_data[0] = new char[length+1];
-  strcpy(new_data[0], (char*)Suffix);
-
-  // write the colormap
-  new_data[1] = (char*)(p = new uchar[4*numcolors]);
-  for (i = 0; i < ColorMapSize; i++) if (used[i]) {
-    *p++ = remap[i];
-    *p++ = Red[i];
-    *p++ = Green[i];
-    *p++ = Blue[i];
+  while (frame_ < n) {
+    dispose_frame_(frame_);
+    draw_frame_(++frame_);
   }
+  uncache();
+  return 0;
+}
 
-  // remap the image data:
-  p = Image+Width*Height;
-  while (p-- > Image) *p = remap[*p];
-
-  // split the image data into lines:
-  for (i=0; i<Height; i++) {
-    new_data[i+2] = new char[Width+1];
-    memcpy(new_data[i + 2], (char*)(Image + i*Width), Width);
-    new_data[i + 2][Width] = 0;
-  }
+/**
+ Makes the next frame the image data, or the first frame after the last one.
+
+ An animation can be played by calling this from a timeout, with the
+ delay() of the new frame as the time until the next call:
+ \code
+ static void animate(void *data) {
+   Fl_Box *box = (Fl_Box *)data;
+   Fl_GIF_Image *gif = (Fl_GIF_Image *)box->image();
+   gif->next_frame();
+   box->redraw();
+   Fl::repeat_timeout(gif->delay(gif->frame()), animate, data);
+ }
+ \endcode
+
+ \returns the index of the new frame
+ \version 1.4.0
+ */
+int Fl_GIF_Image::next_frame() {
+  frame(frame_ + 1 < frames_ ? frame_ + 1 : 0);
+  return frame_;
+}
 
-  data((const char **)new_data, Height + 2);
-  alloc_data = 1;
+/**
+ Returns how long frame \p n should be displayed, in seconds.
 
-  delete[] Image;
+ Many GIF files use 0 for frames that should be displayed for a short
+ time; browsers usually display those for 0.1 seconds.
+ \version 1.4.0
+ */
+double Fl_GIF_Image::delay(int n) const {
+  if (n < 0 || n >= frames_) return 0.0;
+  return frame_info_[n].delay / 100.0;
+}
 
-  fclose(GifFile);
+/**
+ Returns how the area of frame \p n is restored before the next frame
+ is drawn: DISPOSE_UNSPECIFIED, DISPOSE_NONE, DISPOSE_BACKGROUND, or
+ DISPOSE_PREVIOUS.
+ \version 1.4.0
+ */
+int Fl_GIF_Image::disposal(int n) const {
+  if (n < 0 || n >= frames_) return DISPOSE_UNSPECIFIED;
+  return frame_info_[n].disposal;
 }
 
 
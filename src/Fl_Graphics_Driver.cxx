@@ -68,6 +68,28 @@ void Fl_Graphics_Driver::focus_rect(int x, int y, int w, int h)
   line_style(FL_SOLID);
 }
 
+// Blends the pixels read back from the surface, drivers that can blend
+// on their own do better
+void Fl_Graphics_Driver::rectf_alpha(int x, int y, int w, int h, uchar alpha)
+{
+  if (alpha == 0 || w <= 0 || h <= 0) return;
+  uchar *buf = alpha < 255 ? fl_read_image(NULL, x, y, w, h) : NULL;
+  if (!buf) {
+    rectf(x, y, w, h);
+    return;
+  }
+  uchar r, g, b;
+  Fl::get_color(color(), r, g, b);
+  unsigned a = alpha, na = 255 - alpha;
+  for (uchar *q = buf, *e = buf + 3 * w * h; q < e; q += 3) {
+    q[0] = (q[0] * na + r * a + 127) / 255;
+    q[1] = (q[1] * na + g * a + 127) / 255;
+    q[2] = (q[2] * na + b * a + 127) / 255;
+  }
+  draw_image(buf, x, y, w, h, 3);
+  delete[] buf;
+}
+
 /** Draws an Fl_Image scaled to width \p W & height \p H with top-left corner at \em X,Y
  \return zero when the graphics driver doesn't implement scaled drawing, non-zero if it does implement it.
  */
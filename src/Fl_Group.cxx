@@ -26,10 +26,367 @@
 #include <FL/Fl_Group.H>
 #include <FL/Fl_Window.H>
 #include <FL/fl_draw.H>
+#include <FL/Fl_Device.H>
 #include <stdlib.h>
+#include <string.h>
 
 Fl_Group* Fl_Group::current_;
 
+////////////////////////////////////////////////////////////////
+// The spatial index of a group's children, see Fl_Group::spatial_index().
+//
+// A uniform grid of square cells: each cell lists the children that
+// overlap it. Only cells with children are kept, in a hash table. A child
+// that would be in too many cells, a subwindow (moved by the system) and
+// a child without area are kept in a list of 'large' children instead,
+// which every search returns.
+//
+// The children are also kept in a hash table by address, with their index
+// in the group and the cells they are in, so that they can be taken out
+// of those cells when they are moved or removed. Searches check the index
+// of each child they find against the group's array, so a group that
+// reorders its array by other means only makes the index rebuild itself.
+
+#define INDEX_LARGE_CELLS 64	// a child in more cells than this is 'large'
+
+struct Fl_Group_Index_Entry {	// a child of the group
+  Fl_Widget *w;			// NULL if this slot of the table is free
+  int i;			// index of the child in the group
+  int x0, y0, x1, y1;		// cells the child is in, x1 < x0 if 'large'
+};
+
+struct Fl_Group_Index_Cell {
+  int cx, cy;			// position of the cell, in cells
+  int n, size;			// children in the cell, and size of v (0 if this slot is free)
+  Fl_Widget **v;
+};
+
+// A list of indexes of children, without allocation for a few of them
+struct Fl_Group_Index_List {
+  int *v, n, size;
+  int fixed[64];
+  Fl_Group_Index_List() : v(fixed), n(0), size(64) {}
+  ~Fl_Group_Index_List() { if (v != fixed) free(v); }
+  void add(int i) {
+    if (n == size) {
+      size *= 2;
+      if (v == fixed) {
+	v = (int*)malloc(size * sizeof(int));
+	memcpy(v, fixed, sizeof(fixed));
+      } else {
+	v = (int*)realloc(v, size * sizeof(int));
+      }
+    }
+    v[n++] = i;
+  }
+};
+
+class Fl_Group_Index {
+  Fl_Group *group_;
+  int cell_;				// size of a cell in pixels
+  int dirty_;				// rebuild before the next search
+  Fl_Group_Index_Entry *entries_;	// hash table of the children
+  int nentries_, entries_size_;
+  Fl_Group_Index_Cell *cells_;		// hash table of the cells
+  int ncells_, cells_size_;
+  Fl_Widget **large_;			// children that are in no cell
+  int nlarge_, large_size_;
+
+  static unsigned hash(const Fl_Widget *w) {
+    fl_uintptr_t p = (fl_uintptr_t)w;
+    return (unsigned)(p ^ (p >> 16)) * 2654435761U;
+  }
+  static unsigned hash(int cx, int cy) {
+    return (unsigned)cx * 73856093U ^ (unsigned)cy * 19349663U;
+  }
+  // the cell of a coordinate, rounding down
+  int cell_of(int v) const { return v >= 0 ? v / cell_ : -((-v - 1) / cell_) - 1; }
+
+  Fl_Group_Index_Entry *find_entry(const Fl_Widget *w) const;
+  void erase_entry(Fl_Group_Index_Entry *e);
+  void grow_entries();
+  Fl_Group_Index_Cell *find_cell(int cx, int cy, int create);
+  void cells_of(const Fl_Widget *w, int &x0, int &y0, int &x1, int &y1) const;
+  void place(Fl_Group_Index_Entry *e);
+  void unplace(Fl_Group_Index_Entry *e);
+  void add(Fl_Widget *w, int i);
+  void renumber(int from, int d);
+  void clear();
+  void rebuild();
+public:
+  Fl_Group_Index(Fl_Group *g, int cell);
+  ~Fl_Group_Index();
+  int cell() const { return cell_; }
+  void invalidate() { dirty_ = 1; }
+  void inserted(Fl_Widget *w, int i);
+  void removed(Fl_Widget *w, int i);
+  void moved(Fl_Widget *w);
+  int search(int X, int Y, int W, int H, Fl_Group_Index_List &list);
+};
+
+Fl_Group_Index::Fl_Group_Index(Fl_Group *g, int cell) {
+  group_ = g;
+  cell_ = cell;
+  dirty_ = 1;
+  entries_ = 0; nentries_ = entries_size_ = 0;
+  cells_ = 0; ncells_ = cells_size_ = 0;
+  large_ = 0; nlarge_ = large_size_ = 0;
+}
+
+Fl_Group_Index::~Fl_Group_Index() {
+  clear();
+  free(entries_);
+  free(cells_);
+  free(large_);
+}
+
+// Returns the slot of the table with child 'w', or the free slot where it would go
+Fl_Group_Index_Entry *Fl_Group_Index::find_entry(const Fl_Widget *w) const {
+  unsigned mask = entries_size_ - 1;
+  unsigned h = hash(w) & mask;
+  while (entries_[h].w && entries_[h].w != w) h = (h + 1) & mask;
+  return entries_ + h;
+}
+
+// Frees a slot of the table, moving back the entries that follow it
+void Fl_Group_Index::erase_entry(Fl_Group_Index_Entry *e) {
+  unsigned mask = entries_size_ - 1;
+  unsigned i = (unsigned)(e - entries_), j = i;
+  for (;;) {
+    j = (j + 1) & mask;
+    if (!entries_[j].w) break;
+    unsigned k = hash(entries_[j].w) & mask;	// where entry j would like to be
+    if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+    entries_[i] = entries_[j];
+    i = j;
+  }
+  entries_[i].w = 0;
+  nentries_--;
+}
+
+// Doubles the size of the table of children
+void Fl_Group_Index::grow_entries() {
+  Fl_Group_Index_Entry *old = entries_;
+  int n = entries_size_;
+  entries_size_ = n ? 2 * n : 64;
+  entries_ = (Fl_Group_Index_Entry*)calloc(entries_size_, sizeof(Fl_Group_Index_Entry));
+  for (int t = 0; t < n; t++)
+    if (old[t].w) *find_entry(old[t].w) = old[t];
+  free(old);
+}
+
+// Returns cell cx,cy, creating it if 'create' is set, or NULL
+Fl_Group_Index_Cell *Fl_Group_Index::find_cell(int cx, int cy, int create) {
+  if (!cells_size_) {
+    if (!create) return 0;
+    cells_size_ = 64;
+    cells_ = (Fl_Group_Index_Cell*)calloc(cells_size_, sizeof(Fl_Group_Index_Cell));
+  }
+  unsigned mask = cells_size_ - 1;
+  unsigned h = hash(cx, cy) & mask;
+  for (; cells_[h].size; h = (h + 1) & mask)
+    if (cells_[h].cx == cx && cells_[h].cy == cy) return cells_ + h;
+  if (!create) return 0;
+  if (2 * (ncells_ + 1) > cells_size_) {	// keep the table half empty
+    Fl_Group_Index_Cell *old = cells_;
+    int n = cells_size_;
+    cells_size_ = 2 * n;
+    cells_ = (Fl_Group_Index_Cell*)calloc(cells_size_, sizeof(Fl_Group_Index_Cell));
+    mask = cells_size_ - 1;
+    for (int t = 0; t < n; t++) {
+      if (!old[t].size) continue;
+      for (h = hash(old[t].cx, old[t].cy) & mask; cells_[h].size; h = (h + 1) & mask) {}
+      cells_[h] = old[t];
+    }
+    free(old);
+    for (h = hash(cx, cy) & mask; cells_[h].size; h = (h + 1) & mask) {}
+  }
+  // Cells are never removed, even when empty: rebuild now and then if
+  // children moved around a lot and left many of them behind
+  if (ncells_ > 8 * nentries_ + 1024) dirty_ = 1;
+  Fl_Group_Index_Cell *c = cells_ + h;
+  c->cx = cx; c->cy = cy;
+  c->n = 0; c->size = 4;
+  c->v = (Fl_Widget**)malloc(c->size * sizeof(Fl_Widget*));
+  ncells_++;
+  return c;
+}
+
+// Gets the cells that child 'w' is in, x1 < x0 if it is 'large'
+void Fl_Group_Index::cells_of(const Fl_Widget *w, int &x0, int &y0, int &x1, int &y1) const {
+  x0 = 1; x1 = 0; y0 = y1 = 0;
+  if (w->type() >= FL_WINDOW || w->w() <= 0 || w->h() <= 0) return;
+  int cx0 = cell_of(w->x()), cx1 = cell_of(w->x() + w->w() - 1);
+  int cy0 = cell_of(w->y()), cy1 = cell_of(w->y() + w->h() - 1);
+  if ((double)(cx1 - cx0 + 1) * (cy1 - cy0 + 1) > INDEX_LARGE_CELLS) return;
+  x0 = cx0; x1 = cx1; y0 = cy0; y1 = cy1;
+}
+
+// Adds child 'e' to the cells it is in
+void Fl_Group_Index::place(Fl_Group_Index_Entry *e) {
+  Fl_Widget *w = e->w;
+  if (e->x1 < e->x0) {
+    if (nlarge_ == large_size_) {
+      large_size_ = large_size_ ? 2 * large_size_ : 16;
+      large_ = (Fl_Widget**)realloc(large_, large_size_ * sizeof(Fl_Widget*));
+    }
+    large_[nlarge_++] = w;
+    return;
+  }
+  for (int cy = e->y0; cy <= e->y1; cy++)
+    for (int cx = e->x0; cx <= e->x1; cx++) {
+      Fl_Group_Index_Cell *c = find_cell(cx, cy, 1);
+      if (c->n == c->size) {
+	c->size *= 2;
+	c->v = (Fl_Widget**)realloc(c->v, c->size * sizeof(Fl_Widget*));
+      }
+      c->v[c->n++] = w;
+    }
+}
+
+// Removes child 'e' from the cells it is in
+void Fl_Group_Index::unplace(Fl_Group_Index_Entry *e) {
+  Fl_Widget *w = e->w;
+  if (e->x1 < e->x0) {
+    for (int t = 0; t < nlarge_; t++)
+      if (large_[t] == w) { large_[t] = large_[--nlarge_]; break; }
+    return;
+  }
+  for (int cy = e->y0; cy <= e->y1; cy++)
+    for (int cx = e->x0; cx <= e->x1; cx++) {
+      Fl_Group_Index_Cell *c = find_cell(cx, cy, 0);
+      if (!c) continue;
+      for (int t = 0; t < c->n; t++)
+	if (c->v[t] == w) { c->v[t] = c->v[--c->n]; break; }
+    }
+}
+
+// Adds child 'w' at index 'i'
+void Fl_Group_Index::add(Fl_Widget *w, int i) {
+  if (2 * (nentries_ + 1) > entries_size_) grow_entries();
+  Fl_Group_Index_Entry *e = find_entry(w);
+  if (e->w) unplace(e);			// already there? should not happen
+  else nentries_++;
+  e->w = w;
+  e->i = i;
+  cells_of(w, e->x0, e->y0, e->x1, e->y1);
+  place(e);
+}
+
+// Adds 'd' to the index of the children from index 'from' on
+void Fl_Group_Index::renumber(int from, int d) {
+  for (int t = 0; t < entries_size_; t++)
+    if (entries_[t].w && entries_[t].i >= from) entries_[t].i += d;
+}
+
+void Fl_Group_Index::clear() {
+  for (int t = 0; t < cells_size_; t++) free(cells_[t].v);
+  if (cells_) memset(cells_, 0, cells_size_ * sizeof(Fl_Group_Index_Cell));
+  if (entries_) memset(entries_, 0, entries_size_ * sizeof(Fl_Group_Index_Entry));
+  ncells_ = nentries_ = nlarge_ = 0;
+}
+
+void Fl_Group_Index::rebuild() {
+  clear();
+  Fl_Widget*const* a = group_->array();
+  for (int i = 0; i < group_->children(); i++) add(a[i], i);
+  // find_cell() compares the cells with the children added so far, and
+  // may have asked for another rebuild: every cell is used now
+  dirty_ = 0;
+}
+
+// Called after child 'w' was inserted at index 'i'
+void Fl_Group_Index::inserted(Fl_Widget *w, int i) {
+  if (dirty_) return;
+  if (i < group_->children() - 1) renumber(i, 1);
+  add(w, i);
+}
+
+// Called before child 'w' at index 'i' is removed
+void Fl_Group_Index::removed(Fl_Widget *w, int i) {
+  if (dirty_) return;
+  Fl_Group_Index_Entry *e = find_entry(w);
+  if (!e->w) { dirty_ = 1; return; }
+  unplace(e);
+  erase_entry(e);
+  if (i < group_->children() - 1) renumber(i + 1, -1);
+}
+
+// Called after child 'w' was moved or resized
+void Fl_Group_Index::moved(Fl_Widget *w) {
+  if (dirty_) return;
+  Fl_Group_Index_Entry *e = find_entry(w);
+  if (!e->w) { dirty_ = 1; return; }
+  int x0, y0, x1, y1;
+  cells_of(w, x0, y0, x1, y1);
+  if (x0 == e->x0 && y0 == e->y0 && x1 == e->x1 && y1 == e->y1) return;
+  unplace(e);
+  e->x0 = x0; e->y0 = y0; e->x1 = x1; e->y1 = y1;
+  place(e);
+}
+
+static int compare_ints(const void *a, const void *b) {
+  int i = *(const int*)a, j = *(const int*)b;
+  return i < j ? -1 : i > j;
+}
+
+// Gets the index of the children that may overlap area X,Y,W,H, in the
+// order of the group. Returns 0 if the area has more cells than there
+// are children, then all the children are better looked at.
+int Fl_Group_Index::search(int X, int Y, int W, int H, Fl_Group_Index_List &list) {
+  if (dirty_) rebuild();
+  list.n = 0;
+  if (W <= 0 || H <= 0) return 1;
+  int cx0 = cell_of(X), cx1 = cell_of(X + W - 1);
+  int cy0 = cell_of(Y), cy1 = cell_of(Y + H - 1);
+  if ((double)(cx1 - cx0 + 1) * (cy1 - cy0 + 1) > nentries_ + 16) return 0;
+  Fl_Widget*const* a = group_->array();
+  for (int pass = 0; pass < 2; pass++) {
+    for (int cy = cy0; cy <= cy1; cy++)
+      for (int cx = cx0; cx <= cx1; cx++) {
+	Fl_Group_Index_Cell *c = find_cell(cx, cy, 0);
+	if (c) for (int t = 0; t < c->n; t++) list.add(find_entry(c->v[t])->i);
+      }
+    for (int t = 0; t < nlarge_; t++) list.add(find_entry(large_[t])->i);
+    int ok = 1;				// does the group agree with the index?
+    for (int t = 0; t < list.n && ok; t++)
+      ok = list.v[t] >= 0 && list.v[t] < group_->children() &&
+           find_entry(a[list.v[t]])->w == a[list.v[t]] &&
+           find_entry(a[list.v[t]])->i == list.v[t];
+    if (ok) break;
+    list.n = 0;				// no: it was changed behind our back
+    rebuild();
+  }
+  qsort(list.v, list.n, sizeof(int), compare_ints);
+  int n = 0;				// remove duplicates
+  for (int t = 0; t < list.n; t++)
+    if (!n || list.v[t] != list.v[n - 1]) list.v[n++] = list.v[t];
+  list.n = n;
+  return 1;
+}
+
+// Iterates over the index of the children of a group that may overlap an
+// area, or over all of them without a spatial index, in the order of the
+// group or in reverse order
+class Fl_Group_Child_Iterator {
+  Fl_Group_Index_List list_;
+  int all_, reverse_, n_, k_;
+public:
+  Fl_Group_Child_Iterator(Fl_Group_Index *index, int children,
+                          int X, int Y, int W, int H, int reverse) {
+    all_ = !index || !index->search(X, Y, W, H, list_);
+    reverse_ = reverse;
+    n_ = all_ ? children : list_.n;
+    k_ = reverse ? n_ : -1;
+  }
+  // Returns the index of the next child, or -1 at the end
+  int next() {
+    if (reverse_) { if (k_ <= 0) return -1; k_--; }
+    else { if (k_ + 1 >= n_) return -1; k_++; }
+    return all_ ? k_ : list_.v[k_];
+  }
+};
+
 // Hack: A single child is stored in the pointer to the array, while
 // multiple children are stored in an allocated array:
 
@@ -170,8 +527,9 @@ int Fl_Group::handle(int event) {
   case FL_KEYBOARD:
     return navigation(navkey());
 
-  case FL_SHORTCUT:
-    for (i = children(); i--;) {
+  case FL_SHORTCUT: {
+    Fl_Group_Child_Iterator c(index_, children(), Fl::event_x(), Fl::event_y(), 1, 1, 1);
+    while ((i = c.next()) >= 0) {
       o = a[i];
       if (o->takesevents() && Fl::event_inside(o) && send(o,FL_SHORTCUT))
 	return 1;
@@ -183,10 +541,12 @@ int Fl_Group::handle(int event) {
     }
     if ((Fl::event_key() == FL_Enter || Fl::event_key() == FL_KP_Enter)) return navigation(FL_Down);
     return 0;
+    }
 
   case FL_ENTER:
-  case FL_MOVE:
-    for (i = children(); i--;) {
+  case FL_MOVE: {
+    Fl_Group_Child_Iterator c(index_, children(), Fl::event_x(), Fl::event_y(), 1, 1, 1);
+    while ((i = c.next()) >= 0) {
       o = a[i];
       if (o->visible() && Fl::event_inside(o)) {
 	if (o->contains(Fl::belowmouse())) {
@@ -199,10 +559,12 @@ int Fl_Group::handle(int event) {
     }
     Fl::belowmouse(this);
     return 1;
+    }
 
   case FL_DND_ENTER:
-  case FL_DND_DRAG:
-    for (i = children(); i--;) {
+  case FL_DND_DRAG: {
+    Fl_Group_Child_Iterator c(index_, children(), Fl::event_x(), Fl::event_y(), 1, 1, 1);
+    while ((i = c.next()) >= 0) {
       o = a[i];
       if (o->takesevents() && Fl::event_inside(o)) {
 	if (o->contains(Fl::belowmouse())) {
@@ -215,9 +577,11 @@ int Fl_Group::handle(int event) {
     }
     Fl::belowmouse(this);
     return 0;
+    }
 
-  case FL_PUSH:
-    for (i = children(); i--;) {
+  case FL_PUSH: {
+    Fl_Group_Child_Iterator c(index_, children(), Fl::event_x(), Fl::event_y(), 1, 1, 1);
+    while ((i = c.next()) >= 0) {
       o = a[i];
       if (o->takesevents() && Fl::event_inside(o)) {
 	Fl_Widget_Tracker wp(o);
@@ -228,6 +592,7 @@ int Fl_Group::handle(int event) {
       }
     }
     return 0;
+    }
 
   case FL_RELEASE:
   case FL_DRAG:
@@ -235,7 +600,8 @@ int Fl_Group::handle(int event) {
     if (o == this) return 0;
     else if (o) send(o,event);
     else {
-      for (i = children(); i--;) {
+      Fl_Group_Child_Iterator c(index_, children(), Fl::event_x(), Fl::event_y(), 1, 1, 1);
+      while ((i = c.next()) >= 0) {
 	o = a[i];
 	if (o->takesevents() && Fl::event_inside(o)) {
 	  if (send(o,event)) return 1;
@@ -244,8 +610,9 @@ int Fl_Group::handle(int event) {
     }
     return 0;
 
-  case FL_MOUSEWHEEL:
-    for (i = children(); i--;) {
+  case FL_MOUSEWHEEL: {
+    Fl_Group_Child_Iterator c(index_, children(), Fl::event_x(), Fl::event_y(), 1, 1, 1);
+    while ((i = c.next()) >= 0) {
       o = a[i];
       if (o->takesevents() && Fl::event_inside(o) && send(o,FL_MOUSEWHEEL))
 	return 1;
@@ -256,6 +623,7 @@ int Fl_Group::handle(int event) {
 	return 1;
     }
     return 0;
+    }
 
   case FL_DEACTIVATE:
   case FL_ACTIVATE:
@@ -365,6 +733,7 @@ Fl_Group::Fl_Group(int X,int Y,int W,int H,const char *l)
   resizable_ = this;
   bounds_ = 0; // this is allocated when first resize() is done
   sizes_ = 0; // see bounds_ (FLTK 1.3 compatibility)
+  index_ = 0; // see spatial_index()
 
   // Subclasses may want to construct child objects as part of their
   // constructor, so make sure they are add()'d to this object.
@@ -388,6 +757,7 @@ void Fl_Group::clear() {
   savedfocus_ = 0;
   resizable_ = this;
   init_sizes();
+  if (index_) index_->invalidate();
 
   // we must change the Fl::pushed() widget, if it is one of
   // the group's children. Otherwise fl_fix_focus() would send lots
@@ -450,6 +820,7 @@ void Fl_Group::clear() {
 */
 Fl_Group::~Fl_Group() {
   clear();
+  delete index_;
 }
 
 /**
@@ -484,6 +855,7 @@ void Fl_Group::insert(Fl_Widget &o, int index) {
     array_[j] = &o;
   }
   children_++;
+  if (index_) index_->inserted(&o, index < children_ ? index : children_-1);
   init_sizes();
 }
 
@@ -507,6 +879,7 @@ void Fl_Group::remove(int index) {
   if (index < 0 || index >= children_) return;
   Fl_Widget &o = *child(index);
   if (&o == savedfocus_) savedfocus_ = 0;
+  if (index_) index_->removed(&o, index);
   if (o.parent_ == this) {	// this should always be true
     o.parent_ = 0;
   }
@@ -543,6 +916,57 @@ void Fl_Group::remove(Fl_Widget &o) {
   if (i < children_) remove(i);
 }
 
+/**
+  Keeps an index of where the children are, to find them quickly.
+
+  Normally the group looks at all its children to find the one under the
+  mouse, on every mouse move, click or drag, and when it draws them. That
+  is fine for a few hundred children, but groups with many thousands of
+  children, e.g. the canvas of an editor with one widget per item, get
+  slow at it.
+
+  With a spatial index, the group divides the plane in square cells of
+  \p cell_size pixels, and remembers which children overlap each cell.
+  Pointer events then only look at the children in the cell under the
+  mouse, and draw_children() only at the children in the cells of the
+  area being drawn, e.g. the damaged part of the window. The children
+  are still tried and drawn in the same order as without an index.
+
+  A good cell size is about the size of a typical child. Children much
+  larger than the cells, subwindows and children without area are looked
+  at every time, as without an index.
+
+  The index is updated when children are added, removed or resized
+  (moved), but it only knows what Fl_Widget::resize() is told: a child
+  that changes its position by other means must call it. Outside labels
+  of the children are only drawn with the children they belong to, so
+  with an index a label outside of a child is not drawn when the area
+  being drawn contains the label but not the child.
+
+  \param[in] cell_size size of the cells in pixels, or 0 to remove the index
+
+  \see spatial_index() const
+  \version 1.4.0
+*/
+void Fl_Group::spatial_index(int cell_size) {
+  delete index_;
+  index_ = cell_size > 0 ? new Fl_Group_Index(this, cell_size) : 0;
+}
+
+/**
+  Returns the cell size of the spatial index, or 0 if the group has none.
+  \see spatial_index(int)
+  \version 1.4.0
+*/
+int Fl_Group::spatial_index() const {
+  return index_ ? index_->cell() : 0;
+}
+
+// Called by Fl_Widget::resize() for the children of a group with an index
+void Fl_Group::index_moved(Fl_Widget *o) {
+  index_->moved(o);
+}
+
 /**
   Resets the internal array of widget sizes and positions.
 
@@ -778,19 +1202,35 @@ void Fl_Group::draw_children() {
 		 h() - Fl::box_dh(box()));
   }
 
+  // with a spatial index, only look at the children in the drawn area:
+  int X = 0, Y = 0, W = 0, H = 0;
+  Fl_Group_Index *index = (index_ && drawn_area(X, Y, W, H)) ? index_ : 0;
+  Fl_Group_Child_Iterator c(index, children_, X, Y, W, H, 0);
+  int i;
   if (damage() & ~FL_DAMAGE_CHILD) { // redraw the entire thing:
-    for (int i=children_; i--;) {
-      Fl_Widget& o = **a++;
+    while ((i = c.next()) >= 0) {
+      Fl_Widget& o = *a[i];
       draw_child(o);
       draw_outside_label(o);
     }
   } else {	// only redraw the children that need it:
-    for (int i=children_; i--;) update_child(**a++);
+    while ((i = c.next()) >= 0) update_child(*a[i]);
   }
 
   if (clip_children()) fl_pop_clip();
 }
 
+// Gets the bounding box of the area that drawing can change now, in the
+// coordinates of the children, or returns 0 if it is not known
+int Fl_Group::drawn_area(int &X, int &Y, int &W, int &H) {
+  Fl_Window *win = as_window() ? as_window() : window();
+  if (!win) return 0;
+  // On the display nothing is drawn outside of the window, but other
+  // surfaces may be larger: there, only an actual clip can be trusted
+  int clipped = fl_clip_box(0, 0, win->w(), win->h(), X, Y, W, H);
+  return clipped || Fl_Surface_Device::surface() == Fl_Display_Device::display_device();
+}
+
 void Fl_Group::draw() {
   if (damage() & ~FL_DAMAGE_CHILD) { // redraw the entire thing:
     draw_box();
@@ -26,12 +26,15 @@
 #include "flstring.h"
 
 void fl_restore_clip(); // from fl_rect.cxx
+void fl_scale_rgb(const uchar *src, int w, int h, int d, int ld, uchar *dst,
+                  int W, int H, Fl_RGB_Scaling method, int threads); // from fl_rgb_scaling.cxx
 
 //
 // Base image class...
 //
 
 Fl_RGB_Scaling Fl_Image::RGB_scaling_ = FL_RGB_SCALING_NEAREST;
+int Fl_Image::RGB_scaling_threads_ = 1;
 
 
 /**
@@ -223,6 +226,24 @@ Fl_RGB_Scaling Fl_Image::RGB_scaling() {
   return RGB_scaling_;
 }
 
+/** Sets the number of threads used by copy(int, int) to scale RGB images.
+    Large images are divided into bands of rows that are scaled in
+    parallel. The default is 1, which scales images in the calling thread
+    only. Has no effect on FL_RGB_SCALING_NEAREST, or on platforms without
+    POSIX threads.
+    \version 1.4.0
+*/
+void Fl_Image::RGB_scaling_threads(int n) {
+  RGB_scaling_threads_ = n < 1 ? 1 : n;
+}
+
+/** Returns the number of threads used to scale RGB images.
+    \version 1.4.0
+*/
+int Fl_Image::RGB_scaling_threads() {
+  return RGB_scaling_threads_;
+}
+
 
 //
 // RGB image class...
@@ -353,116 +374,12 @@ Fl_Image *Fl_RGB_Image::copy(int W, int H) {
   if (W <= 0 || H <= 0) return 0;
 
   // OK, need to resize the image data; allocate memory and create new image
-  uchar		*new_ptr;	// Pointer into new array
-  const uchar	*old_ptr;	// Pointer into old array
-  int		dx, dy,		// Destination coordinates
-		line_d;		// stride from line to line
-
-  // Allocate memory for the new image...
   new_array = new uchar [W * H * d()];
   new_image = new Fl_RGB_Image(new_array, W, H, d());
   new_image->alloc_array = 1;
 
-  line_d = ld() ? ld() : w() * d();
-
-  if (Fl_Image::RGB_scaling() == FL_RGB_SCALING_NEAREST) {
-
-    int		c,		// Channel number
-		sy,		// Source coordinate
-		xerr, yerr,	// X & Y errors
-		xmod, ymod,	// X & Y moduli
-		xstep, ystep;	// X & Y step increments
-
-    // Figure out Bresenham step/modulus values...
-    xmod   = w() % W;
-    xstep  = (w() / W) * d();
-    ymod   = h() % H;
-    ystep  = h() / H;
-
-    // Scale the image using a nearest-neighbor algorithm...
-    for (dy = H, sy = 0, yerr = H, new_ptr = new_array; dy > 0; dy --) {
-      for (dx = W, xerr = W, old_ptr = array + sy * line_d; dx > 0; dx --) {
-        for (c = 0; c < d(); c ++) *new_ptr++ = old_ptr[c];
-
-        old_ptr += xstep;
-        xerr    -= xmod;
-
-        if (xerr <= 0) {
-          xerr    += W;
-	  old_ptr += d();
-        }
-      }
-
-      sy   += ystep;
-      yerr -= ymod;
-      if (yerr <= 0) {
-        yerr += H;
-        sy ++;
-      }
-    }
-  } else {
-    // Bilinear scaling (FL_RGB_SCALING_BILINEAR)
-    const float xscale = (w() - 1) / (float) W;
-    const float yscale = (h() - 1) / (float) H;
-    for (dy = 0; dy < H; dy++) {
-      float oldy = dy * yscale;
-      if (oldy >= h())
-        oldy = float(h() - 1);
-      const float yfract = oldy - (unsigned) oldy;
-
-      for (dx = 0; dx < W; dx++) {
-        new_ptr = new_array + dy * W * d() + dx * d();
-
-        float oldx = dx * xscale;
-        if (oldx >= w())
-          oldx = float(w() - 1);
-        const float xfract = oldx - (unsigned) oldx;
-
-        const unsigned leftx = (unsigned)oldx;
-        const unsigned lefty = (unsigned)oldy;
-        const unsigned rightx = (unsigned)(oldx + 1 >= w() ? oldx : oldx + 1);
-        const unsigned righty = (unsigned)oldy;
-        const unsigned dleftx = (unsigned)oldx;
-        const unsigned dlefty = (unsigned)(oldy + 1 >= h() ? oldy : oldy + 1);
-        const unsigned drightx = (unsigned)rightx;
-        const unsigned drighty = (unsigned)dlefty;
-
-        uchar left[4], right[4], downleft[4], downright[4];
-        memcpy(left, array + lefty * line_d + leftx * d(), d());
-        memcpy(right, array + righty * line_d + rightx * d(), d());
-        memcpy(downleft, array + dlefty * line_d + dleftx * d(), d());
-        memcpy(downright, array + drighty * line_d + drightx * d(), d());
-
-        int i;
-        if (d() == 4) {
-          for (i = 0; i < 3; i++) {
-            left[i] = (uchar)(left[i] * left[3] / 255.0f);
-            right[i] = (uchar)(right[i] * right[3] / 255.0f);
-            downleft[i] = (uchar)(downleft[i] * downleft[3] / 255.0f);
-            downright[i] = (uchar)(downright[i] * downright[3] / 255.0f);
-          }
-        }
-
-	const float leftf = 1 - xfract;
-	const float rightf = xfract;
-	const float upf = 1 - yfract;
-	const float downf = yfract;
-
-        for (i = 0; i < d(); i++) {
-          new_ptr[i] = (uchar)((left[i] * leftf +
-                   right[i] * rightf) * upf +
-                   (downleft[i] * leftf +
-                   downright[i] * rightf) * downf);
-        }
-
-        if (d() == 4 && new_ptr[3]) {
-          for (i = 0; i < 3; i++) {
-            new_ptr[i] = (uchar)(new_ptr[i] / (new_ptr[3] / 255.0f));
-          }
-        }
-      }
-    }
-  }
+  fl_scale_rgb(array, w(), h(), d(), ld() ? ld() : w() * d(), new_array, W, H,
+               Fl_Image::RGB_scaling(), Fl_Image::RGB_scaling_threads());
 
   return new_image;
 }
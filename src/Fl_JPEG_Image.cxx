@@ -19,6 +19,8 @@
 // Contents:
 //
 //   Fl_JPEG_Image::Fl_JPEG_Image() - Load a JPEG image file.
+//   Fl_JPEG_Image::load_jpg_()     - Decode a JPEG image file or memory.
+//   Fl_JPEG_Image::add_data()      - Decode JPEG data incrementally.
 //
 
 //
@@ -32,6 +34,8 @@
 #include <config.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <setjmp.h>
 
 
@@ -97,105 +101,32 @@ extern "C" {
  \param[in] filename a full path and name pointing to a valid jpeg file.
  */
 Fl_JPEG_Image::Fl_JPEG_Image(const char *filename)	// I - File to load
-: Fl_RGB_Image(0,0,0) {
-#ifdef HAVE_LIBJPEG
-  FILE				*fp;	// File pointer
-  jpeg_decompress_struct	dinfo;	// Decompressor info
-  fl_jpeg_error_mgr		jerr;	// Error handler info
-  JSAMPROW			row;	// Sample row pointer
-  
-  // the following variables are pointers allocating some private space that
-  // is not reset by 'setjmp()'
-  char* max_finish_decompress_err;      // count errors and give up afer a while
-  char* max_destroy_decompress_err;     // to avoid recusion and deadlock
-  
-  // Clear data...
-  alloc_array = 0;
-  array = (uchar *)0;
-  
-  // Open the image file...
-  if ((fp = fl_fopen(filename, "rb")) == NULL) {
-    ld(ERR_FILE_ACCESS);
-    return;
-  }
-  
-  // Setup the decompressor info and read the header...
-  dinfo.err                = jpeg_std_error((jpeg_error_mgr *)&jerr);
-  jerr.pub_.error_exit     = fl_jpeg_error_handler;
-  jerr.pub_.output_message = fl_jpeg_output_handler;
-  
-  // Setup error loop variables
-  max_finish_decompress_err = (char*)malloc(1);   // allocate space on the frame for error counters
-  max_destroy_decompress_err = (char*)malloc(1);  // otherwise, the variables are reset on the longjmp
-  *max_finish_decompress_err=10;
-  *max_destroy_decompress_err=10;
-  
-  if (setjmp(jerr.errhand_))
-  {
-    // JPEG error handling...
-    Fl::warning("JPEG file \"%s\" is too large or contains errors!\n", filename);
-    // if any of the cleanup routines hits another error, we would end up 
-    // in a loop. So instead, we decrement max_err for some upper cleanup limit.
-    if ( ((*max_finish_decompress_err)-- > 0) && array)
-      jpeg_finish_decompress(&dinfo);
-    if ( (*max_destroy_decompress_err)-- > 0)
-      jpeg_destroy_decompress(&dinfo);
-    
-    fclose(fp);
-    
-    w(0);
-    h(0);
-    d(0);
-    
-    if (array) {
-      delete[] (uchar *)array;
-      array = 0;
-      alloc_array = 0;
-    }
-    
-    free(max_destroy_decompress_err);
-    free(max_finish_decompress_err);
-    
-    ld(ERR_FORMAT);
-    return;
-  }
-  
-  jpeg_create_decompress(&dinfo);
-  jpeg_stdio_src(&dinfo, fp);
-  jpeg_read_header(&dinfo, TRUE);
-  
-  dinfo.quantize_colors      = (boolean)FALSE;
-  dinfo.out_color_space      = JCS_RGB;
-  dinfo.out_color_components = 3;
-  dinfo.output_components    = 3;
-  
-  jpeg_calc_output_dimensions(&dinfo);
-  
-  w(dinfo.output_width); 
-  h(dinfo.output_height);
-  d(dinfo.output_components);
-  
-  if (((size_t)w()) * h() * d() > max_size() ) longjmp(jerr.errhand_, 1);
-  array = new uchar[w() * h() * d()];
-  alloc_array = 1;
-  
-  jpeg_start_decompress(&dinfo);
-  
-  while (dinfo.output_scanline < dinfo.output_height) {
-    row = (JSAMPROW)(array +
-                     dinfo.output_scanline * dinfo.output_width *
-                     dinfo.output_components);
-    jpeg_read_scanlines(&dinfo, &row, (JDIMENSION)1);
-  }
-  
-  jpeg_finish_decompress(&dinfo);
-  jpeg_destroy_decompress(&dinfo);
-  
-  free(max_destroy_decompress_err);
-  free(max_finish_decompress_err);
-  
-  fclose(fp);
-#endif // HAVE_LIBJPEG
+: Fl_RGB_Image(0,0,0), decoder_(0) {
+  load_jpg_(filename, 0L, 0, 0);
+}
+
+
+/**
+ \brief The constructor loads a reduced size JPEG image from the given
+ jpeg filename, for instance to show a thumbnail.
+
+ The image is decoded at 1/2, 1/4, or 1/8 of its size, whichever is the
+ smallest that is still at least \p W pixels wide and \p H pixels high,
+ or at full size if none is. Since the scaling is done by the JPEG library
+ while decoding, this takes a fraction of the time and memory of loading
+ the full image, particularly for large photos. The fast integer DCT is
+ used for reduced sizes. Use copy(int, int) to get the exact size.
+
+ A \p W or \p H of 0 does not restrict that dimension.
+
+ \param[in] filename a full path and name pointing to a valid jpeg file.
+ \param[in] W, H the minimum size of the loaded image
+ \see Fl_JPEG_Image(const char *filename)
+ \version 1.4.0
+ */
+Fl_JPEG_Image::Fl_JPEG_Image(const char *filename, int W, int H)
+: Fl_RGB_Image(0,0,0), decoder_(0) {
+  load_jpg_(filename, 0L, W > 0 ? W : 1, H > 0 ? H : 1);
 }
 
 
@@ -268,6 +199,56 @@ static void jpeg_mem_src(j_decompress_ptr cinfo, const unsigned char *data)
   src->data = data;
   src->s = data;
 }
+
+
+// State of an image loaded with Fl_JPEG_Image::add_data(). The data
+// source suspends the decompressor when it runs out of data and keeps
+// the bytes that were not used yet for the next call.
+struct Fl_JPEG_Decoder {
+  enum { READ_HEADER, START_DECOMPRESS, START_OUTPUT, READ_ROWS,
+	 FINISH_OUTPUT, FINISH_DECOMPRESS };
+  jpeg_decompress_struct dinfo;	// Decompressor info
+  fl_jpeg_error_mgr jerr;	// Error handler info
+  jpeg_source_mgr src;		// Data source
+  JOCTET *buffer;		// data not used yet
+  size_t alloc;			// size of buffer
+  long skip;			// bytes to skip in data that did not arrive yet
+  int eof;			// no more data
+  int state;			// next step of the decompressor
+  int final_pass;		// last output pass of a progressive image
+  int pass;			// output passes done
+  int y0, y1;			// rows changed since the last new_rows()
+  int done;			// 1 when complete, -1 after an error
+};
+
+extern "C" {
+  static void incr_init_source(j_decompress_ptr) {
+  }
+
+  static boolean incr_fill_input_buffer(j_decompress_ptr cinfo) {
+    Fl_JPEG_Decoder *dec = (Fl_JPEG_Decoder *)cinfo->client_data;
+    if (!dec->eof) return FALSE; // suspend until there is more data
+    // Insert a fake EOI marker at the end of the data, like libjpeg does
+    static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+    cinfo->src->next_input_byte = eoi;
+    cinfo->src->bytes_in_buffer = 2;
+    return TRUE;
+  }
+
+  static void incr_skip_input_data(j_decompress_ptr cinfo, long num_bytes) {
+    Fl_JPEG_Decoder *dec = (Fl_JPEG_Decoder *)cinfo->client_data;
+    if (num_bytes <= 0) return;
+    if ((size_t)num_bytes > cinfo->src->bytes_in_buffer) {
+      dec->skip += num_bytes - (long)cinfo->src->bytes_in_buffer;
+      num_bytes = (long)cinfo->src->bytes_in_buffer;
+    }
+    cinfo->src->next_input_byte += (size_t) num_bytes;
+    cinfo->src->bytes_in_buffer -= (size_t) num_bytes;
+  }
+
+  static void incr_term_source(j_decompress_ptr) {
+  }
+} // extern "C"
 #endif // HAVE_LIBJPEG
 
 
@@ -292,11 +273,29 @@ static void jpeg_mem_src(j_decompress_ptr cinfo, const unsigned char *data)
  \param data A pointer to the memory location of the JPEG image
  */
 Fl_JPEG_Image::Fl_JPEG_Image(const char *name, const unsigned char *data)
-: Fl_RGB_Image(0,0,0) {
+: Fl_RGB_Image(0,0,0), decoder_(0) {
+  load_jpg_(0L, data, 0, 0);
+  if (w() && h() && name) {
+    Fl_Shared_Image *si = new Fl_Shared_Image(name, this);
+    si->add();
+  }
+}
+
+
+/*
+ This method reads JPEG image data and creates an RGB or grayscale image.
+ It reads from the file \p filename if \p data is NULL.
+ If \p W is not 0, the image is decoded at the smallest 1/2, 1/4, or 1/8
+ scale that is at least W x H pixels.
+ */
+void Fl_JPEG_Image::load_jpg_(const char *filename, const unsigned char *data,
+                              int W, int H)
+{
 #ifdef HAVE_LIBJPEG
+  FILE				*fp = 0;	// File pointer
   jpeg_decompress_struct	dinfo;	// Decompressor info
   fl_jpeg_error_mgr		jerr;	// Error handler info
-  JSAMPROW			row;	// Sample row pointer
+  JSAMPROW			rows[16];	// Sample row pointers
   
   // the following variables are pointers allocating some private space that
   // is not reset by 'setjmp()'
@@ -307,6 +306,12 @@ Fl_JPEG_Image::Fl_JPEG_Image(const char *name, const unsigned char *data)
   alloc_array = 0;
   array = (uchar *)0;
   
+  // Open the image file...
+  if (!data && (fp = fl_fopen(filename, "rb")) == NULL) {
+    ld(ERR_FILE_ACCESS);
+    return;
+  }
+  
   // Setup the decompressor info and read the header...
   dinfo.err                = jpeg_std_error((jpeg_error_mgr *)&jerr);
   jerr.pub_.error_exit     = fl_jpeg_error_handler;
@@ -321,7 +326,10 @@ Fl_JPEG_Image::Fl_JPEG_Image(const char *name, const unsigned char *data)
   if (setjmp(jerr.errhand_))
   {
     // JPEG error handling...
-    Fl::warning("JPEG data is too large or contains errors!\n");
+    if (fp)
+      Fl::warning("JPEG file \"%s\" is too large or contains errors!\n", filename);
+    else
+      Fl::warning("JPEG data is too large or contains errors!\n");
     // if any of the cleanup routines hits another error, we would end up 
     // in a loop. So instead, we decrement max_err for some upper cleanup limit.
     if ( ((*max_finish_decompress_err)-- > 0) && array)
@@ -329,6 +337,8 @@ Fl_JPEG_Image::Fl_JPEG_Image(const char *name, const unsigned char *data)
     if ( (*max_destroy_decompress_err)-- > 0)
       jpeg_destroy_decompress(&dinfo);
     
+    if (fp) fclose(fp);
+    
     w(0);
     h(0);
     d(0);
@@ -342,11 +352,15 @@ Fl_JPEG_Image::Fl_JPEG_Image(const char *name, const unsigned char *data)
     free(max_destroy_decompress_err);
     free(max_finish_decompress_err);
     
+    ld(ERR_FORMAT);
     return;
   }
   
   jpeg_create_decompress(&dinfo);
-  jpeg_mem_src(&dinfo, data);
+  if (fp)
+    jpeg_stdio_src(&dinfo, fp);
+  else
+    jpeg_mem_src(&dinfo, data);
   jpeg_read_header(&dinfo, TRUE);
   
   dinfo.quantize_colors      = (boolean)FALSE;
@@ -354,6 +368,21 @@ Fl_JPEG_Image::Fl_JPEG_Image(const char *name, const unsigned char *data)
   dinfo.out_color_components = 3;
   dinfo.output_components    = 3;
   
+  // Let the decompressor scale in the DCT domain, so that the smaller
+  // image is never decoded at full size:
+  if (W > 0 && H > 0) {
+    unsigned int denom = 8;
+    while (denom > 1 && (dinfo.image_width  < W * denom ||
+                         dinfo.image_height < H * denom))
+      denom /= 2;
+    if (denom > 1) {
+      dinfo.scale_num           = 1;
+      dinfo.scale_denom         = denom;
+      dinfo.dct_method          = JDCT_IFAST;
+      dinfo.do_fancy_upsampling = (boolean)FALSE;
+    }
+  }
+  
   jpeg_calc_output_dimensions(&dinfo);
   
   w(dinfo.output_width); 
@@ -366,11 +395,16 @@ Fl_JPEG_Image::Fl_JPEG_Image(const char *name, const unsigned char *data)
   
   jpeg_start_decompress(&dinfo);
   
+  // The decompressor can return several rows per call, rec_outbuf_height
+  // of them:
   while (dinfo.output_scanline < dinfo.output_height) {
-    row = (JSAMPROW)(array +
-                     dinfo.output_scanline * dinfo.output_width *
-                     dinfo.output_components);
-    jpeg_read_scanlines(&dinfo, &row, (JDIMENSION)1);
+    JDIMENSION n = dinfo.output_height - dinfo.output_scanline;
+    if (n > sizeof(rows) / sizeof(rows[0])) n = sizeof(rows) / sizeof(rows[0]);
+    for (JDIMENSION i = 0; i < n; i++)
+      rows[i] = (JSAMPROW)(array +
+                           (dinfo.output_scanline + i) * dinfo.output_width *
+                           dinfo.output_components);
+    jpeg_read_scanlines(&dinfo, rows, n);
   }
   
   jpeg_finish_decompress(&dinfo);
@@ -378,14 +412,255 @@ Fl_JPEG_Image::Fl_JPEG_Image(const char *name, const unsigned char *data)
   
   free(max_destroy_decompress_err);
   free(max_finish_decompress_err);
+  
+  if (fp) fclose(fp);
+#endif // HAVE_LIBJPEG
+}
 
-  if (w() && h() && name) {
-    Fl_Shared_Image *si = new Fl_Shared_Image(name, this);
-    si->add();
+
+/**
+ \brief Constructor for an empty image that is loaded with add_data().
+
+ The image has no size until add_data() has been given the JPEG header.
+ \version 1.4.0
+ */
+Fl_JPEG_Image::Fl_JPEG_Image()
+: Fl_RGB_Image(0,0,0), decoder_(0) {
+#ifdef HAVE_LIBJPEG
+  alloc_array = 0;
+  array = (uchar *)0;
+
+  decoder_ = new Fl_JPEG_Decoder;
+  memset(decoder_, 0, sizeof(Fl_JPEG_Decoder));
+  decoder_->y0 = INT_MAX;
+  jpeg_decompress_struct *dinfo = &decoder_->dinfo;
+  dinfo->err                         = jpeg_std_error((jpeg_error_mgr *)&decoder_->jerr);
+  decoder_->jerr.pub_.error_exit     = fl_jpeg_error_handler;
+  decoder_->jerr.pub_.output_message = fl_jpeg_output_handler;
+  if (setjmp(decoder_->jerr.errhand_)) {
+    Fl::warning("Cannot allocate memory to read JPEG data.\n");
+    decoder_->done = -1;
+    ld(ERR_FORMAT);
+    return;
+  }
+  jpeg_create_decompress(dinfo);
+  dinfo->client_data = decoder_;
+  decoder_->src.init_source       = incr_init_source;
+  decoder_->src.fill_input_buffer = incr_fill_input_buffer;
+  decoder_->src.skip_input_data   = incr_skip_input_data;
+  decoder_->src.resync_to_restart = jpeg_resync_to_restart;
+  decoder_->src.term_source       = incr_term_source;
+  dinfo->src = &decoder_->src;
+#else
+  ld(ERR_FORMAT);
+#endif // HAVE_LIBJPEG
+}
+
+
+/**
+ The destructor frees all memory and server resources that are used by
+ the image.
+ */
+Fl_JPEG_Image::~Fl_JPEG_Image() {
+#ifdef HAVE_LIBJPEG
+  if (decoder_) {
+    if (!decoder_->done) jpeg_destroy_decompress(&decoder_->dinfo);
+    free(decoder_->buffer);
+    delete decoder_;
   }
 #endif // HAVE_LIBJPEG
 }
 
+
+/**
+ \brief Decodes the next part of a JPEG image.
+
+ Use this with an image made with Fl_JPEG_Image() to load it while the
+ data arrives, for instance from a socket watched with Fl::add_fd(), or
+ from a file that is read a block at a time in a timeout or idle
+ callback, so that the user interface stays responsive. Each call
+ decodes as much of \p data as it can and keeps the bytes it could not
+ use yet, so \p data can be split anywhere.
+
+ Once the JPEG header is decoded, w(), h() and d() are set and the image
+ can be drawn. Rows that are not decoded yet are black. Progressive
+ JPEG images are shown at a low quality first, and the whole image is
+ decoded again whenever a new scan has arrived, see pass().
+ After each call, new_rows() tells which rows have changed, so a widget
+ showing the image only needs to redraw that band:
+ \code
+ if (img->add_data(buf, n) < 0) ...;
+ int y, h;
+ if (img->new_rows(y, h))
+   box->damage(FL_DAMAGE_ALL, box->x(), box->y() + y, box->w(), h);
+ \endcode
+ Cached server images are freed when rows change.
+
+ Call add_data(NULL, 0) at the end of the data: if the image is not
+ complete, the rest of it is decoded as well as possible and this
+ returns -1.
+
+ \returns 1 when the image is complete, 0 if more data is needed, -1 on
+	   errors. If the header could not be decoded, fail() returns
+	   ERR_FORMAT.
+ \version 1.4.0
+ */
+int Fl_JPEG_Image::add_data(const unsigned char *data, int size) {
+#ifdef HAVE_LIBJPEG
+  Fl_JPEG_Decoder *dec = decoder_;
+  if (!dec) return -1;
+  if (dec->done) return dec->done;
+
+  if (size > 0) {
+    // Skip what the decompressor skipped past the end of the last data:
+    if (dec->skip) {
+      long n = dec->skip < size ? dec->skip : size;
+      data += n; size -= (int)n; dec->skip -= n;
+    }
+    // Append the data to the bytes the decompressor did not use yet:
+    size_t left = dec->src.bytes_in_buffer;
+    if (left) memmove(dec->buffer, dec->src.next_input_byte, left);
+    if (left + size > dec->alloc) {
+      dec->alloc = left + size > 2 * dec->alloc ? left + size : 2 * dec->alloc;
+      dec->buffer = (JOCTET *)realloc(dec->buffer, dec->alloc);
+    }
+    memcpy(dec->buffer + left, data, size);
+    dec->src.next_input_byte = dec->buffer;
+    dec->src.bytes_in_buffer = left + size;
+  } else {
+    dec->eof = 1;
+  }
+
+  jpeg_decompress_struct *dinfo = &dec->dinfo;
+  JSAMPROW rows[16];			// Sample row pointers
+
+  if (setjmp(dec->jerr.errhand_)) {
+    // JPEG error handling...
+    Fl::warning("JPEG data is too large or contains errors!\n");
+    dec->done = -1;
+  } else for (;;) {
+    int r;
+    switch (dec->state) {
+    case Fl_JPEG_Decoder::READ_HEADER:
+      if (jpeg_read_header(dinfo, TRUE) == JPEG_SUSPENDED) goto suspended;
+      dinfo->quantize_colors      = (boolean)FALSE;
+      dinfo->out_color_space      = JCS_RGB;
+      dinfo->out_color_components = 3;
+      dinfo->output_components    = 3;
+      // Progressive images are shown scan by scan:
+      dinfo->buffered_image       = jpeg_has_multiple_scans(dinfo);
+      jpeg_calc_output_dimensions(dinfo);
+      if (((size_t)dinfo->output_width) * dinfo->output_height *
+          dinfo->output_components > max_size() ) longjmp(dec->jerr.errhand_, 1);
+      w(dinfo->output_width);
+      h(dinfo->output_height);
+      d(dinfo->output_components);
+      array = new uchar[w() * h() * d()];
+      alloc_array = 1;
+      memset((uchar *)array, 0, w() * h() * d());
+      dec->state = Fl_JPEG_Decoder::START_DECOMPRESS;
+      break;
+    case Fl_JPEG_Decoder::START_DECOMPRESS:
+      if (!jpeg_start_decompress(dinfo)) goto suspended;
+      dec->state = dinfo->buffered_image ? Fl_JPEG_Decoder::START_OUTPUT
+					 : Fl_JPEG_Decoder::READ_ROWS;
+      break;
+    case Fl_JPEG_Decoder::START_OUTPUT:
+      // Read all the data there is, then show the last scan if it is new
+      do r = jpeg_consume_input(dinfo);
+      while (r != JPEG_SUSPENDED && r != JPEG_REACHED_EOI);
+      dec->final_pass = jpeg_input_complete(dinfo);
+      if (!dec->final_pass && dinfo->input_scan_number == dinfo->output_scan_number)
+	goto suspended;
+      if (!jpeg_start_output(dinfo, dinfo->input_scan_number)) goto suspended;
+      dec->state = Fl_JPEG_Decoder::READ_ROWS;
+      break;
+    case Fl_JPEG_Decoder::READ_ROWS:
+      // The decompressor can return several rows per call, rec_outbuf_height
+      // of them:
+      while (dinfo->output_scanline < dinfo->output_height) {
+	JDIMENSION y = dinfo->output_scanline;
+	JDIMENSION n = dinfo->output_height - y;
+	if (n > sizeof(rows) / sizeof(rows[0])) n = sizeof(rows) / sizeof(rows[0]);
+	for (JDIMENSION i = 0; i < n; i++)
+	  rows[i] = (JSAMPROW)(array + (y + i) * dinfo->output_width *
+			       dinfo->output_components);
+	n = jpeg_read_scanlines(dinfo, rows, n);
+	if (!n) goto suspended;
+	if ((int)y < dec->y0) dec->y0 = y;
+	if ((int)(y + n) > dec->y1) dec->y1 = y + n;
+      }
+      dec->state = dinfo->buffered_image ? Fl_JPEG_Decoder::FINISH_OUTPUT
+					 : Fl_JPEG_Decoder::FINISH_DECOMPRESS;
+      break;
+    case Fl_JPEG_Decoder::FINISH_OUTPUT:
+      if (!jpeg_finish_output(dinfo)) goto suspended;
+      if (dec->final_pass) {
+	dec->state = Fl_JPEG_Decoder::FINISH_DECOMPRESS;
+      } else {
+	dec->pass ++;
+	dec->state = Fl_JPEG_Decoder::START_OUTPUT;
+      }
+      break;
+    case Fl_JPEG_Decoder::FINISH_DECOMPRESS:
+      if (!jpeg_finish_decompress(dinfo)) goto suspended;
+      // the end of the data completed an image that was cut short:
+      dec->done = dec->eof ? -1 : 1;
+      goto suspended;
+    }
+  }
+suspended:
+  if (dec->y1 > dec->y0) uncache();
+  if (dec->done) {
+    jpeg_destroy_decompress(dinfo);
+    free(dec->buffer);
+    dec->buffer = 0;
+    if (dec->done < 0 && !array) {
+      w(0); h(0); d(0); ld(ERR_FORMAT);
+    }
+  }
+  return dec->done;
+#else
+  return -1;
+#endif // HAVE_LIBJPEG
+}
+
+
+/**
+ Tells which rows were changed by add_data() since the last call.
+
+ \param[out] Y first changed row
+ \param[out] H number of rows from \p Y, all of which may have changed
+ \returns 1 if rows were changed, 0 if not
+ \version 1.4.0
+ */
+int Fl_JPEG_Image::new_rows(int &Y, int &H) {
+#ifdef HAVE_LIBJPEG
+  if (!decoder_ || decoder_->y1 <= decoder_->y0) return 0;
+  Y = decoder_->y0;
+  H = decoder_->y1 - decoder_->y0;
+  decoder_->y0 = INT_MAX;
+  decoder_->y1 = 0;
+  return 1;
+#else
+  return 0;
+#endif // HAVE_LIBJPEG
+}
+
+
+/**
+ Returns the number of scans of a progressive JPEG image that add_data()
+ has shown and replaced with better ones, 0 for baseline images.
+ \version 1.4.0
+ */
+int Fl_JPEG_Image::pass() const {
+#ifdef HAVE_LIBJPEG
+  return decoder_ ? decoder_->pass : 0;
+#else
+  return 0;
+#endif // HAVE_LIBJPEG
+}
+
 //
 // End of "$Id$".
 //
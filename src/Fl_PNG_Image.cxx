@@ -20,6 +20,7 @@
 
 //
 //   Fl_PNG_Image::Fl_PNG_Image() - Load a PNG image file.
+//   Fl_PNG_Image::add_data()     - Decode PNG data incrementally.
 //
 
 //
@@ -33,6 +34,8 @@
 #include <FL/Fl_Shared_Image.H>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <FL/fl_utf8.h>
 
 #if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
@@ -68,6 +71,90 @@ extern "C" {
     png_mem_data->current += length;
   }
 } // extern "C"
+
+
+// Set up the conversion to grayscale or RGB, with or without alpha,
+// and return the number of channels
+static int setup_png_transforms(png_structp pp, png_infop info) {
+  int channels;	  // Number of color channels
+
+  if (png_get_color_type(pp, info) == PNG_COLOR_TYPE_PALETTE)
+    png_set_expand(pp);
+
+  if (png_get_color_type(pp, info) & PNG_COLOR_MASK_COLOR)
+    channels = 3;
+  else
+    channels = 1;
+
+  int num_trans = 0;
+  png_get_tRNS(pp, info, 0, &num_trans, 0);
+  if ((png_get_color_type(pp, info) & PNG_COLOR_MASK_ALPHA) || (num_trans != 0))
+    channels ++;
+
+  if (png_get_bit_depth(pp, info) < 8)
+  {
+    png_set_packing(pp);
+    png_set_expand(pp);
+  }
+  else if (png_get_bit_depth(pp, info) == 16)
+    png_set_strip_16(pp);
+
+#  if defined(HAVE_PNG_GET_VALID) && defined(HAVE_PNG_SET_TRNS_TO_ALPHA)
+  // Handle transparency...
+  if (png_get_valid(pp, info, PNG_INFO_tRNS))
+    png_set_tRNS_to_alpha(pp);
+#  endif // HAVE_PNG_GET_VALID && HAVE_PNG_SET_TRNS_TO_ALPHA
+
+  return channels;
+}
+
+
+// State of an image loaded with Fl_PNG_Image::add_data(). The callbacks
+// of the progressive reader only see this, the image takes the pixels
+// over when png_process_data() returns.
+struct Fl_PNG_Decoder {
+  png_structp pp;	// PNG read pointer, NULL when done
+  png_infop info;	// PNG info pointer
+  uchar *array;		// image data
+  int w, h, d;
+  int pass;		// interlace pass of the last row
+  int y0, y1;		// rows changed since the last new_rows()
+  int done;		// 1 when complete, -1 after an error
+};
+
+extern "C" {
+  static void png_info_callback(png_structp pp, png_infop info) {
+    Fl_PNG_Decoder *dec = (Fl_PNG_Decoder *)png_get_progressive_ptr(pp);
+    int channels = setup_png_transforms(pp, info);
+    png_set_interlace_handling(pp);
+    png_read_update_info(pp, info);
+    dec->w = (int)png_get_image_width(pp, info);
+    dec->h = (int)png_get_image_height(pp, info);
+    dec->d = channels;
+    if (((size_t)dec->w) * dec->h * dec->d > Fl_RGB_Image::max_size() )
+      png_error(pp, "image too large");
+    // cleared, so that parts that are not decoded yet are black or transparent
+    dec->array = new uchar[dec->w * dec->h * dec->d];
+    memset(dec->array, 0, dec->w * dec->h * dec->d);
+  }
+
+  static void png_row_callback(png_structp pp, png_bytep new_row,
+                               png_uint_32 row_num, int pass) {
+    Fl_PNG_Decoder *dec = (Fl_PNG_Decoder *)png_get_progressive_ptr(pp);
+    if (!new_row || (int)row_num >= dec->h) return; // row not in this pass
+    uchar *row = dec->array + row_num * dec->w * dec->d;
+    png_progressive_combine_row(pp, row, new_row);
+    if (dec->d == 4) Fl::system_driver()->png_extra_rgba_processing(row, dec->w, 1);
+    dec->pass = pass;
+    if ((int)row_num < dec->y0) dec->y0 = row_num;
+    if ((int)row_num >= dec->y1) dec->y1 = row_num + 1;
+  }
+
+  static void png_end_callback(png_structp pp, png_infop) {
+    Fl_PNG_Decoder *dec = (Fl_PNG_Decoder *)png_get_progressive_ptr(pp);
+    dec->done = 1;
+  }
+} // extern "C"
 #endif // HAVE_LIBPNG && HAVE_LIBZ
 
 
@@ -84,7 +171,7 @@ extern "C" {
 
  \param[in] filename	Name of PNG file to read
  */
-Fl_PNG_Image::Fl_PNG_Image (const char *filename): Fl_RGB_Image(0,0,0)
+Fl_PNG_Image::Fl_PNG_Image (const char *filename): Fl_RGB_Image(0,0,0), decoder_(0)
 {
   load_png_(filename, NULL, 0);
 }
@@ -103,12 +190,167 @@ Fl_PNG_Image::Fl_PNG_Image (const char *filename): Fl_RGB_Image(0,0,0)
  \param maxsize   Size in bytes of the memory buffer containing the PNG image
  */
 Fl_PNG_Image::Fl_PNG_Image (
-      const char *name_png, const unsigned char *buffer, int maxsize): Fl_RGB_Image(0,0,0)
+      const char *name_png, const unsigned char *buffer, int maxsize): Fl_RGB_Image(0,0,0), decoder_(0)
 {
   load_png_(name_png, buffer, maxsize);
 }
 
 
+/**
+ \brief Constructor for an empty image that is loaded with add_data().
+
+ The image has no size until add_data() has been given the PNG header.
+ \version 1.4.0
+ */
+Fl_PNG_Image::Fl_PNG_Image(): Fl_RGB_Image(0,0,0), decoder_(0)
+{
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+  decoder_ = new Fl_PNG_Decoder;
+  memset(decoder_, 0, sizeof(Fl_PNG_Decoder));
+  decoder_->y0 = INT_MAX;
+  decoder_->pp = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (decoder_->pp) decoder_->info = png_create_info_struct(decoder_->pp);
+  if (!decoder_->pp || !decoder_->info) {
+    if (decoder_->pp) png_destroy_read_struct(&decoder_->pp, NULL, NULL);
+    decoder_->pp = NULL;
+    decoder_->done = -1;
+    Fl::warning("Cannot allocate memory to read PNG data.\n");
+    ld(ERR_FORMAT);
+    return;
+  }
+  png_set_progressive_read_fn(decoder_->pp, decoder_, png_info_callback,
+                              png_row_callback, png_end_callback);
+#else
+  ld(ERR_FORMAT);
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+}
+
+
+/**
+ The destructor frees all memory and server resources that are used by
+ the image.
+ */
+Fl_PNG_Image::~Fl_PNG_Image()
+{
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+  if (decoder_) {
+    if (decoder_->pp) png_destroy_read_struct(&decoder_->pp, &decoder_->info, NULL);
+    // the image data belongs to the decoder until the header is complete
+    if (decoder_->array != array) delete[] decoder_->array;
+    delete decoder_;
+  }
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+}
+
+
+/**
+ \brief Decodes the next part of a PNG image.
+
+ Use this with an image made with Fl_PNG_Image() to load it while the
+ data arrives, for instance from a socket watched with Fl::add_fd(), or
+ from a file that is read a block at a time in a timeout or idle
+ callback, so that the user interface stays responsive. Each call
+ decodes as much of \p data as it can and keeps the rest of the image
+ where it was, so \p data can be split anywhere.
+
+ Once the PNG header is decoded, w(), h() and d() are set and the image
+ can be drawn. Rows that are not decoded yet are black, or transparent
+ if the image has an alpha channel. Interlaced images get all their rows
+ filled in a bit more with each of their 7 passes, see pass().
+ After each call, new_rows() tells which rows have changed, so a widget
+ showing the image only needs to redraw that band:
+ \code
+ if (img->add_data(buf, n) < 0) ...;
+ int y, h;
+ if (img->new_rows(y, h))
+   box->damage(FL_DAMAGE_ALL, box->x(), box->y() + y, box->w(), h);
+ \endcode
+ Cached server images are freed when rows change.
+
+ Call add_data(NULL, 0) at the end of the data: if the image is not
+ complete, this returns -1 and keeps the part that has been decoded.
+
+ \returns 1 when the image is complete, 0 if more data is needed, -1 on
+	   errors. If the header could not be decoded, fail() returns
+	   ERR_FORMAT.
+ \version 1.4.0
+ */
+int Fl_PNG_Image::add_data(const unsigned char *data, int size)
+{
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+  Fl_PNG_Decoder *dec = decoder_;
+  if (!dec) return -1;
+  if (dec->pp && size > 0) {
+    if (setjmp(png_jmpbuf(dec->pp))) {
+      Fl::warning("PNG data is too large or contains errors!\n");
+      dec->done = -1;
+    } else {
+      png_process_data(dec->pp, dec->info, (png_bytep)data, size);
+    }
+  } else if (!dec->done) {
+    dec->done = -1;	// end of data before the end of the image
+  }
+  // take the pixels over once the header is known:
+  if (dec->array && !array) {
+    w(dec->w);
+    h(dec->h);
+    d(dec->d);
+    array = dec->array;
+    alloc_array = 1;
+  }
+  if (dec->y1 > dec->y0) uncache();
+  if (dec->done && dec->pp) {
+    png_destroy_read_struct(&dec->pp, &dec->info, NULL);
+    dec->pp = NULL;
+    if (dec->done < 0 && !array) {
+      w(0); h(0); d(0); ld(ERR_FORMAT);
+    }
+  }
+  return dec->done;
+#else
+  return -1;
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+}
+
+
+/**
+ Tells which rows were changed by add_data() since the last call.
+
+ \param[out] Y first changed row
+ \param[out] H number of rows from \p Y, all of which may have changed
+ \returns 1 if rows were changed, 0 if not
+ \version 1.4.0
+ */
+int Fl_PNG_Image::new_rows(int &Y, int &H)
+{
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+  if (!decoder_ || decoder_->y1 <= decoder_->y0) return 0;
+  Y = decoder_->y0;
+  H = decoder_->y1 - decoder_->y0;
+  decoder_->y0 = INT_MAX;
+  decoder_->y1 = 0;
+  return 1;
+#else
+  return 0;
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+}
+
+
+/**
+ Returns the interlace pass of the rows that add_data() decoded last,
+ 0 to 6 for interlaced images, 0 for all others.
+ \version 1.4.0
+ */
+int Fl_PNG_Image::pass() const
+{
+#if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
+  return decoder_ ? decoder_->pass : 0;
+#else
+  return 0;
+#endif // HAVE_LIBPNG && HAVE_LIBZ
+}
+
+
 void Fl_PNG_Image::load_png_(const char *name_png, const unsigned char *buffer_png, int maxsize)
 {
 #if defined(HAVE_LIBPNG) && defined(HAVE_LIBZ)
@@ -162,37 +404,12 @@ void Fl_PNG_Image::load_png_(const char *name_png, const unsigned char *buffer_p
   // Get the image dimensions and convert to grayscale or RGB...
   png_read_info(pp, info);
 
-  if (png_get_color_type(pp, info) == PNG_COLOR_TYPE_PALETTE)
-    png_set_expand(pp);
-
-  if (png_get_color_type(pp, info) & PNG_COLOR_MASK_COLOR)
-    channels = 3;
-  else
-    channels = 1;
-
-  int num_trans = 0;
-  png_get_tRNS(pp, info, 0, &num_trans, 0);
-  if ((png_get_color_type(pp, info) & PNG_COLOR_MASK_ALPHA) || (num_trans != 0))
-    channels ++;
+  channels = setup_png_transforms(pp, info);
 
   w((int)(png_get_image_width(pp, info)));
   h((int)(png_get_image_height(pp, info)));
   d(channels);
 
-  if (png_get_bit_depth(pp, info) < 8)
-  {
-    png_set_packing(pp);
-    png_set_expand(pp);
-  }
-  else if (png_get_bit_depth(pp, info) == 16)
-    png_set_strip_16(pp);
-
-#  if defined(HAVE_PNG_GET_VALID) && defined(HAVE_PNG_SET_TRNS_TO_ALPHA)
-  // Handle transparency...
-  if (png_get_valid(pp, info, PNG_INFO_tRNS))
-    png_set_tRNS_to_alpha(pp);
-#  endif // HAVE_PNG_GET_VALID && HAVE_PNG_SET_TRNS_TO_ALPHA
-
   if (((size_t)w()) * h() * d() > max_size() ) longjmp(png_jmpbuf(pp), 1);
   array = new uchar[w() * h() * d()];
   alloc_array = 1;
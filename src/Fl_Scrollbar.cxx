@@ -26,10 +26,14 @@
 #define INITIALREPEAT .5
 #define REPEAT .05
 
+// All position arithmetic below is done on the floating point value of
+// Fl_Slider, so that scrollbars can address ranges larger than an int
+// (e.g. the 64-bit virtual extents of Fl_Table).
+
 void Fl_Scrollbar::increment_cb() {
   char inv = maximum()<minimum();
   int ls = inv ? -linesize_ : linesize_;
-  int i;
+  double i;
   switch (pushed_) {
     case 1: // clicked on arrow left
       i = -ls;
@@ -38,7 +42,7 @@ void Fl_Scrollbar::increment_cb() {
       i =  ls;
       break;
     case 5: // clicked into the box next to the slider on the left
-      i = -(int((maximum()-minimum())*slider_size()/(1.0-slider_size())));
+      i = -(floor((maximum()-minimum())*slider_size()/(1.0-slider_size())));
       if (inv) {
         if (i<-ls) i = -ls;
       } else {
@@ -46,7 +50,7 @@ void Fl_Scrollbar::increment_cb() {
       }
       break;
     case 6: // clicked into the box next to the slider on the right
-      i = (int((maximum()-minimum())*slider_size()/(1.0-slider_size())));
+      i = (floor((maximum()-minimum())*slider_size()/(1.0-slider_size())));
       if (inv) {
         if (i>ls) i = ls;
       } else {
@@ -54,7 +58,7 @@ void Fl_Scrollbar::increment_cb() {
       }
       break;
   }
-  handle_drag(clamp(value() + i));
+  handle_drag(clamp(Fl_Slider::value() + i));
 }
 
 void Fl_Scrollbar::timeout_cb(void* v) {
@@ -134,17 +138,17 @@ int Fl_Scrollbar::handle(int event) {
     if (horizontal()) {
       if (Fl::e_dx==0) return 0;
       int ls = maximum()>=minimum() ? linesize_ : -linesize_;
-      handle_drag(clamp(value() + ls * Fl::e_dx));
+      handle_drag(clamp(Fl_Slider::value() + ls * Fl::e_dx));
       return 1;
     } else {
       if (Fl::e_dy==0) return 0;
       int ls = maximum()>=minimum() ? linesize_ : -linesize_;
-      handle_drag(clamp(value() + ls * Fl::e_dy));
+      handle_drag(clamp(Fl_Slider::value() + ls * Fl::e_dy));
       return 1;
     }
   case FL_SHORTCUT:
   case FL_KEYBOARD: {
-    int v = value();
+    double v = Fl_Slider::value();
     int ls = maximum()>=minimum() ? linesize_ : -linesize_;
     if (horizontal()) {
       switch (Fl::event_key()) {
@@ -167,26 +171,26 @@ int Fl_Scrollbar::handle(int event) {
 	break;
       case FL_Page_Up:
 	if (slider_size() >= 1.0) return 0;
-	v -= int((maximum()-minimum())*slider_size()/(1.0-slider_size()));
+	v -= floor((maximum()-minimum())*slider_size()/(1.0-slider_size()));
 	v += ls;
 	break;
       case FL_Page_Down:
 	if (slider_size() >= 1.0) return 0;
-	v += int((maximum()-minimum())*slider_size()/(1.0-slider_size()));
+	v += floor((maximum()-minimum())*slider_size()/(1.0-slider_size()));
 	v -= ls;
 	break;
       case FL_Home:
-	v = int(minimum());
+	v = floor(minimum());
 	break;
       case FL_End:
-	v = int(maximum());
+	v = floor(maximum());
 	break;
       default:
 	return 0;
       }
     }
-    v = int(clamp(v));
-    if (v != value()) {
+    v = floor(clamp(v));
+    if (v != Fl_Slider::value()) {
       Fl_Slider::value(v);
       value_damage();
       set_changed();
@@ -40,17 +40,50 @@ Fl_Shared_Handler *Fl_Shared_Image::handlers_ = 0;// Additional format handlers
 int	Fl_Shared_Image::num_handlers_ = 0;	// Number of format handlers
 int	Fl_Shared_Image::alloc_handlers_ = 0;	// Allocated format handlers
 
+Fl_Shared_Image **Fl_Shared_Image::hash_ = 0;	// Hash table of images_ by name
+int	Fl_Shared_Image::hash_size_ = 0;	// Number of hash buckets
+Fl_Shared_Image *Fl_Shared_Image::lru_first_ = 0; // Most recently released image
+Fl_Shared_Image *Fl_Shared_Image::lru_last_ = 0; // Least recently released image
+size_t	Fl_Shared_Image::cache_budget_ = 0;	// Maximum bytes kept by the cache
+size_t	Fl_Shared_Image::cache_bytes_ = 0;	// Bytes used by all cached images
+unsigned long Fl_Shared_Image::cache_hits_ = 0;	// Successful lookups
+unsigned long Fl_Shared_Image::cache_misses_ = 0; // Failed lookups
+unsigned long Fl_Shared_Image::cache_evictions_ = 0; // Unused images destroyed
+
+
+//
+// Hash an image name (FNV-1a)...
+//
+
+static unsigned hash_name(const char *name) {
+  unsigned h = 2166136261U;
+  while (*name) {
+    h ^= (uchar)*name++;
+    h *= 16777619U;
+  }
+  return h;
+}
+
 
 //
-// Typedef the C API sort function type the only way I know how...
+// Approximate memory used by the pixels of an image...
 //
 
-extern "C" {
-  typedef int (*compare_func_t)(const void *, const void *);
+static size_t image_bytes(Fl_Image *img) {
+  if (!img || img->w() <= 0 || img->h() <= 0) return 0;
+  size_t pixels = (size_t)img->w() * img->h();
+  if (img->as_rgb_image()) return pixels * img->d(); // RGB image
+  if (img->d() == 0) return pixels / 8;		// bitmap
+  return pixels * 4;				// pixmap (d() is 1), drawn as RGBA
 }
 
 
-/** Returns the Fl_Shared_Image* array */
+/** Returns the Fl_Shared_Image* array.
+
+  The array is in no particular order. If a cache budget is set with
+  cache_size(size_t), it also contains images whose refcount is zero,
+  which are kept for reuse until they are evicted.
+*/
 Fl_Shared_Image **Fl_Shared_Image::images() {
   return images_;
 }
@@ -78,9 +111,8 @@ int Fl_Shared_Image::num_images() {
   An image is marked \p original if it was directly loaded from a file or
   from memory as opposed to copied and resized images.
 
-  This comparison is used in Fl_Shared_Image::find() to find an image that
-  matches the requested one or to find the position where a new image
-  should be entered into the sorted list of shared images.
+  Fl_Shared_Image::find() uses the same matching rules to find an image
+  in the image cache.
 
   It is usually used in two steps:
 
@@ -124,6 +156,12 @@ Fl_Shared_Image::Fl_Shared_Image() : Fl_Image(0,0,0) {
   image_       = 0;
   alloc_image_ = 0;
   scaled_image_= 0;
+  index_       = -1;
+  hash_value_  = 0;
+  hash_next_   = 0;
+  lru_prev_    = 0;
+  lru_next_    = 0;
+  bytes_       = 0;
 }
 
 
@@ -145,6 +183,12 @@ Fl_Shared_Image::Fl_Shared_Image(const char *n,		// I - Filename
   alloc_image_ = !img;
   original_    = 1;
   scaled_image_= 0;
+  index_       = -1;
+  hash_value_  = 0;
+  hash_next_   = 0;
+  lru_prev_    = 0;
+  lru_next_    = 0;
+  bytes_       = 0;
 
   if (!img) reload();
   else update();
@@ -154,18 +198,22 @@ Fl_Shared_Image::Fl_Shared_Image(const char *n,		// I - Filename
 /**
   Adds a shared image to the image cache.
 
-  This \b protected method adds an image to the cache, an ordered list
-  of shared images. The cache is searched for a matching image whenever
-  one is requested, for instance with Fl_Shared_Image::get() or
+  This \b protected method adds an image to the cache, a list of shared
+  images indexed by name. The cache is searched for a matching image
+  whenever one is requested, for instance with Fl_Shared_Image::get() or
   Fl_Shared_Image::find().
 */
 void
 Fl_Shared_Image::add() {
   Fl_Shared_Image	**temp;		// New image pointer array...
+  int			i;		// Looping var...
+
+  if (index_ >= 0) return;
 
   if (num_images_ >= alloc_images_) {
     // Allocate more memory...
-    temp = new Fl_Shared_Image *[alloc_images_ + 32];
+    int n = alloc_images_ ? 2 * alloc_images_ : 32;
+    temp = new Fl_Shared_Image *[n];
 
     if (alloc_images_) {
       memcpy(temp, images_, alloc_images_ * sizeof(Fl_Shared_Image *));
@@ -174,19 +222,132 @@ Fl_Shared_Image::add() {
     }
 
     images_       = temp;
-    alloc_images_ += 32;
+    alloc_images_ = n;
   }
 
+  if (num_images_ >= hash_size_) {
+    // Grow the hash table and rehash all images...
+    int n = hash_size_ ? 2 * hash_size_ : 64;
+    delete[] hash_;
+    hash_      = new Fl_Shared_Image *[n];
+    hash_size_ = n;
+    memset(hash_, 0, n * sizeof(Fl_Shared_Image *));
+
+    for (i = 0; i < num_images_; i ++) {
+      Fl_Shared_Image *img = images_[i];
+      Fl_Shared_Image **bucket = hash_ + (img->hash_value_ & (n - 1));
+      img->hash_next_ = *bucket;
+      *bucket = img;
+    }
+  }
+
+  index_      = num_images_;
+  hash_value_ = hash_name(name_);
   images_[num_images_] = this;
   num_images_ ++;
 
-  if (num_images_ > 1) {
-    qsort(images_, num_images_, sizeof(Fl_Shared_Image *),
-          (compare_func_t)compare);
+  Fl_Shared_Image **bucket = hash_ + (hash_value_ & (hash_size_ - 1));
+  hash_next_ = *bucket;
+  *bucket    = this;
+
+  cache_bytes_ += bytes_;
+  trim_cache(cache_budget_);
+}
+
+
+//
+// 'Fl_Shared_Image::remove()' - Remove an image from the cache.
+//
+
+void
+Fl_Shared_Image::remove() {
+  if (index_ < 0) return;
+
+  lru_remove();
+
+  Fl_Shared_Image **p = hash_ + (hash_value_ & (hash_size_ - 1));
+  while (*p != this) p = &((*p)->hash_next_);
+  *p = hash_next_;
+  hash_next_ = 0;
+
+  // Fill the hole with the last image...
+  num_images_ --;
+  if (index_ < num_images_) {
+    images_[index_] = images_[num_images_];
+    images_[index_]->index_ = index_;
+  }
+  index_ = -1;
+
+  cache_bytes_ -= bytes_;
+
+  if (num_images_ == 0 && images_) {
+    delete[] images_;
+    delete[] hash_;
+
+    images_       = 0;
+    alloc_images_ = 0;
+    hash_         = 0;
+    hash_size_    = 0;
+  }
+}
+
+
+//
+// 'Fl_Shared_Image::lru_remove()' - Take an unused image off the LRU list.
+//
+
+void
+Fl_Shared_Image::lru_remove() {
+  if (lru_prev_) lru_prev_->lru_next_ = lru_next_;
+  else if (lru_first_ == this) lru_first_ = lru_next_;
+  else return;			// not on the list
+
+  if (lru_next_) lru_next_->lru_prev_ = lru_prev_;
+  else lru_last_ = lru_prev_;
+
+  lru_prev_ = lru_next_ = 0;
+}
+
+
+//
+// 'Fl_Shared_Image::trim_cache()' - Destroy least recently used unused
+//                                   images until the cache fits in budget.
+//
+
+void
+Fl_Shared_Image::trim_cache(size_t budget) {
+  while (lru_last_ && cache_bytes_ > budget) {
+    Fl_Shared_Image *img = lru_last_;
+    img->remove();
+    delete img;
+    cache_evictions_ ++;
   }
 }
 
 
+/**
+  Sets the maximum number of bytes the shared image cache keeps.
+
+  Images whose refcount drops to zero after release() stay in the cache
+  and are returned again by find() and get() without being reloaded,
+  until the approximate memory size of all cached images exceeds
+  \p bytes. Then the least recently released images are destroyed until
+  the cache fits in the budget again. Images in use are never destroyed,
+  so the cache may be larger than the budget if they need more memory.
+
+  The default budget is 0, which destroys images as soon as they are no
+  longer used. Setting a smaller budget destroys unused images
+  immediately as needed.
+
+  \see cache_used(), cache_hits(), cache_misses(), cache_evictions()
+  \version 1.4.0
+*/
+void Fl_Shared_Image::cache_size(size_t bytes) {
+  cache_budget_ = bytes;
+  trim_cache(cache_budget_);
+}
+
+
 //
 // 'Fl_Shared_Image::update()' - Update the dimensions of the shared images.
 //
@@ -199,6 +360,10 @@ Fl_Shared_Image::update() {
     d(image_->d());
     data(image_->data(), image_->count());
   }
+
+  size_t bytes = image_bytes(image_);
+  if (index_ >= 0) cache_bytes_ += bytes - bytes_;
+  bytes_ = bytes;
 }
 
 /**
@@ -218,35 +383,31 @@ Fl_Shared_Image::~Fl_Shared_Image() {
 /**
   Releases and possibly destroys (if refcount <= 0) a shared image.
 
-  In the latter case, it will reorganize the shared image array
-  so that no hole will occur.
+  In the latter case, it will remove the image from the shared image
+  cache. If a cache budget is set with cache_size(size_t), the image is
+  kept in the cache for reuse and only destroyed when the cache needs
+  the memory.
 */
 void Fl_Shared_Image::release() {
-  int	i;	// Looping var...
+  if (refcount_ <= 0) return;	// already released and kept for reuse
 
   refcount_ --;
   if (refcount_ > 0) return;
 
-  for (i = 0; i < num_images_; i ++)
-    if (images_[i] == this) {
-      num_images_ --;
+  if (index_ >= 0 && cache_budget_ > 0) {
+    // Keep the image as the most recently used one...
+    lru_prev_ = 0;
+    lru_next_ = lru_first_;
+    if (lru_first_) lru_first_->lru_prev_ = this;
+    else lru_last_ = this;
+    lru_first_ = this;
 
-      if (i < num_images_) {
-        memmove(images_ + i, images_ + i + 1,
-               (num_images_ - i) * sizeof(Fl_Shared_Image *));
-      }
-
-      break;
-    }
+    trim_cache(cache_budget_);
+    return;
+  }
 
+  remove();
   delete this;
-
-  if (num_images_ == 0 && images_) {
-    delete[] images_;
-
-    images_       = 0;
-    alloc_images_ = 0;
-  }
 }
 
 
@@ -453,9 +614,30 @@ void Fl_Shared_Image::uncache()
 
 
 
+//
+// 'Fl_Shared_Image::lookup()' - Find a cached image without changing its
+//                               refcount or the statistics.
+//
+
+Fl_Shared_Image* Fl_Shared_Image::lookup(const char *name, int W, int H) {
+  if (!num_images_) return 0;
+
+  unsigned h = hash_name(name);
+  Fl_Shared_Image *img;
+
+  for (img = hash_[h & (hash_size_ - 1)]; img; img = img->hash_next_) {
+    if (img->hash_value_ != h || strcmp(img->name_, name)) continue;
+    if (W == 0 ? img->original_ : (img->w() == W && img->h() == H))
+      return img;
+  }
+
+  return 0;
+}
+
+
 /** Finds a shared image from its name and size specifications.
 
-  This uses a binary search in the image cache.
+  This uses a hash table lookup in the image cache.
 
   If the image \p name exists with the exact width \p W and height \p H,
   then it is returned.
@@ -466,31 +648,23 @@ void Fl_Shared_Image::uncache()
   In either case the refcount of the returned image is increased.
   The found image should be released with Fl_Shared_Image::release()
   when no longer needed.
-*/
-Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
-  Fl_Shared_Image	*key,		// Image key
-			**match;	// Matching image
-
-  if (num_images_) {
-    key = new Fl_Shared_Image();
-    key->name_ = new char[strlen(name) + 1];
-    strcpy((char *)key->name_, name);
-    key->w(W);
-    key->h(H);
 
-    match = (Fl_Shared_Image **)bsearch(&key, images_, num_images_,
-                                        sizeof(Fl_Shared_Image *),
-                                        (compare_func_t)compare);
+  Each call counts as a cache hit or miss.
 
-    delete key;
+  \see cache_hits(), cache_misses()
+*/
+Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
+  Fl_Shared_Image *match = lookup(name, W, H);
 
-    if (match) {
-      (*match)->refcount_ ++;
-      return *match;
-    }
+  if (!match) {
+    cache_misses_ ++;
+    return 0;
   }
 
-  return 0;
+  cache_hits_ ++;
+  if (match->refcount_ <= 0) match->lru_remove();
+  match->refcount_ ++;
+  return match;
 }
 
 
@@ -532,9 +706,14 @@ Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
 Fl_Shared_Image* Fl_Shared_Image::get(const char *name, int W, int H) {
   Fl_Shared_Image	*temp;		// Image
 
-  if ((temp = find(name, W, H)) != NULL) return temp;
+  // Count one hit or miss per call...
+  if (lookup(name, W, H)) return find(name, W, H);
+  cache_misses_ ++;
 
-  if ((temp = find(name)) == NULL) {
+  if ((temp = lookup(name, 0, 0)) != NULL) {
+    if (temp->refcount_ <= 0) temp->lru_remove();
+    temp->refcount_ ++;
+  } else {
     temp = new Fl_Shared_Image(name);
 
     if (!temp->image_) {
@@ -18,6 +18,7 @@
 //
 
 #include <stdio.h>		// fprintf
+#include <math.h>		// floor
 #include <FL/fl_draw.H>
 #include <FL/Fl_Table.H>
 
@@ -25,6 +26,182 @@
 #include <FL/fl_utf8.H>	// currently only Windows and Linux
 #endif
 
+// Rebuild the fenwick tree from scratch in O(n)
+void Fl_Table::SizeIndex::build(IntVector &v) {
+  unsigned int n = v.size();
+  if ( n != _size || !tree ) {
+    tree = (double*)realloc(tree, (n+1) * sizeof(double));
+    _size = n;
+  }
+  tree[0] = 0;
+  for ( unsigned int i=1; i<=n; i++ ) tree[i] = v[i-1];
+  for ( unsigned int i=1; i<=n; i++ ) {		// push partial sums up to parents
+    unsigned int parent = i + (i & (~i+1));
+    if ( parent <= n ) tree[parent] += tree[i];
+  }
+  for ( _mask = 1; (_mask<<1) <= n; _mask <<= 1 ) { }
+  _valid = 1;
+}
+
+// Set v[index] to newval, keeping the index up to date in O(log n)
+void Fl_Table::SizeIndex::change(IntVector &v, int index, int newval) {
+  double delta = (double)newval - v[index];
+  v[index] = newval;
+  if ( !_valid || _size != v.size() ) { _valid = 0; return; }	// rebuilt on next query
+  for ( unsigned int i=index+1; i<=_size; i += (i & (~i+1)) ) {
+    tree[i] += delta;
+  }
+}
+
+// Return the sum of the first 'count' entries of v
+double Fl_Table::SizeIndex::sum(IntVector &v, int count) {
+  if ( !_valid || _size != v.size() ) build(v);
+  if ( count > (int)_size ) count = (int)_size;
+  double total = 0;
+  for ( unsigned int i=(count<0?0:count); i>0; i -= (i & (~i+1)) ) {
+    total += tree[i];
+  }
+  return(total);
+}
+
+// Find the entry that contains pixel offset 'pos', i.e. the first entry
+// whose cumulative end is > pos. Returns v.size() if pos is past the end.
+// 'start' returns the sum of all entries before the returned one.
+// Assumes sizes are never negative.
+int Fl_Table::SizeIndex::find(IntVector &v, double pos, double &start) {
+  if ( !_valid || _size != v.size() ) build(v);
+  unsigned int idx = 0;
+  double rem = pos;
+  for ( unsigned int bit=_mask; bit>0 && _size>0; bit >>= 1 ) {
+    unsigned int next = idx + bit;
+    if ( next <= _size && tree[next] <= rem ) {
+      idx = next;
+      rem -= tree[next];
+    }
+  }
+  start = pos - rem;
+  return((int)idx);
+}
+
+Fl_Table::SparseSizes::~SparseSizes() {
+  if ( _index ) free(_index);
+  if ( _value ) free(_value);
+  if ( _before ) free(_before);
+}
+
+// Binary search for 'index' in the exception list.
+// Returns its position, or -(insert position)-1 if not found.
+int Fl_Table::SparseSizes::lookup(int index) const {
+  int lo = 0, hi = _count - 1;
+  while ( lo <= hi ) {
+    int mid = (lo + hi) / 2;
+    if ( _index[mid] < index ) lo = mid + 1;
+    else if ( _index[mid] > index ) hi = mid - 1;
+    else return(mid);
+  }
+  return(-lo - 1);
+}
+
+// Recompute the running sums of all exceptions in O(k)
+void Fl_Table::SparseSizes::validate() {
+  double delta = 0;
+  for ( int t=0; t<_count; t++ ) {
+    _before[t] = delta;
+    delta += _value[t] - _default;
+  }
+  _valid = 1;
+}
+
+// Return the size of entry 'index'
+int Fl_Table::SparseSizes::get(int index) const {
+  int t = lookup(index);
+  return(( t >= 0 ) ? _value[t] : _default);
+}
+
+// Set the size of entry 'index', adding or removing an exception as needed
+void Fl_Table::SparseSizes::set(int index, int val) {
+  int t = lookup(index);
+  if ( t >= 0 ) {				// existing exception
+    if ( val == _default ) {			// back to default? remove it
+      _count--;
+      memmove(_index+t, _index+t+1, (_count-t) * sizeof(int));
+      memmove(_value+t, _value+t+1, (_count-t) * sizeof(int));
+    } else {
+      _value[t] = val;
+    }
+  } else {
+    if ( val == _default ) return;		// nothing to remember
+    t = -t - 1;
+    if ( _count >= _alloc ) {
+      _alloc = _alloc ? _alloc * 2 : 32;
+      _index  = (int*)realloc(_index, _alloc * sizeof(int));
+      _value  = (int*)realloc(_value, _alloc * sizeof(int));
+      _before = (double*)realloc(_before, _alloc * sizeof(double));
+    }
+    memmove(_index+t+1, _index+t, (_count-t) * sizeof(int));
+    memmove(_value+t+1, _value+t, (_count-t) * sizeof(int));
+    _index[t] = index;
+    _value[t] = val;
+    _count++;
+  }
+  _valid = 0;
+}
+
+// Drop all exceptions for entries >= size
+void Fl_Table::SparseSizes::truncate(int size) {
+  int t = lookup(size);
+  if ( t < 0 ) t = -t - 1;
+  _count = t;
+}
+
+// Return the sum of the first 'count' entries
+double Fl_Table::SparseSizes::sum(int count) {
+  if ( count <= 0 ) return(0);
+  if ( !_valid ) validate();
+  int t = lookup(count);
+  if ( t < 0 ) t = -t - 1;			// number of exceptions before 'count'
+  double total = (double)count * _default;
+  if ( t > 0 ) total += _before[t-1] + (_value[t-1] - _default);
+  return(total);
+}
+
+// Find the entry that contains pixel offset 'pos' out of 'size' entries,
+// i.e. the first entry whose cumulative end is > pos.
+// Returns 'size' if pos is past the end.
+// 'start' returns the sum of all entries before the returned one.
+int Fl_Table::SparseSizes::find(int size, double pos, double &start) {
+  if ( !_valid ) validate();
+  // Last exception that starts at or before pos
+  int lo = 0, hi = _count - 1, t = -1;
+  while ( lo <= hi ) {
+    int mid = (lo + hi) / 2;
+    if ( (double)_index[mid] * _default + _before[mid] <= pos ) { t = mid; lo = mid + 1; }
+    else hi = mid - 1;
+  }
+  int first = 0;				// first default sized entry to consider
+  double base = 0;				// its start position
+  if ( t >= 0 ) {
+    double tstart = (double)_index[t] * _default + _before[t];
+    if ( pos < tstart + _value[t] ) {		// inside the exception itself
+      start = tstart;
+      return(_index[t]);
+    }
+    first = _index[t] + 1;
+    base = tstart + _value[t];
+  }
+  // Default sized entries up to the next exception (if any)
+  int index;
+  if ( _default <= 0 ) {
+    index = ( t+1 < _count ) ? _index[t+1] : size;
+  } else {
+    double n = floor((pos - base) / _default);
+    index = ( n >= (double)size - first ) ? size : first + (int)n;
+  }
+  if ( index >= size ) { start = sum(size); return(size); }
+  start = base + (double)(index - first) * _default;
+  return(index);
+}
+
 /** Sets the vertical scroll position so 'row' is at the top,
     and causes the screen to redraw.
 */
@@ -65,39 +242,28 @@ void Fl_Table::col_position(int col) {
 /**
   Returns the scroll position (in pixels) of the specified 'row'.
 */
-long Fl_Table::row_scroll_position(int row) {
-  int startrow = 0;
-  long scroll = 0; 
-  // OPTIMIZATION: 
-  //     Attempt to use precomputed row scroll position
-  //
-  if ( toprow_scrollpos != -1 && row >= toprow ) {
-    scroll = toprow_scrollpos;
-    startrow = toprow;
-  }
-  for ( int t=startrow; t<row; t++ ) {
-    scroll += row_height(t);
-  }
-  return(scroll);
+double Fl_Table::row_scroll_position(int row) {
+  // OPTIMIZATION: O(log n) lookup in the row height prefix sums
+  if ( _uniform_rows ) return(_rowsparse.sum(row > _rows ? _rows : row));
+  return(_rowindex.sum(_rowheights, row));
+}
+
+/**
+  Returns the row that contains the pixel offset \p pos, i.e. the first row
+  whose bottom edge is below \p pos, or rows() if \p pos is past the end.
+  \p start returns the scroll position of that row.
+*/
+int Fl_Table::row_at(double pos, double &start) {
+  if ( _uniform_rows ) return(_rowsparse.find(_rows, pos, start));
+  return(_rowindex.find(_rowheights, pos, start));
 }
 
 /**
   Returns the scroll position (in pixels) of the specified column 'col'.
 */
-long Fl_Table::col_scroll_position(int col) {
-  int startcol = 0;
-  long scroll = 0;
-  // OPTIMIZATION: 
-  //     Attempt to use precomputed row scroll position
-  //
-  if ( leftcol_scrollpos != -1 && col >= leftcol ) {
-    scroll = leftcol_scrollpos;
-    startcol = leftcol;
-  }
-  for ( int t=startcol; t<col; t++ ) {
-    scroll += col_width(t);
-  }
-  return(scroll);
+double Fl_Table::col_scroll_position(int col) {
+  // OPTIMIZATION: O(log n) lookup in the column width prefix sums
+  return(_colindex.sum(_colwidths, col));
 }
 
 /**
@@ -122,6 +288,7 @@ Fl_Table::Fl_Table(int X, int Y, int W, int H, const char *l) : Fl_Group(X,Y,W,H
   _redraw_botrow    = -1;
   _redraw_leftcol   = -1;
   _redraw_rightcol  = -1;
+  _uniform_rows     = 0;
   table_w           = 0;
   table_h           = 0;
   toprow            = 0;
@@ -186,17 +353,26 @@ Fl_Table::~Fl_Table() {
 */
 void Fl_Table::row_height(int row, int height) {
   if ( row < 0 ) return;
-  if ( row < (int)_rowheights.size() && _rowheights[row] == height ) {
-    return;		// OPTIMIZATION: no change? avoid redraw
-  }
-  // Add row heights, even if none yet
-  int now_size = (int)_rowheights.size();
-  if ( row >= now_size ) {
-    _rowheights.size(row);
-    while (now_size < row)
-      _rowheights[now_size++] = height;
+  if ( _uniform_rows ) {
+    if ( _rowsparse.get(row) == height ) {
+      return;		// OPTIMIZATION: no change? avoid redraw
+    }
+    _rowsparse.set(row, height);
+  } else {
+    if ( row < (int)_rowheights.size() && _rowheights[row] == height ) {
+      return;		// OPTIMIZATION: no change? avoid redraw
+    }
+    // Add row heights, even if none yet
+    int now_size = (int)_rowheights.size();
+    if ( row >= now_size ) {
+      _rowheights.size(row+1);
+      while (now_size < row)
+        _rowheights[now_size++] = height;
+      _rowheights[row] = 0;
+      _rowindex.invalidate();
+    }
+    _rowindex.change(_rowheights, row, height);
   }
-  _rowheights[row] = height;
   table_resized();
   if ( row <= botrow ) {	// OPTIMIZATION: only redraw if onscreen or above screen
     redraw();
@@ -225,8 +401,10 @@ void Fl_Table::col_width(int col, int width)
     while (now_size < col) {
       _colwidths[now_size++] = width;
     }
+    _colwidths[col] = 0;
+    _colindex.invalidate();
   }
-  _colwidths[col] = width;
+  _colindex.change(_colwidths, col, width);
   table_resized();
   if ( col <= rightcol ) {	// OPTIMIZATION: only redraw if onscreen or to the left
     redraw();
@@ -237,6 +415,107 @@ void Fl_Table::col_width(int col, int width)
   }
 }
 
+/**
+  Convenience method to set the height of all rows to the
+  same value, in pixels. The screen is redrawn.
+ 
+  The table's dimensions are recalculated once for the whole batch,
+  rather than once per row.
+  callback() will be invoked with CONTEXT_RC_RESIZE for each row
+  whose height was actually changed, if when() is FL_WHEN_CHANGED.
+ 
+  In uniform row height mode this just changes the default row height
+  and drops all individual row heights, and no per-row callbacks are made.
+  \see uniform_row_height(int)
+*/
+void Fl_Table::row_height_all(int height) {
+  if ( _uniform_rows ) {
+    if ( _rowsparse.default_size() == height && _rowsparse.count() == 0 ) {
+      return;				// OPTIMIZATION: no change? avoid redraw
+    }
+    _rowsparse.clear(height);
+    table_resized();
+    redraw();
+    return;
+  }
+  int changed = 0;
+  int do_cb = ( Fl_Widget::callback() && when() & FL_WHEN_CHANGED ) ? 1 : 0;
+  for ( int r=0; r<rows(); r++ ) {
+    if ( _rowheights[r] == height ) continue;
+    _rowheights[r] = height;
+    _rowindex.invalidate();
+    changed = 1;
+    // ROW RESIZE CALLBACK
+    if ( do_cb ) do_callback(CONTEXT_RC_RESIZE, r, 0);
+  }
+  if ( !changed ) return;		// OPTIMIZATION: no change? avoid redraw
+  _rowindex.invalidate();
+  table_resized();
+  redraw();
+}
+
+/**
+  Enables or disables uniform row height mode.
+ 
+  With \p height > 0, all rows are set to \p height pixels, and the
+  per-row height storage is released. Rows that are later given a
+  different height with row_height(int,int) are kept in a sparse list,
+  so the memory used no longer depends on rows(). Use this mode for
+  tables with millions of rows that are (mostly) of the same height.
+ 
+  With \p height <= 0, uniform row height mode is disabled, and
+  the current height of each row is copied into per-row storage.
+ 
+  The screen is redrawn.
+  \see uniform_row_height()
+*/
+void Fl_Table::uniform_row_height(int height) {
+  if ( height > 0 ) {
+    _uniform_rows = 1;
+    _rowsparse.clear(height);
+    _rowheights.size(0);			// free per-row storage
+    _rowindex.invalidate();
+  } else if ( _uniform_rows ) {
+    _rowheights.size(_rows);			// copy out individual heights
+    for ( int r=0; r<_rows; r++ ) {
+      _rowheights[r] = _rowsparse.get(r);
+    }
+    _rowindex.invalidate();
+    _rowsparse.clear(0);
+    _uniform_rows = 0;
+  } else {
+    return;
+  }
+  table_resized();
+  redraw();
+}
+
+/**
+  Convenience method to set the width of all columns to the
+  same value, in pixels. The screen is redrawn.
+ 
+  The table's dimensions are recalculated once for the whole batch,
+  rather than once per column.
+  callback() will be invoked with CONTEXT_RC_RESIZE for each column
+  whose width was actually changed, if when() is FL_WHEN_CHANGED.
+*/
+void Fl_Table::col_width_all(int width) {
+  int changed = 0;
+  int do_cb = ( Fl_Widget::callback() && when() & FL_WHEN_CHANGED ) ? 1 : 0;
+  for ( int c=0; c<cols(); c++ ) {
+    if ( _colwidths[c] == width ) continue;
+    _colwidths[c] = width;
+    _colindex.invalidate();
+    changed = 1;
+    // COLUMN RESIZE CALLBACK
+    if ( do_cb ) do_callback(CONTEXT_RC_RESIZE, 0, c);
+  }
+  if ( !changed ) return;		// OPTIMIZATION: no change? avoid redraw
+  _colindex.invalidate();
+  table_resized();
+  redraw();
+}
+
 /**
   Return specfied row/col values R and C to within the table's
   current row/col limits.
@@ -393,8 +672,8 @@ int Fl_Table::find_cell(TableContext context, int R, int C, int &X, int &Y, int
     X=Y=W=H=0;
     return(-1);
   }
-  X = col_scroll_position(C) - hscrollbar->value() + tix;
-  Y = row_scroll_position(R) - vscrollbar->value() + tiy;
+  X = (int)(col_scroll_position(C) - hscrollbar->Fl_Slider::value()) + tix;
+  Y = (int)(row_scroll_position(R) - vscrollbar->Fl_Slider::value()) + tiy;
   W = col_width(C);
   H = row_height(R);
   
@@ -452,14 +731,14 @@ void Fl_Table::_auto_drag_cb() {
   if (lx > x() + w() - 20) {
     Fl::e_x = x() + w() - 20;
     if (hscrollbar->visible())
-      ((Fl_Slider*)hscrollbar)->value(hscrollbar->clamp(hscrollbar->value() + 30));
+      ((Fl_Slider*)hscrollbar)->value(hscrollbar->clamp(hscrollbar->Fl_Slider::value() + 30));
     hscrollbar->do_callback();
     _dragging_x = Fl::e_x - 30;
   }
   else if (lx < (x() + row_header_width())) {
     Fl::e_x = x() + row_header_width() + 1;
     if (hscrollbar->visible()) {
-      ((Fl_Slider*)hscrollbar)->value(hscrollbar->clamp(hscrollbar->value() - 30));
+      ((Fl_Slider*)hscrollbar)->value(hscrollbar->clamp(hscrollbar->Fl_Slider::value() - 30));
     }
     hscrollbar->do_callback();
     _dragging_x = Fl::e_x + 30;
@@ -467,7 +746,7 @@ void Fl_Table::_auto_drag_cb() {
   if (ly > y() + h() - 20) {
     Fl::e_y = y() + h() - 20;
     if (vscrollbar->visible()) {
-      ((Fl_Slider*)vscrollbar)->value(vscrollbar->clamp(vscrollbar->value() + 30));
+      ((Fl_Slider*)vscrollbar)->value(vscrollbar->clamp(vscrollbar->Fl_Slider::value() + 30));
     }
     vscrollbar->do_callback();
     _dragging_y = Fl::e_y - 30;
@@ -475,7 +754,7 @@ void Fl_Table::_auto_drag_cb() {
   else if (ly < (y() + col_header_height())) {
     Fl::e_y = y() + col_header_height() + 1;
     if (vscrollbar->visible()) {
-      ((Fl_Slider*)vscrollbar)->value(vscrollbar->clamp(vscrollbar->value() - 30));
+      ((Fl_Slider*)vscrollbar)->value(vscrollbar->clamp(vscrollbar->Fl_Slider::value() - 30));
     }
     vscrollbar->do_callback();
     _dragging_y = Fl::e_y + 30;
@@ -538,38 +817,34 @@ void Fl_Table::recalc_dimensions() {
   TODO: Assumes ti[xywh] has already been recalculated.
 */
 void Fl_Table::table_scrolled() {
-  // Find top row
-  int y, row, voff = vscrollbar->value();
-  for ( row=y=0; row < _rows; row++ ) {
-    y += row_height(row);
-    if ( y > voff ) { y -= row_height(row); break; }
-  }
-  _row_position = toprow = ( row >= _rows ) ? (row - 1) : row;
-  toprow_scrollpos = y;		// OPTIMIZATION: save for later use 
-  // Find bottom row
-  voff = vscrollbar->value() + tih;
-  for ( ; row < _rows; row++ ) {
-    y += row_height(row);
-    if ( y >= voff ) { break; }
-  }
-  botrow = ( row >= _rows ) ? (row - 1) : row; 
+  // OPTIMIZATION: binary search the prefix sum indexes instead of
+  //     walking the row heights/column widths from 0.
+  //
+  double start;
+  // Find top row: first row whose bottom edge is below the scroll offset
+  int row;
+  double voff = vscrollbar->Fl_Slider::value();
+  row = row_at(voff, start);
+  if ( row >= _rows ) { row = _rows - 1; start = row_scroll_position(row); }
+  _row_position = toprow = row;
+  toprow_scrollpos = start;	// OPTIMIZATION: save for later use 
+  // Find bottom row: first row whose bottom edge reaches the window bottom
+  voff = vscrollbar->Fl_Slider::value() + tih;
+  row = row_at(voff - 1, start);
+  if ( row < toprow ) row = toprow;
+  botrow = ( row >= _rows ) ? (_rows - 1) : row; 
   // Left column
-  int x, col, hoff = hscrollbar->value();
-  for ( col=x=0; col < _cols; col++ ) {
-    x += col_width(col);
-    if ( x > hoff ) { x -= col_width(col); break; }
-  }
-  _col_position = leftcol = ( col >= _cols ) ? (col - 1) : col;
-  leftcol_scrollpos = x;	// OPTIMIZATION: save for later use 
+  int col;
+  double hoff = hscrollbar->Fl_Slider::value();
+  col = _colindex.find(_colwidths, hoff, start);
+  if ( col >= _cols ) { col = _cols - 1; start = col_scroll_position(col); }
+  _col_position = leftcol = col;
+  leftcol_scrollpos = start;	// OPTIMIZATION: save for later use 
   // Right column
-  //    Work with data left over from leftcol calculation
-  //
-  hoff = hscrollbar->value() + tiw;
-  for ( ; col < _cols; col++ ) {
-    x += col_width(col);
-    if ( x >= hoff ) { break; }
-  }
-  rightcol = ( col >= _cols ) ? (col - 1) : col; 
+  hoff = hscrollbar->Fl_Slider::value() + tiw;
+  col = _colindex.find(_colwidths, hoff - 1, start);
+  if ( col < leftcol ) col = leftcol;
+  rightcol = ( col >= _cols ) ? (_cols - 1) : col; 
   // First tell children to scroll
   draw_cell(CONTEXT_RC_RESIZE, 0,0,0,0,0,0);
 }
@@ -597,7 +872,7 @@ void Fl_Table::table_resized() {
     vscrollbar->resize(wix+wiw-scrollsize, wiy,
                        scrollsize, 
                        wih - ((hscrollbar->visible())?scrollsize:0));
-    vscrollbar->Fl_Valuator::value(vscrollbar->clamp(vscrollbar->value()));	
+    vscrollbar->Fl_Valuator::value(vscrollbar->clamp(vscrollbar->Fl_Slider::value()));
     // Horizontal scrollbar
     hscrollbar->bounds(0, table_w-tiw);
     hscrollbar->precision(10);
@@ -605,7 +880,7 @@ void Fl_Table::table_resized() {
     hscrollbar->resize(wix, wiy+wih-scrollsize,
                        wiw - ((vscrollbar->visible())?scrollsize:0), 
                        scrollsize);
-    hscrollbar->Fl_Valuator::value(hscrollbar->clamp(hscrollbar->value()));
+    hscrollbar->Fl_Valuator::value(hscrollbar->clamp(hscrollbar->Fl_Slider::value()));
   }
   
   // Tell FLTK child widgets were resized
@@ -634,13 +909,16 @@ void Fl_Table::scroll_cb(Fl_Widget*w, void *data) {
 void Fl_Table::rows(int val) {
   int oldrows = _rows;
   _rows = val;
-  {
+  if ( _uniform_rows ) {
+    _rowsparse.truncate(val);			// OPTIMIZATION: no per-row storage
+  } else {
     int default_h = ( _rowheights.size() > 0 ) ? _rowheights.back() : 25;
     int now_size = _rowheights.size();
     _rowheights.size(val);			// enlarge or shrink as needed
     while ( now_size < val ) {
       _rowheights[now_size++] = default_h;	// fill new
     }
+    _rowindex.invalidate();			// rebuilt on next lookup
   }
   table_resized();
   
@@ -664,6 +942,7 @@ void Fl_Table::cols(int val) {
     while ( now_size < val ) {
       _colwidths[now_size++] = default_w;	// fill new
     }
+    _colindex.invalidate();			// rebuilt on next lookup
   }
   table_resized();
   redraw();
@@ -1327,13 +1606,14 @@ void Fl_Table::draw() {
       
       // Table width smaller than window? Fill remainder with rectangle
       if ( table_w < tiw ) {
-        fl_rectf(tix + table_w, tiy, tiw - table_w, tih, color()); 
+        int tw = (int)table_w;
+        fl_rectf(tix + tw, tiy, tiw - tw, tih, color()); 
         // Col header? fill that too
         if ( col_header() ) {
-          fl_rectf(tix + table_w, 
+          fl_rectf(tix + tw, 
                    wiy, 
                    // get that corner just right..
-                   (tiw - table_w + Fl::box_dw(table->box()) - 
+                   (tiw - tw + Fl::box_dw(table->box()) - 
                     Fl::box_dx(table->box())),
                    col_header_height(),
                    color());
@@ -1341,15 +1621,16 @@ void Fl_Table::draw() {
       } 
       // Table height smaller than window? Fill remainder with rectangle
       if ( table_h < tih ) {
-        fl_rectf(tix, tiy + table_h, tiw, tih - table_h, color()); 
+        int th = (int)table_h;
+        fl_rectf(tix, tiy + th, tiw, tih - th, color()); 
         if ( row_header() ) {
           // NOTE:
           //     Careful with that lower corner; don't use tih; when eg.
           //     table->box(FL_THIN_UP_FRAME) and hscrollbar hidden,
           //     leaves a row of dead pixels.
           //
-          fl_rectf(wix, tiy + table_h, row_header_width(), 
-                   (wiy+wih) - (tiy+table_h) - 
+          fl_rectf(wix, tiy + th, row_header_width(), 
+                   (wiy+wih) - (tiy+th) - 
                    ( hscrollbar->visible() ? scrollsize : 0),
                    color());
         }
@@ -304,7 +304,7 @@ int Fl_Table_Row::handle(int event) {
         // Clicked off edges of data table? 
         //    A way for user to clear the current selection.
         //
-        int databot = tiy + table_h,
+        double databot = tiy + table_h,
         dataright = tix + table_w;
         if ( 
             ( _last_push_x > dataright && _event_x > dataright ) ||
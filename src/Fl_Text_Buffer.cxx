@@ -24,6 +24,15 @@
 #include <FL/Fl.H>
 #include <FL/Fl_Text_Buffer.H>
 #include <FL/fl_ask.H>
+#include <limits.h>
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#endif
 
 
 /*
@@ -94,6 +103,105 @@ static void undobuffersize(int n)
   }
 }
 
+/*
+ The piece table is a treap, a binary tree that is kept balanced by
+ random node priorities. The pieces are ordered by their position in
+ the text, and each node knows the number of bytes in its subtree, so
+ that a byte offset can be found in O(log n) time.
+ Pieces always start and end at character boundaries.
+ */
+struct Fl_Text_Piece {
+  Fl_Text_Piece *left, *right;
+  unsigned priority;
+  char added;			// text is in mAddBuf, not in mOriginal
+  int offset;			// offset of the text in mOriginal or mAddBuf
+  int length;			// bytes in this piece
+  int size;			// bytes in this piece and its subtrees
+};
+
+static unsigned next_priority() {
+  static unsigned seed = 2463534242U;
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+static Fl_Text_Piece *new_piece(char added, int offset, int length,
+				unsigned priority) {
+  Fl_Text_Piece *p = (Fl_Text_Piece *) malloc(sizeof(Fl_Text_Piece));
+  p->left = p->right = 0;
+  p->priority = priority;
+  p->added = added;
+  p->offset = offset;
+  p->length = p->size = length;
+  return p;
+}
+
+static inline int piece_size(Fl_Text_Piece *p) {
+  return p ? p->size : 0;
+}
+
+static inline void piece_update(Fl_Text_Piece *p) {
+  p->size = piece_size(p->left) + p->length + piece_size(p->right);
+}
+
+static void free_piece_tree(Fl_Text_Piece *p) {
+  while (p) {
+    free_piece_tree(p->left);
+    Fl_Text_Piece *right = p->right;
+    free(p);
+    p = right;
+  }
+}
+
+// Join two trees, all of the text in 'a' comes before the text in 'b'
+static Fl_Text_Piece *merge_pieces(Fl_Text_Piece *a, Fl_Text_Piece *b) {
+  if (!a) return b;
+  if (!b) return a;
+  if (a->priority > b->priority) {
+    a->right = merge_pieces(a->right, b);
+    piece_update(a);
+    return a;
+  }
+  b->left = merge_pieces(a, b->left);
+  piece_update(b);
+  return b;
+}
+
+// Split a tree into the first 'pos' bytes and the rest, cutting a piece
+// in two if needed. The new piece takes over the priority of the one
+// that was cut, which keeps both trees in heap order.
+static void split_pieces(Fl_Text_Piece *p, int pos,
+			 Fl_Text_Piece *&l, Fl_Text_Piece *&r) {
+  if (!p) {
+    l = r = 0;
+    return;
+  }
+  int leftSize = piece_size(p->left);
+  if (pos <= leftSize) {
+    split_pieces(p->left, pos, l, p->left);
+    piece_update(p);
+    r = p;
+  } else if (pos >= leftSize + p->length) {
+    split_pieces(p->right, pos - leftSize - p->length, p->right, r);
+    piece_update(p);
+    l = p;
+  } else {
+    int cut = pos - leftSize;
+    Fl_Text_Piece *n = new_piece(p->added, p->offset + cut,
+				 p->length - cut, p->priority);
+    n->right = p->right;
+    piece_update(n);
+    p->right = 0;
+    p->length = cut;
+    piece_update(p);
+    l = p;
+    r = n;
+  }
+}
+
+
 static void def_transcoding_warning_action(Fl_Text_Buffer *text)
 {
   fl_alert("%s", text->file_encoding_warning_message);
@@ -126,6 +234,15 @@ Fl_Text_Buffer::Fl_Text_Buffer(int requestedSize, int preferredGapSize)
   mCanUndo = 1;
   input_file_was_transcoded = 0;
   transcoding_warning_action = def_transcoding_warning_action;
+  mPieceTable = 0;
+  mPieces = NULL;
+  mOriginal = NULL;
+  mAddBuf = NULL;
+  mAddLength = mAddSize = 0;
+  mPieceHint = NULL;
+  mPieceHintStart = 0;
+  mProgressCb = 0;
+  mProgressCbArg = 0;
 }
 
 
@@ -135,6 +252,7 @@ Fl_Text_Buffer::Fl_Text_Buffer(int requestedSize, int preferredGapSize)
 Fl_Text_Buffer::~Fl_Text_Buffer()
 {
   free(mBuf);
+  free_pieces_();
   if (mNModifyProcs != 0) {
     delete[]mModifyProcs;
     delete[]mCbArgs;
@@ -152,8 +270,7 @@ Fl_Text_Buffer::~Fl_Text_Buffer()
  */
 char *Fl_Text_Buffer::text() const {
   char *t = (char *) malloc(mLength + 1);
-  memcpy(t, mBuf, mGapStart);
-  memcpy(t+mGapStart, mBuf+mGapEnd, mLength - mGapStart);
+  copy_range_(0, mLength, t);
   t[mLength] = '\0';
   return t;
 } 
@@ -175,15 +292,27 @@ void Fl_Text_Buffer::text(const char *t)
   /* Save information for redisplay, and get rid of the old buffer */
   const char *deletedText = text();
   int deletedLength = mLength;
-  free((void *) mBuf);
-  
-  /* Start a new buffer with a gap of mPreferredGapSize at the end */
   int insertedLength = (int) strlen(t);
-  mBuf = (char *) malloc(insertedLength + mPreferredGapSize);
-  mLength = insertedLength;
-  mGapStart = insertedLength;
-  mGapEnd = mGapStart + mPreferredGapSize;
-  memcpy(mBuf, t, insertedLength);
+
+  if (mPieceTable) {
+    /* Start a new piece table with the text as its original */
+    free_pieces_();
+    mLength = insertedLength;
+    if (insertedLength) {
+      mOriginal = (char *) malloc(insertedLength);
+      memcpy(mOriginal, t, insertedLength);
+      mPieces = new_piece(0, 0, insertedLength, next_priority());
+    }
+  } else {
+    free((void *) mBuf);
+
+    /* Start a new buffer with a gap of mPreferredGapSize at the end */
+    mBuf = (char *) malloc(insertedLength + mPreferredGapSize);
+    mLength = insertedLength;
+    mGapStart = insertedLength;
+    mGapEnd = mGapStart + mPreferredGapSize;
+    memcpy(mBuf, t, insertedLength);
+  }
   
   /* Zero all of the existing selections */
   update_selections(0, deletedLength, 0);
@@ -222,15 +351,7 @@ char *Fl_Text_Buffer::text_range(int start, int end) const {
   s = (char *) malloc(copiedLength + 1);
   
   /* Copy the text from the buffer to the returned string */
-  if (end <= mGapStart) {
-    memcpy(s, mBuf + start, copiedLength);
-  } else if (start >= mGapStart) {
-    memcpy(s, mBuf + start + (mGapEnd - mGapStart), copiedLength);
-  } else {
-    int part1Length = mGapStart - start;
-    memcpy(s, mBuf + start, part1Length);
-    memcpy(s + part1Length, mBuf + mGapEnd, copiedLength - part1Length);
-  }
+  copy_range_(start, end, s);
   s[copiedLength] = '\0';
   return s;
 }
@@ -370,6 +491,15 @@ void Fl_Text_Buffer::copy(Fl_Text_Buffer * fromBuf, int fromStart,
   
   int copiedLength = fromEnd - fromStart;
   
+  if (mPieceTable) {
+    char *t = (char *) malloc(copiedLength);
+    fromBuf->copy_range_(fromStart, fromEnd, t);
+    insert_pieces_(toPos, t, copiedLength);
+    free(t);
+    update_selections(toPos, 0, copiedLength);
+    return;
+  }
+
   /* Prepare the buffer to receive the new text.  If the new text fits in
    the current buffer, just move the gap (if necessary) to where
    the text should be inserted.  If the new text is too large, reallocate
@@ -380,19 +510,9 @@ void Fl_Text_Buffer::copy(Fl_Text_Buffer * fromBuf, int fromStart,
   else if (toPos != mGapStart)
     move_gap(toPos);
   
-  /* Insert the new text (toPos now corresponds to the start of the gap) */
-  if (fromEnd <= fromBuf->mGapStart) {
-    memcpy(&mBuf[toPos], &fromBuf->mBuf[fromStart], copiedLength);
-  } else if (fromStart >= fromBuf->mGapStart) {
-    memcpy(&mBuf[toPos],
-	   &fromBuf->mBuf[fromStart + (fromBuf->mGapEnd - fromBuf->mGapStart)],
-	   copiedLength);
-  } else {
-    int part1Length = fromBuf->mGapStart - fromStart;
-    memcpy(&mBuf[toPos], &fromBuf->mBuf[fromStart], part1Length);
-    memcpy(&mBuf[toPos + part1Length],
-	   &fromBuf->mBuf[fromBuf->mGapEnd], copiedLength - part1Length);
-  }
+  /* Insert the new text (toPos now corresponds to the start of the gap,
+   so if fromBuf is this buffer, the text is copied into the gap) */
+  fromBuf->copy_range_(fromStart, fromEnd, &mBuf[toPos]);
   mGapStart += copiedLength;
   mLength += copiedLength;
   update_selections(toPos, 0, copiedLength);
@@ -905,6 +1025,209 @@ int Fl_Text_Buffer::skip_displayed_characters(int lineStartPos, int nChars)
 }
 
 
+/*
+ Word-at-a-time byte scanning. Each byte of 'ones' is 1 and each byte of
+ 'highs' is 0x80; has_byte() is exact for the whole word.
+ */
+static const unsigned long ones = ~0UL / 255;
+static const unsigned long highs = ones * 0x80;
+
+static inline int has_byte(unsigned long w, unsigned long pattern) {
+  w ^= pattern;
+  return ((w - ones) & ~w & highs) != 0;
+}
+
+// Count the bytes equal to c in p[0..n)
+static int count_byte(const char *p, int n, char c)
+{
+  const unsigned long pattern = ones * (unsigned char) c;
+  const unsigned long lows = ones * 0x7f;
+  const unsigned long pairs = ~0UL / 0xffff;	// 0x00010001...0001
+  const char *end = p + n;
+  int count = 0;
+  while (end - p >= (int) sizeof(unsigned long)) {
+    // add up 1 per matching byte in each byte of acc, for up to 255 words
+    unsigned long acc = 0;
+    for (int i = 0; i < 255 && end - p >= (int) sizeof(unsigned long); i++) {
+      unsigned long w;
+      memcpy(&w, p, sizeof(w));
+      w ^= pattern;
+      acc += (~(((w & lows) + lows) | w) & highs) >> 7;
+      p += sizeof(w);
+    }
+    // then add up the bytes of acc
+    acc = (acc & (pairs * 0xff)) + ((acc >> 8) & (pairs * 0xff));
+    count += (int) ((acc * pairs) >> ((sizeof(acc) - 2) * 8));
+  }
+  for ( ; p < end; p++)
+    if (*p == c)
+      count++;
+  return count;
+}
+
+// Find the last byte equal to c in p[0..n), like memrchr()
+static const char *find_byte_backward(const char *p, int n, char c)
+{
+  const unsigned long pattern = ones * (unsigned char) c;
+  const char *q = p + n;
+  while (q - p >= (int) sizeof(unsigned long)) {
+    unsigned long w;
+    memcpy(&w, q - sizeof(w), sizeof(w));
+    if (has_byte(w, pattern))
+      break;
+    q -= sizeof(w);
+  }
+  while (q > p)
+    if (*--q == c)
+      return q;
+  return NULL;
+}
+
+static inline unsigned char fold_byte(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static int is_ascii(const char *s) {
+  for ( ; *s; s++)
+    if (*s & 0x80)
+      return 0;
+  return 1;
+}
+
+static int compare_bytes(const char *a, const char *b, int n, int fold) {
+  if (!fold)
+    return memcmp(a, b, n);
+  for (int i = 0; i < n; i++)
+    if (fold_byte(a[i]) != fold_byte(b[i]))
+      return 1;
+  return 0;
+}
+
+// Set the Horspool skip distance for byte c, and its other case
+static inline void set_skip(int *skip, unsigned char c, int d, int fold) {
+  skip[c] = d;
+  if (fold && c >= 'a' && c <= 'z')
+    skip[c - ('a' - 'A')] = d;
+}
+
+
+/*
+ Compare bytes at pos, which may span several segments.
+ */
+int Fl_Text_Buffer::match_bytes_(int pos, const char *s, int n, int fold) const
+{
+  if (pos < 0 || pos + n > mLength)
+    return 0;
+  while (n > 0) {
+    int segStart, segLength;
+    const char *seg = segment(pos, segStart, segLength);
+    int k = min(n, segStart + segLength - pos);
+    if (k <= 0 || compare_bytes(seg + (pos - segStart), s, k, fold))
+      return 0;
+    pos += k;
+    s += k;
+    n -= k;
+  }
+  return 1;
+}
+
+
+/*
+ Find bytes forward, using the Boyer-Moore-Horspool algorithm inside of
+ each segment, and memchr() for single bytes. Matches that span two
+ segments are compared separately.
+ */
+int Fl_Text_Buffer::find_bytes_(int startPos, const char *s, int n,
+                                int fold) const
+{
+  if (n <= 0)
+    return -1;
+  int skip[256];
+  for (int i = 0; i < 256; i++)
+    skip[i] = n;
+  for (int i = 0; i < n - 1; i++)
+    set_skip(skip, (unsigned char) (fold ? fold_byte(s[i]) : s[i]), n - 1 - i, fold);
+  unsigned char lastByte = fold ? fold_byte(s[n - 1]) : s[n - 1];
+
+  int pos = max(startPos, 0);
+  while (pos + n <= mLength) {
+    int segStart, segLength;
+    const char *seg = segment(pos, segStart, segLength);
+    int segEnd = segStart + segLength;
+    if (pos + n > segEnd) {		// match would span segments
+      if (match_bytes_(pos, s, n, fold))
+        return pos;
+      pos++;
+      continue;
+    }
+    const char *t = seg + (pos - segStart);
+    const char *last = seg + (segEnd - segStart) - n;
+    if (n == 1 && !fold) {
+      const char *f = (const char *) memchr(t, *s, last - t + 1);
+      if (f)
+        return segStart + (int) (f - seg);
+      pos = segEnd;
+      continue;
+    }
+    while (t <= last) {
+      unsigned char c = (unsigned char) t[n - 1];
+      if ((fold ? fold_byte(c) : c) == lastByte &&
+          !compare_bytes(t, s, n - 1, fold))
+        return segStart + (int) (t - seg);
+      t += skip[c];
+    }
+    pos = segStart + (int) (t - seg);
+  }
+  return -1;
+}
+
+
+/*
+ Find bytes backward, with a mirrored Boyer-Moore-Horspool algorithm.
+ */
+int Fl_Text_Buffer::rfind_bytes_(int startPos, const char *s, int n,
+                                 int fold) const
+{
+  if (n <= 0)
+    return -1;
+  int skip[256];
+  for (int i = 0; i < 256; i++)
+    skip[i] = n;
+  for (int i = n - 1; i > 0; i--)
+    set_skip(skip, (unsigned char) (fold ? fold_byte(s[i]) : s[i]), i, fold);
+  unsigned char firstByte = fold ? fold_byte(s[0]) : s[0];
+
+  int pos = min(startPos, mLength - n);
+  while (pos >= 0) {
+    int segStart, segLength;
+    const char *seg = segment(pos, segStart, segLength);
+    if (pos + n > segStart + segLength) {	// match would span segments
+      if (match_bytes_(pos, s, n, fold))
+        return pos;
+      pos--;
+      continue;
+    }
+    const char *t = seg + (pos - segStart);
+    if (n == 1 && !fold) {
+      const char *f = find_byte_backward(seg, (int) (t - seg) + 1, *s);
+      if (f)
+        return segStart + (int) (f - seg);
+      pos = segStart - 1;
+      continue;
+    }
+    while (t >= seg) {
+      unsigned char c = (unsigned char) *t;
+      if ((fold ? fold_byte(c) : c) == firstByte &&
+          !compare_bytes(t + 1, s + 1, n - 1, fold))
+        return segStart + (int) (t - seg);
+      t -= skip[c];
+    }
+    pos = segStart + (int) (t - seg);
+  }
+  return -1;
+}
+
+
 /*
  Count the number of newline characters between start and end.
  startPos and endPos must be at a character boundary.
@@ -914,22 +1237,19 @@ int Fl_Text_Buffer::count_lines(int startPos, int endPos) const {
   IS_UTF8_ALIGNED2(this, (startPos))
   IS_UTF8_ALIGNED2(this, (endPos))
   
-  int gapLen = mGapEnd - mGapStart;
   int lineCount = 0;
+  if (endPos < startPos || endPos > mLength)
+    endPos = mLength;
   
   int pos = startPos;
-  while (pos < mGapStart)
-  {
-    if (pos == endPos)
-      return lineCount;
-    if (mBuf[pos++] == '\n')
-      lineCount++;
-  } 
-  while (pos < mLength) {
-    if (pos == endPos)
-      return lineCount;
-    if (mBuf[pos++ + gapLen] == '\n')
-      lineCount++;
+  while (pos < endPos) {
+    int segStart, segLength;
+    const char *seg = segment(pos, segStart, segLength);
+    int n = min(segStart + segLength, endPos) - pos;
+    if (n <= 0)
+      break;
+    lineCount += count_byte(seg + (pos - segStart), n, '\n');
+    pos += n;
   }
   return lineCount;
 }
@@ -947,26 +1267,23 @@ int Fl_Text_Buffer::skip_lines(int startPos, int nLines)
   if (nLines == 0)
     return startPos;
   
-  int gapLen = mGapEnd - mGapStart;
   int pos = startPos;
   int lineCount = 0;
-  while (pos < mGapStart) {
-    if (mBuf[pos++] == '\n') {
-      lineCount++;
-      if (lineCount == nLines) {
-        IS_UTF8_ALIGNED2(this, (pos))
-	return pos;
-      }
-    }
-  }
   while (pos < mLength) {
-    if (mBuf[pos++ + gapLen] == '\n') {
+    int segStart, segLength;
+    const char *seg = segment(pos, segStart, segLength);
+    const char *p = seg + (pos - segStart);
+    const char *e = seg + segLength;
+    while ((p = (const char *) memchr(p, '\n', e - p)) != NULL) {
+      p++;
       lineCount++;
       if (lineCount >= nLines) {
+        pos = segStart + (int) (p - seg);
         IS_UTF8_ALIGNED2(this, (pos))
-	return pos;
+        return pos;
       }
     }
+    pos = segStart + segLength;
   }
   IS_UTF8_ALIGNED2(this, (pos))
   return pos;
@@ -985,26 +1302,24 @@ int Fl_Text_Buffer::rewind_lines(int startPos, int nLines)
   int pos = startPos - 1;
   if (pos <= 0)
     return 0;
+  if (pos >= mLength)
+    pos = mLength - 1;
   
-  int gapLen = mGapEnd - mGapStart;
   int lineCount = -1;
-  while (pos >= mGapStart) {
-    if (mBuf[pos + gapLen] == '\n') {
-      if (++lineCount >= nLines) {
-        IS_UTF8_ALIGNED2(this, (pos+1))
-	return pos + 1;
-      }
-    }
-    pos--;
-  }
   while (pos >= 0) {
-    if (mBuf[pos] == '\n') {
+    int segStart, segLength;
+    const char *seg = segment(pos, segStart, segLength);
+    int n = pos - segStart + 1;
+    const char *p;
+    while ((p = find_byte_backward(seg, n, '\n')) != NULL) {
       if (++lineCount >= nLines) {
-        IS_UTF8_ALIGNED2(this, (pos+1))
-	return pos + 1;
+        pos = segStart + (int) (p - seg) + 1;
+        IS_UTF8_ALIGNED2(this, (pos))
+        return pos;
       }
+      n = (int) (p - seg);
     }
-    pos--;
+    pos = segStart - 1;
   }
   return 0;
 }
@@ -1023,45 +1338,36 @@ int Fl_Text_Buffer::search_forward(int startPos, const char *searchString,
     return 0;
   int bp;
   const char *sp;
-  if (matchCase) {
-    while (startPos < length()) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        char c = *sp;
-        // we reached the end of the "needle", so we found the string!
-        if (!c) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int l = fl_utf8len1(c);
-        if (memcmp(sp, address(bp), l))
-          break;
-        sp += l; bp += l;
-      }
-      startPos = next_char(startPos);
-    }
-  } else {
-    while (startPos < length()) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        // we reached the end of the "needle", so we found the string!
-        if (!*sp) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int l;
-        unsigned int b = char_at(bp);
-        unsigned int s = fl_utf8decode(sp, 0, &l);
-        if (fl_tolower(b)!=fl_tolower(s))
-          break;
-        sp += l; 
-        bp = next_char(bp);
+  if (matchCase || is_ascii(searchString)) {
+    // compare bytes, ASCII letters without case unless matchCase is set
+    if (startPos >= length())
+      return 0;
+    int n = (int) strlen(searchString);
+    bp = n ? find_bytes_(startPos, searchString, n, !matchCase) : startPos;
+    if (bp < 0)
+      return 0;
+    *foundPos = bp;
+    return 1;
+  }
+  while (startPos < length()) {
+    bp = startPos;
+    sp = searchString;
+    for (;;) {
+      // we reached the end of the "needle", so we found the string!
+      if (!*sp) {
+        *foundPos = startPos;
+        return 1;
       }
-      startPos = next_char(startPos);
+      int l;
+      unsigned int b = char_at(bp);
+      unsigned int s = fl_utf8decode(sp, 0, &l);
+      if (fl_tolower(b)!=fl_tolower(s))
+        break;
+      sp += l;
+      bp = next_char(bp);
     }
-  }  
+    startPos = next_char(startPos);
+  }
   return 0;
 }
 
@@ -1075,45 +1381,36 @@ int Fl_Text_Buffer::search_backward(int startPos, const char *searchString,
     return 0;
   int bp;
   const char *sp;
-  if (matchCase) {
-    while (startPos >= 0) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        char c = *sp;
-        // we reached the end of the "needle", so we found the string!
-        if (!c) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int l = fl_utf8len1(c);
-        if (memcmp(sp, address(bp), l))
-          break;
-        sp += l; bp += l;
-      }
-      startPos = prev_char(startPos);
-    }
-  } else {
-    while (startPos >= 0) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        // we reached the end of the "needle", so we found the string!
-        if (!*sp) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int l;
-        unsigned int b = char_at(bp);
-        unsigned int s = fl_utf8decode(sp, 0, &l);
-        if (fl_tolower(b)!=fl_tolower(s))
-          break;
-        sp += l; 
-        bp = next_char(bp);
+  if (matchCase || is_ascii(searchString)) {
+    // compare bytes, ASCII letters without case unless matchCase is set
+    if (startPos < 0)
+      return 0;
+    int n = (int) strlen(searchString);
+    bp = n ? rfind_bytes_(startPos, searchString, n, !matchCase) : startPos;
+    if (bp < 0)
+      return 0;
+    *foundPos = bp;
+    return 1;
+  }
+  while (startPos >= 0) {
+    bp = startPos;
+    sp = searchString;
+    for (;;) {
+      // we reached the end of the "needle", so we found the string!
+      if (!*sp) {
+        *foundPos = startPos;
+        return 1;
       }
-      startPos = prev_char(startPos);
+      int l;
+      unsigned int b = char_at(bp);
+      unsigned int s = fl_utf8decode(sp, 0, &l);
+      if (fl_tolower(b)!=fl_tolower(s))
+        break;
+      sp += l;
+      bp = next_char(bp);
     }
-  }  
+    startPos = prev_char(startPos);
+  }
   return 0;
 }
 
@@ -1128,22 +1425,37 @@ int Fl_Text_Buffer::insert_(int pos, const char *text)
   if (!text || !*text)
     return 0;
   
-  int insertedLength = (int) strlen(text);
+  return insert_(pos, text, (int) strlen(text));
+}
+
+
+/*
+ Insert a string of known length into the buffer.
+ Pos must be at a character boundary.
+ */
+int Fl_Text_Buffer::insert_(int pos, const char *text, int insertedLength)
+{
+  if (insertedLength <= 0)
+    return 0;
   
-  /* Prepare the buffer to receive the new text.  If the new text fits in
-   the current buffer, just move the gap (if necessary) to where
-   the text should be inserted.  If the new text is too large, reallocate
-   the buffer with a gap large enough to accomodate the new text and a
-   gap of mPreferredGapSize */
-  if (insertedLength > mGapEnd - mGapStart)
-    reallocate_with_gap(pos, insertedLength + mPreferredGapSize);
-  else if (pos != mGapStart)
-    move_gap(pos);
-  
-  /* Insert the new text (pos now corresponds to the start of the gap) */
-  memcpy(&mBuf[pos], text, insertedLength);
-  mGapStart += insertedLength;
-  mLength += insertedLength;
+  if (mPieceTable) {
+    insert_pieces_(pos, text, insertedLength);
+  } else {
+    /* Prepare the buffer to receive the new text.  If the new text fits in
+     the current buffer, just move the gap (if necessary) to where
+     the text should be inserted.  If the new text is too large, reallocate
+     the buffer with a gap large enough to accomodate the new text and a
+     gap of mPreferredGapSize */
+    if (insertedLength > mGapEnd - mGapStart)
+      reallocate_with_gap(pos, insertedLength + mPreferredGapSize);
+    else if (pos != mGapStart)
+      move_gap(pos);
+    
+    /* Insert the new text (pos now corresponds to the start of the gap) */
+    memcpy(&mBuf[pos], text, insertedLength);
+    mGapStart += insertedLength;
+    mLength += insertedLength;
+  }
   update_selections(pos, 0, insertedLength);
   
   if (mCanUndo) {
@@ -1185,6 +1497,14 @@ void Fl_Text_Buffer::remove_(int start, int end)
     undowidget = this;
   }
   
+  if (mPieceTable) {
+    if (mCanUndo)
+      copy_range_(start, end, undobuffer);
+    remove_pieces_(start, end);
+    update_selections(start, end - start, 0);
+    return;
+  }
+
   if (start > mGapStart) {
     if (mCanUndo)
       memcpy(undobuffer, mBuf + (mGapEnd - mGapStart) + start,
@@ -1434,6 +1754,199 @@ void Fl_Text_Buffer::reallocate_with_gap(int newGapStart, int newGapLen)
 }
 
 
+/*
+ Return the contiguous block of text that contains pos.
+ */
+const char *Fl_Text_Buffer::segment(int pos, int &segStart, int &segLength) const
+{
+  if (!mPieceTable) {
+    if (pos < mGapStart) {
+      segStart = 0;
+      segLength = mGapStart;
+      return mBuf;
+    }
+    segStart = mGapStart;
+    segLength = mLength - mGapStart;
+    return mBuf + mGapEnd;
+  }
+
+  Fl_Text_Piece *p = mPieceHint;
+  int base = mPieceHintStart;
+  if (!p || pos < base || pos >= base + p->length) {
+    p = mPieces;
+    base = 0;
+    while (p) {
+      int leftSize = piece_size(p->left);
+      if (pos < base + leftSize) {
+	p = p->left;
+      } else if (pos < base + leftSize + p->length) {
+	base += leftSize;
+	break;
+      } else {
+	base += leftSize + p->length;
+	p = p->right;
+      }
+    }
+    if (!p) {			// pos is out of range
+      segStart = mLength;
+      segLength = 0;
+      return "";
+    }
+    mPieceHint = p;
+    mPieceHintStart = base;
+  }
+  segStart = base;
+  segLength = p->length;
+  return (p->added ? mAddBuf : mOriginal) + p->offset;
+}
+
+
+/*
+ Return the address of pos in the piece table.
+ */
+const char *Fl_Text_Buffer::piece_address(int pos) const
+{
+  if (pos < 0 || pos >= mLength)
+    return "";
+  int segStart, segLength;
+  const char *seg = segment(pos, segStart, segLength);
+  return seg + (pos - segStart);
+}
+
+
+/*
+ Copy a range of text, in either storage engine.
+ */
+void Fl_Text_Buffer::copy_range_(int start, int end, char *dest) const
+{
+  while (start < end) {
+    int segStart, segLength;
+    const char *seg = segment(start, segStart, segLength);
+    int n = min(segStart + segLength, end) - start;
+    if (n <= 0)
+      break;
+    memcpy(dest, seg + (start - segStart), n);
+    dest += n;
+    start += n;
+  }
+}
+
+
+/*
+ Insert text into the piece table.
+ Typing appends to the last added piece instead of creating new ones.
+ */
+void Fl_Text_Buffer::insert_pieces_(int pos, const char *text, int length)
+{
+  if (length <= 0)
+    return;
+
+  if (mAddLength + length > mAddSize) {
+    mAddSize = max(2 * mAddSize, mAddLength + length + mPreferredGapSize);
+    mAddBuf = (char *) realloc(mAddBuf, mAddSize);
+  }
+  memcpy(mAddBuf + mAddLength, text, length);
+
+  Fl_Text_Piece *l, *r;
+  split_pieces(mPieces, pos, l, r);
+  Fl_Text_Piece *last = l;
+  while (last && last->right)
+    last = last->right;
+  if (last && last->added && last->offset + last->length == mAddLength) {
+    last->length += length;
+    for (Fl_Text_Piece *p = l; p; p = p->right)
+      p->size += length;
+  } else {
+    l = merge_pieces(l, new_piece(1, mAddLength, length, next_priority()));
+  }
+  mPieces = merge_pieces(l, r);
+  mAddLength += length;
+  mLength += length;
+  mPieceHint = 0;
+}
+
+
+/*
+ Remove text from the piece table.
+ */
+void Fl_Text_Buffer::remove_pieces_(int start, int end)
+{
+  Fl_Text_Piece *l, *m, *r;
+  split_pieces(mPieces, start, l, m);
+  split_pieces(m, end - start, m, r);
+  free_piece_tree(m);
+  mPieces = merge_pieces(l, r);
+  mLength -= end - start;
+  mPieceHint = 0;
+}
+
+
+/*
+ Free the piece table, but keep the storage engine.
+ */
+void Fl_Text_Buffer::free_pieces_()
+{
+  free_piece_tree(mPieces);
+  free(mOriginal);
+  free(mAddBuf);
+  mPieces = 0;
+  mOriginal = 0;
+  mAddBuf = 0;
+  mAddLength = mAddSize = 0;
+  mPieceHint = 0;
+  mPieceHintStart = 0;
+}
+
+
+/**
+ Sets the storage engine of the buffer.
+
+ GAP_BUFFER, the default, keeps the text in one block of memory with a gap
+ at the position of the last change. Changes near the previous one are
+ very fast, but every change elsewhere moves all the text in between, and
+ the whole text must fit into one block of memory.
+
+ PIECE_TABLE keeps the original text unchanged and stores inserted text in
+ a separate append-only block. The buffer text is described by a balanced
+ tree of pieces of these two blocks, so that inserting and removing text
+ anywhere takes O(log n) time, regardless of the size of the text. Access
+ to single characters is somewhat slower than with a gap buffer.
+
+ The text, the selections and the undo information are kept. No callbacks
+ are called, since the text does not change.
+
+ \param engine GAP_BUFFER or PIECE_TABLE
+ \version 1.4.0
+ */
+void Fl_Text_Buffer::storage(int engine)
+{
+  if ((engine == PIECE_TABLE) == (mPieceTable != 0))
+    return;
+
+  if (engine == PIECE_TABLE) {
+    char *t = (char *) malloc(mLength + 1);
+    copy_range_(0, mLength, t);
+    free((void *) mBuf);
+    mBuf = (char *) malloc(mPreferredGapSize);
+    mGapStart = 0;
+    mGapEnd = mPreferredGapSize;
+    mPieceTable = 1;
+    mOriginal = t;
+    if (mLength)
+      mPieces = new_piece(0, 0, mLength, next_priority());
+  } else {
+    char *newBuf = (char *) malloc(mLength + mPreferredGapSize);
+    copy_range_(0, mLength, newBuf);
+    free((void *) mBuf);
+    mBuf = newBuf;
+    mGapStart = mLength;
+    mGapEnd = mLength + mPreferredGapSize;
+    free_pieces_();
+    mPieceTable = 0;
+  }
+}
+
+
 /*
  Update selection range if characters were inserted.
  Unicode safe. Pos must be at a character boundary.
@@ -1485,11 +1998,11 @@ int Fl_Text_Buffer::findchar_forward(int startPos, unsigned searchChar,
   if (startPos<0)
     startPos = 0;
   
-  for ( ; startPos<mLength; startPos = next_char(startPos)) {
-    if (searchChar == char_at(startPos)) {
-      *foundPos = startPos;
-      return 1;
-    }
+  char c[5];
+  int pos = find_bytes_(startPos, c, fl_utf8encode(searchChar, c), 0);
+  if (pos >= 0) {
+    *foundPos = pos;
+    return 1;
   }
   
   *foundPos = mLength;
@@ -1511,11 +2024,11 @@ int Fl_Text_Buffer::findchar_backward(int startPos, unsigned int searchChar,
   if (startPos > mLength)
     startPos = mLength;
   
-  for (startPos = prev_char(startPos); startPos>=0; startPos = prev_char(startPos)) {
-    if (searchChar == char_at(startPos)) {
-      *foundPos = startPos;
-      return 1;
-    }
+  char c[5];
+  int pos = rfind_bytes_(startPos - 1, c, fl_utf8encode(searchChar, c), 0);
+  if (pos >= 0) {
+    *foundPos = pos;
+    return 1;
   }
   
   *foundPos = 0;
@@ -1666,11 +2179,170 @@ static int utf8_input_filter(char *buffer, 		// result buffer we fill with utf8
   return (int) (q - buffer);
 }
 
+#if !defined(_WIN32) && !defined(EXAMPLE_ENCODING)
+
+/*
+ Bytes of a mapped file that are checked and inserted at a time, and how
+ often the progress callback is called.
+ */
+#define MAPPED_CHUNK (1024 * 1024)
+
+/*
+ Return the first byte from p to end that utf8_input_filter() would
+ change: a nul byte, or a byte that is not part of a valid UTF-8
+ sequence. Runs of ASCII text are skipped a word at a time.
+ */
+static const char *utf8_check(const char *p, const char *end)
+{
+  while (p < end) {
+    while (end - p >= (int) sizeof(unsigned long)) {
+      unsigned long w;
+      memcpy(&w, p, sizeof(w));
+      // stop at any byte >= 0x80 or == 0
+      if ((w & highs) || has_byte(w, 0))
+        break;
+      p += sizeof(w);
+    }
+    if (p >= end)
+      break;
+    unsigned char c = (unsigned char) *p;
+    if (c == 0)
+      return p;
+    if (c < 0x80) {
+      p++;
+      continue;
+    }
+    int l = fl_utf8len1(c), lp;
+    char multibyte[5];
+    if (end - p < l)
+      return p;
+    unsigned u = fl_utf8decode(p, p + l, &lp);
+    if (lp != l || fl_utf8encode(u, multibyte) != l)
+      return p;
+    p += l;
+  }
+  return end;
+}
+
+/*
+ Transcode from p to end the way utf8_input_filter() does, but drop nul
+ bytes. The output buffer must hold 3 bytes per input byte.
+ Returns #bytes written to 'out'.
+ */
+static int utf8_transcode(const char *p, const char *end, char *out)
+{
+  char *q = out;
+  while (p < end) {
+    int l = fl_utf8len1(*p), lp;
+    if (end - p < l)
+      l = (int) (end - p);
+    while (l > 0) {
+      unsigned u = fl_utf8decode(p, p + l, &lp);
+      if (u)
+        q += fl_utf8encode(u, q);
+      p += lp;
+      l -= lp;
+    }
+  }
+  return (int) (q - out);
+}
+
+#endif // !_WIN32 && !EXAMPLE_ENCODING
+
 const char *Fl_Text_Buffer::file_encoding_warning_message = 
 "Displayed text contains the UTF-8 transcoding\n"
 "of the input file which was not UTF-8 encoded.\n"
 "Some changes may have occurred.";
 
+/*
+ Read a regular file through a memory mapping.
+ The text is copied from the mapping straight into the buffer, only the
+ parts that need transcoding are copied through a temporary buffer. The
+ buffer is updated in chunks, but the callbacks are called only once.
+ The mapping is released before returning, but if another process
+ truncates the file while it is copied, the copy can still raise SIGBUS.
+ */
+int Fl_Text_Buffer::insertfile_mapped_(const char *file, int pos)
+{
+#if defined(_WIN32) || defined(EXAMPLE_ENCODING)
+  // On Windows, files are read in text mode, which converts line endings
+  return -1;
+#else
+  /* Opening a fifo would block, and take the writer from the streaming
+   path, so only regular files are opened here */
+  struct stat st;
+  if (fl_stat(file, &st) || !S_ISREG(st.st_mode))
+    return -1;
+  int fd = fl_open(file, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+      st.st_size >= INT_MAX - mLength - mPreferredGapSize) {
+    close(fd);
+    return -1;
+  }
+  int size = (int) st.st_size;
+  void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return -1;
+#ifdef MADV_SEQUENTIAL
+  madvise(map, size, MADV_SEQUENTIAL);
+#endif
+
+  if (pos > mLength)
+    pos = mLength;
+  if (pos < 0)
+    pos = 0;
+
+  /* Make room for the whole file at once, transcoding may need more */
+  if (mPieceTable) {
+    if (mAddSize - mAddLength < size) {
+      mAddSize = mAddLength + size + mPreferredGapSize;
+      mAddBuf = (char *) realloc(mAddBuf, mAddSize);
+    }
+  } else if (mGapEnd - mGapStart < size) {
+    reallocate_with_gap(pos, size + mPreferredGapSize);
+  }
+
+  call_predelete_callbacks(pos, 0);
+  input_file_was_transcoded = false;
+  const char *p = (const char *) map, *end = p + size;
+  char *buffer = NULL;
+  int nInserted = 0;
+  while (p < end) {
+    const char *e = (end - p > MAPPED_CHUNK) ? p + MAPPED_CHUNK : end;
+    if (e < end) {
+      /* Don't split a UTF-8 sequence between chunks */
+      const char *c = e;
+      while (c > p && (*c & 0xc0) == 0x80 && e - c < 5)
+        c--;
+      if (c > p) e = c;
+    }
+    const char *bad = utf8_check(p, e);
+    nInserted += insert_(pos + nInserted, p, (int) (bad - p));
+    if (bad < e) {
+      if (!buffer)
+        buffer = (char *) malloc(3 * MAPPED_CHUNK);
+      nInserted += insert_(pos + nInserted, buffer,
+                           utf8_transcode(bad, e, buffer));
+      input_file_was_transcoded = true;
+    }
+    p = e;
+    if (mProgressCb)
+      (*mProgressCb)((int) (p - (const char *) map), size, mProgressCbArg);
+  }
+  free(buffer);
+  munmap(map, size);
+
+  mCursorPosHint = pos + nInserted;
+  call_modify_callbacks(pos, 0, nInserted, 0, NULL);
+  if (input_file_was_transcoded && transcoding_warning_action)
+    transcoding_warning_action(this);
+  return 0;
+#endif // _WIN32 || EXAMPLE_ENCODING
+}
+
 /*
  Insert text from a file.
  Input file can be of various encodings according to what input fiter is used.
@@ -1679,9 +2351,24 @@ const char *Fl_Text_Buffer::file_encoding_warning_message =
  */
  int Fl_Text_Buffer::insertfile(const char *file, int pos, int buflen)
 {
+  int e = insertfile_mapped_(file, pos);
+  if (e >= 0)
+    return e;
+
   FILE *fp;
   if (!(fp = fl_fopen(file, "r")))
     return 1;
+  int size = 0;
+  if (fseek(fp, 0, SEEK_END) == 0) {
+    long l = ftell(fp);
+    if (l > 0 && l < INT_MAX)
+      size = (int) l;
+  }
+  rewind(fp);
+  /* Make room for the whole file, instead of growing the gap per block */
+  if (!mPieceTable && mGapEnd - mGapStart < size &&
+      size < INT_MAX - mLength - mPreferredGapSize)
+    reallocate_with_gap(max(0, min(pos, mLength)), size + mPreferredGapSize);
   char *buffer = new char[buflen + 1];  
   char *endline, line[100];
   int l;
@@ -1700,11 +2387,21 @@ const char *Fl_Text_Buffer::file_encoding_warning_message =
 			  fp, &input_file_was_transcoded);
 #endif
     if (l == 0) break;
+    /* Drop nul bytes as the mapped path does, insert() would stop there */
+    char *q = (char *) memchr(buffer, 0, l);
+    if (q) {
+      for (char *p = q; p < buffer + l; p++)
+        if (*p) *q++ = *p;
+      l = (int) (q - buffer);
+      input_file_was_transcoded = true;
+    }
     buffer[l] = 0;
     insert(pos, buffer);
     pos += l;
+    if (mProgressCb)
+      (*mProgressCb)((int) ftell(fp), size, mProgressCbArg);
   }
-  int e = ferror(fp) ? 2 : 0;
+  e = ferror(fp) ? 2 : 0;
   fclose(fp);
   delete[]buffer;
   if ( (!e) && input_file_was_transcoded && transcoding_warning_action) {
@@ -107,6 +107,7 @@ Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L
   _toh = _tih = H - Fl::box_dh(box());
   _tree_w = -1;
   _tree_h = -1;
+  _layout_gen = 1;
   end();
 }
 
@@ -330,6 +331,7 @@ int Fl_Tree::handle(int e) {
 	      set_item_focus(next_visible_item(_item_focus, ekey));	// next item up|dn
 	      if ( _item_focus ) {					// item in focus?
 	        // Autoscroll
+		update_item_xy(_item_focus);				// may be off-screen
 		int itemtop = _item_focus->y();
 		int itembot = _item_focus->y()+_item_focus->h();
 		if ( itemtop < y() ) { show_item_top(_item_focus); }
@@ -647,9 +649,14 @@ void Fl_Tree::calc_dimensions() {
 /// The tree hierarchy's size only changes when items are added/removed,
 /// open/closed, label contents or font sizes changed, margins changed, etc.
 ///
-/// This calculation involves walking the *entire* tree from top to bottom,
-/// potentially a slow calculation if the tree has many items (potentially
-/// hundreds of thousands), and should therefore be called sparingly.
+/// Each item keeps its layout: its position below its parent, and the height
+/// and width of it with its open children. Only the items that changed
+/// since, and their parents, are laid out again, so adding, removing, opening
+/// or closing items does not walk the *entire* tree. draw() and
+/// find_clicked() use the layout to skip over the items that are off-screen.
+/// After recalc_tree() though, or for the first calculation, all the items
+/// are laid out, potentially a slow calculation if the tree has many items
+/// (potentially hundreds of thousands).
 ///
 /// For this reason, recalc_tree() is used as a way to /schedule/
 /// calculation when changes affect the tree hierarchy's size.
@@ -677,8 +684,17 @@ void Fl_Tree::calc_tree() {
     W += _prefs.openicon()->w();
   }
   int xmax = 0, render = 0, ytop = Y;
-  fl_font(_prefs.labelfont(), _prefs.labelsize());
-  _root->draw(X, Y, W, 0, xmax, 1, render);		// descend into tree without drawing (render=0)
+  if ( _root->_layout_gen == _layout_gen ) {		// nothing changed? use root's layout
+    Y += _root->_layout_h;
+    if ( _root->_layout_w >= 0 ) xmax = X + _root->_layout_w;
+  } else {
+    fl_font(_prefs.labelfont(), _prefs.labelsize());
+    _root->draw(X, Y, W, 0, xmax, 1, render);		// descend into tree without drawing (render=0)
+    _root->_layout_y   = 0;				// save root's layout
+    _root->_layout_h   = Y - ytop;
+    _root->_layout_w   = xmax ? xmax - X : -1;
+    _root->_layout_gen = _layout_gen;
+  }
   // Save computed tree width and height
   _tree_w = _prefs.marginleft() + xmax - X;		// include margin in tree's width
   _tree_h = _prefs.margintop()  + Y - ytop;		// include margin in tree's height
@@ -832,6 +848,67 @@ Fl_Tree_Item* Fl_Tree::add(const char *path, Fl_Tree_Item *item) {
   return(item);
 }
 
+/// Adds many new items at once, given an array of menu style \p 'paths'.
+///
+/// This does the same as calling add(const char*,Fl_Tree_Item*) for each
+/// path, but the parents a path has in common with the path before it
+/// are not looked up again from the root. Lists in which the paths
+/// of the same parent follow each other, such as a recursive directory
+/// listing, are added fastest.
+/// \code
+///     const char *paths[] = { "usr/bin/ls", "usr/bin/cat", "usr/lib/libc.so" };
+///     tree->add(paths, 3);
+/// \endcode
+/// \param[in] paths The paths to the items, escaped as for add(const char*,Fl_Tree_Item*).
+/// \param[in] npaths The number of paths.
+/// \returns The number of new items added, including the parents that
+///           were created for the paths. Paths that are already in the
+///           tree add nothing.
+/// \version 1.4.0
+///
+int Fl_Tree::add(const char * const *paths, int npaths) {
+  // Tree has no root? make one
+  if ( ! _root ) {
+    _root = new Fl_Tree_Item(this);
+    _root->parent(0);
+    _root->label("ROOT");
+  }
+  int count = 0, depth = 0, maxdepth = 0;
+  char **prev = 0;			// elements of the previous path
+  Fl_Tree_Item **items = 0;		// items of the previous path's elements
+  for ( int t=0; t<npaths; t++ ) {
+    char **arr = parse_path(paths[t]);
+    int n = 0;
+    while ( arr[n] ) n++;
+    if ( n > maxdepth ) {
+      maxdepth = n * 2;
+      Fl_Tree_Item **newitems = new Fl_Tree_Item*[maxdepth];
+      if ( depth ) memcpy(newitems, items, depth * sizeof(Fl_Tree_Item*));
+      delete[] items;
+      items = newitems;
+    }
+    // Skip the elements in common with the previous path
+    int e = 0;
+    while ( e < n && e < depth && strcmp(arr[e], prev[e]) == 0 ) e++;
+    Fl_Tree_Item *parent = e ? items[e-1] : _root;
+    // Find or add the others
+    for ( ; e < n; e++ ) {
+      Fl_Tree_Item *item = parent->find_child_item(arr[e]);
+      if ( !item ) {
+        item = parent->add(_prefs, arr[e]);
+        count++;
+      }
+      items[e] = parent = item;
+    }
+    free_path(prev);
+    prev = arr;
+    depth = n;
+  }
+  free_path(prev);
+  delete[] items;
+  return(count);
+}
+
 
 /// Add a new child item labeled \p 'name' to the specified \p 'parent_item'.
 ///
@@ -2314,6 +2391,7 @@ void Fl_Tree::item_draw_mode(int mode) {
 int Fl_Tree::displayed(Fl_Tree_Item *item) {
   item = item ? item : first();
   if (!item) return(0);
+  update_item_xy(item);
   return( (item->y() >= y()) && (item->y() <= (y()+h()-item->h())) ? 1 : 0);
 }
 
@@ -2334,6 +2412,7 @@ int Fl_Tree::displayed(Fl_Tree_Item *item) {
 void Fl_Tree::show_item(Fl_Tree_Item *item, int yoff) {
   item = item ? item : first();
   if (!item) return;
+  update_item_xy(item);
   int newval = item->y() - y() - yoff + (int)_vscroll->value();
   if ( newval < _vscroll->minimum() ) newval = (int)_vscroll->minimum();
   if ( newval > _vscroll->maximum() ) newval = (int)_vscroll->maximum();
@@ -2632,10 +2711,41 @@ void Fl_Tree::fix_scrollbar_order() {
 }
 
 /// Schedule tree to recalc the entire tree size.
+/// Unlike the recalculation scheduled by changes to items,
+/// which only lays out the items that changed, this lays out all of them.
 /// \note Must be using FLTK ABI 1.3.3 or higher for this to be effective.
 ///
 void Fl_Tree::recalc_tree() {
   _tree_w = _tree_h = -1;
+  if ( ++_layout_gen == 0 ) _layout_gen = 1;	// forget all the items' layouts (0 means 'stale')
+}
+
+// INTERNAL: Update the position of \p 'item' from the items' layout.
+//
+//    draw() skips over items that are scrolled off-screen,
+//    so their x() and y() are where they were when last drawn.
+//    Needed before using the position of an item that may not be displayed.
+//
+void Fl_Tree::update_item_xy(Fl_Tree_Item *item) {
+  if ( !item || !_root ) return;
+  int X = _root->_xywh[0];
+  int Y = _root->_xywh[1];
+  for ( Fl_Tree_Item *i = item; i != _root; i = i->_parent ) {
+    Fl_Tree_Item *p = i->_parent;
+    if ( !p || p->_layout_gen != _layout_gen || !p->is_open() ) return;	// no layout
+    X += i->_layout_x;
+    Y += i->_layout_y;
+  }
+  int dx = X - item->_xywh[0];
+  int dy = Y - item->_xywh[1];
+  item->_xywh[0] += dx;
+  item->_xywh[1] += dy;
+  item->_xywh[2] = _root->_xywh[0] + _root->_xywh[2] - X;
+  item->_label_xywh[0] += dx;
+  item->_label_xywh[1] += dy;
+  item->_label_xywh[2] = _tix + _tiw - item->_label_xywh[0];
+  item->_collapse_xywh[0] += dx;
+  item->_collapse_xywh[1] += dy;
 }
 
 //
@@ -73,6 +73,11 @@ void Fl_Tree_Item::_Init(const Fl_Tree_Prefs &prefs, Fl_Tree *tree) {
   _children.manage_item_destroy(1);	// let array's dtor manage destroying Fl_Tree_Items
   _prev_sibling     = 0;
   _next_sibling     = 0;
+  _layout_gen       = 0;		// not laid out yet
+  _layout_x         = 0;
+  _layout_y         = 0;
+  _layout_h         = 0;
+  _layout_w         = -1;
 }
 
 /// Constructor.
@@ -129,6 +134,11 @@ Fl_Tree_Item::Fl_Tree_Item(const Fl_Tree_Item *o) {
   _parent           = o->_parent;
   _prev_sibling     = 0;		// do not copy ptrs! use update_prev_next()
   _next_sibling     = 0;		// do not copy ptrs! use update_prev_next()
+  _layout_gen       = 0;		// not laid out yet
+  _layout_x         = 0;
+  _layout_y         = 0;
+  _layout_h         = 0;
+  _layout_w         = -1;
 }
 
 /// Print the tree as 'ascii art' to stdout.
@@ -157,6 +167,7 @@ void Fl_Tree_Item::show_self(const char *indent) const {
 void Fl_Tree_Item::label(const char *name) {
   if ( _label ) { free((void*)_label); _label = 0; }
   _label = name ? strdup(name) : 0;
+  if ( _parent ) _parent->_children.reindex();	// parent's label index is stale
   recalc_tree();		// may change label geometry
 }
 
@@ -183,13 +194,8 @@ void Fl_Tree_Item::clear_children() {
 /// \version 1.3.0 release
 ///
 int Fl_Tree_Item::find_child(const char *name) {
-  if ( name ) {
-    for ( int t=0; t<children(); t++ )
-      if ( child(t)->label() )
-        if ( strcmp(child(t)->label(), name) == 0 )
-          return(t);
-  }
-  return(-1);
+  Fl_Tree_Item *item = _children.find(name);
+  return(item ? find_child(item) : -1);
 }
 
 /// Return the /immediate/ child of current item
@@ -199,12 +205,7 @@ int Fl_Tree_Item::find_child(const char *name) {
 /// \version 1.3.3
 ///
 const Fl_Tree_Item* Fl_Tree_Item::find_child_item(const char *name) const {
-  if ( name )
-    for ( int t=0; t<children(); t++ )
-      if ( child(t)->label() )
-        if ( strcmp(child(t)->label(), name) == 0 )
-          return(child(t));
-  return(0);
+  return(_children.find(name));
 }
 
 /// Non-const version of Fl_Tree_Item::find_child_item(const char *name) const.
@@ -222,18 +223,10 @@ Fl_Tree_Item* Fl_Tree_Item::find_child_item(const char *name) {
 /// \version 1.3.0 release
 ///
 const Fl_Tree_Item *Fl_Tree_Item::find_child_item(char **arr) const {
-  for ( int t=0; t<children(); t++ ) {
-    if ( child(t)->label() ) {
-      if ( strcmp(child(t)->label(), *arr) == 0 ) {	// match?
-        if ( *(arr+1) ) {				// more in arr? descend
-          return(_children[t]->find_child_item(arr+1));
-        } else {					// end of arr? done
-          return(_children[t]);
-        }
-      }
-    }
-  }
-  return(0);
+  const Fl_Tree_Item *item = _children.find(*arr);
+  if ( item && *(arr+1) )				// more in arr? descend
+    return(item->find_child_item(arr+1));
+  return(item);
 }
 
 /// Non-const version of Fl_Tree_Item::find_child_item(char **arr) const.
@@ -297,6 +290,8 @@ Fl_Tree_Item *Fl_Tree_Item::add(const Fl_Tree_Prefs &prefs,
 /// If \p 'item' is NULL, a new item is created.
 /// An internally managed copy is made of the label string.
 /// Adds the item based on the value of prefs.sortorder().
+/// When sorting, the position is found with a binary search, so the children
+/// should already be in that order, as they are if they were all added with it.
 /// \returns the item added
 /// \version 1.3.3
 ///
@@ -312,26 +307,20 @@ Fl_Tree_Item *Fl_Tree_Item::add(const Fl_Tree_Prefs &prefs,
       _children.add(item);
       return(item);
     }
-    case FL_TREE_SORT_ASCENDING: {
-      for ( int t=0; t<_children.total(); t++ ) {
-        Fl_Tree_Item *c = _children[t];
-        if ( c->label() && strcmp(c->label(), new_label) > 0 ) {
-          _children.insert(t, item);
-          return(item);
-        }
-      }
-      _children.add(item);
-      return(item);
-    }
+    case FL_TREE_SORT_ASCENDING:
     case FL_TREE_SORT_DESCENDING: {
-      for ( int t=0; t<_children.total(); t++ ) {
-        Fl_Tree_Item *c = _children[t];
-        if ( c->label() && strcmp(c->label(), new_label) < 0 ) {
-          _children.insert(t, item);
-          return(item);
-        }
+      // Binary search for the first child that sorts after the new label.
+      // Children added this way are in order, so items with equal labels
+      // keep the order they were added in.
+      int ascending = (prefs.sortorder() == FL_TREE_SORT_ASCENDING);
+      int lo = 0, hi = _children.total();
+      while ( new_label && lo < hi ) {
+        int mid = (lo + hi) / 2;
+        const char *l = _children[mid]->label();
+        int cmp = l ? strcmp(l, new_label) : 0;	// unlabeled items never sort after
+        if ( ascending ? cmp > 0 : cmp < 0 ) hi = mid; else lo = mid + 1;
       }
-      _children.add(item);
+      _children.insert(new_label ? lo : hi, item);	// no label: append
       return(item);
     }
   }
@@ -431,6 +420,7 @@ Fl_Tree_Item *Fl_Tree_Item::insert_above(const Fl_Tree_Prefs &prefs, const char
 Fl_Tree_Item* Fl_Tree_Item::deparent(int pos) {
   Fl_Tree_Item *orphan = _children[pos];
   if ( _children.deparent(pos) < 0 ) return NULL;
+  recalc_tree();		// may change tree geometry
   return orphan;
 }
 
@@ -445,6 +435,7 @@ int Fl_Tree_Item::reparent(Fl_Tree_Item *newchild, int pos) {
   int ret;
   if ( (ret = _children.reparent(newchild, this, pos)) < 0 ) return ret;
   newchild->parent(this);		// take custody
+  recalc_tree();		// may change tree geometry
   return 0;
 }
 
@@ -456,7 +447,9 @@ int Fl_Tree_Item::reparent(Fl_Tree_Item *newchild, int pos) {
 ///    - (Other return values reserved for future use)
 ///
 int Fl_Tree_Item::move(int to, int from) {
-  return _children.move(to, from);
+  if ( _children.move(to, from) < 0 ) return -1;
+  recalc_tree();		// children moved
+  return 0;
 }
 
 /// Move the current item above/below/into the specified 'item',
@@ -654,6 +647,7 @@ int Fl_Tree_Item::remove_child(const char *name) {
 ///
 void Fl_Tree_Item::swap_children(int ax, int bx) {
   _children.swap(ax, bx);
+  recalc_tree();		// children moved
 }
 
 /// Swap two of our immediate children, given item pointers.
@@ -743,25 +737,53 @@ void Fl_Tree_Item::draw_vertical_connector(int x, int y1, int y2, const Fl_Tree_
 /// \version 1.3.3 ABI feature
 ///
 const Fl_Tree_Item *Fl_Tree_Item::find_clicked(const Fl_Tree_Prefs &prefs, int yonly) const {
+  const Fl_Tree_Item *item = find_clicked_xy(prefs, yonly, _xywh[0], _xywh[1], _xywh[2]);
+  if ( item && _tree ) _tree->update_item_xy(const_cast<Fl_Tree_Item*>(item));	// x() and y() may be out of date
+  return(item);
+}
+
+// Internal: find_clicked() for this item at position 'X','Y' with width 'W'.
+//    Children scrolled off-screen are not drawn, so their x() and y() may be
+//    out of date; their position is taken from the tree's layout instead,
+//    which also finds the few children to look at without checking them all.
+//
+const Fl_Tree_Item *Fl_Tree_Item::find_clicked_xy(const Fl_Tree_Prefs &prefs, int yonly,
+						  int X, int Y, int W) const {
   if ( ! is_visible() ) return(0);
   if ( is_root() && !prefs.showroot() ) {
     // skip event check if we're root but root not being shown
   } else {
     // See if event is over us
     if ( yonly ) {
-      if ( Fl::event_y() >= _xywh[1] &&
-           Fl::event_y() <= (_xywh[1]+_xywh[3]) ) {
+      if ( Fl::event_y() >= Y &&
+           Fl::event_y() <= (Y+_xywh[3]) ) {
         return(this);
       }
     } else {
-      if ( event_inside(_xywh) ) {		// event within this item?
+      if ( Fl::event_inside(X, Y, W, _xywh[3]) ) {	// event within this item?
         return(this);				// found
       }
     }
   }
-  if ( is_open() ) {				// open? check children of this item
-    for ( int t=0; t<children(); t++ ) {
-      const Fl_Tree_Item *item;
+  if ( is_open() && children() ) {		// open? check children of this item
+    const Fl_Tree_Item *item;
+    int t = 0, n = children(), ey = Fl::event_y();
+    if ( _tree && _layout_gen == _tree->_layout_gen ) {
+      int hi = n-1;				// first child that ends below the event
+      while ( t < hi ) {
+        int mid = (t + hi) / 2;
+        const Fl_Tree_Item *c = _children[mid];
+        if ( Y + c->_layout_y + c->_layout_h < ey ) t = mid + 1; else hi = mid;
+      }
+      for ( ; t<n && Y + _children[t]->_layout_y <= ey; t++ ) {
+        const Fl_Tree_Item *c = _children[t];
+        if ( (item = c->find_clicked_xy(prefs, yonly, X + c->_layout_x, Y + c->_layout_y,
+                                        W - c->_layout_x)) != NULL )
+          return(item);
+      }
+      return(0);
+    }
+    for ( ; t<n; t++ ) {
       if ( (item = _children[t]->find_clicked(prefs, yonly)) != NULL)  // recurse into child for descendents
         return(item);						       // found?
     }
@@ -1141,14 +1163,65 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
   if ( xmax > tree_item_xmax )
     tree_item_xmax = xmax;
   // Draw child items (if any)
+  //    Each child's layout (its position, and the height and width of it
+  //    with its children) is kept when not rendering. Children whose layout
+  //    did not change, or that are clipped, are then skipped over entirely.
+  //
+  int widgets = 0;				// does an open descendant have a widget?
   if ( has_children() && is_open() ) {
     int child_x = drawthis ? (hconn_x_center - (icon_w/2) + 1)	// offset children to right,
                            : X;					// unless didn't drawthis
     int child_w = W - (child_x-X);
     int child_y_start = Y;
-    for ( int t=0; t<children(); t++ ) {
-      int lastchild = ((t+1)==children()) ? 1 : 0;
-      _children[t]->draw(child_x, Y, child_w, itemfocus, tree_item_xmax, lastchild, render);
+    int gen = _tree->_layout_gen;
+    int t = 0, n = children();
+    if ( render && _layout_gen == gen && !is_flag(CHILD_WIDGETS) ) {
+      // Layout is known: binary search for the first child that is not
+      // above the tree's area, and stop after the last one that is in it
+      int hi = n-1;
+      while ( t < hi ) {
+        int mid = (t + hi) / 2;
+        const Fl_Tree_Item *c = _children[mid];
+        if ( _xywh[1] + c->_layout_y + c->_layout_h < tree_top ) t = mid + 1; else hi = mid;
+      }
+      for ( ; t<n; t++ ) {
+        Y = _xywh[1] + _children[t]->_layout_y;
+        if ( Y > tree_bot ) break;
+        int lastchild = ((t+1)==n) ? 1 : 0;
+        _children[t]->draw(child_x, Y, child_w, itemfocus, tree_item_xmax, lastchild, render);
+      }
+      const Fl_Tree_Item *c = _children[n-1];
+      Y = _xywh[1] + c->_layout_y + c->_layout_h;
+    } else {
+      for ( ; t<n; t++ ) {
+        Fl_Tree_Item *c = _children[t];
+        int lastchild = ((t+1)==n) ? 1 : 0;
+        if ( !render ) {
+          c->_layout_x = child_x - X;
+          c->_layout_y = Y - _xywh[1];
+        }
+        if ( c->_layout_gen == gen &&
+             ( !render ||
+               ( !c->widget() && !c->is_flag(CHILD_WIDGETS) &&	// widgets are always moved
+                 ( Y + c->_layout_h < tree_top || Y > tree_bot ) ) ) ) {
+          // Not changed, or clipped: use the child's layout
+          if ( c->_layout_w >= 0 && child_x + c->_layout_w > tree_item_xmax )
+            tree_item_xmax = child_x + c->_layout_w;
+          Y += c->_layout_h;
+        } else {
+          int child_y = Y, child_xmax = 0;
+          c->draw(child_x, Y, child_w, itemfocus, child_xmax, lastchild, render);
+          if ( !render ) {			// save child's new layout
+            c->_layout_h = Y - child_y;
+            c->_layout_w = child_xmax ? child_xmax - child_x : -1;
+            c->_layout_gen = gen;
+          }
+          if ( child_xmax > tree_item_xmax )
+            tree_item_xmax = child_xmax;
+        }
+        if ( c->is_visible() && (c->widget() || c->is_flag(CHILD_WIDGETS)) )
+          widgets = 1;
+      }
     }
     if ( has_children() && is_open() ) {
       Y += prefs.openchild_marginbottom();		// offset below open child tree
@@ -1161,6 +1234,10 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
         draw_vertical_connector(hconn_x, child_y_start, Y, prefs);
     }
   }
+  if ( !render ) {
+    if ( widgets ) _flags |= CHILD_WIDGETS;
+    else           _flags &= ~CHILD_WIDGETS;
+  }
 }
 
 
@@ -1362,6 +1439,23 @@ void Fl_Tree_Item::update_prev_next(int index) {
 ///
 Fl_Tree_Item *Fl_Tree_Item::next_visible(Fl_Tree_Prefs &prefs) {
   Fl_Tree_Item *item = this;
+  if ( visible_r() ) {
+    // Walk down the displayed items only, skipping closed and hidden children
+    int descend = 1;
+    while ( 1 ) {
+      if ( descend && item->is_open() && item->has_children() ) {
+        item = item->child(0);
+      } else {
+        while ( !item->_next_sibling ) {	// last child? move up to the parent
+          item = item->parent();
+          if ( !item ) return(0);
+        }
+        item = item->_next_sibling;
+      }
+      if ( item->visible() ) return(item);
+      descend = 0;				// hidden: skip its children
+    }
+  }
   while ( 1 ) {
     item = item->next();
     if ( !item ) return 0;
@@ -1430,7 +1524,11 @@ int Fl_Tree_Item::visible_r() const {
 /// \version 1.3.3 ABI
 ///
 void Fl_Tree_Item::recalc_tree() {
-  _tree->recalc_tree();
+  // Only this item and its parents need a new layout,
+  // the rest of the tree keeps its own (see Fl_Tree::calc_tree())
+  for ( Fl_Tree_Item *p = this; p; p = p->_parent )
+    p->_layout_gen = 0;
+  _tree->_tree_w = _tree->_tree_h = -1;
 }
 
 //
@@ -27,6 +27,15 @@
 //     http://www.fltk.org/str.php
 //
 
+#define INDEX_MIN_ITEMS	16		// smaller arrays are searched one item at a time
+
+// Internal: FNV-1a hash of a label
+static unsigned label_hash(const char *s) {
+  unsigned h = 2166136261U;
+  while ( *s ) { h ^= (unsigned char)*s++; h *= 16777619U; }
+  return(h);
+}
+
 /// Constructor; creates an empty array.
 ///
 ///     The optional 'chunksize' can be specified to optimize
@@ -38,6 +47,8 @@ Fl_Tree_Item_Array::Fl_Tree_Item_Array(int new_chunksize) {
   _size      = 0;
   _flags     = 0;
   _chunksize = new_chunksize;
+  _index      = 0;
+  _index_size = 0;
 }
 
 /// Destructor. Calls each item's destructor, destroys internal _items array.
@@ -52,6 +63,8 @@ Fl_Tree_Item_Array::Fl_Tree_Item_Array(const Fl_Tree_Item_Array* o) {
   _size      = o->_size;
   _chunksize = o->_chunksize;
   _flags     = o->_flags;
+  _index      = 0;			// made again by find() when needed
+  _index_size = 0;
   for ( int t=0; t<o->_total; t++ ) {
     if ( _flags & MANAGE_ITEM ) {
       _items[t] = new Fl_Tree_Item(o->_items[t]);	// make new copy of item
@@ -81,6 +94,7 @@ void Fl_Tree_Item_Array::clear() {
     free((void*)_items); _items = 0;
   }
   _total = _size = 0;
+  reindex();
 }
 
 // Internal: Enlarge the items array.
@@ -124,6 +138,7 @@ void Fl_Tree_Item_Array::insert(int pos, Fl_Tree_Item *new_item) {
   {
     _items[pos]->update_prev_next(pos);	// adjust item's prev/next and its neighbors
   }
+  index_add(new_item);
 }
 
 /// Add an item* to the end of the array.
@@ -148,6 +163,7 @@ void Fl_Tree_Item_Array::replace(int index, Fl_Tree_Item *newitem) {
       delete _items[index];
   }
   _items[index] = newitem;			// install new item
+  reindex();
   if ( _flags & MANAGE_ITEM )
   {
     // Restitch into linked list
@@ -166,6 +182,7 @@ void Fl_Tree_Item_Array::remove(int index) {
   }
   _items[index] = 0;
   _total--;
+  reindex();
   for ( int i=index; i<_total; i++ ) {		// reshuffle the array
     _items[i] = _items[i+1];
   }
@@ -251,6 +268,7 @@ int Fl_Tree_Item_Array::deparent(int pos) {
   _total -= 1;
   for ( int t=pos; t<_total; t++ )
     _items[t] = _items[t+1];            // delete, no destroy
+  reindex();
   // Now an orphan: remove association with old parent and siblings
   item->update_prev_next(-1);           // become an orphan
   // Adjust bereaved siblings
@@ -275,9 +293,82 @@ int Fl_Tree_Item_Array::reparent(Fl_Tree_Item *item, Fl_Tree_Item* newparent, in
   // Attach to new parent and siblings
   _items[pos]->parent(newparent);       // reparent (update_prev_next() needs this)
   _items[pos]->update_prev_next(pos);   // find new siblings
+  index_add(item);
   return 0;
 }
 
+// Internal: Make the hash table of labels for all the items.
+void Fl_Tree_Item_Array::index_build() const {
+  free((void*)_index);
+  _index_size = 32;
+  while ( _index_size < _total * 2 ) _index_size *= 2;	// at most half full
+  _index = (Fl_Tree_Item**)calloc(_index_size, sizeof(Fl_Tree_Item*));
+  for ( int t=0; t<_total; t++ )
+    index_add(_items[t]);
+}
+
+// Internal: Add an item to the hash table of labels, if there is one.
+//
+//    Items without a label are not in the table.
+//    The table is made again, larger, when it becomes half full.
+//
+void Fl_Tree_Item_Array::index_add(Fl_Tree_Item *item) const {
+  if ( !_index || !item || !item->label() ) return;
+  if ( _total * 2 > _index_size ) { index_build(); return; }
+  unsigned mask = _index_size - 1;
+  unsigned i = label_hash(item->label()) & mask;
+  while ( _index[i] ) i = (i + 1) & mask;		// linear probing
+  _index[i] = (Fl_Tree_Item*)item;
+}
+
+/// Drop the hash table of labels, which find() makes again when needed.
+///
+///     The table is kept up to date when items are added or removed,
+///     but the array does not know when an item's label changes:
+///     Fl_Tree_Item::label() calls this for its parent's array of children.
+///
+/// \version 1.4.0
+///
+void Fl_Tree_Item_Array::reindex() {
+  free((void*)_index);
+  _index = 0;
+  _index_size = 0;
+}
+
+/// Find the first item in the array with the label \p 'label'.
+///
+///     Arrays with more than a few items use a hash table of the labels,
+///     which is made at the first call and then kept up to date,
+///     so the items are not compared one at a time.
+///
+/// \returns the item, or NULL if no item has this label.
+/// \version 1.4.0
+///
+const Fl_Tree_Item *Fl_Tree_Item_Array::find(const char *label) const {
+  if ( !label ) return(0);
+  if ( _total >= INDEX_MIN_ITEMS ) {
+    if ( !_index ) index_build();
+    const Fl_Tree_Item *found = 0;
+    int matches = 0;
+    unsigned mask = _index_size - 1;
+    for ( unsigned i = label_hash(label) & mask; _index[i]; i = (i + 1) & mask ) {
+      if ( strcmp(_index[i]->label(), label) == 0 ) { found = _index[i]; matches++; }
+    }
+    if ( matches < 2 ) return(found);
+    // Several items have this label: return the first one in the array
+  }
+  for ( int t=0; t<_total; t++ )
+    if ( _items[t]->label() && strcmp(_items[t]->label(), label) == 0 )
+      return(_items[t]);
+  return(0);
+}
+
+/// Non-const version of Fl_Tree_Item_Array::find(const char *label) const.
+Fl_Tree_Item *Fl_Tree_Item_Array::find(const char *label) {
+  return(const_cast<Fl_Tree_Item*>(
+	 static_cast<const Fl_Tree_Item_Array &>(*this).find(label)));
+}
+
 //
 // End of "$Id$".
 //
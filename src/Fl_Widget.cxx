@@ -149,6 +149,7 @@ Fl_Widget::Fl_Widget(int X, int Y, int W, int H, const char* L) {
 
 void Fl_Widget::resize(int X, int Y, int W, int H) {
   x_ = X; y_ = Y; w_ = W; h_ = H;
+  if (parent_ && parent_->index_) parent_->index_moved(this);	// see Fl_Group::spatial_index()
 }
 
 // this is useful for parent widgets to call to resize children:
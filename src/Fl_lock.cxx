@@ -64,69 +64,140 @@
    Fl::awake() call, or returns NULL if none.  WARNING: the
    current implementation only has a one-entry queue and only
    returns the most recent value!
+
+   Fl::awake_delivered(), Fl::awake_coalesced(), Fl::awake_dropped() -
+   statistics of the Fl::awake(cb, data) queue.
 */
 
-#ifndef FL_DOXYGEN
-Fl_Awake_Handler *Fl::awake_ring_;
-void **Fl::awake_data_;
-int Fl::awake_ring_size_;
-int Fl::awake_ring_head_;
-int Fl::awake_ring_tail_;
-#endif
+// Pending awake callbacks are pushed by any thread onto a lock-free
+// stack (awake_head) without taking a lock. The main thread takes the
+// whole stack at once, reverses it into a FIFO batch (awake_batch) and
+// delivers the batch without touching shared data. Only the first
+// callback posted since the queue was last found empty wakes the main
+// thread (awake_signaled), the others are delivered in the same batch.
 
-static const int AWAKE_RING_SIZE = 1024;
+struct Fl_Awake_Node {
+  Fl_Awake_Handler func;
+  void *data;
+  Fl_Awake_Node *next;
+};
+
+static Fl_Awake_Node * volatile awake_head;	// pushed by any thread
+static Fl_Awake_Node *awake_batch;		// main thread only
+static volatile long awake_signaled;		// main thread was woken up
+static volatile long awake_coalesced_count;
+static volatile long awake_dropped_count;
+static unsigned long awake_delivered_count;	// main thread only
+
+// Atomic operations on the queue, with a full memory barrier.
+// Without compiler support they fall back to a mutex.
+#if defined(__GNUC__)
+#  define AWAKE_ATOMICS 1
+static inline bool cas_node(Fl_Awake_Node * volatile *p, Fl_Awake_Node *o, Fl_Awake_Node *n) {
+  return __sync_bool_compare_and_swap(p, o, n);
+}
+static inline bool cas_long(volatile long *p, long o, long n) {
+  return __sync_bool_compare_and_swap(p, o, n);
+}
+static inline void inc_long(volatile long *p) {
+  __sync_fetch_and_add(p, 1);
+}
+#elif defined(_MSC_VER)
+#  define AWAKE_ATOMICS 1
+#  include <windows.h>
+static inline bool cas_node(Fl_Awake_Node * volatile *p, Fl_Awake_Node *o, Fl_Awake_Node *n) {
+  return InterlockedCompareExchangePointer((PVOID volatile *)p, n, o) == o;
+}
+static inline bool cas_long(volatile long *p, long o, long n) {
+  return InterlockedCompareExchange(p, n, o) == o;
+}
+static inline void inc_long(volatile long *p) {
+  InterlockedIncrement(p);
+}
+#else
+#  define AWAKE_ATOMICS 0
 static void lock_ring();
 static void unlock_ring();
+static bool cas_node(Fl_Awake_Node * volatile *p, Fl_Awake_Node *o, Fl_Awake_Node *n) {
+  lock_ring();
+  bool ret = (*p == o);
+  if (ret) *p = n;
+  unlock_ring();
+  return ret;
+}
+static bool cas_long(volatile long *p, long o, long n) {
+  lock_ring();
+  bool ret = (*p == o);
+  if (ret) *p = n;
+  unlock_ring();
+  return ret;
+}
+static void inc_long(volatile long *p) {
+  lock_ring();
+  ++*p;
+  unlock_ring();
+}
+#endif
 
 /** Adds an awake handler for use in awake(). */
 int Fl::add_awake_handler_(Fl_Awake_Handler func, void *data)
 {
-  int ret = 0;
-  lock_ring();
-  if (!awake_ring_) {
-    awake_ring_size_ = AWAKE_RING_SIZE;
-    awake_ring_ = (Fl_Awake_Handler*)malloc(awake_ring_size_*sizeof(Fl_Awake_Handler));
-    awake_data_ = (void**)malloc(awake_ring_size_*sizeof(void*));
-    // explicitly initialize the head and tail indices
-    awake_ring_head_= awake_ring_tail_ = 0;
+  Fl_Awake_Node *node = (Fl_Awake_Node*)malloc(sizeof(Fl_Awake_Node));
+  if (!node) {
+    inc_long(&awake_dropped_count);
+    return -1;
   }
-  // The next head index we will want (not the current index):
-  // We use this to check if the ring-buffer is full or not
-  // (and to update awake_ring_head_ if we do use the current index.)
-  int next_head = awake_ring_head_ + 1;
-  if (next_head >= awake_ring_size_) {
-    next_head = 0;
-  }
-  // check that the ring buffer is not full, and that it exists
-  if ((!awake_ring_) || (next_head == awake_ring_tail_)) {
-    // ring is non-existent or full. Return -1 as an error indicator.
-    ret = -1;
-  } else {
-    awake_ring_[awake_ring_head_] = func;
-    awake_data_[awake_ring_head_] = data;
-    awake_ring_head_ = next_head;
+  node->func = func;
+  node->data = data;
+  Fl_Awake_Node *head;
+  do {
+    head = awake_head;
+    node->next = head;
+  } while (!cas_node(&awake_head, head, node));
+  return 0;
+}
+
+// Moves all pushed awake handlers into the batch, oldest first
+static void take_awake_batch() {
+  Fl_Awake_Node *head;
+  do {
+    head = awake_head;
+  } while (head && !cas_node(&awake_head, head, 0));
+  while (head) {
+    Fl_Awake_Node *next = head->next;
+    head->next = awake_batch;
+    awake_batch = head;
+    head = next;
   }
-  unlock_ring();
-  return ret;
 }
 
-/** Gets the last stored awake handler for use in awake(). */
+/** Gets the oldest stored awake handler for use in awake().
+    This must only be called by the main thread. */
 int Fl::get_awake_handler_(Fl_Awake_Handler &func, void *&data)
 {
-  int ret = 0;
-  lock_ring();
-  if ((!awake_ring_) || (awake_ring_head_ == awake_ring_tail_)) {
-    ret = -1;
-  } else {
-    func = awake_ring_[awake_ring_tail_];
-    data = awake_data_[awake_ring_tail_];
-    ++awake_ring_tail_;
-    if (awake_ring_tail_ >= awake_ring_size_) {
-      awake_ring_tail_ = 0;
+  if (!awake_batch) {
+    take_awake_batch();
+    if (!awake_batch) {
+      // The queue is empty: the next awake() must wake us up again.
+      // Check once more in case a handler was pushed before the reset.
+      cas_long(&awake_signaled, 1, 0);
+      take_awake_batch();
+      if (!awake_batch) return -1;
     }
   }
-  unlock_ring();
-  return ret;
+  Fl_Awake_Node *node = awake_batch;
+  awake_batch = node->next;
+  func = node->func;
+  data = node->data;
+  free(node);
+  awake_delivered_count++;
+  return 0;
+}
+
+/** Returns non-zero if awake handlers are waiting to be called. */
+int Fl::awake_pending_()
+{
+  return awake_batch != 0 || awake_head != 0;
 }
 
 /**
@@ -134,17 +205,55 @@ int Fl::get_awake_handler_(Fl_Awake_Handler &func, void *&data)
  Registers a function that will be 
  called by the main thread during the next message handling cycle. 
  Returns 0 if the callback function was registered, 
- and -1 if registration failed. Over a thousand awake callbacks can be
- registered simultaneously.
- 
+ and -1 if registration failed, which only happens if memory runs out.
+ There is no limit on the number of pending awake callbacks.
+
+ The callbacks are called in the order they were registered. Any number
+ of threads can register callbacks at the same time without waiting for
+ each other. If the main thread has already been woken up but has not
+ called the callbacks yet, the main thread is not woken up again: the
+ new callback is called with the ones already pending.
+
  \see Fl::awake(void* message=0)
+ \see Fl::awake_delivered(), Fl::awake_coalesced(), Fl::awake_dropped()
 */
 int Fl::awake(Fl_Awake_Handler func, void *data) {
   int ret = add_awake_handler_(func, data);
-  Fl::awake();
+  if (cas_long(&awake_signaled, 0, 1))
+    Fl::awake();
+  else
+    inc_long(&awake_coalesced_count);
   return ret;
 }
 
+/**
+  Returns the number of callbacks registered with
+  Fl::awake(Fl_Awake_Handler, void*) that have been called.
+  \version 1.4.0
+*/
+unsigned long Fl::awake_delivered() {
+  return awake_delivered_count;
+}
+
+/**
+  Returns the number of calls of Fl::awake(Fl_Awake_Handler, void*) that
+  did not need to wake up the main thread, because the main thread was
+  already woken up to call pending callbacks.
+  \version 1.4.0
+*/
+unsigned long Fl::awake_coalesced() {
+  return (unsigned long)awake_coalesced_count;
+}
+
+/**
+  Returns the number of callbacks that could not be registered with
+  Fl::awake(Fl_Awake_Handler, void*) because memory ran out.
+  \version 1.4.0
+*/
+unsigned long Fl::awake_dropped() {
+  return (unsigned long)awake_dropped_count;
+}
+
 /** \fn int Fl::lock()
     The lock() method blocks the current thread until it
     can safely access FLTK widgets and data. Child threads should
@@ -210,6 +319,9 @@ static DWORD main_thread;
 
 // Microsoft's version of a MUTEX...
 CRITICAL_SECTION cs;
+
+#  if !AWAKE_ATOMICS
+// Critical section for the awake queue, if atomic operations are not available
 CRITICAL_SECTION *cs_ring;
 
 void unlock_ring() {
@@ -223,6 +335,7 @@ void lock_ring() {
   }
   EnterCriticalSection(cs_ring);
 }
+#  endif // !AWAKE_ATOMICS
 
 //
 // 'unlock_function()' - Release the lock.
@@ -386,7 +499,8 @@ void Fl_Posix_System_Driver::unlock() {
   fl_unlock_function();
 }
 
-// Mutex code for the awake ring buffer
+#  if !AWAKE_ATOMICS
+// Mutex code for the awake queue, if atomic operations are not available
 static pthread_mutex_t *ring_mutex;
 
 void unlock_ring() {
@@ -400,6 +514,7 @@ void lock_ring() {
   }
   pthread_mutex_lock(ring_mutex);
 }
+#  endif // !AWAKE_ATOMICS
 
 #else // ! HAVE_PTHREAD
 
@@ -408,8 +523,10 @@ int Fl_Posix_System_Driver::lock() { return 1; }
 void Fl_Posix_System_Driver::unlock() {}
 void* Fl_Posix_System_Driver::thread_message() { return NULL; }
 
+#  if !AWAKE_ATOMICS
 void lock_ring() {}
 void unlock_ring() {}
+#  endif // !AWAKE_ATOMICS
 
 #endif // HAVE_PTHREAD
 
@@ -361,7 +361,7 @@ extern int fl_send_system_handlers(void *e);
 MSG fl_msg;
 
 // A local helper function to flush any pending callback requests
-// from the awake ring-buffer
+// from the awake queue
 static void process_awake_handler_requests(void) {
   Fl_Awake_Handler func;
   void *data;
@@ -451,26 +451,24 @@ double Fl_WinAPI_Screen_Driver::wait(double time_to_wait) {
   }
 
   // The following conditional test:
-  //    (Fl::awake_ring_head_ != Fl::awake_ring_tail_)
+  //    (Fl::awake_pending_())
   // is a workaround / fix for STR #3143. This works, but a better solution
   // would be to understand why the PostThreadMessage() messages are not
   // seen by the main window if it is being dragged/ resized at the time.
-  // If a worker thread posts an awake callback to the ring buffer
+  // If a worker thread posts an awake callback to the queue
   // whilst the main window is unresponsive (if a drag or resize operation
   // is in progress) we may miss the PostThreadMessage(). So here, we check if
-  // there is anything pending in the awake ring buffer and if so process
-  // it. This is not strictly thread safe (for speed it compares the head
-  // and tail indices without first locking the ring buffer) but is intended
+  // there is anything pending in the awake queue and if so process
+  // it. The test reads the queue without any locking, but is intended
   // only as a fall-back recovery mechanism if the awake processing stalls.
-  // If the test erroneously returns true (may happen if we test the indices
-  // whilst they are being modified) we will call process_awake_handler_requests()
-  // unnecessarily, but this has no harmful consequences so is safe to do.
+  // If a callback is posted just after the test we will process it on the
+  // next PostThreadMessage(), so this is safe to do.
   // Note also that if we miss the PostThreadMessage(), then thread_message_
   // will not be updated, so this is not a perfect solution, but it does
   // recover and process any pending awake callbacks.
-  // Normally the ring buffer head and tail indices will match and this
-  // comparison will do nothing. Addresses STR #3143
-  if (Fl::awake_ring_head_ != Fl::awake_ring_tail_) {
+  // Normally the queue is empty and this test will do nothing.
+  // Addresses STR #3143
+  if (Fl::awake_pending_()) {
     process_awake_handler_requests();
   }
 
@@ -78,7 +78,31 @@ static bool have_xfixes = false;
 extern Fl_Widget *fl_selection_requestor;
 
 ////////////////////////////////////////////////////////////////
-// interface to poll/select call:
+// interface to epoll/poll/select call:
+//
+// With USE_EPOLL the file descriptors are registered with an epoll
+// instance, so waiting and dispatching only costs time for the file
+// descriptors that are ready. If the epoll instance can't be created
+// poll() is used instead, so an epoll build keeps the pollfds array too.
+// Without USE_EPOLL, poll() or select() is used as before.
+//
+// Each add_fd() call creates an entry in the fd array. Entries for the
+// same file descriptor are chained by index, and fd_slot[] maps each
+// file descriptor to its first entry, so add_fd() and remove_fd() don't
+// search the array.
+
+#  if USE_EPOLL
+#    include <sys/epoll.h>
+#    include <errno.h>
+#    if !USE_POLL
+#      undef USE_POLL
+#      define USE_POLL 1
+#    endif
+static int epoll_fd = -1;	// -1 = not created yet, -2 = not available
+static epoll_event *epoll_events = 0;
+static int epoll_events_size = 0;
+static int num_unpollable = 0;	// entries epoll refused, always "ready"
+#  endif /* USE_EPOLL */
 
 #  if USE_POLL
 
@@ -101,28 +125,81 @@ static int maxfd;
 
 #  endif /* USE_POLL */
 
+#define FD_EVENTS (POLLIN|POLLOUT|POLLERR)
+
 static int nfds = 0;
 static int fd_array_size = 0;
 struct FD {
-#  if !USE_POLL
   int fd;
-  short events;
-#  endif
+  short events;		// FL_READ, FL_WRITE, FL_EXCEPT and FL_EDGE bits
+  char unpollable;	// epoll can't watch this file descriptor
+  int next;		// next entry for the same fd, or -1
   void (*cb)(int, void*);
   void* arg;
 };
 
 static FD *fd = 0;
+static int *fd_slot = 0;	// first entry of each file descriptor, or -1
+static int fd_slot_size = 0;
+
+#  if USE_EPOLL
+// Register the union of all events wanted for file descriptor n
+static void epoll_update(int n, int old_events) {
+  if (epoll_fd < 0) return;
+  int events = 0, unpollable = 0;
+  for (int i = fd_slot[n]; i >= 0; i = fd[i].next) {
+    events |= fd[i].events;
+    unpollable |= fd[i].unpollable;
+  }
+  if (unpollable) {
+    // mark all entries, they are dispatched by their first entry:
+    for (int i = fd_slot[n]; i >= 0; i = fd[i].next)
+      if (!fd[i].unpollable) { fd[i].unpollable = 1; num_unpollable++; }
+    return;
+  }
+  epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.data.fd = n;
+  if (events & FL_READ) ev.events |= EPOLLIN;
+  if (events & FL_WRITE) ev.events |= EPOLLOUT;
+  if (events & FL_EXCEPT) ev.events |= EPOLLPRI;
+  if (events & FL_EDGE) ev.events |= EPOLLET;
+  if (!(events & FD_EVENTS)) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, n, &ev); // fails harmlessly if n was closed
+  } else if (epoll_ctl(epoll_fd, (old_events & FD_EVENTS) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, n, &ev) < 0) {
+    // n may have been closed and reopened, or dup'ed, since the last call:
+    if (errno == ENOENT) epoll_ctl(epoll_fd, EPOLL_CTL_ADD, n, &ev);
+    else if (errno == EEXIST) epoll_ctl(epoll_fd, EPOLL_CTL_MOD, n, &ev);
+    else if (errno == EPERM) {
+      // regular files and some devices can't be watched, but are always
+      // ready, just like poll() and select() report them:
+      for (int i = fd_slot[n]; i >= 0; i = fd[i].next) {
+        fd[i].unpollable = 1;
+        num_unpollable++;
+      }
+    }
+  }
+}
+#  endif /* USE_EPOLL */
 
 void Fl_X11_System_Driver::add_fd(int n, int events, void (*cb)(int, void*), void *v) {
   remove_fd(n,events);
-  int i = nfds++;
+  if (n < 0) return;
+  if (n >= fd_slot_size) {
+    int size = 2*fd_slot_size > n ? 2*fd_slot_size : n+1;
+    int *temp = (int*)realloc(fd_slot, size*sizeof(int));
+    if (!temp) return;
+    for (int k = fd_slot_size; k < size; k++) temp[k] = -1;
+    fd_slot = temp;
+    fd_slot_size = size;
+  }
+  int i = nfds;
   if (i >= fd_array_size) {
     FD *temp;
-    fd_array_size = 2*fd_array_size+1;
+    int size = 2*fd_array_size+1;
 
-    if (!fd) temp = (FD*)malloc(fd_array_size*sizeof(FD));
-    else temp = (FD*)realloc(fd, fd_array_size*sizeof(FD));
+    if (!fd) temp = (FD*)malloc(size*sizeof(FD));
+    else temp = (FD*)realloc(fd, size*sizeof(FD));
 
     if (!temp) return;
     fd = temp;
@@ -130,66 +207,106 @@ void Fl_X11_System_Driver::add_fd(int n, int events, void (*cb)(int, void*), voi
 #  if USE_POLL
     pollfd *tpoll;
 
-    if (!pollfds) tpoll = (pollfd*)malloc(fd_array_size*sizeof(pollfd));
-    else tpoll = (pollfd*)realloc(pollfds, fd_array_size*sizeof(pollfd));
+    if (!pollfds) tpoll = (pollfd*)malloc(size*sizeof(pollfd));
+    else tpoll = (pollfd*)realloc(pollfds, size*sizeof(pollfd));
 
     if (!tpoll) return;
     pollfds = tpoll;
 #  endif
+    fd_array_size = size;
   }
+  nfds++;
+  int old_events = 0;
+  for (int k = fd_slot[n]; k >= 0; k = fd[k].next) old_events |= fd[k].events;
+  fd[i].fd = n;
+  fd[i].events = events;
+  fd[i].unpollable = 0;
   fd[i].cb = cb;
   fd[i].arg = v;
+  fd[i].next = fd_slot[n];
+  fd_slot[n] = i;
 #  if USE_POLL
   pollfds[i].fd = n;
-  pollfds[i].events = events;
+  pollfds[i].events = events & FD_EVENTS;
+  pollfds[i].revents = 0;
 #  else
-  fd[i].fd = n;
-  fd[i].events = events;
   if (events & POLLIN) FD_SET(n, &fdsets[0]);
   if (events & POLLOUT) FD_SET(n, &fdsets[1]);
   if (events & POLLERR) FD_SET(n, &fdsets[2]);
   if (n > maxfd) maxfd = n;
 #  endif
+#  if USE_EPOLL
+  if (epoll_fd == -1) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+      epoll_fd = -2; // use poll() instead
+    } else {
+      // register the file descriptors that were added before:
+      for (int k = 0; k < nfds; k++)
+        if (fd_slot[fd[k].fd] == k) epoll_update(fd[k].fd, 0);
+      return;
+    }
+  }
+  epoll_update(n, old_events);
+#  else
+  (void)old_events;
+#  endif
 }
 
 void Fl_X11_System_Driver::add_fd(int n, void (*cb)(int, void*), void* v) {
   add_fd(n, POLLIN, cb, v);
 }
 
-void Fl_X11_System_Driver::remove_fd(int n, int events) {
-  int i,j;
-# if !USE_POLL
-  maxfd = -1; // recalculate maxfd on the fly
-# endif
-  for (i=j=0; i<nfds; i++) {
-#  if USE_POLL
-    if (pollfds[i].fd == n) {
-      int e = pollfds[i].events & ~events;
-      if (!e) continue; // if no events left, delete this fd
-      pollfds[j].events = e;
-    }
-#  else
-    if (fd[i].fd == n) {
-      int e = fd[i].events & ~events;
-      if (!e) continue; // if no events left, delete this fd
-      fd[i].events = e;
-    }
-    if (fd[i].fd > maxfd) maxfd = fd[i].fd;
+// Remove entry i from the fd array by moving the last entry into its place
+static void delete_fd_entry(int i, int *link) {
+  *link = fd[i].next;
+#  if USE_EPOLL
+  if (fd[i].unpollable) num_unpollable--;
 #  endif
-    // move it down in the array if necessary:
-    if (j<i) {
-      fd[j] = fd[i];
+  int last = --nfds;
+  if (i == last) return;
+  // find the reference to the last entry and redirect it to i:
+  int *p = &fd_slot[fd[last].fd];
+  while (*p != last) p = &fd[*p].next;
+  *p = i;
+  fd[i] = fd[last];
 #  if USE_POLL
-      pollfds[j] = pollfds[i];
+  pollfds[i] = pollfds[last];
 #  endif
+}
+
+void Fl_X11_System_Driver::remove_fd(int n, int events) {
+  if (n < 0 || n >= fd_slot_size || fd_slot[n] < 0) return;
+  int old_events = 0;
+  int *link = &fd_slot[n];
+  while (*link >= 0) {
+    int i = *link;
+    old_events |= fd[i].events;
+    int e = fd[i].events & ~events;
+    if (!(e & FD_EVENTS)) { // if no events left, delete this entry
+      delete_fd_entry(i, link);
+      link = &fd_slot[n]; // entries may have moved, start over
+      continue;
     }
-    j++;
+    fd[i].events = e;
+#  if USE_POLL
+    pollfds[i].events = e & FD_EVENTS;
+#  endif
+    link = &fd[i].next;
   }
-  nfds = j;
 #  if !USE_POLL
   if (events & POLLIN) FD_CLR(n, &fdsets[0]);
   if (events & POLLOUT) FD_CLR(n, &fdsets[1]);
   if (events & POLLERR) FD_CLR(n, &fdsets[2]);
+  if (n == maxfd && fd_slot[n] < 0) {
+    maxfd = -1; // recalculate maxfd
+    for (int i = 0; i < nfds; i++) if (fd[i].fd > maxfd) maxfd = fd[i].fd;
+  }
+#  endif
+#  if USE_EPOLL
+  epoll_update(n, old_events);
+#  else
+  (void)old_events;
 #  endif
 }
 
@@ -197,6 +314,33 @@ void Fl_X11_System_Driver::remove_fd(int n) {
   remove_fd(n, -1);
 }
 
+// Is cb still called with arg for some of the events in revents of f?
+static int fd_handler_registered(int f, int revents, void (*cb)(int, void*), void *arg) {
+  if (f >= fd_slot_size) return 0;
+  for (int i = fd_slot[f]; i >= 0; i = fd[i].next)
+    if (fd[i].cb == cb && fd[i].arg == arg && (fd[i].events & revents)) return 1;
+  return 0;
+}
+
+// Call the callbacks of file descriptor f for the events in revents
+static void do_fd_callbacks(int f, int revents) {
+  // collect the callbacks first, they may add or remove handlers:
+  struct { void (*cb)(int, void*); void *arg; } todo[3];
+  int n = 0;
+  for (int i = fd_slot[f]; i >= 0 && n < 3; i = fd[i].next) {
+    if (fd[i].events & revents) {
+      todo[n].cb = fd[i].cb;
+      todo[n].arg = fd[i].arg;
+      n++;
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    // skip handlers removed by an earlier callback, their arg may be gone:
+    if (i && !fd_handler_registered(f, revents, todo[i].cb, todo[i].arg)) continue;
+    todo[i].cb(f, todo[i].arg);
+  }
+}
+
 extern int fl_send_system_handlers(void *e);
 
 #if CONSOLIDATE_MOTION
@@ -248,6 +392,48 @@ int Fl_X11_Screen_Driver::poll_or_select_with_delay(double time_to_wait) {
 
   fl_unlock_function();
 
+#  if USE_EPOLL
+  if (epoll_fd >= 0) {
+    if (epoll_events_size < nfds || !epoll_events_size) {
+      int size = nfds < 1 ? 1 : nfds < 256 ? nfds : 256; // the rest is reported next time
+      if (size > epoll_events_size) {
+        epoll_events = (epoll_event*)realloc(epoll_events, size*sizeof(epoll_event));
+        epoll_events_size = size;
+      }
+    }
+    if (num_unpollable) time_to_wait = 0.0;
+    n = epoll_wait(epoll_fd, epoll_events, epoll_events_size,
+                   time_to_wait < 2147483.648 ? int(time_to_wait*1000 + .5) : -1);
+
+    fl_lock_function();
+
+    if (n > 0) {
+      for (int i = 0; i < n; i++) {
+        int f = epoll_events[i].data.fd;
+        if (f >= fd_slot_size || fd_slot[f] < 0) continue; // removed meanwhile
+        unsigned e = epoll_events[i].events;
+        int revents = 0;
+        if (e & EPOLLIN) revents |= FL_READ;
+        if (e & EPOLLOUT) revents |= FL_WRITE;
+        if (e & EPOLLPRI) revents |= FL_EXCEPT;
+        if (e & (EPOLLERR|EPOLLHUP)) revents |= FD_EVENTS;
+        do_fd_callbacks(f, revents);
+      }
+    } else if (n < 0) {
+      return n;
+    }
+    if (num_unpollable) {
+      for (int i = 0; i < nfds; i++) {
+        if (fd[i].unpollable && fd_slot[fd[i].fd] == i) {
+          do_fd_callbacks(fd[i].fd, FD_EVENTS);
+          n++;
+        }
+      }
+    }
+    return n;
+  }
+#  endif /* USE_EPOLL */
+
   if (time_to_wait < 2147483.648) {
 #  if USE_POLL
     n = ::poll(pollfds, nfds, int(time_to_wait*1000 + .5));
@@ -270,7 +456,10 @@ int Fl_X11_Screen_Driver::poll_or_select_with_delay(double time_to_wait) {
   if (n > 0) {
     for (int i=0; i<nfds; i++) {
 #  if USE_POLL
-      if (pollfds[i].revents) fd[i].cb(pollfds[i].fd, fd[i].arg);
+      if (pollfds[i].revents) {
+        pollfds[i].revents = 0;
+        fd[i].cb(pollfds[i].fd, fd[i].arg);
+      }
 #  else
       int f = fd[i].fd;
       short revents = 0;
@@ -288,6 +477,17 @@ int Fl_X11_Screen_Driver::poll_or_select_with_delay(double time_to_wait) {
 int Fl_X11_Screen_Driver::poll_or_select() {
   if (XQLength(fl_display)) return 1;
   if (!nfds) return 0; // nothing to select or poll
+#  if USE_EPOLL
+  if (epoll_fd >= 0) {
+    if (num_unpollable) return 1;
+    // the epoll instance is readable if any of its file descriptors is
+    // ready, so this does not consume edge-triggered events:
+    pollfd p;
+    p.fd = epoll_fd;
+    p.events = POLLIN;
+    return ::poll(&p, 1, 0);
+  }
+#  endif
 #  if USE_POLL
   return ::poll(pollfds, nfds, 0);
 #  else
@@ -0,0 +1,1111 @@
+//
+// "$Id$"
+//
+// Framebuffer drawing routines for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+
+#include "../../config_lib.h"
+#include "Fl_PicoFB_Graphics_Driver.H"
+#include <FL/Fl.H>
+#include <FL/fl_draw.H>
+#include <FL/Fl_Image.H>
+#include <FL/Fl_Bitmap.H>
+#include <FL/Fl_Pixmap.H>
+#include <FL/math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_PTHREAD) && !defined(_WIN32)
+#  include <pthread.h>
+#  define USE_TILE_THREADS 1
+#endif // HAVE_PTHREAD && !_WIN32
+
+#if defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#  define USE_SSE2 1
+#endif
+
+// Tiles of the display list. Wide tiles keep rows long enough to fill fast.
+#define TILE_W		256
+#define TILE_H		64
+// The display list is drawn when it gets larger than this, which keeps
+// it in the processor cache, and images from using much memory
+#define MAX_LIST_COMMANDS	65536
+#define MAX_LIST_DATA		(16 << 20)
+
+
+// Sets n pixels to the same value
+static void fill_span(unsigned *p, int n, unsigned pixel)
+{
+#if USE_SSE2
+  __m128i v = _mm_set1_epi32((int)pixel);
+  for ( ; n >= 8; n -= 8, p += 8) {
+    _mm_storeu_si128((__m128i*)p, v);
+    _mm_storeu_si128((__m128i*)(p + 4), v);
+  }
+#endif
+  while (n-- > 0) *p++ = pixel;
+}
+
+// Exact (x + 127) / 255 for x <= 255 * 255
+static inline unsigned div255(unsigned x)
+{
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+// Blends n pixels with the same color of opacity alpha (0 to 255)
+static void blend_span(unsigned *p, int n, unsigned pixel, unsigned alpha)
+{
+  unsigned na = 255 - alpha;
+  unsigned r = ((pixel >> 16) & 0xff) * alpha, g = ((pixel >> 8) & 0xff) * alpha,
+           b = (pixel & 0xff) * alpha;
+#if USE_SSE2
+  __m128i zero = _mm_setzero_si128();
+  __m128i src = _mm_set_epi16(0, (short)r, (short)g, (short)b, 0, (short)r, (short)g, (short)b);
+  __m128i k = _mm_set1_epi16((short)na), c128 = _mm_set1_epi16(128);
+  __m128i opaque = _mm_set1_epi32((int)0xff000000);
+  for ( ; n >= 4; n -= 4, p += 4) {
+    __m128i d = _mm_loadu_si128((__m128i*)p);
+    __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), k), src), c128);
+    __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), k), src), c128);
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+    _mm_storeu_si128((__m128i*)p, _mm_or_si128(_mm_packus_epi16(lo, hi), opaque));
+  }
+#endif
+  for ( ; n > 0; n--, p++) {
+    unsigned d = *p;
+    *p = 0xff000000 | (div255(((d >> 16) & 0xff) * na + r) << 16) |
+         (div255(((d >> 8) & 0xff) * na + g) << 8) | div255((d & 0xff) * na + b);
+  }
+}
+
+// Copies n pixels of an image with depth channels (1 to 4) and delta bytes
+// from one pixel to the next. Pixels with an alpha channel are blended.
+static void copy_row(unsigned *p, const uchar *s, int n, int depth, int delta)
+{
+  switch (depth) {
+    case 1:
+      for ( ; n > 0; n--, s += delta) *p++ = 0xff000000 | (s[0] * 0x10101);
+      break;
+    case 3:
+      for ( ; n > 0; n--, s += delta) *p++ = 0xff000000 | (s[0] << 16) | (s[1] << 8) | s[2];
+      break;
+    default: {
+      int ia = depth - 1; // alpha is the last channel
+      for ( ; n > 0; n--, s += delta, p++) {
+        unsigned a = s[ia];
+        if (!a) continue;
+        unsigned r = s[0], g = depth == 2 ? r : s[1], b = depth == 2 ? r : s[2];
+        if (a < 255) {
+          unsigned d = *p, na = 255 - a;
+          r = div255(r * a + ((d >> 16) & 0xff) * na);
+          g = div255(g * a + ((d >> 8) & 0xff) * na);
+          b = div255(b * a + (d & 0xff) * na);
+        }
+        *p = 0xff000000 | (r << 16) | (g << 8) | b;
+      }
+    }
+  }
+}
+
+
+
+
+/* All drawing is done by commands, which are run at once, or added to a
+ display list when the driver draws in tiles (see threads()). A command
+ changes only the pixels of a target rectangle, and the pixels it sets do
+ not depend on the target, so drawing a command in several tiles gives
+ the same pixels as drawing it at once.
+ */
+enum {
+  FB_FILL,	// fills the rectangle
+  FB_BLEND,	// blends the rectangle with opacity a
+  FB_SEGMENT,	// draws the line from x,y to w,h
+  FB_POLYGON,	// fills the polygon of a vertices
+  FB_IMAGE,	// copies an image of depth a, delta b and line length c
+  FB_BITMAP	// sets the pixels of a bitmap of first bit a and b bytes per row
+};
+
+struct Fl_PicoFB_Command {
+  int type;
+  int x, y, w, h;	// in graphical coordinates
+  int a, b, c;		// depending on type
+  unsigned pixel;	// the color
+  int bx, by, br, bb;	// the pixels that can change, bx <= x < br and by <= y < bb
+  size_t data;		// vertices or pixels, in the display list
+};
+
+struct Fl_PicoFB_Display_List {
+  Fl_PicoFB_Command *commands;
+  int count, alloc;
+  uchar *data;
+  size_t size, data_alloc;
+};
+
+// The pixels a command draws, bx <= x < br and by <= y < bb
+struct fb_target {
+  unsigned *pixels;
+  int width;
+  int bx, by, br, bb;
+};
+
+typedef struct { double x, y; } fb_point;
+
+/* Fills the pixels whose center is inside the polygon, with the even-odd
+ rule like X11 does. The polygon is closed, and its edges are crossed by
+ the center line of each pixel row. Polygons separated by gap() are one
+ polygon here, with each part closed and the edges joining two parts
+ crossed twice, i.e. not at all.
+ */
+static void scan_polygon(const fb_target &t, const fb_point *v, int n, unsigned pixel)
+{
+  double ymin = v[0].y, ymax = v[0].y;
+  for (int i = 1; i < n; i++) {
+    if (v[i].y < ymin) ymin = v[i].y;
+    if (v[i].y > ymax) ymax = v[i].y;
+  }
+  if (ymin < t.by) ymin = t.by;
+  if (ymax > t.bb) ymax = t.bb;
+  int y = (int)ceil(ymin - 0.5), y1 = (int)ceil(ymax - 0.5) - 1;
+  if (y > y1) return;
+  double small[32], *xs = n <= 32 ? small : (double*)malloc(n * sizeof(double));
+  for ( ; y <= y1; y++) {
+    double yc = y + 0.5;
+    int k = 0;
+    for (int i = 0; i < n; i++) {
+      const fb_point &a = v[i], &b = v[i + 1 < n ? i + 1 : 0];
+      if ((a.y <= yc && yc < b.y) || (b.y <= yc && yc < a.y)) {
+        double x = a.x + (yc - a.y) * (b.x - a.x) / (b.y - a.y);
+        int j = k++;
+        for ( ; j > 0 && xs[j - 1] > x; j--) xs[j] = xs[j - 1];
+        xs[j] = x;
+      }
+    }
+    unsigned *row = t.pixels + y * t.width;
+    for (int i = 0; i + 1 < k; i += 2) {
+      if (xs[i + 1] <= t.bx || xs[i] >= t.br) continue;
+      int xa = xs[i] < t.bx ? t.bx : (int)ceil(xs[i] - 0.5);
+      int xb = xs[i + 1] > t.br ? t.br : (int)ceil(xs[i + 1] - 0.5);
+      if (xa < xb) fill_span(row + xa, xb - xa, pixel);
+    }
+  }
+  if (xs != small) free(xs);
+}
+
+// Bresenham, writing pixels directly when the line is inside the target
+static void draw_segment(const fb_target &t, int x, int y, int x1, int y1, unsigned pixel)
+{
+  int inside = x >= t.bx && x1 >= t.bx && x < t.br && x1 < t.br &&
+               y >= t.by && y1 >= t.by && y < t.bb && y1 < t.bb;
+  int dx = abs(x1 - x), sx = x < x1 ? 1 : -1;
+  int dy = -abs(y1 - y), sy = y < y1 ? 1 : -1;
+  int err = dx + dy;
+  for (;;) {
+    if (inside || (x >= t.bx && x < t.br && y >= t.by && y < t.bb))
+      t.pixels[y * t.width + x] = pixel;
+    if (x == x1 && y == y1) break;
+    int e2 = 2 * err;
+    if (e2 >= dy) { err += dy; x += sx; }
+    if (e2 <= dx) { err += dx; y += sy; }
+  }
+}
+
+// Draws the part of the command inside the target, which is inside the
+// rectangle of the command except for segments and polygons
+static void run_command(const fb_target &t, const Fl_PicoFB_Command &c, const uchar *data)
+{
+  int w = t.br - t.bx, y;
+  unsigned *row = t.pixels + t.by * t.width + t.bx;
+  switch (c.type) {
+    case FB_FILL:
+      for (y = t.by; y < t.bb; y++, row += t.width) fill_span(row, w, c.pixel);
+      break;
+    case FB_BLEND:
+      for (y = t.by; y < t.bb; y++, row += t.width) blend_span(row, w, c.pixel, c.a);
+      break;
+    case FB_SEGMENT:
+      draw_segment(t, c.x, c.y, c.w, c.h, c.pixel);
+      break;
+    case FB_POLYGON:
+      scan_polygon(t, (const fb_point*)data, c.a, c.pixel);
+      break;
+    case FB_IMAGE:
+      data += (t.by - c.y) * c.c + (t.bx - c.x) * c.b;
+      for (y = t.by; y < t.bb; y++, row += t.width, data += c.c) copy_row(row, data, w, c.a, c.b);
+      break;
+    case FB_BITMAP:
+      data += (t.by - c.y) * c.b;
+      for (y = t.by; y < t.bb; y++, row += t.width, data += c.b) {
+        for (int i = 0; i < w; i++) {
+          int b = c.a + t.bx - c.x + i;
+          if (data[b >> 3] & (1 << (b & 7))) row[i] = c.pixel;
+        }
+      }
+      break;
+  }
+}
+
+// Reserves size bytes of data, 8 byte aligned, at list->size
+static uchar *list_data(Fl_PicoFB_Display_List *list, size_t size)
+{
+  size = (size + 7) & ~(size_t)7;
+  if (list->size + size > list->data_alloc) {
+    while (list->size + size > list->data_alloc) list->data_alloc = list->data_alloc ? 2 * list->data_alloc : 65536;
+    list->data = (uchar*)realloc(list->data, list->data_alloc);
+  }
+  uchar *d = list->data + list->size;
+  list->size += size;
+  return d;
+}
+
+// What the threads that draw tiles share
+struct fb_tile_job {
+  const Fl_PicoFB_Display_List *list;
+  unsigned *pixels;
+  int width, height, tiles_x, tiles;
+  const int *first;	// commands[first[t]] to commands[first[t + 1] - 1] are in tile t
+  const int *commands;	// indexes in list->commands
+  int next;		// the next tile to draw
+#if USE_TILE_THREADS
+  pthread_mutex_t mutex;
+#endif
+};
+
+static void draw_tile(const fb_tile_job *job, int tile)
+{
+  fb_target t;
+  t.pixels = job->pixels;
+  t.width = job->width;
+  int tx = (tile % job->tiles_x) * TILE_W, ty = (tile / job->tiles_x) * TILE_H;
+  for (int i = job->first[tile]; i < job->first[tile + 1]; i++) {
+    const Fl_PicoFB_Command &c = job->list->commands[job->commands[i]];
+    t.bx = c.bx > tx ? c.bx : tx;
+    t.by = c.by > ty ? c.by : ty;
+    t.br = c.br < tx + TILE_W ? c.br : tx + TILE_W;
+    t.bb = c.bb < ty + TILE_H ? c.bb : ty + TILE_H;
+    run_command(t, c, job->list->data + c.data);
+  }
+}
+
+// Draws the tiles that no other thread is drawing
+static void draw_tiles(fb_tile_job *job)
+{
+  for (;;) {
+#if USE_TILE_THREADS
+    pthread_mutex_lock(&job->mutex);
+    int tile = job->next++;
+    pthread_mutex_unlock(&job->mutex);
+#else
+    int tile = job->next++;
+#endif // USE_TILE_THREADS
+    if (tile >= job->tiles) break;
+    draw_tile(job, tile);
+  }
+}
+
+#if USE_TILE_THREADS
+extern "C" {
+  static void *tile_thread(void *job) {
+    draw_tiles((fb_tile_job*)job);
+    return 0;
+  }
+}
+#endif // USE_TILE_THREADS
+
+
+Fl_PicoFB_Graphics_Driver::Fl_PicoFB_Graphics_Driver(int w, int h)
+{
+  width_ = w > 0 ? w : 0;
+  height_ = h > 0 ? h : 0;
+  pixels_ = new unsigned[width_ * height_];
+  fill_span(pixels_, width_ * height_, 0xffffffff);
+  color(FL_BLACK);
+  line_width_ = 0;
+  offset_x_ = offset_y_ = 0;
+  depth_ = 0;
+  clip_[0].x = clip_[0].y = 0;
+  clip_[0].w = width_; clip_[0].h = height_;
+  p = NULL;
+  p_size = 0;
+  threads_ = 0;
+  list_ = NULL;
+}
+
+
+Fl_PicoFB_Graphics_Driver::~Fl_PicoFB_Graphics_Driver()
+{
+  if (list_) list_->count = 0; // nothing to draw
+  threads(0);
+  delete[] pixels_;
+  if (p) free(p);
+}
+
+
+/* Sets how drawing is done. With 0, each drawing operation changes the
+ pixels at once. Otherwise, they are kept in a display list that is drawn
+ by rasterize(), in tiles drawn by n threads.
+ */
+void Fl_PicoFB_Graphics_Driver::threads(int n)
+{
+  rasterize();
+  threads_ = n > 0 ? n : 0;
+  if (threads_ && !list_) {
+    list_ = new Fl_PicoFB_Display_List;
+    list_->commands = NULL;
+    list_->count = list_->alloc = 0;
+    list_->data = NULL;
+    list_->size = list_->data_alloc = 0;
+  } else if (!threads_ && list_) {
+    free(list_->commands);
+    free(list_->data);
+    delete list_;
+    list_ = NULL;
+  }
+}
+
+
+/* Draws the display list, if any, and empties it. Commands are sorted by
+ tile, keeping their order, and tiles are drawn by up to threads() threads.
+ */
+void Fl_PicoFB_Graphics_Driver::rasterize()
+{
+  if (!list_ || !list_->count) return;
+  fb_tile_job job;
+  job.list = list_;
+  job.pixels = pixels_;
+  job.width = width_;
+  job.height = height_;
+  job.tiles_x = (width_ + TILE_W - 1) / TILE_W;
+  job.tiles = job.tiles_x * ((height_ + TILE_H - 1) / TILE_H);
+  int *first = new int[job.tiles + 1];
+  memset(first, 0, (job.tiles + 1) * sizeof(int));
+  int i, tx, ty, total = 0;
+  for (i = 0; i < list_->count; i++) {
+    const Fl_PicoFB_Command &c = list_->commands[i];
+    for (ty = c.by / TILE_H; ty <= (c.bb - 1) / TILE_H; ty++)
+      for (tx = c.bx / TILE_W; tx <= (c.br - 1) / TILE_W; tx++)
+        first[ty * job.tiles_x + tx + 1]++;
+  }
+  for (i = 1; i <= job.tiles; i++) first[i] += first[i - 1];
+  total = first[job.tiles];
+  int *commands = new int[total], *fill = new int[job.tiles];
+  memcpy(fill, first, job.tiles * sizeof(int));
+  for (i = 0; i < list_->count; i++) {
+    const Fl_PicoFB_Command &c = list_->commands[i];
+    for (ty = c.by / TILE_H; ty <= (c.bb - 1) / TILE_H; ty++)
+      for (tx = c.bx / TILE_W; tx <= (c.br - 1) / TILE_W; tx++)
+        commands[fill[ty * job.tiles_x + tx]++] = i;
+  }
+  delete[] fill;
+  job.first = first;
+  job.commands = commands;
+  job.next = 0;
+  int n = threads_ < job.tiles ? threads_ : job.tiles;
+#if USE_TILE_THREADS
+  pthread_mutex_init(&job.mutex, 0);
+  pthread_t *tid = new pthread_t[n];
+  char *started = new char[n];
+  for (i = 1; i < n; i++)
+    started[i] = pthread_create(tid + i, 0, tile_thread, &job) == 0;
+  // threads that could not be started leave more tiles to this one
+  draw_tiles(&job);
+  for (i = 1; i < n; i++)
+    if (started[i]) pthread_join(tid[i], 0);
+  delete[] started;
+  delete[] tid;
+  pthread_mutex_destroy(&job.mutex);
+#else
+  draw_tiles(&job);
+#endif // USE_TILE_THREADS
+  delete[] commands;
+  delete[] first;
+  list_->count = 0;
+  list_->size = 0;
+}
+
+
+/* Draws the command c if it changes pixels inside bx <= x < br and
+ by <= y < bb, or adds it to the display list with a copy of the part of
+ its data that is needed.
+ */
+void Fl_PicoFB_Graphics_Driver::draw_command(Fl_PicoFB_Command &c, int bx, int by, int br, int bb, const uchar *data)
+{
+  const Clip_Rect &r = clip_[rstackptr];
+  c.bx = bx > r.x ? bx : r.x;
+  c.by = by > r.y ? by : r.y;
+  c.br = br < r.x + r.w ? br : r.x + r.w;
+  c.bb = bb < r.y + r.h ? bb : r.y + r.h;
+  if (c.bx >= c.br || c.by >= c.bb) return;
+  if (!list_) {
+    fb_target t = { pixels_, width_, c.bx, c.by, c.br, c.bb };
+    run_command(t, c, data);
+    return;
+  }
+  c.data = list_->size;
+  int w = c.br - c.bx, h = c.bb - c.by, y;
+  uchar *d;
+  switch (c.type) {
+    case FB_POLYGON:
+      memcpy(list_data(list_, c.a * sizeof(fb_point)), data, c.a * sizeof(fb_point));
+      break;
+    case FB_IMAGE:
+      // the pixels inside the rectangle, packed
+      d = list_data(list_, w * h * c.a);
+      data += (c.by - c.y) * c.c + (c.bx - c.x) * c.b;
+      for (y = 0; y < h; y++, data += c.c) {
+        if (c.b == c.a) {
+          memcpy(d, data, w * c.a);
+          d += w * c.a;
+        } else {
+          const uchar *s = data;
+          for (int i = 0; i < w; i++, s += c.b, d += c.a) memcpy(d, s, c.a);
+        }
+      }
+      c.x = c.bx; c.y = c.by;
+      c.b = c.a; c.c = w * c.a;
+      break;
+    case FB_BITMAP:
+      // the rows inside the rectangle
+      d = list_data(list_, h * c.b);
+      memcpy(d, data + (c.by - c.y) * c.b, h * c.b);
+      c.y = c.by;
+      break;
+  }
+  if (list_->count >= list_->alloc) {
+    list_->alloc = list_->alloc ? 2 * list_->alloc : 1024;
+    list_->commands = (Fl_PicoFB_Command*)realloc(list_->commands, list_->alloc * sizeof(Fl_PicoFB_Command));
+  }
+  list_->commands[list_->count++] = c;
+  if (list_->size > MAX_LIST_DATA || list_->count >= MAX_LIST_COMMANDS) rasterize();
+}
+
+
+void Fl_PicoFB_Graphics_Driver::translate_all(int dx, int dy)
+{
+  stack_x_[depth_] = offset_x_;
+  stack_y_[depth_] = offset_y_;
+  offset_x_ = stack_x_[depth_] + dx;
+  offset_y_ = stack_y_[depth_] + dy;
+  push_matrix();
+  translate(dx, dy);
+  if (depth_ < sizeof(stack_x_)/sizeof(int)) depth_++;
+  else Fl::warning("%s: translate stack overflow!", "Fl_PicoFB_Graphics_Driver");
+}
+
+
+void Fl_PicoFB_Graphics_Driver::untranslate_all()
+{
+  if (depth_ > 0) depth_--;
+  offset_x_ = stack_x_[depth_];
+  offset_y_ = stack_y_[depth_];
+  pop_matrix();
+}
+
+
+// --- rectangles and lines
+
+void Fl_PicoFB_Graphics_Driver::span(int x, int y, int x1)
+{
+  if (x1 < x) { int t = x; x = x1; x1 = t; }
+  Fl_PicoFB_Command c;
+  c.type = FB_FILL;
+  c.pixel = pixel_;
+  draw_command(c, x, y, x1 + 1, y + 1);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::segment(int x, int y, int x1, int y1)
+{
+  if (y == y1) {
+    span(x, y, x1);
+    return;
+  }
+  Fl_PicoFB_Command c;
+  c.type = FB_SEGMENT;
+  c.x = x; c.y = y;
+  c.w = x1; c.h = y1;
+  c.pixel = pixel_;
+  draw_command(c, x < x1 ? x : x1, y < y1 ? y : y1, (x > x1 ? x : x1) + 1, (y > y1 ? y : y1) + 1);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::point(int x, int y)
+{
+  span(x + offset_x_, y + offset_y_, x + offset_x_);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::rect(int x, int y, int w, int h)
+{
+  if (w <= 0 || h <= 0) return;
+  int x1 = x+w-1, y1 = y+h-1;
+  xyline(x, y, x1);
+  xyline(x, y1, x1);
+  yxline(x, y, y1);
+  yxline(x1, y, y1);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::rectf(int x, int y, int w, int h)
+{
+  if (w <= 0 || h <= 0) return;
+  Fl_PicoFB_Command c;
+  c.type = FB_FILL;
+  c.pixel = pixel_;
+  x += offset_x_; y += offset_y_;
+  draw_command(c, x, y, x + w, y + h);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::rectf_alpha(int x, int y, int w, int h, uchar alpha)
+{
+  if (alpha == 255) {
+    rectf(x, y, w, h);
+    return;
+  }
+  if (alpha == 0 || w <= 0 || h <= 0) return;
+  Fl_PicoFB_Command c;
+  c.type = FB_BLEND;
+  c.a = alpha;
+  c.pixel = pixel_;
+  x += offset_x_; y += offset_y_;
+  draw_command(c, x, y, x + w, y + h);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::line(int x, int y, int x1, int y1)
+{
+  if (x == x1) {
+    yxline(x, y, y1);
+    return;
+  }
+  if (y == y1) {
+    xyline(x, y, x1);
+    return;
+  }
+  segment(x + offset_x_, y + offset_y_, x1 + offset_x_, y1 + offset_y_);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::line(int x, int y, int x1, int y1, int x2, int y2)
+{
+  line(x, y, x1, y1);
+  line(x1, y1, x2, y2);
+}
+
+
+// Lines wider than 1 are drawn as rectangles centered on the line
+void Fl_PicoFB_Graphics_Driver::xyline(int x, int y, int x1)
+{
+  int lw = line_width_ > 1 ? line_width_ : 1;
+  y += offset_y_ - lw / 2;
+  for (int i = 0; i < lw; i++) span(x + offset_x_, y + i, x1 + offset_x_);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::xyline(int x, int y, int x1, int y2)
+{
+  xyline(x, y, x1);
+  yxline(x1, y, y2);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::xyline(int x, int y, int x1, int y2, int x3)
+{
+  xyline(x, y, x1);
+  yxline(x1, y, y2);
+  xyline(x1, y2, x3);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::yxline(int x, int y, int y1)
+{
+  int lw = line_width_ > 1 ? line_width_ : 1;
+  if (y1 < y) { int t = y; y = y1; y1 = t; }
+  rectf(x - lw / 2, y, lw, y1 - y + 1);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::yxline(int x, int y, int y1, int x2)
+{
+  yxline(x, y, y1);
+  xyline(x, y1, x2);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::yxline(int x, int y, int y1, int x2, int y3)
+{
+  yxline(x, y, y1);
+  xyline(x, y1, x2);
+  yxline(x2, y1, y3);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::loop(int x0, int y0, int x1, int y1, int x2, int y2)
+{
+  line(x0, y0, x1, y1);
+  line(x1, y1, x2, y2);
+  line(x2, y2, x0, y0);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::loop(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3)
+{
+  line(x0, y0, x1, y1);
+  line(x1, y1, x2, y2);
+  line(x2, y2, x3, y3);
+  line(x3, y3, x0, y0);
+}
+
+
+// Like with X11, the outline is drawn too
+void Fl_PicoFB_Graphics_Driver::polygon(int x0, int y0, int x1, int y1, int x2, int y2)
+{
+  POINT v[3] = {{double(x0 + offset_x_), double(y0 + offset_y_)},
+                {double(x1 + offset_x_), double(y1 + offset_y_)},
+                {double(x2 + offset_x_), double(y2 + offset_y_)}};
+  fill_polygon(v, 3);
+  loop(x0, y0, x1, y1, x2, y2);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::polygon(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3)
+{
+  POINT v[4] = {{double(x0 + offset_x_), double(y0 + offset_y_)},
+                {double(x1 + offset_x_), double(y1 + offset_y_)},
+                {double(x2 + offset_x_), double(y2 + offset_y_)},
+                {double(x3 + offset_x_), double(y3 + offset_y_)}};
+  fill_polygon(v, 4);
+  loop(x0, y0, x1, y1, x2, y2, x3, y3);
+}
+
+
+// The polygon is drawn by scan_polygon(), with a copy of the vertices
+// in the display list
+void Fl_PicoFB_Graphics_Driver::fill_polygon(const POINT *v, int n)
+{
+  if (n < 3) return;
+  const Clip_Rect &r = clip_[rstackptr];
+  double xmin = v[0].x, xmax = v[0].x, ymin = v[0].y, ymax = v[0].y;
+  for (int i = 1; i < n; i++) {
+    if (v[i].x < xmin) xmin = v[i].x;
+    if (v[i].x > xmax) xmax = v[i].x;
+    if (v[i].y < ymin) ymin = v[i].y;
+    if (v[i].y > ymax) ymax = v[i].y;
+  }
+  if (xmin < r.x) xmin = r.x;
+  if (xmax > r.x + r.w) xmax = r.x + r.w;
+  if (ymin < r.y) ymin = r.y;
+  if (ymax > r.y + r.h) ymax = r.y + r.h;
+  if (xmin >= xmax || ymin >= ymax) return;
+  Fl_PicoFB_Command c;
+  c.type = FB_POLYGON;
+  c.a = n;
+  c.pixel = pixel_;
+  draw_command(c, (int)floor(xmin), (int)floor(ymin), (int)ceil(xmax), (int)ceil(ymax), (const uchar*)v);
+}
+
+
+// --- clipping
+
+void Fl_PicoFB_Graphics_Driver::push_clip(int x, int y, int w, int h)
+{
+  if (rstackptr < region_stack_max) {
+    const Clip_Rect &c = clip_[rstackptr];
+    Clip_Rect &r = clip_[++rstackptr];
+    x += offset_x_; y += offset_y_;
+    int x1 = x + w, y1 = y + h;
+    if (w <= 0 || h <= 0) x1 = x, y1 = y;
+    if (x < c.x) x = c.x;
+    if (y < c.y) y = c.y;
+    if (x1 > c.x + c.w) x1 = c.x + c.w;
+    if (y1 > c.y + c.h) y1 = c.y + c.h;
+    r.x = x; r.y = y;
+    r.w = x1 > x ? x1 - x : 0;
+    r.h = y1 > y ? y1 - y : 0;
+    fl_clip_state_number++;
+  } else {
+    Fl::warning("Fl_PicoFB_Graphics_Driver::push_clip: clip stack overflow!\n");
+  }
+}
+
+
+int Fl_PicoFB_Graphics_Driver::clip_box(int x, int y, int w, int h, int &X, int &Y, int &W, int &H)
+{
+  const Clip_Rect &c = clip_[rstackptr];
+  int cx = c.x - offset_x_, cy = c.y - offset_y_;
+  X = x > cx ? x : cx;
+  Y = y > cy ? y : cy;
+  int x1 = x + w < cx + c.w ? x + w : cx + c.w;
+  int y1 = y + h < cy + c.h ? y + h : cy + c.h;
+  W = x1 > X ? x1 - X : 0;
+  H = y1 > Y ? y1 - Y : 0;
+  return X != x || Y != y || W != w || H != h;
+}
+
+
+int Fl_PicoFB_Graphics_Driver::not_clipped(int x, int y, int w, int h)
+{
+  int X, Y, W, H;
+  clip_box(x, y, w, h, X, Y, W, H);
+  return W > 0 && H > 0;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::push_no_clip()
+{
+  if (rstackptr < region_stack_max) {
+    Clip_Rect &r = clip_[++rstackptr];
+    r.x = r.y = 0;
+    r.w = width_; r.h = height_;
+    fl_clip_state_number++;
+  } else {
+    Fl::warning("Fl_PicoFB_Graphics_Driver::push_no_clip: clip stack overflow!\n");
+  }
+}
+
+
+void Fl_PicoFB_Graphics_Driver::pop_clip()
+{
+  if (rstackptr > 0) {
+    rstackptr--;
+    fl_clip_state_number++;
+  } else {
+    Fl::warning("Fl_PicoFB_Graphics_Driver::pop_clip: clip stack underflow!\n");
+  }
+}
+
+
+// --- paths, kept with subpixel precision in graphical coordinates
+
+void Fl_PicoFB_Graphics_Driver::add_vertex(double x, double y)
+{
+  if (n && x == p[n-1].x && y == p[n-1].y) return;
+  if (n >= p_size) {
+    p_size = p ? 2*p_size : 16;
+    p = (POINT*)realloc((void*)p, p_size*sizeof(*p));
+  }
+  p[n].x = x;
+  p[n].y = y;
+  n++;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::begin_points()
+{
+  what = POINT_;
+  n = 0;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::begin_line()
+{
+  what = LINE;
+  n = 0;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::begin_loop()
+{
+  what = LOOP;
+  n = 0;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::begin_polygon()
+{
+  what = POLYGON;
+  n = 0;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::begin_complex_polygon()
+{
+  begin_polygon();
+  gap_ = 0;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::transformed_vertex(double xf, double yf)
+{
+  add_vertex(xf, yf);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::vertex(double x, double y)
+{
+  add_vertex(x*m.a + y*m.c + m.x, x*m.b + y*m.d + m.y);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::end_points()
+{
+  for (int i = 0; i < n; i++) {
+    int x = (int)floor(p[i].x), y = (int)floor(p[i].y);
+    span(x, y, x);
+  }
+}
+
+
+void Fl_PicoFB_Graphics_Driver::end_path_line(int closed)
+{
+  if (n < 2) {
+    end_points();
+    return;
+  }
+  int x = (int)floor(p[0].x), y = (int)floor(p[0].y);
+  for (int i = 1; i <= n; i++) {
+    if (i == n && !closed) break;
+    const POINT &b = p[i < n ? i : 0];
+    int x1 = (int)floor(b.x), y1 = (int)floor(b.y);
+    segment(x, y, x1, y1);
+    x = x1; y = y1;
+  }
+}
+
+
+void Fl_PicoFB_Graphics_Driver::end_line()
+{
+  end_path_line(0);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::end_loop()
+{
+  end_path_line(1);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::end_polygon()
+{
+  while (n > 2 && p[n-1].x == p[0].x && p[n-1].y == p[0].y) n--;
+  if (n < 3) {
+    end_line();
+    return;
+  }
+  fill_polygon(p, n);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::gap()
+{
+  while (n > gap_+2 && p[n-1].x == p[gap_].x && p[n-1].y == p[gap_].y) n--;
+  if (n > gap_+2) {
+    add_vertex(p[gap_].x, p[gap_].y);
+    gap_ = n;
+  } else {
+    n = gap_;
+  }
+}
+
+
+void Fl_PicoFB_Graphics_Driver::end_complex_polygon()
+{
+  gap();
+  if (n < 3) {
+    end_line();
+    return;
+  }
+  fill_polygon(p, n);
+}
+
+
+// Adds the circle to the current path, as a closed line of about 3 pixel
+// long segments
+void Fl_PicoFB_Graphics_Driver::circle(double x, double y, double r)
+{
+  double rx = fabs(transform_dx(r, 0)) + fabs(transform_dx(0, r));
+  double ry = fabs(transform_dy(r, 0)) + fabs(transform_dy(0, r));
+  int segs = int(M_PI * (rx + ry) / 3);
+  if (segs < 8) segs = 8;
+  for (int i = 0; i <= segs; i++) {
+    double a = 2 * M_PI * i / segs;
+    vertex(x + r * cos(a), y - r * sin(a));
+  }
+}
+
+
+// Makes the path the arc of the ellipse inside the box, like
+// XDrawArc() and XFillArc() do, in graphical coordinates
+void Fl_PicoFB_Graphics_Driver::arc_vertices(int x, int y, int w, int h, double a1, double a2)
+{
+  n = 0;
+  double rx = w / 2.0, ry = h / 2.0;
+  double cx = x + offset_x_ + rx, cy = y + offset_y_ + ry;
+  int segs = int(M_PI * (rx + ry) * fabs(a2 - a1) / 360 / 3);
+  if (segs < 4) segs = 4;
+  a1 *= M_PI / 180; a2 *= M_PI / 180;
+  for (int i = 0; i <= segs; i++) {
+    double a = a1 + (a2 - a1) * i / segs;
+    add_vertex(cx + rx * cos(a), cy - ry * sin(a));
+  }
+}
+
+
+void Fl_PicoFB_Graphics_Driver::arc(int x, int y, int w, int h, double a1, double a2)
+{
+  if (w <= 0 || h <= 0) return;
+  // the outline goes through the pixels inside the box
+  arc_vertices(x, y, w - 1, h - 1, a1, a2);
+  for (int i = 0; i < n; i++) { p[i].x += 0.5; p[i].y += 0.5; }
+  end_line();
+  n = 0;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::pie(int x, int y, int w, int h, double a1, double a2)
+{
+  if (w <= 0 || h <= 0) return;
+  arc_vertices(x, y, w, h, a1, a2);
+  if (fabs(a2 - a1) < 360) add_vertex(x + offset_x_ + w / 2.0, y + offset_y_ + h / 2.0);
+  fill_polygon(p, n);
+  n = 0;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::line_style(int style, int width, char* dashes)
+{
+  // dashes are not supported, and only horizontal and vertical lines
+  // can be wider than 1
+  line_width_ = width;
+}
+
+
+// --- colors
+
+void Fl_PicoFB_Graphics_Driver::color(Fl_Color c)
+{
+  uchar r, g, b;
+  Fl::get_color(c, r, g, b);
+  color_ = c;
+  pixel_ = 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::color(uchar r, uchar g, uchar b)
+{
+  color_ = fl_rgb_color(r, g, b);
+  pixel_ = 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+
+// --- images
+
+// Images are drawn from the pixel at X,Y, with D bytes from one pixel to
+// the next and L bytes from one line to the next
+void Fl_PicoFB_Graphics_Driver::draw_image(const uchar* buf, int X, int Y, int W, int H, int D, int L)
+{
+  int alpha = D & FL_IMAGE_WITH_ALPHA; // images with alpha are blended
+  D &= ~FL_IMAGE_WITH_ALPHA;
+  if (!L) L = W * D;
+  int depth = abs(D);
+  if (depth < 1 || W <= 0 || H <= 0) return;
+  if (depth > 4) depth = 3;
+  else if (!alpha) depth = depth < 3 ? 1 : 3;
+  Fl_PicoFB_Command c;
+  c.type = FB_IMAGE;
+  c.x = X + offset_x_; c.y = Y + offset_y_;
+  c.a = depth; c.b = D; c.c = L;
+  draw_command(c, c.x, c.y, c.x + W, c.y + H, buf);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::draw_image_mono(const uchar* buf, int X, int Y, int W, int H, int D, int L)
+{
+  if (!L) L = W * D;
+  if (!D || W <= 0 || H <= 0) return;
+  Fl_PicoFB_Command c;
+  c.type = FB_IMAGE;
+  c.x = X + offset_x_; c.y = Y + offset_y_;
+  c.a = 1; c.b = D; c.c = L;
+  draw_command(c, c.x, c.y, c.x + W, c.y + H, buf);
+}
+
+
+// Each line of the image is a command
+void Fl_PicoFB_Graphics_Driver::draw_image(Fl_Draw_Image_Cb cb, void* data, int X, int Y, int W, int H, int D)
+{
+  int x, y, w, h;
+  clip_box(X, Y, W, H, x, y, w, h);
+  if (w <= 0 || h <= 0) return;
+  D = abs(D);
+  uchar *buf = new uchar[w * D];
+  for (int j = 0; j < h; j++) {
+    cb(data, x - X, y - Y + j, w, buf);
+    draw_image(buf, x, y + j, w, 1, D, 0);
+  }
+  delete[] buf;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::draw_image_mono(Fl_Draw_Image_Cb cb, void* data, int X, int Y, int W, int H, int D)
+{
+  int x, y, w, h;
+  clip_box(X, Y, W, H, x, y, w, h);
+  if (w <= 0 || h <= 0) return;
+  D = abs(D);
+  uchar *buf = new uchar[w * D];
+  for (int j = 0; j < h; j++) {
+    cb(data, x - X, y - Y + j, w, buf);
+    draw_image_mono(buf, x, y + j, w, 1, D, 0);
+  }
+  delete[] buf;
+}
+
+
+void Fl_PicoFB_Graphics_Driver::draw(Fl_RGB_Image *img, int XP, int YP, int WP, int HP, int cx, int cy)
+{
+  int X, Y, W, H;
+  if (!img->d() || !img->array) return;
+  if (start_image(img, XP, YP, WP, HP, cx, cy, X, Y, W, H)) return;
+  int d = img->d(), ld = img->ld() ? img->ld() : img->w() * d;
+  Fl_PicoFB_Command c;
+  c.type = FB_IMAGE;
+  c.x = X + offset_x_; c.y = Y + offset_y_;
+  c.a = d; c.b = d; c.c = ld;
+  draw_command(c, c.x, c.y, c.x + W, c.y + H, img->array + cy * ld + cx * d);
+}
+
+
+// Pixmaps are converted to an image with alpha each time
+void Fl_PicoFB_Graphics_Driver::draw(Fl_Pixmap *pxm, int XP, int YP, int WP, int HP, int cx, int cy)
+{
+  if (pxm->w() <= 0 || pxm->h() <= 0) return;
+  Fl_RGB_Image rgb(pxm);
+  draw(&rgb, XP, YP, WP, HP, cx, cy);
+}
+
+
+void Fl_PicoFB_Graphics_Driver::draw(Fl_Bitmap *bm, int XP, int YP, int WP, int HP, int cx, int cy)
+{
+  int X, Y, W, H;
+  if (!bm->array) return;
+  if (start_image(bm, XP, YP, WP, HP, cx, cy, X, Y, W, H)) return;
+  int rowbytes = (bm->w() + 7) / 8;
+  Fl_PicoFB_Command c;
+  c.type = FB_BITMAP;
+  c.x = X + offset_x_; c.y = Y + offset_y_;
+  c.a = cx; c.b = rowbytes;
+  c.pixel = pixel_;
+  draw_command(c, c.x, c.y, c.x + W, c.y + H, bm->array + cy * rowbytes);
+}
+
+
+//
+// End of "$Id$".
+//
@@ -30,6 +30,9 @@
 #include <FL/Fl_Tooltip.H>
 
 #include <sys/time.h>
+#include <time.h>
+#include <stdio.h>
+#include <string.h>
 
 #if HAVE_XINERAMA
 #  include <X11/extensions/Xinerama.h>
@@ -65,40 +68,148 @@ extern const char *fl_bg2;
 
 
 ////////////////////////////////////////////////////////////////////////
-// Timeouts are stored in a sorted list (*first_timeout), so only the
-// first one needs to be checked to see if any should be called.
-// Allocated, but unused (free) Timeout structs are stored in another
-// linked list (*free_timeout).
+// Timeouts are stored in a binary heap (timeout_heap) ordered by their
+// absolute due time on a monotonic clock, so only the first one needs
+// to be checked to see if any should be called, and adding or removing
+// a timeout takes O(log n). Each timeout also knows its position in the
+// heap and is linked into a hash table by (cb, arg), so that
+// has_timeout() and remove_timeout() don't need to search the heap.
+// Allocated, but unused (free) Timeout structs are stored in a linked
+// list (*free_timeout).
 
 struct Timeout {
-  double time;
+  double time;		// absolute due time, see timeout_clock
+  unsigned long seq;	// insertion order, to call equal times in order
   void (*cb)(void*);
   void* arg;
-  Timeout* next;
+  int index;		// position in timeout_heap
+  Timeout* next;	// next in hash bucket or free list
+  Timeout** prev;	// pointer to this in hash bucket
 };
-static Timeout* first_timeout, *free_timeout;
+static Timeout** timeout_heap;
+static int num_timeouts, alloc_timeouts;
+static Timeout** timeout_hash;
+static int timeout_hash_size;	// power of 2
+static Timeout* free_timeout;
+static unsigned long timeout_seq;
+
+// The current time, as of the last call of elapse_timeouts().
+static double timeout_clock;
 
 // I avoid the overhead of getting the current time when we have no
 // timeouts by setting this flag instead of getting the time.
-// In this case calling elapse_timeouts() does nothing, but records
-// the current time, and the next call will actually elapse time.
+// In this case timeout_clock is out of date and is updated before
+// any new timeout is added.
 static char reset_clock = 1;
 
 static void elapse_timeouts() {
-  static struct timeval prevclock;
+#ifdef CLOCK_MONOTONIC
+  struct timespec newclock;
+  clock_gettime(CLOCK_MONOTONIC, &newclock);
+  timeout_clock = newclock.tv_sec + newclock.tv_nsec/1000000000.0;
+#else
   struct timeval newclock;
   gettimeofday(&newclock, NULL);
-  double elapsed = newclock.tv_sec - prevclock.tv_sec +
-    (newclock.tv_usec - prevclock.tv_usec)/1000000.0;
-  prevclock.tv_sec = newclock.tv_sec;
-  prevclock.tv_usec = newclock.tv_usec;
-  if (reset_clock) {
-    reset_clock = 0;
-  } else if (elapsed > 0) {
-    for (Timeout* t = first_timeout; t; t = t->next) t->time -= elapsed;
+  timeout_clock = newclock.tv_sec + newclock.tv_usec/1000000.0;
+#endif
+  reset_clock = 0;
+}
+
+static inline int timeout_before(Timeout* a, Timeout* b) {
+  return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+static void timeout_sift_up(int i) {
+  Timeout* t = timeout_heap[i];
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!timeout_before(t, timeout_heap[parent])) break;
+    timeout_heap[i] = timeout_heap[parent];
+    timeout_heap[i]->index = i;
+    i = parent;
+  }
+  timeout_heap[i] = t;
+  t->index = i;
+}
+
+static void timeout_sift_down(int i) {
+  Timeout* t = timeout_heap[i];
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= num_timeouts) break;
+    if (child + 1 < num_timeouts &&
+        timeout_before(timeout_heap[child + 1], timeout_heap[child])) child++;
+    if (!timeout_before(timeout_heap[child], t)) break;
+    timeout_heap[i] = timeout_heap[child];
+    timeout_heap[i]->index = i;
+    i = child;
+  }
+  timeout_heap[i] = t;
+  t->index = i;
+}
+
+static inline Timeout** timeout_bucket(void (*cb)(void*), void* arg) {
+  unsigned long h = (unsigned long)(fl_uintptr_t)cb * 31 ^ (unsigned long)(fl_uintptr_t)arg;
+  h ^= h >> 7; h ^= h >> 15;
+  return timeout_hash + (h & (timeout_hash_size - 1));
+}
+
+static void timeout_hash_insert(Timeout* t) {
+  Timeout** p = timeout_bucket(t->cb, t->arg);
+  t->next = *p;
+  if (t->next) t->next->prev = &t->next;
+  t->prev = p;
+  *p = t;
+}
+
+// Take a timeout out of the heap and the hash table and put it on the
+// free list.
+static void timeout_delete(Timeout* t) {
+  int i = t->index;
+  num_timeouts--;
+  if (i < num_timeouts) {
+    Timeout* last = timeout_heap[num_timeouts];
+    timeout_heap[i] = last;
+    last->index = i;
+    if (i > 0 && timeout_before(last, timeout_heap[(i - 1) / 2]))
+      timeout_sift_up(i);
+    else
+      timeout_sift_down(i);
   }
+  *t->prev = t->next;
+  if (t->next) t->next->prev = t->prev;
+  t->next = free_timeout;
+  free_timeout = t;
 }
 
+// Put a new timeout due at the absolute \p time into the heap and the
+// hash table.
+static void timeout_add(double time, void (*cb)(void*), void* arg) {
+  Timeout* t = free_timeout;
+  if (t) free_timeout = t->next;
+  else t = new Timeout;
+  t->time = time;
+  t->seq = timeout_seq++;
+  t->cb = cb;
+  t->arg = arg;
+
+  if (num_timeouts >= alloc_timeouts) {
+    alloc_timeouts = alloc_timeouts ? 2 * alloc_timeouts : 32;
+    timeout_heap = (Timeout**)realloc(timeout_heap, alloc_timeouts * sizeof(Timeout*));
+  }
+  if (num_timeouts >= timeout_hash_size) {
+    // grow the hash table and rehash all timeouts:
+    free(timeout_hash);
+    timeout_hash_size = timeout_hash_size ? 2 * timeout_hash_size : 64;
+    timeout_hash = (Timeout**)calloc(timeout_hash_size, sizeof(Timeout*));
+    for (int i = 0; i < num_timeouts; i++) timeout_hash_insert(timeout_heap[i]);
+  }
+
+  timeout_heap[num_timeouts] = t;
+  num_timeouts++;
+  timeout_sift_up(num_timeouts - 1);
+  timeout_hash_insert(t);
+}
 
 // Continuously-adjusted error value, this is a number <= 0 for how late
 // we were at calling the last timeout. This appears to make repeat_timeout
@@ -446,19 +557,18 @@ double Fl_X11_Screen_Driver::wait(double time_to_wait)
 {
   static char in_idle;
 
-  if (first_timeout) {
+  if (num_timeouts) {
     elapse_timeouts();
     Timeout *t;
-    while ((t = first_timeout)) {
-      if (t->time > 0) break;
-      // The first timeout in the array has expired.
-      missed_timeout_by = t->time;
-      // We must remove timeout from array before doing the callback:
+    while (num_timeouts) {
+      t = timeout_heap[0];
+      if (t->time > timeout_clock) break;
+      // The first timeout in the heap has expired.
+      missed_timeout_by = t->time - timeout_clock;
+      // We must remove timeout from heap before doing the callback:
       void (*cb)(void*) = t->cb;
       void *argp = t->arg;
-      first_timeout = t->next;
-      t->next = free_timeout;
-      free_timeout = t;
+      timeout_delete(t);
       // Now it is safe for the callback to do add_timeout:
       cb(argp);
     }
@@ -475,8 +585,8 @@ double Fl_X11_Screen_Driver::wait(double time_to_wait)
     // the idle function may turn off idle, we can then wait:
     if (Fl::idle) time_to_wait = 0.0;
   }
-  if (first_timeout && first_timeout->time < time_to_wait)
-    time_to_wait = first_timeout->time;
+  if (num_timeouts && timeout_heap[0]->time - timeout_clock < time_to_wait)
+    time_to_wait = timeout_heap[0]->time - timeout_clock;
   if (time_to_wait <= 0.0) {
     // do flush second so that the results of events are visible:
     int ret = this->poll_or_select_with_delay(0.0);
@@ -494,9 +604,9 @@ double Fl_X11_Screen_Driver::wait(double time_to_wait)
 
 int Fl_X11_Screen_Driver::ready()
 {
-  if (first_timeout) {
+  if (num_timeouts) {
     elapse_timeouts();
-    if (first_timeout->time <= 0) return 1;
+    if (timeout_heap[0]->time <= timeout_clock) return 1;
   } else {
     reset_clock = 1;
   }
@@ -559,6 +669,28 @@ void Fl_X11_Screen_Driver::grab(Fl_Window* win)
 // Wrapper around XParseColor...
 int Fl_X11_Screen_Driver::parse_color(const char* p, uchar& r, uchar& g, uchar& b)
 {
+  if (*p == '#') {
+    // XParseColor() reads these without the server, and so do we, so that
+    // pixmaps (e.g. the icons of Fl_Tree) can be used without a display.
+    // The digits are the high bits of each component.
+    size_t n = strlen(++p);
+    size_t m = n/3;
+    const char *pattern = 0;
+    switch(m) {
+      case 1: pattern = "%1x%1x%1x"; break;
+      case 2: pattern = "%2x%2x%2x"; break;
+      case 3: pattern = "%3x%3x%3x"; break;
+      case 4: pattern = "%4x%4x%4x"; break;
+      default: return 0;
+    }
+    if (n != 3*m || strspn(p, "0123456789abcdefABCDEF") != n) return 0;
+    unsigned R,G,B; if (sscanf(p,pattern,&R,&G,&B) != 3) return 0;
+    int shift = 16 - 4*m;
+    r = (uchar)((R << shift) >> 8);
+    g = (uchar)((G << shift) >> 8);
+    b = (uchar)((B << shift) >> 8);
+    return 1;
+  }
   XColor x;
   if (!fl_display) open_display();
   if (XParseColor(fl_display, fl_colormap, p, &x)) {
@@ -637,33 +769,23 @@ const char *Fl_X11_Screen_Driver::get_system_scheme()
 //
 
 void Fl_X11_Screen_Driver::add_timeout(double time, Fl_Timeout_Handler cb, void *argp) {
+  // unlike repeat_timeout(), don't make up for the last timeout being late:
   elapse_timeouts();
-  repeat_timeout(time, cb, argp);
+  timeout_add(timeout_clock + time, cb, argp);
 }
 
 void Fl_X11_Screen_Driver::repeat_timeout(double time, Fl_Timeout_Handler cb, void *argp) {
+  if (reset_clock) elapse_timeouts();
   time += missed_timeout_by; if (time < -.05) time = 0;
-  Timeout* t = free_timeout;
-  if (t) {
-      free_timeout = t->next;
-  } else {
-      t = new Timeout;
-  }
-  t->time = time;
-  t->cb = cb;
-  t->arg = argp;
-  // insert-sort the new timeout:
-  Timeout** p = &first_timeout;
-  while (*p && (*p)->time <= time) p = &((*p)->next);
-  t->next = *p;
-  *p = t;
+  timeout_add(timeout_clock + time, cb, argp);
 }
 
 /**
   Returns true if the timeout exists and has not been called yet.
 */
 int Fl_X11_Screen_Driver::has_timeout(Fl_Timeout_Handler cb, void *argp) {
-  for (Timeout* t = first_timeout; t; t = t->next)
+  if (!num_timeouts) return 0;
+  for (Timeout* t = *timeout_bucket(cb, argp); t; t = t->next)
     if (t->cb == cb && t->arg == argp) return 1;
   return 0;
 }
@@ -676,14 +798,17 @@ int Fl_X11_Screen_Driver::has_timeout(Fl_Timeout_Handler cb, void *argp) {
 	This may change in the future.
 */
 void Fl_X11_Screen_Driver::remove_timeout(Fl_Timeout_Handler cb, void *argp) {
-  for (Timeout** p = &first_timeout; *p;) {
+  if (!num_timeouts) return;
+  // without argp the timeouts with any argument are removed, and these
+  // may be in any bucket:
+  Timeout** first = argp ? timeout_bucket(cb, argp) : timeout_hash;
+  Timeout** last = argp ? first : timeout_hash + timeout_hash_size - 1;
+  for (Timeout** p = first; p <= last; p++) {
     Timeout* t = *p;
-    if (t->cb == cb && (t->arg == argp || !argp)) {
-      *p = t->next;
-      t->next = free_timeout;
-      free_timeout = t;
-    } else {
-      p = &(t->next);
+    while (t) {
+      Timeout* next = t->next;
+      if (t->cb == cb && (t->arg == argp || !argp)) timeout_delete(t);
+      t = next;
     }
   }
 }
@@ -56,6 +56,10 @@ Fl_Xlib_Graphics_Driver::Fl_Xlib_Graphics_Driver(void) {
   mask_bitmap_ = NULL;
   p_size = 0;
   p = NULL;
+#if HAVE_XRENDER
+  antialias_ = 0;
+  pd = NULL;
+#endif
   line_delta_ = 0;
 #if USE_PANGO
   pfd_ = pango_font_description_new();
@@ -63,10 +67,14 @@ Fl_Xlib_Graphics_Driver::Fl_Xlib_Graphics_Driver(void) {
 #endif
   offset_x_ = 0; offset_y_ = 0;
   depth_ = 0;
+  clip_rect_[0].is_rect = 0;
 }
 
 Fl_Xlib_Graphics_Driver::~Fl_Xlib_Graphics_Driver() {
   if (p) free(p);
+#if HAVE_XRENDER
+  if (pd) free(pd);
+#endif
 #if USE_PANGO
   pango_font_description_free(pfd_);
 #endif
@@ -117,20 +125,100 @@ void Fl_Xlib_Graphics_Driver::add_rectangle_to_region(Fl_Region r, int X, int Y,
 
 void Fl_Xlib_Graphics_Driver::transformed_vertex0(float fx, float fy) {
   short x = short(fx), y = short(fy);
-  if (!n || x != p[n-1].x || y != p[n-1].y) {
-    if (n >= p_size) {
-      p_size = p ? 2*p_size : 16;
-      p = (XPOINT*)realloc((void*)p, p_size*sizeof(*p));
-    }
-    p[n].x = x;
-    p[n].y = y;
-    n++;
+  if (n) {
+#if HAVE_XRENDER
+    // antialiased polygons keep points that differ by less than a pixel
+    if (antialias_) {
+      if (fx == pd[n-1].x && fy == pd[n-1].y) return;
+    } else
+#endif
+    if (x == p[n-1].x && y == p[n-1].y) return;
   }
+  if (n >= p_size) {
+    p_size = p ? 2*p_size : 16;
+    p = (XPOINT*)realloc((void*)p, p_size*sizeof(*p));
+#if HAVE_XRENDER
+    pd = (XPOINTD*)realloc((void*)pd, p_size*sizeof(*pd));
+#endif
+  }
+  p[n].x = x;
+  p[n].y = y;
+#if HAVE_XRENDER
+  pd[n].x = fx;
+  pd[n].y = fy;
+#endif
+  n++;
+}
+
+int Fl_Xlib_Graphics_Driver::same_vertex(int i, int j) {
+#if HAVE_XRENDER
+  if (antialias_) return pd[i].x == pd[j].x && pd[i].y == pd[j].y;
+#endif
+  return p[i].x == p[j].x && p[i].y == p[j].y;
 }
 
 void Fl_Xlib_Graphics_Driver::fixloop() {  // remove equal points from closed path
-  while (n>2 && p[n-1].x == p[0].x && p[n-1].y == p[0].y) n--;
+  while (n>2 && same_vertex(n-1, 0)) n--;
+}
+
+void Fl_Xlib_Graphics_Driver::antialias(int state) {
+#if HAVE_XRENDER
+  antialias_ = state && can_do_alpha_blending();
+#endif
+}
+
+int Fl_Xlib_Graphics_Driver::antialias() {
+#if HAVE_XRENDER
+  return antialias_;
+#else
+  return 0;
+#endif
+}
+
+#if HAVE_XRENDER
+/* Returns a Render picture of fl_window clipped like the GC, or 0 if
+ nothing would be visible. The caller frees it.
+ The clip is scaled to window pixels here, as restore_clip() does it,
+ so this must not be called between scale_clip() and unscale_clip().
+ */
+XID Fl_Xlib_Graphics_Driver::render_target() {
+  static XRenderPictFormat *fmt24 = XRenderFindStandardFormat(fl_display, PictStandardRGB24);
+  const Clip_Rect *c = rect_clip();
+  Region region = c ? NULL : rstack[rstackptr];
+  XRectangle R;
+  if ((c && !scale_rect_clip(c, R)) || (region && XEmptyRegion(region))) return 0;
+  XRenderPictureAttributes attr;
+  memset(&attr, 0, sizeof(attr));
+  Picture dst = XRenderCreatePicture(fl_display, fl_window, fmt24, 0, &attr);
+  if (c) {
+    XRenderSetPictureClipRectangles(fl_display, dst, 0, 0, &R, 1);
+  } else if (region) {
+    Region r2 = scale_clip(scale_);
+    XRenderSetPictureClipRegion(fl_display, dst, rstack[rstackptr]);
+    unscale_clip(r2);
+  }
+  return dst;
+}
+
+/* Fills a polygon with the current color and antialiased edges. The server
+ gets the polygon as trapezoids and blends them in one request. Like the
+ GC used by XFillPolygon(), this uses the even-odd rule.
+ */
+void Fl_Xlib_Graphics_Driver::render_polygon(const XPOINTD *v, int n) {
+  static XRenderPictFormat *fmt8 = XRenderFindStandardFormat(fl_display, PictStandardA8);
+  Picture dst = render_target();
+  if (!dst) return;
+  uchar r, g, b;
+  Fl::get_color(color(), r, g, b);
+  XRenderColor rc;
+  rc.red = r * 0x101; rc.green = g * 0x101; rc.blue = b * 0x101; rc.alpha = 0xffff;
+  Picture src = XRenderCreateSolidFill(fl_display, &rc);
+  XRenderCompositeDoublePoly(fl_display, PictOpOver, src, dst, fmt8, 0, 0, 0, 0,
+                             (const XPointDouble*)v, n, 0);
+  XRenderFreePicture(fl_display, src);
+  XRenderFreePicture(fl_display, dst);
 }
+#endif // HAVE_XRENDER
 
 // FIXME: should be members of Fl_Xlib_Graphics_Driver
 XRectangle fl_spot;
@@ -235,8 +323,9 @@ void Fl_Xlib_Graphics_Driver::font_name(int num, const char *name) {
 
 
 Region Fl_Xlib_Graphics_Driver::scale_clip(float f) {
-  Region r = rstack[rstackptr];
-  if (r == 0 || (f == 1 && offset_x_ == 0 && offset_y_ == 0) ) return 0;
+  if (f == 1 && offset_x_ == 0 && offset_y_ == 0) return 0;
+  Region r = clip_region();
+  if (r == 0) return 0;
   int deltaf = f/2;
   Region r2 = XCreateRegion();
   XRectangle R;
@@ -678,6 +678,99 @@ Fl_Font_Descriptor::Fl_Font_Descriptor(const char* name, Fl_Fontsize fsize, int
   listbase = 0;
 #endif // HAVE_GL
   font = fontopen(name, fsize, false, angle);
+  glyphs = NULL;
+}
+
+
+/*
+ Cache of the metrics of single characters, so that the width and the
+ extents of a string can be added up without asking Xft every time.
+ Xft does no kerning, so this gives the same results as XftTextExtents32().
+ Code points in the Basic Multilingual Plane are looked up in pages of
+ 256 characters that are allocated when first used, all others in a hash
+ table.
+ */
+struct Fl_Xft_Glyph {
+  short x, y;
+  unsigned short width, height;
+  short xOff, yOff;
+  char cached;
+};
+
+struct Fl_Xft_Glyph_Entry {
+  unsigned ucs;			// 0 = unused
+  Fl_Xft_Glyph glyph;
+};
+
+struct Fl_Xft_Glyph_Cache {
+  Fl_Xft_Glyph *page[256];
+  Fl_Xft_Glyph_Entry *hash;
+  int hash_size;		// power of 2
+  int hash_count;
+};
+
+static void free_glyph_cache(Fl_Xft_Glyph_Cache *c) {
+  if (!c) return;
+  for (int i = 0; i < 256; i++) free(c->page[i]);
+  free(c->hash);
+  free(c);
+}
+
+static Fl_Xft_Glyph_Entry *glyph_hash_slot(Fl_Xft_Glyph_Cache *c, unsigned ucs) {
+  unsigned i = (ucs * 2654435761U) & (c->hash_size - 1);
+  while (c->hash[i].ucs && c->hash[i].ucs != ucs)
+    i = (i + 1) & (c->hash_size - 1);
+  return c->hash + i;
+}
+
+static const Fl_Xft_Glyph *xft_glyph(Fl_Font_Descriptor *desc, unsigned ucs) {
+  Fl_Xft_Glyph_Cache *c = desc->glyphs;
+  if (!c) c = desc->glyphs = (Fl_Xft_Glyph_Cache*)calloc(1, sizeof(Fl_Xft_Glyph_Cache));
+  Fl_Xft_Glyph *g;
+  if (ucs < 0x10000) {
+    Fl_Xft_Glyph *&page = c->page[ucs >> 8];
+    if (!page) page = (Fl_Xft_Glyph*)calloc(256, sizeof(Fl_Xft_Glyph));
+    g = page + (ucs & 255);
+  } else {
+    if (2 * (c->hash_count + 1) > c->hash_size) {	// grow at half full
+      Fl_Xft_Glyph_Entry *old = c->hash;
+      int old_size = c->hash_size;
+      c->hash_size = old_size ? 2 * old_size : 64;
+      c->hash = (Fl_Xft_Glyph_Entry*)calloc(c->hash_size, sizeof(Fl_Xft_Glyph_Entry));
+      for (int i = 0; i < old_size; i++)
+        if (old[i].ucs) *glyph_hash_slot(c, old[i].ucs) = old[i];
+      free(old);
+    }
+    Fl_Xft_Glyph_Entry *e = glyph_hash_slot(c, ucs);
+    if (!e->ucs) {
+      e->ucs = ucs;
+      c->hash_count++;
+    }
+    g = &e->glyph;
+  }
+  if (!g->cached) {
+    XGlyphInfo i;
+#ifdef __CYGWIN__
+    XftChar16 u = (XftChar16)ucs;
+    XftTextExtents16(fl_display, desc->font, &u, 1, &i);
+#else
+    XftChar32 u = ucs;
+    XftTextExtents32(fl_display, desc->font, &u, 1, &i);
+#endif
+    g->x = i.x; g->y = i.y;
+    g->width = i.width; g->height = i.height;
+    g->xOff = i.xOff; g->yOff = i.yOff;
+    g->cached = 1;
+  }
+  return g;
+}
+
+static inline unsigned next_ucs(const char *&str, const char *end) {
+  if (!(*str & 0x80)) return *str++;
+  int len;
+  unsigned ucs = fl_utf8decode(str, end, &len);
+  str += len;
+  return ucs;
 }
 
 
@@ -704,15 +797,29 @@ static const wchar_t *utf8reformat(const char *str, int& n)
   return buffer;
 }
 
+// Add up the cached character metrics the way XftGlyphExtents() does
 static void utf8extents(Fl_Font_Descriptor *desc, const char *str, int n, XGlyphInfo *extents)
 {
   memset(extents, 0, sizeof(XGlyphInfo));
-  const wchar_t *buffer = utf8reformat(str, n);
-#ifdef __CYGWIN__
-    XftTextExtents16(fl_display, desc->font, (XftChar16 *)buffer, n, extents);
-#else
-    XftTextExtents32(fl_display, desc->font, (XftChar32 *)buffer, n, extents);
-#endif
+  const char *end = str + n;
+  int x = 0, y = 0, left = 0, top = 0, right = 0, bottom = 0;
+  for (bool first = true; str < end; first = false) {
+    const Fl_Xft_Glyph *g = xft_glyph(desc, next_ucs(str, end));
+    int l = x - g->x, t = y - g->y;
+    int r = l + g->width, b = t + g->height;
+    if (first || l < left) left = l;
+    if (first || t < top) top = t;
+    if (first || r > right) right = r;
+    if (first || b > bottom) bottom = b;
+    x += g->xOff;
+    y += g->yOff;
+  }
+  extents->x = -left;
+  extents->y = -top;
+  extents->width = right - left;
+  extents->height = bottom - top;
+  extents->xOff = x;
+  extents->yOff = y;
 }
 
 int Fl_Xlib_Graphics_Driver::height_unscaled() {
@@ -726,22 +833,24 @@ int Fl_Xlib_Graphics_Driver::descent_unscaled() {
 }
 
 double Fl_Xlib_Graphics_Driver::width_unscaled(const char* str, int n) {
-  if (!font_descriptor()) return -1.0;
-  XGlyphInfo i;
-  utf8extents(font_descriptor(), str, n, &i);
-  return i.xOff;
+  Fl_Font_Descriptor *desc = font_descriptor();
+  if (!desc) return -1.0;
+  const char *end = str + n;
+  int w = 0;
+  while (str < end) w += xft_glyph(desc, next_ucs(str, end))->xOff;
+  return w;
 }
 
 static double fl_xft_width(Fl_Font_Descriptor *desc, FcChar32 *str, int n) {
   if (!desc) return -1.0;
-  XGlyphInfo i;
-  XftTextExtents32(fl_display, desc->font, str, n, &i);
-  return i.xOff;
+  int w = 0;
+  for (int i = 0; i < n; i++) w += xft_glyph(desc, str[i])->xOff;
+  return w;
 }
 
 double Fl_Xlib_Graphics_Driver::width_unscaled(unsigned int c) {
   if (!font_descriptor()) return -1.0;
-  return fl_xft_width(font_descriptor(), (FcChar32 *)(&c), 1);
+  return xft_glyph(font_descriptor(), c)->xOff;
 }
 
 void Fl_Xlib_Graphics_Driver::text_extents_unscaled(const char *c, int n, int &dx, int &dy, int &w, int &h) {
@@ -760,6 +869,23 @@ void Fl_Xlib_Graphics_Driver::text_extents_unscaled(const char *c, int n, int &d
   correct_extents(scale_, dx, dy, w, h);
 }
 
+// Sets the clip of an XftDraw to the current clip, without making a Region
+// for rectangular clips. Returns 0 if nothing can be drawn.
+int Fl_Xlib_Graphics_Driver::set_xft_clip(XftDraw *draw) {
+  const Clip_Rect *c = rect_clip();
+  if (c) {
+    if (c->w <= 0 || c->h <= 0) return 0;
+    XRectangle R;
+    R.x = c->x; R.y = c->y; R.width = c->w; R.height = c->h;
+    XftDrawSetClipRectangles(draw, 0, 0, &R, 1);
+    return 1;
+  }
+  Region region = rstack[rstackptr];
+  if (region && XEmptyRegion(region)) return 0;
+  XftDrawSetClip(draw, region);
+  return 1;
+}
+
 void Fl_Xlib_Graphics_Driver::draw_unscaled(const char *str, int n, int x, int y) {
 #if USE_OVERLAY
   XftDraw*& draw_ = fl_overlay ? draw_overlay : ::draw_;
@@ -777,9 +903,7 @@ void Fl_Xlib_Graphics_Driver::draw_unscaled(const char *str, int n, int x, int y
   else //if (draw_window != fl_window)
     XftDrawChange(draw_, draw_window = fl_window);
 
-  Region region = fl_clip_region();
-  if (!(region && XEmptyRegion(region))) {
-    XftDrawSetClip(draw_, region);
+  if (set_xft_clip(draw_)) {
     
     // Use fltk's color allocator, copy the results to match what
     // XftCollorAllocValue returns:
@@ -823,9 +947,7 @@ void Fl_Xlib_Graphics_Driver::drawUCS4(const void *str, int n, int x, int y) {
   else //if (draw_window != fl_window)
     XftDrawChange(draw_, draw_window = fl_window);
 
-  Region region = fl_clip_region();
-  if (region && XEmptyRegion(region)) return;
-  XftDrawSetClip(draw_, region);
+  if (!set_xft_clip(draw_)) return;
 
   // Use fltk's color allocator, copy the results to match what
   // XftCollorAllocValue returns:
@@ -976,6 +1098,9 @@ float Fl_Xlib_Graphics_Driver::scale_bitmap_for_PostScript() {
 Fl_Font_Descriptor::~Fl_Font_Descriptor() {
   if (this == fl_graphics_driver->font_descriptor()) fl_graphics_driver->font_descriptor(NULL);
   //  XftFontClose(fl_display, font);
+#if ! USE_PANGO
+  free_glyph_cache(glyphs);
+#endif
 }
 
 
@@ -47,6 +47,8 @@
 
 #include <config.h>
 #include "Fl_Xlib_Graphics_Driver.H"
+#include "Fl_Xlib_Image_Converter.H"
+#include "Fl_Xlib_Image_Cache.H"
 #include "../X11/Fl_X11_Screen_Driver.H"
 #include "../X11/Fl_X11_Window_Driver.H"
 #  include <FL/Fl.H>
@@ -59,14 +61,19 @@
 #if HAVE_XRENDER
 #include <X11/extensions/Xrender.h>
 #endif
+#if HAVE_XSHM
+#  include <X11/extensions/XShm.h>
+#  include <sys/ipc.h>
+#  include <sys/shm.h>
+#endif
 
 static XImage xi;	// template used to pass info to X
 static int bytes_per_pixel;
 static int scanline_add;
 static int scanline_mask;
 
-static void (*converter)(const uchar *from, uchar *to, int w, int delta);
-static void (*mono_converter)(const uchar *from, uchar *to, int w, int delta);
+static Fl_Xlib_Converter converter;
+static Fl_Xlib_Converter mono_converter;
 
 static int dir;		// direction-alternator
 static int ri,gi,bi;	// saved error-diffusion value
@@ -358,6 +365,365 @@ mono32_converter(const uchar *from,uchar *to,int w, int delta) {
     (*from << fl_redshift)+(*from << fl_greenshift)+(*from << fl_blueshift));
 }
 
+#if HAVE_XSHM
+// for data that is already in the format of the visual
+static void copy_converter(const uchar *from, uchar *to, int w, int delta) {
+  memcpy(to, from, w*delta);
+}
+#endif // HAVE_XSHM
+
+// Not a visual converter: blends RGBA (delta 4) or gray+alpha (delta 2)
+// pixels over the RGB pixels in to, for servers without XRender
+static void blend_converter(const uchar *from, uchar *to, int w, int delta) {
+  uchar srca, dsta;
+  if (delta == 2) {
+    // Composite grayscale + alpha over RGB...
+    for (; w--; from += 2, to += 3) {
+      srca = from[1];
+      dsta = 255 - srca;
+      to[0] = (from[0] * srca + to[0] * dsta) >> 8;
+      to[1] = (from[0] * srca + to[1] * dsta) >> 8;
+      to[2] = (from[0] * srca + to[2] * dsta) >> 8;
+    }
+  } else {
+    // Composite RGBA over RGB...
+    for (; w--; from += delta, to += 3) {
+      srca = from[3];
+      dsta = 255 - srca;
+      to[0] = (from[0] * srca + to[0] * dsta) >> 8;
+      to[1] = (from[1] * srca + to[1] * dsta) >> 8;
+      to[2] = (from[2] * srca + to[2] * dsta) >> 8;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////
+// SSSE3 and AVX2 versions of the 24 and 32 bit converters, chosen at
+// run time depending on the processor. They only handle delta 1 to 4,
+// convert as many pixels as they can at once and leave the last few
+// pixels of each row to the plain converters above. The results are
+// the same to the bit.
+// The 8 and 16 bit converters are not here: error diffusion carries
+// the error of each pixel to the next one, so they can't be done in
+// parallel.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  include <immintrin.h>
+#  define USE_X86_SIMD 1
+#  define SIMD_TARGET(t) __attribute__((target(t)))
+#endif
+
+#if USE_X86_SIMD
+
+// Byte order of each output pixel, as the byte of the input pixel
+// (0 = red or gray, 3 or 1 = alpha) or -1 for zero
+static const signed char rgb_order[]  = { 0, 1, 2 };
+static const signed char bgr_order[]  = { 2, 1, 0 };
+static const signed char rrr_order[]  = { 0, 0, 0 };
+static const signed char xbgr_order[] = { 0, 1, 2,-1 };
+static const signed char rgbx_order[] = {-1, 2, 1, 0 };
+static const signed char bgrx_order[] = {-1, 0, 1, 2 };
+static const signed char xrgb_order[] = { 2, 1, 0,-1 };
+static const signed char xrrr_order[] = { 0, 0, 0,-1 };
+static const signed char rrrx_order[] = {-1, 0, 0, 0 };
+static const signed char argb_order[] = { 2, 1, 0, 3 };
+static const signed char aggg_order[] = { 0, 0, 0, 1 };
+
+// Makes a _mm_shuffle_epi8() mask for 4 pixels of 'size' bytes in the
+// given order, from pixels 'delta' bytes apart starting at pixel 'first'
+static void make_mask(uchar *mask, const signed char *order, int size,
+                      int delta, int first = 0, int word = 0) {
+  memset(mask, 0x80, 16);
+  int n = word ? 2 : 4;
+  for (int k = 0; k < n; k++)
+    for (int c = 0; c < size; c++)
+      if (order[c] >= 0) {
+        if (word) mask[(k*size + c)*2] = uchar((first+k)*delta + order[c]);
+        else mask[k*size + c] = uchar((first+k)*delta + order[c]);
+      }
+}
+
+// Copies bytes of each pixel into the order of the visual
+static int SIMD_TARGET("ssse3")
+shuffle_ssse3(const uchar *from, uchar *to, int w, int delta, int size,
+              const signed char *order) {
+  uchar m[16];
+  make_mask(m, order, size, delta);
+  const __m128i mask = _mm_loadu_si128((const __m128i*)m);
+  const int lim = delta < size ? delta : size; // keep loads and stores inside the rows
+  int n = 0;
+  for (; (w-n)*lim >= 16; n += 4, from += 4*delta, to += 4*size)
+    _mm_storeu_si128((__m128i*)to,
+                     _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)from), mask));
+  return n;
+}
+
+static int SIMD_TARGET("avx2")
+shuffle_avx2(const uchar *from, uchar *to, int w, int delta, int size,
+             const signed char *order) {
+  uchar m[16];
+  make_mask(m, order, size, delta);
+  const __m256i mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m));
+  const int lim = delta < size ? delta : size;
+  int n = 0;
+  for (; (w-n-4)*lim >= 16; n += 8, from += 8*delta, to += 8*size) {
+    __m256i v = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)from)),
+      _mm_loadu_si128((const __m128i*)(from + 4*delta)), 1);
+    v = _mm256_shuffle_epi8(v, mask);
+    if (size == 4) {
+      _mm256_storeu_si256((__m256i*)to, v);
+    } else {
+      _mm_storeu_si128((__m128i*)to, _mm256_castsi256_si128(v));
+      _mm_storeu_si128((__m128i*)(to + 4*size), _mm256_extracti128_si256(v, 1));
+    }
+  }
+  return n + shuffle_ssse3(from, to, w - n, delta, size, order);
+}
+
+// Shifts each color to the place given by fl_redshift etc. (color32_converter)
+static int SIMD_TARGET("ssse3")
+shift_ssse3(const uchar *from, uchar *to, int w, int delta, int mono) {
+  static const signed char r[] = {0,-1,-1,-1}, g[] = {1,-1,-1,-1}, b[] = {2,-1,-1,-1};
+  uchar m[3][16];
+  make_mask(m[0], r, 4, delta);
+  make_mask(m[1], mono ? r : g, 4, delta);
+  make_mask(m[2], mono ? r : b, 4, delta);
+  const __m128i mr = _mm_loadu_si128((const __m128i*)m[0]);
+  const __m128i mg = _mm_loadu_si128((const __m128i*)m[1]);
+  const __m128i mb = _mm_loadu_si128((const __m128i*)m[2]);
+  const __m128i rs = _mm_cvtsi32_si128(fl_redshift);
+  const __m128i gs = _mm_cvtsi32_si128(fl_greenshift);
+  const __m128i bs = _mm_cvtsi32_si128(fl_blueshift);
+  int n = 0;
+  for (; (w-n)*delta >= 16; n += 4, from += 4*delta, to += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)from);
+    __m128i p = _mm_add_epi32(_mm_sll_epi32(_mm_shuffle_epi8(v, mr), rs),
+                              _mm_sll_epi32(_mm_shuffle_epi8(v, mg), gs));
+    p = _mm_add_epi32(p, _mm_sll_epi32(_mm_shuffle_epi8(v, mb), bs));
+    _mm_storeu_si128((__m128i*)to, p);
+  }
+  return n;
+}
+
+// Multiplies the colors by alpha/255 (argb_premul_converter), using
+// x/255 == (x * 0x8081) >> 23 for all x <= 255*255
+static int SIMD_TARGET("ssse3")
+premul_ssse3(const uchar *from, uchar *to, int w, int delta,
+             const signed char *order) {
+  const signed char alpha[] = { order[3], order[3], order[3], -1 };
+  uchar m[4][16];
+  make_mask(m[0], order, 4, delta, 0, 1);
+  make_mask(m[1], order, 4, delta, 2, 1);
+  make_mask(m[2], alpha, 4, delta, 0, 1);
+  make_mask(m[3], alpha, 4, delta, 2, 1);
+  const __m128i clo = _mm_loadu_si128((const __m128i*)m[0]);
+  const __m128i chi = _mm_loadu_si128((const __m128i*)m[1]);
+  const __m128i alo = _mm_loadu_si128((const __m128i*)m[2]);
+  const __m128i ahi = _mm_loadu_si128((const __m128i*)m[3]);
+  const __m128i a255 = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0); // alpha stays
+  const __m128i div = _mm_set1_epi16((short)0x8081);
+  int n = 0;
+  for (; (w-n)*delta >= 16; n += 4, from += 4*delta, to += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)from);
+    __m128i lo = _mm_mullo_epi16(_mm_shuffle_epi8(v, clo),
+                                 _mm_or_si128(_mm_shuffle_epi8(v, alo), a255));
+    __m128i hi = _mm_mullo_epi16(_mm_shuffle_epi8(v, chi),
+                                 _mm_or_si128(_mm_shuffle_epi8(v, ahi), a255));
+    lo = _mm_srli_epi16(_mm_mulhi_epu16(lo, div), 7);
+    hi = _mm_srli_epi16(_mm_mulhi_epu16(hi, div), 7);
+    _mm_storeu_si128((__m128i*)to, _mm_packus_epi16(lo, hi));
+  }
+  return n;
+}
+
+static int SIMD_TARGET("avx2")
+premul_avx2(const uchar *from, uchar *to, int w, int delta,
+            const signed char *order) {
+  const signed char alpha[] = { order[3], order[3], order[3], -1 };
+  uchar m[4][16];
+  make_mask(m[0], order, 4, delta, 0, 1);
+  make_mask(m[1], order, 4, delta, 2, 1);
+  make_mask(m[2], alpha, 4, delta, 0, 1);
+  make_mask(m[3], alpha, 4, delta, 2, 1);
+  const __m256i clo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m[0]));
+  const __m256i chi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m[1]));
+  const __m256i alo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m[2]));
+  const __m256i ahi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)m[3]));
+  const __m256i a255 = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0,
+                                        255, 0, 0, 0, 255, 0, 0, 0);
+  const __m256i div = _mm256_set1_epi16((short)0x8081);
+  int n = 0;
+  for (; (w-n-4)*delta >= 16; n += 8, from += 8*delta, to += 32) {
+    __m256i v = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)from)),
+      _mm_loadu_si128((const __m128i*)(from + 4*delta)), 1);
+    __m256i lo = _mm256_mullo_epi16(_mm256_shuffle_epi8(v, clo),
+                                    _mm256_or_si256(_mm256_shuffle_epi8(v, alo), a255));
+    __m256i hi = _mm256_mullo_epi16(_mm256_shuffle_epi8(v, chi),
+                                    _mm256_or_si256(_mm256_shuffle_epi8(v, ahi), a255));
+    lo = _mm256_srli_epi16(_mm256_mulhi_epu16(lo, div), 7);
+    hi = _mm256_srli_epi16(_mm256_mulhi_epu16(hi, div), 7);
+    _mm256_storeu_si256((__m256i*)to, _mm256_packus_epi16(lo, hi));
+  }
+  return n + premul_ssse3(from, to, w - n, delta, order);
+}
+
+// RGBA over RGB (blend_converter). The RGB pixels are changed in place,
+// so exactly 12 bytes are stored for every 4 pixels.
+static int SIMD_TARGET("ssse3")
+blend_ssse3(const uchar *from, uchar *to, int w, int delta) {
+  if (delta != 4) return 0;
+  static const signed char src[] = { 0, 1, 2,-1 }, a[] = { 3, 3, 3,-1 };
+  uchar m[6][16];
+  make_mask(m[0], src, 4, 4, 0, 1);
+  make_mask(m[1], src, 4, 4, 2, 1);
+  make_mask(m[2], a, 4, 4, 0, 1);
+  make_mask(m[3], a, 4, 4, 2, 1);
+  make_mask(m[4], src, 4, 3, 0, 1);
+  make_mask(m[5], src, 4, 3, 2, 1);
+  const __m128i slo = _mm_loadu_si128((const __m128i*)m[0]);
+  const __m128i shi = _mm_loadu_si128((const __m128i*)m[1]);
+  const __m128i alo = _mm_loadu_si128((const __m128i*)m[2]);
+  const __m128i ahi = _mm_loadu_si128((const __m128i*)m[3]);
+  const __m128i dlo = _mm_loadu_si128((const __m128i*)m[4]);
+  const __m128i dhi = _mm_loadu_si128((const __m128i*)m[5]);
+  const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+                                     -128, -128, -128, -128);
+  const __m128i c255 = _mm_set1_epi16(255);
+  int n = 0;
+  for (; (w-n)*3 >= 16; n += 4, from += 16, to += 12) {
+    __m128i s = _mm_loadu_si128((const __m128i*)from);
+    __m128i d = _mm_loadu_si128((const __m128i*)to);
+    __m128i a_lo = _mm_shuffle_epi8(s, alo), a_hi = _mm_shuffle_epi8(s, ahi);
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(s, slo), a_lo),
+                               _mm_mullo_epi16(_mm_shuffle_epi8(d, dlo),
+                                               _mm_sub_epi16(c255, a_lo)));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(s, shi), a_hi),
+                               _mm_mullo_epi16(_mm_shuffle_epi8(d, dhi),
+                                               _mm_sub_epi16(c255, a_hi)));
+    __m128i v = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+    v = _mm_shuffle_epi8(v, pack);
+    _mm_storel_epi64((__m128i*)to, v);
+    int last = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+    memcpy(to + 8, &last, 4);
+  }
+  return n;
+}
+
+// The SIMD level of this processor: 0 = none, 1 = SSSE3, 2 = AVX2
+static int cpu_simd_level() {
+  static int level = -1;
+  if (level < 0) {
+    __builtin_cpu_init();
+    level = __builtin_cpu_supports("avx2") ? 2 :
+            __builtin_cpu_supports("ssse3") ? 1 : 0;
+  }
+  return level;
+}
+
+// The shuffle and premultiply kernels of a SIMD level
+#  define SHUFFLE_KERNEL(level) ((level) >= 2 ? shuffle_avx2 : shuffle_ssse3)
+#  define PREMUL_KERNEL(level) ((level) >= 2 ? premul_avx2 : premul_ssse3)
+
+// Converters that run a kernel of the given level and do the rest of the
+// row with the plain converter: f_ssse3() and f_avx2(), or only f_ssse3()
+// if there is no AVX2 kernel
+#  define SIMD_CONVERTER_LEVEL(f, size, kernel, name, level) \
+static void f##_##name(const uchar *from, uchar *to, int w, int delta) { \
+  const int simd = level; (void)simd; \
+  int n = (delta > 0 && delta <= 4) ? kernel : 0; \
+  if (n < w) f(from + n*delta, to + n*size, w - n, delta); \
+}
+#  define SIMD_CONVERTER(f, size, kernel) \
+SIMD_CONVERTER_LEVEL(f, size, kernel, ssse3, 1) \
+SIMD_CONVERTER_LEVEL(f, size, kernel, avx2, 2)
+#  define SSSE3_CONVERTER(f, size, kernel) \
+SIMD_CONVERTER_LEVEL(f, size, kernel, ssse3, 1)
+
+SIMD_CONVERTER(rgb_converter, 3, SHUFFLE_KERNEL(simd)(from, to, w, delta, 3, rgb_order))
+SIMD_CONVERTER(bgr_converter, 3, SHUFFLE_KERNEL(simd)(from, to, w, delta, 3, bgr_order))
+SIMD_CONVERTER(rrr_converter, 3, SHUFFLE_KERNEL(simd)(from, to, w, delta, 3, rrr_order))
+SIMD_CONVERTER(xbgr_converter, 4, SHUFFLE_KERNEL(simd)(from, to, w, delta, 4, xbgr_order))
+SIMD_CONVERTER(rgbx_converter, 4, SHUFFLE_KERNEL(simd)(from, to, w, delta, 4, rgbx_order))
+SIMD_CONVERTER(bgrx_converter, 4, SHUFFLE_KERNEL(simd)(from, to, w, delta, 4, bgrx_order))
+SIMD_CONVERTER(xrgb_converter, 4, SHUFFLE_KERNEL(simd)(from, to, w, delta, 4, xrgb_order))
+SIMD_CONVERTER(xrrr_converter, 4, SHUFFLE_KERNEL(simd)(from, to, w, delta, 4, xrrr_order))
+SIMD_CONVERTER(rrrx_converter, 4, SHUFFLE_KERNEL(simd)(from, to, w, delta, 4, rrrx_order))
+SSSE3_CONVERTER(color32_converter, 4, shift_ssse3(from, to, w, delta, 0))
+SSSE3_CONVERTER(mono32_converter, 4, shift_ssse3(from, to, w, delta, 1))
+SIMD_CONVERTER(argb_premul_converter, 4,
+               (delta == 4 ? PREMUL_KERNEL(simd)(from, to, w, 4, argb_order) : 0))
+SIMD_CONVERTER(depth2_to_argb_premul_converter, 4,
+               (delta == 2 ? PREMUL_KERNEL(simd)(from, to, w, 2, aggg_order) : 0))
+SSSE3_CONVERTER(blend_converter, 3, blend_ssse3(from, to, w, delta))
+
+#  define SIMD(f)	f, f##_ssse3, f##_avx2
+#  define SSSE3(f)	f, f##_ssse3, f##_ssse3
+#else
+#  define SIMD(f)	f, f, f
+#  define SSSE3(f)	f, f, f
+#endif // USE_X86_SIMD
+#define PLAIN(f)	f, f, f
+
+// All converters that don't need a colormap, for fl_xlib_image_converter()
+static const struct {
+  const char *name;
+  Fl_Xlib_Converter level[3];	// plain, SSSE3 and AVX2 versions
+  int size;		// bytes per output pixel
+  int delta;		// bytes per input pixel, 3 stands for 3 or 4
+} converter_table[] = {
+  {"color16",	{PLAIN(color16_converter)},	2, 3},
+  {"mono16",	{PLAIN(mono16_converter)},	2, 1},
+  {"c565",	{PLAIN(c565_converter)},	2, 3},
+  {"m565",	{PLAIN(m565_converter)},	2, 1},
+  {"rgb",	{SIMD(rgb_converter)},		3, 3},
+  {"bgr",	{SIMD(bgr_converter)},		3, 3},
+  {"rrr",	{SIMD(rrr_converter)},		3, 1},
+  {"xbgr",	{SIMD(xbgr_converter)},		4, 3},
+  {"rgbx",	{SIMD(rgbx_converter)},		4, 3},
+  {"bgrx",	{SIMD(bgrx_converter)},		4, 3},
+  {"xrgb",	{SIMD(xrgb_converter)},		4, 3},
+  {"xrrr",	{SIMD(xrrr_converter)},		4, 1},
+  {"rrrx",	{SIMD(rrrx_converter)},		4, 1},
+  {"color32",	{SSSE3(color32_converter)},	4, 3},
+  {"mono32",	{SSSE3(mono32_converter)},	4, 1},
+  {"argb_premul", {SIMD(argb_premul_converter)}, 4, 4},
+  {"depth2_to_argb_premul", {SIMD(depth2_to_argb_premul_converter)}, 4, 2},
+  {"blend (RGBA over RGB)", {SSSE3(blend_converter)}, 3, 4},
+};
+
+#  define CONVERTER_COUNT int(sizeof(converter_table)/sizeof(converter_table[0]))
+
+// Returns the fastest version of a converter for this processor
+static Fl_Xlib_Converter fast_converter(Fl_Xlib_Converter f) {
+#if USE_X86_SIMD
+  int level = cpu_simd_level();
+  if (level)
+    for (int i = 0; i < CONVERTER_COUNT; i++)
+      if (converter_table[i].level[0] == f) return converter_table[i].level[level];
+#endif // USE_X86_SIMD
+  return f;
+}
+
+// For test/convert_bench.cxx, see Fl_Xlib_Image_Converter.H
+Fl_Xlib_Converter fl_xlib_image_converter(int i, int *level,
+                                          const char **name,
+                                          int *size, int *delta) {
+  if (i < 0 || i >= CONVERTER_COUNT) return 0;
+#if USE_X86_SIMD
+  if (*level > cpu_simd_level()) *level = cpu_simd_level();
+  if (*level < 0) *level = 0;
+#else
+  *level = 0;
+#endif // USE_X86_SIMD
+  *name = converter_table[i].name;
+  *size = converter_table[i].size;
+  *delta = converter_table[i].delta;
+  return converter_table[i].level[*level];
+}
+
 ////////////////////////////////////////////////////////////////
 
 static void figure_out_visual() {
@@ -467,6 +833,105 @@ static void figure_out_visual() {
 
 #  define MAXBUFFER 0x40000 // 256k
 
+#if HAVE_XSHM
+////////////////////////////////////////////////////////////////
+// Large images are converted into a shared memory segment that the X
+// server reads directly, instead of being sent through the socket.
+// The segment is kept and reused for all images, and only grows.
+
+#  define SHM_MIN_PIXELS 0x4000 // smaller images are sent with XPutImage()
+
+static int shm_state;			// 0 = not tried, 1 = usable, -1 = not usable
+static XShmSegmentInfo shm_info;
+static size_t shm_size;
+static int shm_pending;			// the X server may still read the segment
+static int shm_error;
+static int shm_used;			// the last image was drawn through the segment
+static int shm_fail_attach;		// see fl_xlib_shm_reset()
+
+extern "C" {
+  static int shm_error_handler(Display *, XErrorEvent *) {
+    shm_error = 1;
+    return 0;
+  }
+}
+
+// Wait until the X server is done with the segment
+static void shm_sync() {
+  if (shm_pending) {
+    XSync(fl_display, False);
+    shm_pending = 0;
+  }
+}
+
+// Returns a segment of at least 'size' bytes that is not in use, or NULL
+// if the X server can't use shared memory, e.g. because it runs on
+// another machine
+static char *shm_buffer(size_t size) {
+  if (shm_state < 0) return 0;
+  if (!shm_state) {
+    shm_state = XShmQueryExtension(fl_display) ? 1 : -1;
+    if (shm_state < 0) return 0;
+  }
+  shm_sync();
+  if (size <= shm_size) return shm_info.shmaddr;
+  if (shm_size) {
+    XShmDetach(fl_display, &shm_info);
+    shmdt(shm_info.shmaddr);
+    shm_size = 0;
+  }
+  size = (size + 0xfffff) & ~(size_t)0xfffff; // grow in steps of 1 MB
+  shm_info.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+  if (shm_info.shmid < 0) return 0;
+  shm_info.shmaddr = (char *)shmat(shm_info.shmid, 0, 0);
+  shm_info.readOnly = True;
+  if (shm_info.shmaddr == (char *)-1) {
+    shmctl(shm_info.shmid, IPC_RMID, 0);
+    return 0;
+  }
+  // attaching fails with an X error if the server can't see the segment
+  int shmid = shm_info.shmid;
+  if (shm_fail_attach) shm_info.shmid = -1;
+  shm_error = 0;
+  XErrorHandler old_handler = XSetErrorHandler(shm_error_handler);
+  XShmAttach(fl_display, &shm_info);
+  XSync(fl_display, False);
+  XSetErrorHandler(old_handler);
+  // the segment is freed when both the server and we have detached it
+  shmctl(shmid, IPC_RMID, 0);
+  if (shm_error) {
+    shmdt(shm_info.shmaddr);
+    shm_state = -1;
+    return 0;
+  }
+  shm_size = size;
+  return shm_info.shmaddr;
+}
+#endif // HAVE_XSHM
+
+// For test/image_bench.cxx, see Fl_Xlib_Image_Converter.H
+void fl_xlib_shm_reset(int fail_attach) {
+#if HAVE_XSHM
+  if (shm_size) {
+    shm_sync();
+    XShmDetach(fl_display, &shm_info);
+    shmdt(shm_info.shmaddr);
+    shm_size = 0;
+  }
+  shm_state = 0;
+  shm_used = 0;
+  shm_fail_attach = fail_attach;
+#endif // HAVE_XSHM
+}
+
+int fl_xlib_shm_used() {
+#if HAVE_XSHM
+  return shm_used;
+#else
+  return 0;
+#endif // HAVE_XSHM
+}
+
 static void innards(const uchar *buf, int X, int Y, int W, int H,
 		    int delta, int linedelta, int mono,
 		    Fl_Draw_Image_Cb cb, void* userdata,
@@ -485,7 +950,7 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
   xi.width = w;
   xi.height = h;
 
-  void (*conv)(const uchar *from, uchar *to, int w, int delta) = converter;
+  Fl_Xlib_Converter conv = converter;
   if (mono) conv = mono_converter;
   if (alpha) {
     // This flag states the destination format is ARGB32 (big-endian), pre-multiplied.
@@ -502,71 +967,100 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
     }
   }
 
-  // See if the data is already in the right format.  Unfortunately
-  // some 32-bit x servers (XFree86) care about the unknown 8 bits
-  // and they must be zero.  I can't confirm this for user-supplied
-  // data, so the 32-bit shortcut is disabled...
+  // See if the data is already in the right format. XFree86 cared
+  // about the unused 8 bits of 32-bit pixels, which must be zero, so
+  // user-supplied data is only used for 32-bit visuals with a depth of
+  // 24, where those bits are padding.
   // This can set bytes_per_line negative if image is bottom-to-top
   // I tested it on Linux, but it may fail on other Xlib implementations:
-  if (buf && (
-#  if 0	// set this to 1 to allow 32-bit shortcut
-      delta == 4 &&
-#    if WORDS_BIGENDIAN
-      conv == rgbx_converter
-#    else
-      conv == xbgr_converter
-#    endif
-      ||
+  int direct = buf && (
+      (delta == 4 && fl_visual->depth == 24 &&
+#  if WORDS_BIGENDIAN
+       conv == rgbx_converter
+#  else
+       conv == xbgr_converter
 #  endif
-      conv == rgb_converter && delta==3
-      ) && !(linedelta&scanline_add)) {
+      ) ||
+      (conv == rgb_converter && delta==3)
+      ) && !(linedelta&scanline_add);
+  conv = fast_converter(conv);
+  int linesize = ((w*bytes_per_pixel+scanline_add)&scanline_mask)/sizeof(STORETYPE);
+  STORETYPE *buffer = 0;
+  int blocking = h;
+
+#if HAVE_XSHM
+  // Big images are converted (or just copied) straight into shared
+  // memory, and sent with one request. The server must be able to use
+  // the image without swapping bytes or changing the row padding.
+  XImage shm_xi, *image = &xi;
+  shm_used = 0;
+  if (!alpha && w*h >= SHM_MIN_PIXELS &&
+      xi.byte_order == ImageByteOrder(fl_display) &&
+      linesize*sizeof(STORETYPE) % bytes_per_pixel == 0) {
+    buffer = (STORETYPE *)shm_buffer(linesize*sizeof(STORETYPE)*h);
+    if (buffer) {
+      shm_xi = xi;
+      shm_xi.width = linesize*sizeof(STORETYPE)/bytes_per_pixel;
+      shm_xi.height = h;
+      shm_xi.data = (char *)buffer;
+      shm_xi.bytes_per_line = linesize*sizeof(STORETYPE);
+      shm_xi.obdata = (char *)&shm_info;
+      image = &shm_xi;
+      shm_used = 1;
+      if (direct) conv = copy_converter;
+      direct = 0;
+    }
+  }
+#endif // HAVE_XSHM
+
+  if (direct) {
     xi.data = (char *)(buf+delta*dx+linedelta*dy);
     xi.bytes_per_line = linedelta;
-
+    XPutImage(fl_display,fl_window,gc, &xi, 0, 0, X+dx, Y+dy, w, h);
   } else {
-    int linesize = ((w*bytes_per_pixel+scanline_add)&scanline_mask)/sizeof(STORETYPE);
-    int blocking = h;
-    static STORETYPE *buffer;	// our storage, always word aligned
-    static long buffer_size;
-    {int size = linesize*h;
-    if (size > MAXBUFFER) {
-      size = MAXBUFFER;
-      blocking = MAXBUFFER/linesize;
+    if (!buffer) {
+      static STORETYPE *temp;	// our storage, always word aligned
+      static long temp_size;
+      int size = linesize*h;
+      if (size > MAXBUFFER) {
+        size = MAXBUFFER;
+        blocking = MAXBUFFER/linesize;
+      }
+      if (size > temp_size) {
+        delete[] temp;
+        temp_size = size;
+        temp = new STORETYPE[size];
+      }
+      buffer = temp;
+      xi.data = (char *)buffer;
+      xi.bytes_per_line = linesize*sizeof(STORETYPE);
     }
-    if (size > buffer_size) {
-      delete[] buffer;
-      buffer_size = size;
-      buffer = new STORETYPE[size];
-    }}
-    xi.data = (char *)buffer;
-    xi.bytes_per_line = linesize*sizeof(STORETYPE);
-    if (buf) {
-      buf += delta*dx+linedelta*dy;
-      for (int j=0; j<h; ) {
-	STORETYPE *to = buffer;
-	int k;
-	for (k = 0; j<h && k<blocking; k++, j++) {
-	  conv(buf, (uchar*)to, w, delta);
-	  buf += linedelta;
-	  to += linesize;
-	}
-	XPutImage(fl_display,fl_window,gc, &xi, 0, 0, X+dx, Y+dy+j-k, w, k);
+    STORETYPE* linebuf = 0;
+    if (!buf) linebuf = new STORETYPE[(W*delta+(sizeof(STORETYPE)-1))/sizeof(STORETYPE)];
+    else buf += delta*dx+linedelta*dy;
+    for (int j=0; j<h; ) {
+      STORETYPE *to = buffer;
+      int k;
+      for (k = 0; j<h && k<blocking; k++, j++) {
+        if (buf) {
+          conv(buf, (uchar*)to, w, delta);
+          buf += linedelta;
+        } else {
+          cb(userdata, dx, dy+j, w, (uchar*)linebuf);
+          conv((uchar*)linebuf, (uchar*)to, w, delta);
+        }
+        to += linesize;
       }
-    } else {
-      STORETYPE* linebuf = new STORETYPE[(W*delta+(sizeof(STORETYPE)-1))/sizeof(STORETYPE)];
-      for (int j=0; j<h; ) {
-	STORETYPE *to = buffer;
-	int k;
-	for (k = 0; j<h && k<blocking; k++, j++) {
-	  cb(userdata, dx, dy+j, w, (uchar*)linebuf);
-	  conv((uchar*)linebuf, (uchar*)to, w, delta);
-	  to += linesize;
-	}
-	XPutImage(fl_display,fl_window,gc, &xi, 0, 0, X+dx, Y+dy+j-k, w, k);
+#if HAVE_XSHM
+      if (image != &xi) {
+        XShmPutImage(fl_display, fl_window, gc, image, 0, 0, X+dx, Y+dy, w, h, False);
+        shm_pending = 1;
+        continue;
       }
-
-      delete[] linebuf;
+#endif // HAVE_XSHM
+      XPutImage(fl_display,fl_window,gc, &xi, 0, 0, X+dx, Y+dy+j-k, w, k);
     }
+    delete[] linebuf;
   }
 
   if (alpha) {
@@ -645,51 +1139,15 @@ static void alpha_blend(Fl_RGB_Image *img, int X, int Y, int W, int H, int cx, i
   int ld = img->ld();
   if (ld == 0) ld = img->w() * img->d();
   uchar *srcptr = (uchar*)img->array + cy * ld + cx * img->d();
-  int srcskip = ld - img->d() * W;
 
   uchar *dst = new uchar[W * H * 3];
   uchar *dstptr = dst;
 
   fl_read_image(dst, X, Y, W, H, 0);
 
-  uchar srcr, srcg, srcb, srca;
-  uchar dstr, dstg, dstb, dsta;
-
-  if (img->d() == 2) {
-    // Composite grayscale + alpha over RGB...
-    for (int y = H; y > 0; y--, srcptr+=srcskip)
-      for (int x = W; x > 0; x--) {
-        srcg = *srcptr++;
-        srca = *srcptr++;
-
-        dstr = dstptr[0];
-        dstg = dstptr[1];
-        dstb = dstptr[2];
-        dsta = 255 - srca;
-
-        *dstptr++ = (srcg * srca + dstr * dsta) >> 8;
-        *dstptr++ = (srcg * srca + dstg * dsta) >> 8;
-        *dstptr++ = (srcg * srca + dstb * dsta) >> 8;
-      }
-  } else {
-    // Composite RGBA over RGB...
-    for (int y = H; y > 0; y--, srcptr+=srcskip)
-      for (int x = W; x > 0; x--) {
-        srcr = *srcptr++;
-        srcg = *srcptr++;
-        srcb = *srcptr++;
-        srca = *srcptr++;
-
-        dstr = dstptr[0];
-        dstg = dstptr[1];
-        dstb = dstptr[2];
-        dsta = 255 - srca;
-
-        *dstptr++ = (srcr * srca + dstr * dsta) >> 8;
-        *dstptr++ = (srcg * srca + dstg * dsta) >> 8;
-        *dstptr++ = (srcb * srca + dstb * dsta) >> 8;
-      }
-  }
+  Fl_Xlib_Converter blend = fast_converter(blend_converter);
+  for (int y = H; y > 0; y--, srcptr += ld, dstptr += W * 3)
+    blend(srcptr, dstptr, W, img->d());
 
   fl_draw_image(dst, X, Y, W, H, 3, 0);
 
@@ -716,6 +1174,101 @@ static Fl_Offscreen cache_rgb(Fl_RGB_Image *img) {
   return off;
 }
 
+////////////////////////////////////////////////////////////////
+// Fl_RGB_Image's converted for the display are kept in pixmaps on the
+// server, one per image and scale, so that drawing an image again only
+// copies (or composites) a pixmap. When the pixmaps need more memory
+// than the budget, those of the least recently drawn images are freed.
+// Fl_RGB_Image::uncache() frees all pixmaps of an image.
+// The bookkeeping is in Fl_Xlib_Image_Cache.cxx.
+
+#define IMAGE_CACHE_BUDGET	(32*1024*1024)
+
+static void free_cached_image(Fl_Xlib_Image_Cache::entry *e) {
+#if HAVE_XRENDER
+  if (e->picture) XRenderFreePicture(fl_display, e->picture);
+#endif
+  XFreePixmap(fl_display, e->pixmap);
+}
+
+static Fl_Xlib_Image_Cache image_cache(free_cached_image, IMAGE_CACHE_BUDGET);
+typedef Fl_Xlib_Image_Cache::entry image_cache_entry;
+
+// Returns the cache entry of img drawn at scale s, converting it to a
+// w*h pixmap if needed, or NULL if it can't be converted
+static image_cache_entry *cached_image(Fl_RGB_Image *img, float s, int w, int h) {
+  image_cache_entry *e = image_cache.find(img, s);
+  if (e) return e;
+  Fl_Offscreen pixmap;
+  if (w == img->w() && h == img->h()) {
+    pixmap = cache_rgb(img);
+  } else {
+    Fl_RGB_Image *img2 = (Fl_RGB_Image*)img->copy(w, h);
+    pixmap = cache_rgb(img2);
+    delete img2;
+  }
+  if (!pixmap) return 0;
+  int alpha = (img->d() == 2 || img->d() == 4);
+  return image_cache.add(img, s, pixmap, (unsigned long)w * h *
+    (alpha || fl_visual->depth > 16 ? 4 : (fl_visual->depth > 8 ? 2 : 1)));
+}
+
+#if HAVE_XRENDER
+static XID cached_picture(image_cache_entry *e, int depth) {
+  if (!e->picture) {
+    XRenderPictureAttributes srcattr;
+    memset(&srcattr, 0, sizeof(XRenderPictureAttributes));
+    static XRenderPictFormat *fmt32 = XRenderFindStandardFormat(fl_display, PictStandardARGB32);
+    static XRenderPictFormat *fmt24 = XRenderFindStandardFormat(fl_display, PictStandardRGB24);
+    e->picture = XRenderCreatePicture(fl_display, e->pixmap,
+                                      (depth == 2 || depth == 4) ? fmt32 : fmt24,
+                                      0, &srcattr);
+  }
+  return e->picture;
+}
+#endif // HAVE_XRENDER
+
+void Fl_Xlib_Graphics_Driver::image_cache_budget(unsigned long bytes) {
+  image_cache.budget(bytes);
+}
+
+unsigned long Fl_Xlib_Graphics_Driver::image_cache_budget() {
+  return image_cache.budget();
+}
+
+int Fl_Xlib_Graphics_Driver::image_cache_stats(cache_stats &stats) {
+  stats = image_cache.stats();
+  return 1;
+}
+
+void Fl_Xlib_Graphics_Driver::draw(Fl_RGB_Image *img, int XP, int YP, int WP, int HP, int cx, int cy) {
+  int alpha = (img->d() == 2 || img->d() == 4);
+  if (!img->d() || !img->array || (alpha && !can_do_alpha_blending())) {
+    // empty images, and images that are blended with what is below each time
+    Fl_Scalable_Graphics_Driver::draw(img, XP, YP, WP, HP, cx, cy);
+    return;
+  }
+  if (start_image(img, XP, YP, WP, HP, cx, cy, XP, YP, WP, HP)) {
+    return;
+  }
+  float s = scale_;
+  int w = img->w(), h = img->h();
+  if (s != 1) cache_size(img, w, h);
+  image_cache_entry *e = cached_image(img, s, w, h);
+  if (!e) return;
+  int X = (XP+offset_x_)*s, Y = (YP+offset_y_)*s;
+  cache_size(img, WP, HP);
+  cx *= s; cy *= s;
+  if (alpha) {
+#if HAVE_XRENDER
+    scale_and_render_pixmap(e->pixmap, img->d(), 1, 1, cx, cy, X, Y, WP, HP,
+                            cached_picture(e, img->d()));
+#endif
+  } else {
+    XCopyArea(fl_display, e->pixmap, fl_window, gc_, cx, cy, WP, HP, X, Y);
+  }
+}
+
 // X,Y,W,H,cx,cy are in FLTK units
 // if s != 1 and id(img) != 0, the offscreen has been previously scaled by s
 // if s != 1 and id(img) == 0, img has been previously scaled by s
@@ -728,7 +1281,6 @@ void Fl_Xlib_Graphics_Driver::draw_unscaled(Fl_RGB_Image *img, float s, int X, i
     *Fl_Graphics_Driver::id(img) = cache_rgb(img);
     *cache_scale(img) = 1;
   }
-  Fl_Region r2 = scale_clip(s);
   if (*Fl_Graphics_Driver::id(img)) {
     if (img->d() == 4 || img->d() == 2) {
 #if HAVE_XRENDER
@@ -739,6 +1291,7 @@ void Fl_Xlib_Graphics_Driver::draw_unscaled(Fl_RGB_Image *img, float s, int X, i
     }
   } else {
     // Composite image with alpha manually each time...
+    Fl_Region r2 = scale_clip(s);
     scale_ = 1;
     int ox = offset_x_, oy = offset_y_;
     offset_x_ = offset_y_ = 0;
@@ -750,12 +1303,13 @@ void Fl_Xlib_Graphics_Driver::draw_unscaled(Fl_RGB_Image *img, float s, int X, i
     d->scale(nscreen, keep);
     scale_ = s;
     offset_x_ = ox; offset_y_ = oy;
+    unscale_clip(r2);
   }
-  unscale_clip(r2);
 }
 
-void Fl_Xlib_Graphics_Driver::uncache(Fl_RGB_Image*, fl_uintptr_t &id_, fl_uintptr_t &mask_)
+void Fl_Xlib_Graphics_Driver::uncache(Fl_RGB_Image *img, fl_uintptr_t &id_, fl_uintptr_t &mask_)
 {
+  image_cache.uncache(img);
   if (id_) {
     XFreePixmap(fl_display, (Fl_Offscreen)id_);
     id_ = 0;
@@ -834,32 +1388,37 @@ fl_uintptr_t Fl_Xlib_Graphics_Driver::cache(Fl_Pixmap *pxm, int w, int h, const
 /* Draws with Xrender an Fl_Offscreen with optional scaling and accounting for transparency if necessary.
  XP,YP,WP,HP are in drawing units
  */
-int Fl_Xlib_Graphics_Driver::scale_and_render_pixmap(Fl_Offscreen pixmap, int depth, double scale_x, double scale_y, int srcx, int srcy, int XP, int YP, int WP, int HP) {
+int Fl_Xlib_Graphics_Driver::scale_and_render_pixmap(Fl_Offscreen pixmap, int depth, double scale_x, double scale_y, int srcx, int srcy, int XP, int YP, int WP, int HP, XID src_picture) {
   bool has_alpha = (depth == 2 || depth == 4);
   XRenderPictureAttributes srcattr;
   memset(&srcattr, 0, sizeof(XRenderPictureAttributes));
   static XRenderPictFormat *fmt32 = XRenderFindStandardFormat(fl_display, PictStandardARGB32);
   static XRenderPictFormat *fmt24 = XRenderFindStandardFormat(fl_display, PictStandardRGB24);
-  Picture src = XRenderCreatePicture(fl_display, pixmap, has_alpha ?fmt32:fmt24, 0, &srcattr);
-  Picture dst = XRenderCreatePicture(fl_display, fl_window, fmt24, 0, &srcattr);
-  if (!src || !dst) {
-    fprintf(stderr, "Failed to create Render pictures (%lu %lu)\n", src, dst);
+  Picture dst = render_target();
+  if (!dst) return 1; // clipped out
+  // src_picture belongs to the image cache and is kept
+  Picture src = src_picture ? src_picture :
+    XRenderCreatePicture(fl_display, pixmap, has_alpha ?fmt32:fmt24, 0, &srcattr);
+  if (!src) {
+    fprintf(stderr, "Failed to create Render picture\n");
+    XRenderFreePicture(fl_display, dst);
     return 0;
   }
-  const Fl_Region clipr = clip_region();
-  if (clipr)
-    XRenderSetPictureClipRegion(fl_display, dst, clipr);
-  if (scale_x != 1 || scale_y != 1) {
+  if (scale_x != 1 || scale_y != 1 || src_picture) {
     XTransform mat = {{
       { XDoubleToFixed( scale_x ), XDoubleToFixed( 0 ),       XDoubleToFixed( 0 ) },
       { XDoubleToFixed( 0 ),       XDoubleToFixed( scale_y ), XDoubleToFixed( 0 ) },
       { XDoubleToFixed( 0 ),       XDoubleToFixed( 0 ),       XDoubleToFixed( 1 ) }
     }};
     XRenderSetPictureTransform(fl_display, src, &mat);
+    // the server smooths scaled images when antialiasing is on
+    XRenderSetPictureFilter(fl_display, src,
+                            antialias_ && (scale_x != 1 || scale_y != 1) ? FilterBilinear : FilterNearest,
+                            NULL, 0);
   }
   XRenderComposite(fl_display, (has_alpha ? PictOpOver : PictOpSrc), src, None, dst, srcx, srcy, 0, 0,
                    XP, YP, WP, HP);
-  XRenderFreePicture(fl_display, src);
+  if (!src_picture) XRenderFreePicture(fl_display, src);
   XRenderFreePicture(fl_display, dst);
   return 1;
 }
@@ -868,13 +1427,12 @@ int Fl_Xlib_Graphics_Driver::scale_and_render_pixmap(Fl_Offscreen pixmap, int de
 int Fl_Xlib_Graphics_Driver::draw_scaled(Fl_Image *img, int XP, int YP, int WP, int HP) {
   Fl_RGB_Image *rgb = img->as_rgb_image();
   if (!rgb || !can_do_alpha_blending()) return 0;
-  if (!*Fl_Graphics_Driver::id(rgb)) {
-    *Fl_Graphics_Driver::id(rgb) = cache_rgb(rgb);
-    *cache_scale(rgb) = 1;
-  }
+  image_cache_entry *e = cached_image(rgb, 1, rgb->w(), rgb->h());
+  if (!e) return 0;
   cache_size(img, WP, HP);
-  return scale_and_render_pixmap( *Fl_Graphics_Driver::id(rgb), rgb->d(),
-                                 rgb->w() / double(WP), rgb->h() / double(HP), 0, 0, (XP + offset_x_)*scale_, (YP + offset_y_)*scale_, WP, HP);
+  return scale_and_render_pixmap(e->pixmap, rgb->d(),
+                                 rgb->w() / double(WP), rgb->h() / double(HP), 0, 0, (XP + offset_x_)*scale_, (YP + offset_y_)*scale_, WP, HP,
+                                 cached_picture(e, rgb->d()));
 }
 #endif // HAVE_XRENDER
 
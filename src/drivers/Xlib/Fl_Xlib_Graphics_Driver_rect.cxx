@@ -36,6 +36,9 @@
 
 #include "Fl_Xlib_Graphics_Driver.H"
 
+#if HAVE_XRENDER
+#include <X11/extensions/Xrender.h>
+#endif
 
 #ifndef SHRT_MAX
 #define SHRT_MAX (32767)
@@ -187,6 +190,33 @@ void Fl_Xlib_Graphics_Driver::rectf_unscaled(float fx, float fy, float fw, float
     XFillRectangle(fl_display, fl_window, gc_, x+line_delta_, y+line_delta_, w, h);
 }
 
+// With antialias() on, the server blends the rectangle with XRender, else
+// the default implementation reads the pixels back and blends them here.
+void Fl_Xlib_Graphics_Driver::rectf_alpha(int X, int Y, int W, int H, uchar alpha) {
+#if HAVE_XRENDER
+  if (alpha > 0 && alpha < 255 && W > 0 && H > 0 && antialias_) {
+    // same rounding as rectf_unscaled()
+    float fx = (X + offset_x_) * scale_, fy = (Y + offset_y_) * scale_;
+    int deltaf = scale_ >= 2 ? scale_/2 : 0;
+    int x = fx-deltaf; int y = fy-deltaf;
+    int w = int(int(fx/scale_+W+0.5)*scale_) - int(fx);
+    int h = int(int(fy/scale_+H+0.5)*scale_) - int(fy);
+    if (clip_to_short(x, y, w, h, line_width_)) return;
+    Picture dst = render_target();
+    if (!dst) return;
+    uchar r, g, b;
+    Fl::get_color(color(), r, g, b);
+    XRenderColor rc; // premultiplied
+    rc.alpha = alpha * 0x101;
+    rc.red = r * rc.alpha / 255; rc.green = g * rc.alpha / 255; rc.blue = b * rc.alpha / 255;
+    XRenderFillRectangle(fl_display, PictOpOver, dst, &rc, x+line_delta_, y+line_delta_, w, h);
+    XRenderFreePicture(fl_display, dst);
+    return;
+  }
+#endif
+  Fl_Graphics_Driver::rectf_alpha(X, Y, W, H, alpha);
+}
+
 void Fl_Xlib_Graphics_Driver::point_unscaled(float fx, float fy) {
   int deltaf = scale_ >= 2 ? scale_/2 : 0;
   int x = fx+offset_x_*scale_-deltaf; int y = fy+offset_y_*scale_-deltaf;
@@ -313,6 +343,14 @@ void Fl_Xlib_Graphics_Driver::polygon_unscaled(float x, float y, float x1, float
   p[1].x = x1+offset_x_*scale_+line_delta_; p[1].y = y1+offset_y_*scale_+line_delta_;
   p[2].x = x2+offset_x_*scale_+line_delta_; p[2].y = y2+offset_y_*scale_+line_delta_;
   p[3].x = x+offset_x_*scale_+line_delta_;  p[3].y = y+offset_y_*scale_+line_delta_;
+#if HAVE_XRENDER
+  if (antialias_) {
+    double dx = offset_x_*scale_+line_delta_, dy = offset_y_*scale_+line_delta_;
+    XPOINTD v[3] = {{x+dx, y+dy}, {x1+dx, y1+dy}, {x2+dx, y2+dy}};
+    render_polygon(v, 3);
+    return;
+  }
+#endif
   XFillPolygon(fl_display, fl_window, gc_, p, 3, Convex, 0);
   XDrawLines(fl_display, fl_window, gc_, p, 4, 0);
 }
@@ -324,33 +362,103 @@ void Fl_Xlib_Graphics_Driver::polygon_unscaled(float x, float y, float x1, float
   p[2].x = x2+offset_x_*scale_+line_delta_; p[2].y = y2+offset_y_*scale_+line_delta_;
   p[3].x = x3+offset_x_*scale_+line_delta_; p[3].y = y3+offset_y_*scale_+line_delta_;
   p[4].x = x+offset_x_*scale_+line_delta_;  p[4].y = y+offset_y_*scale_+line_delta_;
+#if HAVE_XRENDER
+  if (antialias_) {
+    double dx = offset_x_*scale_+line_delta_, dy = offset_y_*scale_+line_delta_;
+    XPOINTD v[4] = {{x+dx, y+dy}, {x1+dx, y1+dy}, {x2+dx, y2+dy}, {x3+dx, y3+dy}};
+    render_polygon(v, 4);
+    return;
+  }
+#endif
   XFillPolygon(fl_display, fl_window, gc_, p, 4, Convex, 0);
   XDrawLines(fl_display, fl_window, gc_, p, 5, 0);
 }
 
 // --- clipping
 
+/*
+ Rectangular clips, which are the clips of almost all widgets, are kept
+ in clip_rect_[] as plain rectangles with a NULL region in rstack[], and
+ are set with XSetClipRectangles(). A Region is only made when somebody
+ asks for it with clip_region(), and it is then kept until the clip is
+ popped. rstack[] holds Regions for all other clips, as always.
+ scale_clip() puts a scaled Region in rstack[] temporarily; the clip is
+ not used as a rectangle until unscale_clip() puts the old one back.
+ */
+
+// Returns the current clip rectangle, NULL if the clip is not rectangular
+Fl_Xlib_Graphics_Driver::Clip_Rect *Fl_Xlib_Graphics_Driver::rect_clip() {
+  Clip_Rect *c = clip_rect_ + rstackptr;
+  return (c->is_rect && rstack[rstackptr] == c->region) ? c : 0;
+}
+
+// Sets R to the clip rectangle c in window pixels, scaled like
+// scale_clip() does it. Returns 0 if the clip is empty.
+int Fl_Xlib_Graphics_Driver::scale_rect_clip(const Clip_Rect *c, XRectangle &R) {
+  if (c->w <= 0 || c->h <= 0) return 0;
+  int deltaf = scale_/2;
+  int x = (c->x + offset_x_)*scale_;
+  int y = (c->y + offset_y_)*scale_;
+  R.x = x - deltaf + line_delta_;
+  R.y = y - deltaf + line_delta_;
+  R.width = int((c->x + c->w + offset_x_) * scale_) - x;
+  R.height = int((c->y + c->h + offset_y_) * scale_) - y;
+  return 1;
+}
+
 void Fl_Xlib_Graphics_Driver::push_clip(int x, int y, int w, int h) {
-  Fl_Region r;
-  if (w > 0 && h > 0) {
-    r = XRectangleRegion(x,y,w,h);
-    Fl_Region current = rstack[rstackptr];
-    if (current) {
-      Fl_Region temp = XCreateRegion();
-      XIntersectRegion(current, r, temp);
-      XDestroyRegion(r);
-      r = temp;
+  if (rstackptr >= region_stack_max) {
+    Fl::warning("Fl_Xlib_Graphics_Driver::push_clip: clip stack overflow!\n");
+    restore_clip();
+    return;
+  }
+  // same coordinate range as XRectangleRegion()
+  if (w <= 0 || h <= 0 || clip_to_short(x, y, w, h, line_width_)) w = h = 0;
+  Clip_Rect *c = rect_clip();
+  Fl_Region current = rstack[rstackptr];
+  if (current && !c) { // intersect with a complex region
+    Fl_Region r = XCreateRegion();
+    if (w > 0 && h > 0) add_rectangle_to_region(r, x, y, w, h);
+    Fl_Region temp = XCreateRegion();
+    XIntersectRegion(current, r, temp);
+    XDestroyRegion(r);
+    rstack[++rstackptr] = temp;
+    clip_rect_[rstackptr].is_rect = 0;
+  } else {
+    if (c) { // intersect with the current rectangle
+      int r = x + w, b = y + h;
+      if (x < c->x) x = c->x;
+      if (y < c->y) y = c->y;
+      if (r > c->x + c->w) r = c->x + c->w;
+      if (b > c->y + c->h) b = c->y + c->h;
+      w = r - x; h = b - y;
+      if (w <= 0 || h <= 0) w = h = 0;
     }
-  } else { // make empty clip region:
-    r = XCreateRegion();
+    rstack[++rstackptr] = 0;
+    c = clip_rect_ + rstackptr;
+    c->x = x; c->y = y; c->w = w; c->h = h;
+    c->region = 0;
+    c->is_rect = 1;
   }
-  if (rstackptr < region_stack_max) rstack[++rstackptr] = r;
-  else Fl::warning("Fl_Xlib_Graphics_Driver::push_clip: clip stack overflow!\n");
   restore_clip();
 }
 
 int Fl_Xlib_Graphics_Driver::clip_box(int x, int y, int w, int h, int& X, int& Y, int& W, int& H){
   X = x; Y = y; W = w; H = h;
+  const Clip_Rect *c = rect_clip();
+  if (c) {
+    int r = x + w, b = y + h;
+    if (X < c->x) X = c->x;
+    if (Y < c->y) Y = c->y;
+    if (r > c->x + c->w) r = c->x + c->w;
+    if (b > c->y + c->h) b = c->y + c->h;
+    if (r <= X || b <= Y) { // completely outside
+      X = x; Y = y; W = H = 0;
+      return 2;
+    }
+    W = r - X; H = b - Y;
+    return (X != x || Y != y || W != w || H != h);
+  }
   Fl_Region r = rstack[rstackptr];
   if (!r) return 0;
   switch (XRectInRegion(r, x, y, w, h)) {
@@ -375,16 +483,27 @@ int Fl_Xlib_Graphics_Driver::clip_box(int x, int y, int w, int h, int& X, int& Y
 
 int Fl_Xlib_Graphics_Driver::not_clipped(int x, int y, int w, int h) {
   if (x+w <= 0 || y+h <= 0) return 0;
+  const Clip_Rect *c = rect_clip();
   Fl_Region r = rstack[rstackptr];
-  if (!r) return 1;
+  if (!r && !c) return 1;
   // get rid of coordinates outside the 16-bit range the X calls take.
   if (clip_to_short(x,y,w,h, line_width_)) return 0;	// clipped
+  if (c) {
+    if (c->w <= 0 || x >= c->x + c->w || y >= c->y + c->h ||
+        x + w <= c->x || y + h <= c->y) return RectangleOut;
+    if (x >= c->x && y >= c->y &&
+        x + w <= c->x + c->w && y + h <= c->y + c->h) return RectangleIn;
+    return RectanglePart;
+  }
   return XRectInRegion(r, x, y, w, h);
 }
 
 // make there be no clip (used by fl_begin_offscreen() only!)
 void Fl_Xlib_Graphics_Driver::push_no_clip() {
-  if (rstackptr < region_stack_max) rstack[++rstackptr] = 0;
+  if (rstackptr < region_stack_max) {
+    rstack[++rstackptr] = 0;
+    clip_rect_[rstackptr].is_rect = 0;
+  }
   else Fl::warning("Fl_Xlib_Graphics_Driver::push_no_clip: clip stack overflow!\n");
   restore_clip();
 }
@@ -398,9 +517,32 @@ void Fl_Xlib_Graphics_Driver::pop_clip() {
   restore_clip();
 }
 
+// Makes a Region for a rectangular clip
+Fl_Region Fl_Xlib_Graphics_Driver::clip_region() {
+  Clip_Rect *c = rect_clip();
+  if (c && !c->region) {
+    c->region = XCreateRegion();
+    if (c->w > 0 && c->h > 0) add_rectangle_to_region(c->region, c->x, c->y, c->w, c->h);
+    rstack[rstackptr] = c->region;
+  }
+  return rstack[rstackptr];
+}
+
+void Fl_Xlib_Graphics_Driver::clip_region(Fl_Region r) {
+  clip_rect_[rstackptr].is_rect = 0;
+  Fl_Graphics_Driver::clip_region(r);
+}
+
 void Fl_Xlib_Graphics_Driver::restore_clip() {
   fl_clip_state_number++;
   if (gc_) {
+    const Clip_Rect *c = rect_clip();
+    if (c) {
+      XRectangle R;
+      int n = scale_rect_clip(c, R);
+      XSetClipRectangles(fl_display, gc_, 0, 0, &R, n, YXBanded);
+      return;
+    }
     Region r = rstack[rstackptr];
     if (r) {
       Region r2 = scale_clip(scale_);
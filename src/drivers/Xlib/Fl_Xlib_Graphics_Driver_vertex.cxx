@@ -56,6 +56,12 @@ void Fl_Xlib_Graphics_Driver::end_polygon() {
     end_line();
     return;
   }
+#if HAVE_XRENDER
+  if (antialias_) {
+    render_polygon(pd, n);
+    return;
+  }
+#endif
   if (n>2) XFillPolygon(fl_display, fl_window, gc_, (XPoint*)p, n, Convex, 0);
 }
 
@@ -65,8 +71,12 @@ void Fl_Xlib_Graphics_Driver::begin_complex_polygon() {
 }
 
 void Fl_Xlib_Graphics_Driver::gap() {
-  while (n>gap_+2 && p[n-1].x == p[gap_].x && p[n-1].y == p[gap_].y) n--;
+  while (n>gap_+2 && same_vertex(n-1, gap_)) n--;
   if (n > gap_+2) {
+#if HAVE_XRENDER
+    if (antialias_) transformed_vertex0(pd[gap_].x, pd[gap_].y);
+    else
+#endif
     transformed_vertex0(p[gap_].x, p[gap_].y);
     gap_ = n;
   } else {
@@ -80,6 +90,12 @@ void Fl_Xlib_Graphics_Driver::end_complex_polygon() {
     end_line();
     return;
   }
+#if HAVE_XRENDER
+  if (antialias_) {
+    render_polygon(pd, n);
+    return;
+  }
+#endif
   if (n>2) XFillPolygon(fl_display, fl_window, gc_, (XPoint*)p, n, 0, 0);
 }
 
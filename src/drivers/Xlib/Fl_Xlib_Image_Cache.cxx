@@ -0,0 +1,116 @@
+//
+// "$Id$"
+//
+// Xlib image cache for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+#include "Fl_Xlib_Image_Cache.H"
+#include <string.h>
+
+Fl_Xlib_Image_Cache::Fl_Xlib_Image_Cache(free_cb f, unsigned long budget) {
+  memset(buckets_, 0, sizeof(buckets_));
+  newest_ = oldest_ = 0;
+  memset(&stats_, 0, sizeof(stats_));
+  stats_.budget = budget;
+  free_ = f;
+}
+
+Fl_Xlib_Image_Cache::entry **Fl_Xlib_Image_Cache::bucket(const void *img) {
+  fl_uintptr_t h = (fl_uintptr_t)img;
+  return buckets_ + ((h >> 4) ^ (h >> 12)) % BUCKETS;
+}
+
+void Fl_Xlib_Image_Cache::unlink(entry *e) {
+  if (e->older) e->older->newer = e->newer; else oldest_ = e->newer;
+  if (e->newer) e->newer->older = e->older; else newest_ = e->older;
+}
+
+void Fl_Xlib_Image_Cache::link(entry *e) {
+  e->older = newest_;
+  e->newer = 0;
+  if (newest_) newest_->newer = e; else oldest_ = e;
+  newest_ = e;
+}
+
+void Fl_Xlib_Image_Cache::free_entry(entry *e) {
+  entry **p = bucket(e->img);
+  while (*p != e) p = &(*p)->next;
+  *p = e->next;
+  unlink(e);
+  free_(e);
+  stats_.bytes -= e->bytes;
+  stats_.entries--;
+  delete e;
+}
+
+// Frees the least recently drawn images, but not the last one
+void Fl_Xlib_Image_Cache::trim() {
+  while (stats_.bytes > stats_.budget && oldest_ != newest_) {
+    free_entry(oldest_);
+    stats_.evictions++;
+  }
+}
+
+Fl_Xlib_Image_Cache::entry *Fl_Xlib_Image_Cache::find(const void *img, float s) {
+  for (entry *e = *bucket(img); e; e = e->next) {
+    if (e->img == img && e->scale == s) {
+      stats_.hits++;
+      if (e != newest_) {
+        unlink(e);
+        link(e);
+      }
+      return e;
+    }
+  }
+  stats_.misses++;
+  return 0;
+}
+
+Fl_Xlib_Image_Cache::entry *Fl_Xlib_Image_Cache::add(const void *img, float s,
+                                                     Fl_Offscreen pixmap,
+                                                     unsigned long bytes) {
+  entry **b = bucket(img);
+  entry *e = new entry;
+  e->img = img;
+  e->scale = s;
+  e->pixmap = pixmap;
+  e->picture = 0;
+  e->bytes = bytes;
+  e->next = *b;
+  *b = e;
+  link(e);
+  stats_.bytes += bytes;
+  stats_.entries++;
+  trim();
+  return e;
+}
+
+void Fl_Xlib_Image_Cache::uncache(const void *img) {
+  entry *e = *bucket(img);
+  while (e) {
+    entry *next = e->next;
+    if (e->img == img) free_entry(e);
+    e = next;
+  }
+}
+
+void Fl_Xlib_Image_Cache::budget(unsigned long bytes) {
+  stats_.budget = bytes;
+  trim();
+}
+
+//
+// End of "$Id$".
+//
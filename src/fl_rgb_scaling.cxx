@@ -0,0 +1,457 @@
+//
+// "$Id$"
+//
+// RGB image scaling for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Scales image data for Fl_RGB_Image::copy(int, int).
+//
+// All filters except FL_RGB_SCALING_NEAREST are separable: each row of
+// the source is filtered horizontally into a temporary buffer, and the
+// rows of that are filtered vertically into the destination. Filter
+// weights are computed once per image as 14 bit fixed point numbers.
+// Filters are widened by the scale factor when reducing an image, except
+// for the bilinear filter, so that all source pixels contribute.
+// Images with alpha are filtered with colors weighted by alpha.
+//
+// Rows of the destination can be computed in parallel bands, see
+// Fl_Image::RGB_scaling_threads().
+//
+
+#include <config.h>
+#include <FL/Fl_Image.H>
+#include <FL/math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_PTHREAD) && !defined(_WIN32)
+#  include <pthread.h>
+#  define USE_SCALING_THREADS 1
+#endif // HAVE_PTHREAD && !_WIN32
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define USE_SSE2 1
+#endif // __SSE2__
+
+#define PRECISION_BITS	14	// 1.0 is 1 << PRECISION_BITS in filter weights
+#define HALF		(1 << (PRECISION_BITS - 1))
+
+// Filter weights for one direction
+struct fl_scale_weights {
+  int *first;		// first source pixel of each destination pixel
+  int *count;		// number of source pixels for each destination pixel
+  short *weights;	// count[i] weights at i * stride for each destination pixel
+  int stride;
+};
+
+static double box_filter(double x) {
+  return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+}
+
+static double bilinear_filter(double x) {
+  if (x < 0.0) x = -x;
+  return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+static double bicubic_filter(double x) {
+  const double a = -0.5;
+  if (x < 0.0) x = -x;
+  if (x < 1.0) return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+  if (x < 2.0) return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+  return 0.0;
+}
+
+static double sinc(double x) {
+  if (x == 0.0) return 1.0;
+  x *= M_PI;
+  return sin(x) / x;
+}
+
+static double lanczos_filter(double x) {
+  if (x <= -3.0 || x >= 3.0) return 0.0;
+  return sinc(x) * sinc(x / 3.0);
+}
+
+// Compute the weights to scale 'in' pixels to 'out' pixels
+static void make_weights(int in, int out, Fl_RGB_Scaling method,
+                         fl_scale_weights &c) {
+  double (*filter)(double);
+  double support;
+  switch (method) {
+    case FL_RGB_SCALING_AREA:    filter = box_filter;      support = 0.5; break;
+    case FL_RGB_SCALING_BICUBIC: filter = bicubic_filter;  support = 2.0; break;
+    case FL_RGB_SCALING_LANCZOS: filter = lanczos_filter;  support = 3.0; break;
+    default:                     filter = bilinear_filter; support = 1.0; break;
+  }
+  double scale = (double)in / out;
+  double filterscale = (scale > 1.0 && method != FL_RGB_SCALING_BILINEAR) ? scale : 1.0;
+  support *= filterscale;
+
+  c.stride  = (int)ceil(support) * 2 + 1;
+  c.first   = new int[out];
+  c.count   = new int[out];
+  c.weights = new short[out * c.stride];
+  double *w = new double[c.stride];
+
+  for (int i = 0; i < out; i++) {
+    double center = (i + 0.5) * scale;
+    int xmin = (int)(center - support + 0.5);
+    int xmax = (int)(center + support + 0.5);
+    if (xmin < 0) xmin = 0;
+    if (xmax > in) xmax = in;
+    if (xmax - xmin > c.stride) xmax = xmin + c.stride;
+    double total = 0.0;
+    int j, n = xmax - xmin;
+    for (j = 0; j < n; j++) {
+      w[j] = filter((j + xmin - center + 0.5) / filterscale);
+      total += w[j];
+    }
+    short *k = c.weights + i * c.stride;
+    if (total == 0.0) {
+      // only possible at the edges, use the nearest pixel
+      xmin = (int)center < in ? (int)center : in - 1;
+      n = 1;
+      k[0] = 1 << PRECISION_BITS;
+    } else {
+      // Fixed point weights, with the rounding error added to the largest
+      // one, so that areas of one color keep their color
+      int sum = 0, largest = 0;
+      for (j = 0; j < n; j++) {
+        k[j] = (short)floor(w[j] / total * (1 << PRECISION_BITS) + 0.5);
+        sum += k[j];
+        if (k[j] > k[largest]) largest = j;
+      }
+      k[largest] += (short)((1 << PRECISION_BITS) - sum);
+      // drop weights that became 0
+      while (n > 1 && k[n - 1] == 0) n--;
+      int skip = 0;
+      while (skip < n - 1 && k[skip] == 0) skip++;
+      if (skip) {
+        memmove(k, k + skip, (n - skip) * sizeof(short));
+        xmin += skip;
+        n -= skip;
+      }
+    }
+    c.first[i] = xmin;
+    c.count[i] = n;
+  }
+  delete[] w;
+}
+
+static void free_weights(fl_scale_weights &c) {
+  delete[] c.first;
+  delete[] c.count;
+  delete[] c.weights;
+}
+
+static inline uchar clamp8(int v) {
+  return v < 0 ? 0 : (v > 255 ? 255 : (uchar)v);
+}
+
+// Filter one row horizontally, D is a constant in each caller so that
+// the channel loops are unrolled
+static inline void filter_row(const uchar *src, uchar *dst, int W,
+                              const fl_scale_weights &c, const int D) {
+  for (int x = 0; x < W; x++, dst += D) {
+    const short *k = c.weights + x * c.stride;
+    const uchar *s = src + c.first[x] * D;
+    int n = c.count[x];
+#if USE_SSE2
+    if (D == 4) {
+      const __m128i zero = _mm_setzero_si128();
+      __m128i acc = _mm_set1_epi32(HALF);
+      int j = 0, v;
+      for (; j + 1 < n; j += 2, s += 8) {
+        // two pixels, interleaved as r0 r1 g0 g1 b0 b1 a0 a1
+        __m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)s), zero);
+        p = _mm_unpacklo_epi16(p, _mm_srli_si128(p, 8));
+        __m128i w = _mm_set1_epi32((int)(((unsigned)(unsigned short)k[j + 1] << 16) |
+                                         (unsigned short)k[j]));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(p, w));
+      }
+      if (j < n) {
+        memcpy(&v, s, 4);
+        __m128i p = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero);
+        p = _mm_unpacklo_epi16(p, zero);
+        __m128i w = _mm_set1_epi32((unsigned short)k[j]);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(p, w));
+      }
+      acc = _mm_srai_epi32(acc, PRECISION_BITS);
+      acc = _mm_packs_epi32(acc, acc);
+      v = _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+      memcpy(dst, &v, 4);
+      continue;
+    }
+#endif // USE_SSE2
+    int acc0 = HALF, acc1 = HALF, acc2 = HALF, acc3 = HALF;
+    for (int j = 0; j < n; j++, s += D) {
+      acc0 += s[0] * k[j];
+      if (D > 1) acc1 += s[1] * k[j];
+      if (D > 2) acc2 += s[2] * k[j];
+      if (D > 3) acc3 += s[3] * k[j];
+    }
+    dst[0] = clamp8(acc0 >> PRECISION_BITS);
+    if (D > 1) dst[1] = clamp8(acc1 >> PRECISION_BITS);
+    if (D > 2) dst[2] = clamp8(acc2 >> PRECISION_BITS);
+    if (D > 3) dst[3] = clamp8(acc3 >> PRECISION_BITS);
+  }
+}
+
+// Filter n rows of 'len' bytes vertically into one row
+static void filter_column(const uchar * const *rows, int n, const short *k,
+                          uchar *dst, int len) {
+  int i = 0;
+#if USE_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= len; i += 16) {
+    __m128i acc0 = _mm_set1_epi32(HALF), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    int j = 0;
+    for (; j + 1 < n; j += 2) {
+      // two rows, interleaved byte by byte
+      __m128i a = _mm_loadu_si128((const __m128i *)(rows[j] + i));
+      __m128i b = _mm_loadu_si128((const __m128i *)(rows[j + 1] + i));
+      __m128i w = _mm_set1_epi32((int)(((unsigned)(unsigned short)k[j + 1] << 16) |
+                                       (unsigned short)k[j]));
+      __m128i lo = _mm_unpacklo_epi8(a, b), hi = _mm_unpackhi_epi8(a, b);
+      __m128i p;
+      p = _mm_unpacklo_epi8(lo, zero); acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(p, w));
+      p = _mm_unpackhi_epi8(lo, zero); acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(p, w));
+      p = _mm_unpacklo_epi8(hi, zero); acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(p, w));
+      p = _mm_unpackhi_epi8(hi, zero); acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(p, w));
+    }
+    if (j < n) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(rows[j] + i));
+      __m128i w = _mm_set1_epi32((unsigned short)k[j]);
+      __m128i lo = _mm_unpacklo_epi8(a, zero), hi = _mm_unpackhi_epi8(a, zero);
+      __m128i p;
+      p = _mm_unpacklo_epi16(lo, zero); acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(p, w));
+      p = _mm_unpackhi_epi16(lo, zero); acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(p, w));
+      p = _mm_unpacklo_epi16(hi, zero); acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(p, w));
+      p = _mm_unpackhi_epi16(hi, zero); acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(p, w));
+    }
+    acc0 = _mm_srai_epi32(acc0, PRECISION_BITS);
+    acc1 = _mm_srai_epi32(acc1, PRECISION_BITS);
+    acc2 = _mm_srai_epi32(acc2, PRECISION_BITS);
+    acc3 = _mm_srai_epi32(acc3, PRECISION_BITS);
+    __m128i r = _mm_packus_epi16(_mm_packs_epi32(acc0, acc1), _mm_packs_epi32(acc2, acc3));
+    _mm_storeu_si128((__m128i *)(dst + i), r);
+  }
+#endif // USE_SSE2
+  for (; i < len; i++) {
+    int acc = HALF;
+    for (int j = 0; j < n; j++) acc += rows[j][i] * k[j];
+    dst[i] = clamp8(acc >> PRECISION_BITS);
+  }
+}
+
+// Images with alpha are filtered with colors weighted by alpha. This is
+// the same as filtering premultiplied colors and dividing them by the
+// alpha of the result, but keeps the colors of pixels with little alpha
+// exact. Fully transparent pixels add nothing to the colors.
+
+// Sums for one pixel of D channels, the last one alpha, with weight k
+struct fl_alpha_sums {
+  int a;		// sum of weight * alpha
+  double c[3];		// sums of weight * alpha * color
+};
+
+static inline void add_alpha(fl_alpha_sums &sum, const uchar *p, int k, const int D) {
+  int ka = k * p[D - 1];
+  sum.a += ka;
+  sum.c[0] += (double)ka * p[0];
+  if (D > 2) {
+    sum.c[1] += (double)ka * p[1];
+    sum.c[2] += (double)ka * p[2];
+  }
+}
+
+static inline void store_alpha(const fl_alpha_sums &sum, uchar *dst, const int D) {
+  dst[D - 1] = clamp8((sum.a + HALF) >> PRECISION_BITS);
+  if (sum.a <= 0) {
+    memset(dst, 0, D - 1);
+    return;
+  }
+  for (int c = 0; c < D - 1; c++)
+    dst[c] = clamp8((int)floor(sum.c[c] / sum.a + 0.5));
+}
+
+// Filter one row of pixels with alpha horizontally
+static void filter_row_alpha(const uchar *src, uchar *dst, int W,
+                             const fl_scale_weights &c, const int D) {
+  for (int x = 0; x < W; x++, dst += D) {
+    const short *k = c.weights + x * c.stride;
+    const uchar *s = src + c.first[x] * D;
+    fl_alpha_sums sum = { 0, { 0.0, 0.0, 0.0 } };
+    for (int j = 0; j < c.count[x]; j++, s += D) add_alpha(sum, s, k[j], D);
+    store_alpha(sum, dst, D);
+  }
+}
+
+// Filter n rows of W pixels with alpha vertically into one row
+static void filter_column_alpha(const uchar * const *rows, int n, const short *k,
+                                uchar *dst, int W, const int D) {
+  for (int x = 0; x < W; x++, dst += D) {
+    fl_alpha_sums sum = { 0, { 0.0, 0.0, 0.0 } };
+    for (int j = 0; j < n; j++) add_alpha(sum, rows[j] + x * D, k[j], D);
+    store_alpha(sum, dst, D);
+  }
+}
+
+// Everything needed to compute a band of destination rows
+struct fl_scale_job {
+  const uchar *src;
+  int w, d, ld;
+  uchar *dst;
+  int W;
+  const fl_scale_weights *xw, *yw;
+  int y0, y1;		// destination rows
+};
+
+// Source rows are filtered horizontally into a ring of as many rows as
+// the vertical filter can use, when they are first needed
+static void scale_band(const fl_scale_job *job) {
+  const fl_scale_weights &xw = *job->xw, &yw = *job->yw;
+  int d = job->d, stride = job->W * d, nring = yw.stride;
+  uchar *ring = new uchar[nring * stride];
+  int *ring_row = new int[nring];	// source row in each slot
+  const uchar **rows = new const uchar*[nring];
+  int i, y;
+  for (i = 0; i < nring; i++) ring_row[i] = -1;
+  for (y = job->y0; y < job->y1; y++) {
+    int n = yw.count[y];
+    for (i = 0; i < n; i++) {
+      int sy = yw.first[y] + i, slot = sy % nring;
+      uchar *t = ring + slot * stride;
+      rows[i] = t;
+      if (ring_row[slot] == sy) continue;
+      ring_row[slot] = sy;
+      const uchar *s = job->src + sy * job->ld;
+      switch (d) {
+        case 1: filter_row(s, t, job->W, xw, 1); break;
+        case 2: filter_row_alpha(s, t, job->W, xw, 2); break;
+        case 3: filter_row(s, t, job->W, xw, 3); break;
+        default: filter_row_alpha(s, t, job->W, xw, 4); break;
+      }
+    }
+    uchar *dst = job->dst + y * stride;
+    const short *k = yw.weights + y * yw.stride;
+    if (d == 2) filter_column_alpha(rows, n, k, dst, job->W, 2);
+    else if (d == 4) filter_column_alpha(rows, n, k, dst, job->W, 4);
+    else filter_column(rows, n, k, dst, stride);
+  }
+  delete[] rows;
+  delete[] ring_row;
+  delete[] ring;
+}
+
+#if USE_SCALING_THREADS
+extern "C" {
+  static void *scale_thread(void *job) {
+    scale_band((const fl_scale_job *)job);
+    return 0;
+  }
+}
+#endif // USE_SCALING_THREADS
+
+// Nearest neighbor scaling, picks the same pixels as the Bresenham
+// stepping that FLTK always used
+static void scale_nearest(const uchar *src, int w, int h, int d, int ld,
+                          uchar *dst, int W, int H) {
+  int *xoff = new int[W];
+  int dx, dy, sx, sy, xerr, yerr;
+  for (dx = 0, sx = 0, xerr = W; dx < W; dx++) {
+    xoff[dx] = sx * d;
+    sx += w / W;
+    xerr -= w % W;
+    if (xerr <= 0) {
+      xerr += W;
+      sx++;
+    }
+  }
+  for (dy = 0, sy = 0, yerr = H; dy < H; dy++) {
+    const uchar *s = src + sy * ld;
+    switch (d) {
+      case 1: for (dx = 0; dx < W; dx++, dst += 1) dst[0] = s[xoff[dx]]; break;
+      case 2: for (dx = 0; dx < W; dx++, dst += 2) memcpy(dst, s + xoff[dx], 2); break;
+      case 3: for (dx = 0; dx < W; dx++, dst += 3) memcpy(dst, s + xoff[dx], 3); break;
+      default: for (dx = 0; dx < W; dx++, dst += 4) memcpy(dst, s + xoff[dx], 4); break;
+    }
+    sy += h / H;
+    yerr -= h % H;
+    if (yerr <= 0) {
+      yerr += H;
+      sy++;
+    }
+  }
+  delete[] xoff;
+}
+
+/*
+ Scale w x h image data with d channels (1 to 4) and ld bytes per line
+ into W x H pixels at dst, using up to 'threads' threads.
+ */
+void fl_scale_rgb(const uchar *src, int w, int h, int d, int ld,
+                  uchar *dst, int W, int H, Fl_RGB_Scaling method, int threads)
+{
+  if (method == FL_RGB_SCALING_NEAREST) {
+    scale_nearest(src, w, h, d, ld, dst, W, H);
+    return;
+  }
+  fl_scale_weights xw, yw;
+  make_weights(w, W, method, xw);
+  make_weights(h, H, method, yw);
+
+  // Bands of at least 32 rows, each with its own ring of source rows
+  if (threads > H / 32) threads = H / 32;
+  if (threads < 1) threads = 1;
+#if !USE_SCALING_THREADS
+  threads = 1;
+#endif // !USE_SCALING_THREADS
+  fl_scale_job *jobs = new fl_scale_job[threads];
+  int i;
+  for (i = 0; i < threads; i++) {
+    fl_scale_job &job = jobs[i];
+    job.src = src; job.w = w; job.d = d; job.ld = ld;
+    job.dst = dst; job.W = W;
+    job.xw = &xw; job.yw = &yw;
+    job.y0 = (int)((long)H * i / threads);
+    job.y1 = (int)((long)H * (i + 1) / threads);
+  }
+#if USE_SCALING_THREADS
+  pthread_t *tid = new pthread_t[threads];
+  char *started = new char[threads];
+  for (i = 1; i < threads; i++)
+    started[i] = pthread_create(tid + i, 0, scale_thread, jobs + i) == 0;
+  scale_band(jobs);
+  for (i = 1; i < threads; i++) {
+    // bands whose thread could not be started are done here
+    if (started[i]) pthread_join(tid[i], 0);
+    else scale_band(jobs + i);
+  }
+  delete[] started;
+  delete[] tid;
+#else
+  scale_band(jobs);
+#endif // USE_SCALING_THREADS
+  delete[] jobs;
+  free_weights(xw);
+  free_weights(yw);
+}
+
+//
+// End of "$Id$".
+//
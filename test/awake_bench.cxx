@@ -0,0 +1,149 @@
+//
+// "$Id$"
+//
+// Fl::awake() callback queue benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Starts several threads that each post many Fl::awake(cb, data)
+// callbacks as fast as they can, while the main thread delivers them in
+// Fl::wait(). Reports the time until all were delivered, whether the
+// callbacks of each thread arrived in order, and how many woke up the
+// main thread.
+// Use -q to just run the benchmark and exit without opening a window.
+//
+
+#include <config.h>
+
+#if defined(HAVE_PTHREAD) || defined(WIN32)
+#  include <stdio.h>
+#  include <string.h>
+#  include <FL/Fl.H>
+#  include <FL/Fl_Double_Window.H>
+#  include <FL/Fl_Button.H>
+#  include <FL/Fl_Box.H>
+#  include <FL/fl_draw.H>
+#  include "threads.h"
+#  ifdef WIN32
+#    include <windows.h>
+#  else
+#    include <sys/time.h>
+#  endif
+
+#define BENCH_THREADS	4
+#define BENCH_CALLBACKS	200000		// posted by each thread
+
+static Fl_Box *G_result = 0;
+static long G_last[BENCH_THREADS];	// last sequence number of each thread
+static long G_received = 0;
+static long G_out_of_order = 0;
+
+// Wall clock time, so that the threads are measured correctly
+static double now() {
+#ifdef WIN32
+  return GetTickCount() / 1000.0;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+// Called in the main thread, data is a sequence number and thread number
+static void awake_cb(void *data) {
+  long v = (long)data;
+  int t = (int)(v % BENCH_THREADS);
+  long seq = v / BENCH_THREADS;
+  if (seq != G_last[t] + 1) G_out_of_order++;
+  G_last[t] = seq;
+  G_received++;
+}
+
+extern "C" void *post_func(void *p) {
+  long t = (long)p;
+  for (long i = 0; i < BENCH_CALLBACKS; i++)
+    Fl::awake(awake_cb, (void*)(i * BENCH_THREADS + t));
+  return 0;
+}
+
+// Run the benchmark, print and display the results.
+// Returns 1 if callbacks were lost or out of order.
+static int run_benchmark() {
+  static char msg[600];
+  int t;
+  for (t = 0; t < BENCH_THREADS; t++) G_last[t] = -1;
+  G_received = G_out_of_order = 0;
+  long total = (long)BENCH_THREADS * BENCH_CALLBACKS;
+  unsigned long delivered = Fl::awake_delivered();
+  unsigned long coalesced = Fl::awake_coalesced();
+  unsigned long dropped = Fl::awake_dropped();
+
+  double start = now();
+  Fl_Thread thread;
+  for (t = 0; t < BENCH_THREADS; t++) fl_create_thread(thread, post_func, (void*)(long)t);
+  while (G_received + (long)(Fl::awake_dropped() - dropped) < total) Fl::wait(1.0);
+  double secs = now() - start;
+
+  delivered = Fl::awake_delivered() - delivered;
+  coalesced = Fl::awake_coalesced() - coalesced;
+  dropped = Fl::awake_dropped() - dropped;
+  sprintf(msg, "%d threads posted %d Fl::awake() callbacks each: %.3fs\n"
+               "%lu delivered, %ld out of order, %lu dropped\n"
+               "%lu woke up the main thread, %lu were coalesced",
+          BENCH_THREADS, BENCH_CALLBACKS, secs,
+          delivered, G_out_of_order, dropped,
+          (unsigned long)total - dropped - coalesced, coalesced);
+  printf("%s\n", msg);
+  if (G_result) G_result->label(msg);
+  return (G_out_of_order || G_received != total) ? 1 : 0;
+}
+
+static void run_cb(Fl_Widget*, void*) {
+  fl_cursor(FL_CURSOR_WAIT);
+  Fl::check();
+  run_benchmark();
+  fl_cursor(FL_CURSOR_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+  Fl::lock();		// enables Fl::awake() from other threads
+  if (argc > 1 && strcmp(argv[1], "-q") == 0) {
+    // Headless: callbacks are delivered by Fl::wait() without a window
+    return run_benchmark();
+  }
+
+  Fl_Double_Window win(500, 120, "Fl::awake() benchmark");
+  Fl_Button *run = new Fl_Button(10, 10, 160, 25, "Run benchmark");
+  run->callback(run_cb);
+  G_result = new Fl_Box(10, 45, 480, 65, "Press 'Run benchmark'");
+  G_result->box(FL_DOWN_BOX);
+  G_result->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT | FL_ALIGN_TOP);
+  G_result->labelsize(12);
+  win.end();
+  win.show(argc, argv);
+  return Fl::run();
+}
+
+#else
+#  include <FL/fl_ask.H>
+
+int main() {
+  fl_alert("Sorry, threading not supported on this platform!");
+}
+#endif // HAVE_PTHREAD || WIN32
+
+//
+// End of "$Id$".
+//
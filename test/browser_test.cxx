@@ -0,0 +1,174 @@
+//
+// "$Id$"
+//
+// Fl_Browser line index test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Changes the lines of an Fl_Browser at random with add(), insert(),
+// remove(), move(), swap(), text(), add_lines() and clear(), makes the
+// same changes to an array, and checks that the line numbers of the
+// browser's index still match the array in both directions.
+// No display is needed.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Browser.H>
+#include <FL/Fl_Framebuffer_Surface.H>
+#include "checks.h"
+
+#define OPERATIONS	20000		// random changes made
+#define MAX_LINES	3000		// lines are removed above this
+
+// Gives access to the line index
+class TestBrowser : public Fl_Browser {
+public:
+  TestBrowser() : Fl_Browser(0, 0, 200, 200) { }
+  void *line_item(int line) const { return find_line(line); }
+  int item_line(void *item) const { return lineno(item); }
+  void *first_item() const { return item_first(); }
+  void *next_item(void *item) const { return item_next(item); }
+  void *prev_item(void *item) const { return item_prev(item); }
+  const char *text_of(void *item) const { return item_text(item); }
+};
+
+// What the browser should contain: the text and data of each line
+struct Line {
+  char text[24];
+  long data;
+};
+
+static Line *G_lines = 0;
+static int G_size = 0;
+static long G_next_data = 1;
+
+static void model_insert(int line, const char *text, long data) {
+  if (line < 1) line = 1;
+  if (line > G_size + 1) line = G_size + 1;
+  memmove(G_lines + line, G_lines + line - 1, (G_size - line + 1) * sizeof(Line));
+  strcpy(G_lines[line - 1].text, text);
+  G_lines[line - 1].data = data;
+  G_size++;
+}
+
+static void model_remove(int line) {
+  memmove(G_lines + line - 1, G_lines + line, (G_size - line) * sizeof(Line));
+  G_size--;
+}
+
+// Checks a few lines at random, or all of them, both with the line
+// number index and by walking the linked list
+static void check_lines(TestBrowser &b, int all) {
+  CHECK(b.size() == G_size);
+  int i;
+  if (!all) {
+    for (int n = 0; n < 5 && G_size; n++) {
+      i = checks_random(G_size) + 1;
+      void *item = b.line_item(i);
+      if (!CHECK(item && strcmp(b.text_of(item), G_lines[i - 1].text) == 0)) return;
+      CHECK(b.item_line(item) == i);
+      CHECK(b.data(i) == (void*)G_lines[i - 1].data);
+    }
+    CHECK(b.line_item(0) == 0 && b.line_item(G_size + 1) == 0);
+    return;
+  }
+  void *item = b.first_item(), *prev = 0;
+  for (i = 1; i <= G_size; i++) {
+    if (!CHECK(item != 0)) return;
+    CHECK(strcmp(b.text_of(item), G_lines[i - 1].text) == 0);
+    CHECK(b.line_item(i) == item);
+    CHECK(b.item_line(item) == i);
+    CHECK(b.prev_item(item) == prev);
+    prev = item;
+    item = b.next_item(item);
+  }
+  CHECK(item == 0);
+}
+
+static void random_operation(TestBrowser &b) {
+  char text[24];
+  int n = G_size, op = checks_random(100);
+  if (n > MAX_LINES) op = 40;			// remove
+  if (op < 20) {				// add
+    sprintf(text, "a%ld", G_next_data);
+    b.add(text, (void*)G_next_data);
+    model_insert(n + 1, text, G_next_data++);
+  } else if (op < 40) {				// insert, also out of range
+    int line = checks_random(n + 3) - 1;
+    sprintf(text, "i%ld", G_next_data);
+    b.insert(line, text, (void*)G_next_data);
+    model_insert(line, text, G_next_data++);
+  } else if (op < 60) {				// remove, also out of range
+    int line = checks_random(n + 2);
+    b.remove(line);
+    if (line >= 1 && line <= n) model_remove(line);
+  } else if (op < 75) {				// move
+    int from = checks_random(n + 2), to = checks_random(n + 2);
+    b.move(to, from);
+    if (from >= 1 && from <= n) {
+      Line l = G_lines[from - 1];
+      model_remove(from);
+      model_insert(to, l.text, l.data);
+    }
+  } else if (op < 90) {				// swap
+    if (!n) return;
+    int a = checks_random(n) + 1, c = checks_random(n) + 1;
+    b.swap(a, c);
+    Line l = G_lines[a - 1];
+    G_lines[a - 1] = G_lines[c - 1];
+    G_lines[c - 1] = l;
+  } else if (op < 95) {				// longer text, a new node
+    if (!n) return;
+    int line = checks_random(n) + 1;
+    sprintf(text, "text%ld-longer", G_next_data++);
+    b.text(line, text);
+    strcpy(G_lines[line - 1].text, text);
+  } else if (op < 99) {				// several lines at once
+    char buf[200];
+    int len = 0, count = checks_random(8) + 1;
+    for (int i = 0; i < count; i++) {
+      sprintf(text, "b%ld", G_next_data++);
+      len += sprintf(buf + len, "%s\n", text);
+      model_insert(G_size + 1, text, 0);
+    }
+    CHECK(b.add_lines(buf, len) == count);
+  } else {					// start again
+    b.clear();
+    G_size = 0;
+  }
+}
+
+int main(int argc, char **argv) {
+  // lines are measured with the font of this surface, without a display
+  Fl_Framebuffer_Surface surface(10, 10);
+  Fl_Surface_Device::push_current(&surface);
+  G_lines = (Line*)malloc((MAX_LINES + 20) * sizeof(Line));
+  TestBrowser b;
+  for (int i = 0; i < OPERATIONS; i++) {
+    random_operation(b);
+    check_lines(b, i % 500 == 0);
+  }
+  check_lines(b, 1);
+  Fl_Surface_Device::pop_current();
+  free(G_lines);
+  return checks_result("browser_test");
+}
+
+//
+// End of "$Id$".
+//
@@ -0,0 +1,64 @@
+//
+// "$Id$"
+//
+// Checks for the headless tests of the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// The test programs named *_test.cxx check parts of the library without
+// a display, and are run by "ctest" and "make check". Each one includes
+// this file once, uses CHECK() and returns checks_result() from main().
+//
+
+#ifndef checks_h
+#define checks_h
+
+#include <stdio.h>
+
+static int checks_count = 0;	// checks made
+static int checks_failed = 0;	// checks that failed
+
+// Checks that 'cond' is true, and prints where it is not.
+// Returns 'cond', so that the caller can print more about a failure.
+#define CHECK(cond) check_((cond) != 0, #cond, __FILE__, __LINE__)
+
+static int check_(int ok, const char *what, const char *file, int line) {
+  checks_count++;
+  if (!ok) {
+    checks_failed++;
+    if (checks_failed <= 20) fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+  }
+  return ok;
+}
+
+// Prints the number of checks made and failed, and returns the exit
+// status of the test
+static int checks_result(const char *name) {
+  printf("%s: %d checks, %d failed\n", name, checks_count, checks_failed);
+  return checks_failed ? 1 : 0;
+}
+
+// Pseudo random numbers from 0 to n-1 that are the same on all platforms
+static unsigned checks_seed = 1;
+static inline int checks_random(int n) {
+  checks_seed = checks_seed * 1103515245 + 12345;
+  return (int)((checks_seed >> 8) % (unsigned)n);
+}
+
+#endif // checks_h
+
+//
+// End of "$Id$".
+//
@@ -0,0 +1,167 @@
+//
+// "$Id$"
+//
+// Clip stack test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Pushes and pops random clips with fl_push_clip(), fl_push_no_clip()
+// and fl_clip_region(), and checks fl_clip_box(), fl_not_clipped() and
+// fl_clip_region() against the same clips made with plain X Regions.
+// The Xlib driver keeps rectangular clips as rectangles, and this checks
+// that they answer like Regions do.
+// No display is needed, since nothing is drawn.
+//
+
+#include <config.h>
+#include <stdio.h>
+
+#if defined(USE_X11)
+
+#include <FL/Fl.H>
+#include <FL/fl_draw.H>
+#include <FL/Fl_Device.H>
+#include <FL/x.H>
+#include <X11/Xutil.h>
+#include "checks.h"
+
+#define SEQUENCES	20000	// random sequences of clips
+#define MAX_DEPTH	8	// clips pushed at most
+
+static Region rect_region(int x, int y, int w, int h) {
+  Region r = XCreateRegion();
+  if (w > 0 && h > 0) {
+    XRectangle R = { (short)x, (short)y, (unsigned short)w, (unsigned short)h };
+    XUnionRectWithRegion(&R, r, r);
+  }
+  return r;
+}
+
+// Coordinates left of or above the window are cut off at -1, as
+// clip_to_short() does with the default line width
+static void cut(int &x, int &y, int &w, int &h) {
+  if (x < -1) { w -= -1 - x; x = -1; }
+  if (y < -1) { h -= -1 - y; y = -1; }
+}
+
+// Checks the answers of the driver for a random rectangle. 'ref' is
+// the clip as a Region, or 0 for no clip.
+static void check_rectangle(Region ref) {
+  int x = checks_random(300) - 20, y = checks_random(300) - 20;
+  int w = checks_random(100) + 1, h = checks_random(100) + 1;
+  int X, Y, W, H;
+  int result = fl_clip_box(x, y, w, h, X, Y, W, H);
+  int eX = x, eY = y, eW = w, eH = h, expected = 0;
+  if (ref) {
+    switch (XRectInRegion(ref, x, y, w, h)) {
+      case RectangleOut:
+        eW = eH = 0;
+        expected = 2;
+        break;
+      case RectangleIn:
+        break;
+      default: {
+        Region rr = rect_region(x, y, w, h), t = XCreateRegion();
+        XIntersectRegion(ref, rr, t);
+        XRectangle b;
+        XClipBox(t, &b);
+        eX = b.x; eY = b.y; eW = b.width; eH = b.height;
+        expected = 1;
+        XDestroyRegion(rr);
+        XDestroyRegion(t);
+      }
+    }
+  }
+  if (expected == 2) {	// where X and Y are left is not defined
+    CHECK(result == 2 && W == 0 && H == 0);
+  } else if (!CHECK(result == expected && X == eX && Y == eY && W == eW && H == eH)) {
+    fprintf(stderr, "  fl_clip_box(%d, %d, %d, %d) = %d: %d, %d, %d, %d, expected %d: %d, %d, %d, %d\n",
+            x, y, w, h, result, X, Y, W, H, expected, eX, eY, eW, eH);
+  }
+
+  expected = 1;
+  if (x + w <= 0 || y + h <= 0) expected = 0;
+  else if (ref) {
+    cut(x, y, w, h);
+    expected = XRectInRegion(ref, x, y, w, h);
+  }
+  CHECK(fl_not_clipped(x, y, w, h) == expected);
+}
+
+int main(int argc, char **argv) {
+  Fl_Display_Device::display_device();
+  Region ref[MAX_DEPTH + 1];
+  for (int sequence = 0; sequence < SEQUENCES; sequence++) {
+    int depth = 0;
+    ref[0] = 0;
+    int steps = checks_random(8) + 1;
+    for (int step = 0; step < steps; step++) {
+      int op = checks_random(10);
+      if (op < 6 && depth < MAX_DEPTH) {		// a rectangle
+        int x = checks_random(300) - 50, y = checks_random(300) - 50;
+        int w = checks_random(200) - 10, h = checks_random(200) - 10;
+        fl_push_clip(x, y, w, h);
+        cut(x, y, w, h);
+        Region r = rect_region(x, y, w, h);
+        if (ref[depth]) {
+          Region t = XCreateRegion();
+          XIntersectRegion(ref[depth], r, t);
+          XDestroyRegion(r);
+          r = t;
+        }
+        ref[++depth] = r;
+      } else if (op < 7 && depth < MAX_DEPTH) {	// two rectangles
+        Region r = rect_region(checks_random(200), checks_random(200), 30, 30);
+        Region r2 = rect_region(checks_random(200), checks_random(200), 40, 20);
+        XUnionRegion(r, r2, r);
+        XDestroyRegion(r2);
+        fl_push_no_clip();
+        ref[++depth] = XCreateRegion();
+        XUnionRegion(r, ref[depth], ref[depth]);
+        fl_clip_region(r);				// takes r
+      } else if (op < 8 && depth < MAX_DEPTH) {	// no clip
+        fl_push_no_clip();
+        ref[++depth] = 0;
+      } else if (depth > 0) {
+        fl_pop_clip();
+        if (ref[depth]) XDestroyRegion(ref[depth]);
+        depth--;
+      }
+      for (int i = 0; i < 20; i++) check_rectangle(ref[depth]);
+      // a rectangular clip makes its Region when asked for it
+      Region r = fl_clip_region();
+      CHECK((r == 0) == (ref[depth] == 0) && (!r || XEqualRegion(r, ref[depth])));
+    }
+    while (depth > 0) {
+      fl_pop_clip();
+      if (ref[depth]) XDestroyRegion(ref[depth]);
+      depth--;
+    }
+  }
+  return checks_result("clip_test");
+}
+
+#else
+
+int main(int argc, char **argv) {
+  printf("clip_test: only for X11\n");
+  return 0;
+}
+
+#endif // USE_X11
+
+//
+// End of "$Id$".
+//
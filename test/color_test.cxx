@@ -0,0 +1,98 @@
+//
+// "$Id$"
+//
+// Color parsing test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Checks that fl_parse_color() reads "#rgb" colors like XParseColor()
+// does, and without opening the display, so that pixmaps can be used
+// without one.
+// No display is needed.
+//
+
+#include <config.h>
+#include <stdio.h>
+
+#if defined(USE_X11)
+
+#include <FL/Fl.H>
+#include <FL/x.H>
+#include <FL/Fl_Pixmap.H>
+#include "checks.h"
+
+static void check_color(const char *p, int ok, int r = 0, int g = 0, int b = 0) {
+  uchar R = 1, G = 2, B = 3;
+  int result = fl_parse_color(p, R, G, B);
+  if (!ok) {
+    // a bad color leaves r, g, b alone
+    CHECK(result == 0 && R == 1 && G == 2 && B == 3);
+  } else if (!CHECK(result && R == r && G == g && B == b)) {
+    fprintf(stderr, "  fl_parse_color(\"%s\") = %d: %d, %d, %d, expected %d, %d, %d\n",
+            p, result, R, G, B, r, g, b);
+  }
+}
+
+static const char * const icon_xpm[] = {
+  "3 2 2 1",
+  ".	c #fefefe",
+  "#	c #444",
+  "#..",
+  "..#"
+};
+
+int main(int argc, char **argv) {
+  // the digits are the high bits of each component
+  check_color("#abc", 1, 0xa0, 0xb0, 0xc0);
+  check_color("#fefefe", 1, 0xfe, 0xfe, 0xfe);
+  check_color("#123456", 1, 0x12, 0x34, 0x56);
+  check_color("#ABCDEF", 1, 0xab, 0xcd, 0xef);
+  check_color("#fffeeeddd", 1, 0xff, 0xee, 0xdd);
+  check_color("#123456789abc", 1, 0x12, 0x56, 0x9a);
+  check_color("#000000000000", 1, 0, 0, 0);
+  check_color("#ffffffffffff", 1, 0xff, 0xff, 0xff);
+  // not a multiple of 3, too long, not hexadecimal
+  check_color("#", 0);
+  check_color("#ab", 0);
+  check_color("#abcd", 0);
+  check_color("#1234567890abcdef", 0);
+  check_color("#12345g", 0);
+  check_color("#-1-1-1", 0);
+  check_color("# 1 1 1", 0);
+  check_color("#+1+1+1", 0);
+
+  // inactive pixmaps parse their colors, as the icons of Fl_Tree do
+  Fl_Pixmap icon(icon_xpm);
+  Fl_Image *copy = icon.copy();
+  copy->inactive();
+  CHECK(copy->w() == 3 && copy->h() == 2);
+  delete copy;
+
+  CHECK(fl_display == 0);
+  return checks_result("color_test");
+}
+
+#else
+
+int main(int argc, char **argv) {
+  printf("color_test: only for X11\n");
+  return 0;
+}
+
+#endif // USE_X11
+
+//
+// End of "$Id$".
+//
@@ -0,0 +1,171 @@
+//
+// "$Id$"
+//
+// X11 image conversion benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Converts a full HD image to the pixel format of every kind of X11
+// visual that fl_draw_image() supports (except colormaps), with plain C
+// code and with the SSSE3 and AVX2 code the processor can run, and
+// reports the time taken. Also checks that all versions give the same
+// pixels for rows of any width.
+// Use -q to just run the benchmark and exit without opening a window;
+// the exit status is then 1 if any version gives different pixels.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Box.H>
+#include <FL/fl_draw.H>
+
+#if defined(_WIN32) || defined(__APPLE__)
+
+int main(int, char **) {
+  printf("This benchmark is for the X11 drawing driver only.\n");
+  return 0;
+}
+
+#else
+
+#define BENCH_W		1920
+#define BENCH_H		1080
+#define BENCH_REPEAT	5
+
+// not part of the FLTK API, only in the static library
+#include "../src/drivers/Xlib/Fl_Xlib_Image_Converter.H"
+
+static Fl_Box *G_result = 0;
+static const char *level_name[] = { "C", "SSSE3", "AVX2" };
+
+static double seconds_since(clock_t t) {
+  return (double)(clock() - t) / CLOCKS_PER_SEC;
+}
+
+// Random pixels, with many fully opaque and fully transparent ones
+static void make_pixels(uchar *p, int n) {
+  unsigned int seed = 1;
+  for (int i = 0; i < n; i++) {
+    seed = seed * 1103515245 + 12345;
+    uchar v = uchar(seed >> 16);
+    if ((i & 3) == 3 && (seed & 0x300) == 0) v = (seed & 0x400) ? 255 : 0;
+    p[i] = v;
+  }
+}
+
+// Convert an image of w*h pixels, or blend over the destination
+static void convert(Fl_Xlib_Converter f, const uchar *src, uchar *dst,
+                    int w, int h, int delta, int size) {
+  for (int y = 0; y < h; y++)
+    f(src + y * w * delta, dst + y * w * size, w, delta);
+}
+
+// Compare rows of 1 to 99 pixels at all offsets with the plain C version
+static int same_pixels(Fl_Xlib_Converter c, Fl_Xlib_Converter simd,
+                       const uchar *src, int delta, int size) {
+  uchar a[100 * 4], b[100 * 4];
+  for (int w = 1; w < 100; w++)
+    for (int o = 0; o < 8; o++) {
+      // the destination is only read by the blend converter
+      memcpy(a, src + 1000 + o, w * size);
+      memcpy(b, a, w * size);
+      c(src + o, a, w, delta);
+      simd(src + o, b, w, delta);
+      if (memcmp(a, b, w * size)) return 0;
+    }
+  return 1;
+}
+
+// Run the benchmark, print and display the results. Returns 0 if a
+// version gives different pixels than the plain C version.
+static int run_benchmark() {
+  static char msg[4000];
+  int n = 0;
+  uchar *src = new uchar[BENCH_W * BENCH_H * 4];
+  uchar *dst = new uchar[BENCH_W * BENCH_H * 4];
+  make_pixels(src, BENCH_W * BENCH_H * 4);
+  make_pixels(dst, BENCH_W * BENCH_H * 3);
+  n += sprintf(msg + n, "%dx%d pixels, ms per image:\n", BENCH_W, BENCH_H);
+
+  const char *name;
+  int size, delta, level, all_ok = 1;
+  for (int i = 0; ; i++) {
+    level = 0;
+    Fl_Xlib_Converter c = fl_xlib_image_converter(i, &level, &name, &size, &delta);
+    if (!c) break;
+    for (int d = delta; d <= (delta == 3 ? 4 : delta); d++) {
+      n += sprintf(msg + n, "%-21s %d to %d bytes:", name, d, size);
+      int ok = 1;
+      Fl_Xlib_Converter prev = 0;
+      for (int l = 0; l < 3; l++) {
+        level = l;
+        Fl_Xlib_Converter f = fl_xlib_image_converter(i, &level, &name, &size, &delta);
+        if (level != l || f == prev) break;	// no such version
+        prev = f;
+        if (l && !same_pixels(c, f, src, d, size)) ok = 0;
+        clock_t t = clock();
+        for (int r = 0; r < BENCH_REPEAT; r++)
+          convert(f, src, dst, BENCH_W, BENCH_H, d, size);
+        n += sprintf(msg + n, " %s %6.2f", level_name[l],
+                     seconds_since(t) * 1000.0 / BENCH_REPEAT);
+      }
+      n += sprintf(msg + n, "%s\n", ok ? "" : "  DIFFERENT");
+      if (!ok) all_ok = 0;
+    }
+  }
+  msg[n - 1] = 0;
+  printf("%s\n", msg);
+  if (G_result) G_result->label(msg);
+  delete[] dst;
+  delete[] src;
+  return all_ok;
+}
+
+static void run_cb(Fl_Widget*, void*) {
+  fl_cursor(FL_CURSOR_WAIT);
+  Fl::check();
+  run_benchmark();
+  fl_cursor(FL_CURSOR_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "-q") == 0) {
+    // Headless: the pixels are converted in memory only
+    return run_benchmark() ? 0 : 1;
+  }
+
+  Fl_Double_Window win(720, 480, "X11 image conversion benchmark");
+  Fl_Button *run = new Fl_Button(10, 10, 160, 25, "Run benchmark");
+  run->callback(run_cb);
+  G_result = new Fl_Box(10, 45, 700, 425, "Press 'Run benchmark'");
+  G_result->box(FL_DOWN_BOX);
+  G_result->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT | FL_ALIGN_TOP);
+  G_result->labelfont(FL_COURIER);
+  G_result->labelsize(12);
+  win.end();
+  win.show(argc, argv);
+  return Fl::run();
+}
+
+#endif // _WIN32 || __APPLE__
+
+//
+// End of "$Id$".
+//
@@ -0,0 +1,199 @@
+//
+// "$Id$"
+//
+// File descriptor callback test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Watches pipes and sockets with Fl::add_fd(), and checks which callbacks
+// Fl::wait() calls: with the epoll backend where it is built in, for many
+// descriptors, for callbacks that remove other handlers, for regular
+// files, which epoll can't watch, and for FL_EDGE.
+// No display is needed.
+//
+
+#include <config.h>
+#include <stdio.h>
+
+#if defined(USE_X11)
+
+#include <FL/Fl.H>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include "checks.h"
+
+#define PIPES	100	// pipes watched at once
+
+struct Handler {
+  int fd;	// file descriptor passed to the callback
+  int calls;	// times called
+  int remove;	// descriptor whose FL_WRITE handler this one removes, or -1
+};
+
+static void handler_cb(int fd, void *v) {
+  Handler *h = (Handler*)v;
+  CHECK(fd == h->fd);
+  h->calls++;
+  if (h->remove >= 0) Fl::remove_fd(h->remove, FL_WRITE);
+}
+
+static void drain(int fd) {
+  char buf[64];
+  while (read(fd, buf, sizeof(buf)) == (ssize_t)sizeof(buf)) {}
+}
+
+// Pipes that become readable, in random order, while others are added
+// and removed
+static void test_pipes() {
+  int p[PIPES][2];
+  Handler h[PIPES];
+  int watched[PIPES];
+  int i, round;
+  for (i = 0; i < PIPES; i++) {
+    CHECK(pipe(p[i]) == 0);
+    fcntl(p[i][0], F_SETFL, O_NONBLOCK);
+    h[i].fd = p[i][0];
+    h[i].remove = -1;
+    watched[i] = 0;
+  }
+  for (round = 0; round < 200; round++) {
+    int ready[PIPES];
+    for (i = 0; i < PIPES; i++) {
+      h[i].calls = 0;
+      if (checks_random(10) == 0) {
+        if (watched[i]) Fl::remove_fd(p[i][0]);
+        else Fl::add_fd(p[i][0], FL_READ, handler_cb, &h[i]);
+        watched[i] = !watched[i];
+      }
+      ready[i] = checks_random(4) == 0;
+      if (ready[i]) CHECK(write(p[i][1], "x", 1) == 1);
+    }
+    Fl::wait(0.0);
+    for (i = 0; i < PIPES; i++) {
+      if (!CHECK(h[i].calls == (ready[i] && watched[i])))
+        fprintf(stderr, "  round %d, pipe %d: %d calls\n", round, i, h[i].calls);
+      drain(p[i][0]);
+    }
+  }
+  // nothing is ready
+  for (i = 0; i < PIPES; i++) h[i].calls = 0;
+  Fl::wait(0.0);
+  for (i = 0; i < PIPES; i++) CHECK(h[i].calls == 0);
+  for (i = 0; i < PIPES; i++) {
+    Fl::remove_fd(p[i][0]);
+    close(p[i][0]);
+    close(p[i][1]);
+  }
+}
+
+// A socket is readable and writable at once. The FL_READ handler runs
+// first, since it was added last, and removes the FL_WRITE handler,
+// which must not be called any more.
+static void test_remove_in_callback() {
+  int s[2];
+  CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, s) == 0);
+  CHECK(write(s[1], "x", 1) == 1);
+  Handler r = { s[0], 0, s[0] }, w = { s[0], 0, -1 };
+  Fl::add_fd(s[0], FL_WRITE, handler_cb, &w);
+  Fl::add_fd(s[0], FL_READ, handler_cb, &r);
+  Fl::wait(0.0);
+  CHECK(r.calls == 1);
+  CHECK(w.calls == 0);
+  // the FL_READ handler is still there
+  r.remove = -1;
+  Fl::wait(0.0);
+  CHECK(r.calls == 2);
+  CHECK(w.calls == 0);
+  // removing FL_WRITE only keeps FL_READ, both are called
+  Fl::add_fd(s[0], FL_WRITE, handler_cb, &w);
+  Fl::wait(0.0);
+  CHECK(r.calls == 3 && w.calls == 1);
+  Fl::remove_fd(s[0], FL_WRITE);
+  Fl::wait(0.0);
+  CHECK(r.calls == 4 && w.calls == 1);
+  Fl::remove_fd(s[0]);
+  Fl::wait(0.0);
+  CHECK(r.calls == 4 && w.calls == 1);
+  close(s[0]);
+  close(s[1]);
+}
+
+// A regular file is always ready, also for epoll, which refuses it
+static void test_regular_file() {
+  const char *name = "fd_test.tmp";
+  FILE *fp = fopen(name, "w");
+  fputs("x", fp);
+  fclose(fp);
+  int f = open(name, O_RDONLY);
+  Handler h = { f, 0, -1 };
+  Fl::add_fd(f, FL_READ, handler_cb, &h);
+  Fl::wait(0.0);
+  Fl::wait(0.0);
+  CHECK(h.calls == 2);
+  Fl::remove_fd(f);
+  Fl::wait(0.0);
+  CHECK(h.calls == 2);
+  close(f);
+  remove(name);
+}
+
+// With epoll, FL_EDGE calls back when data arrives, not while it is
+// left unread. Other backends ignore FL_EDGE.
+static void test_edge() {
+  int p[2];
+  CHECK(pipe(p) == 0);
+  Handler h = { p[0], 0, -1 };
+  Fl::add_fd(p[0], FL_READ | FL_EDGE, handler_cb, &h);
+  Fl::wait(0.0);
+  CHECK(h.calls == 0);
+  CHECK(write(p[1], "x", 1) == 1);
+  Fl::wait(0.0);
+  CHECK(h.calls == 1);
+  Fl::wait(0.0);
+#if USE_EPOLL
+  CHECK(h.calls == 1);
+#else
+  CHECK(h.calls == 2);
+#endif
+  int calls = h.calls;
+  CHECK(write(p[1], "y", 1) == 1);
+  Fl::wait(0.0);
+  CHECK(h.calls == calls + 1);
+  Fl::remove_fd(p[0]);
+  close(p[0]);
+  close(p[1]);
+}
+
+int main(int argc, char **argv) {
+  test_pipes();
+  test_remove_in_callback();
+  test_regular_file();
+  test_edge();
+  return checks_result("fd_test");
+}
+
+#else
+
+int main(int argc, char **argv) {
+  printf("fd_test: only for X11\n");
+  return 0;
+}
+
+#endif // USE_X11
+
+//
+// End of "$Id$".
+//
@@ -0,0 +1,193 @@
+//
+// "$Id$"
+//
+// Headless drawing test program for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Draws a dashboard of widgets into an Fl_Framebuffer_Surface many times
+// and reports the time taken, then shows the drawing next to the real
+// widgets.
+// Use -q to just run the benchmark and exit, which needs no display, and
+// -o file.ppm to also save the drawing.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Group.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Light_Button.H>
+#include <FL/Fl_Value_Slider.H>
+#include <FL/Fl_Dial.H>
+#include <FL/Fl_Progress.H>
+#include <FL/Fl_Chart.H>
+#include <FL/Fl_Clock.H>
+#include <FL/Fl_Input.H>
+#include <FL/Fl_Hold_Browser.H>
+#include <FL/Fl_Image.H>
+#include <FL/Fl_Framebuffer_Surface.H>
+#include <FL/fl_draw.H>
+
+#define DASH_W		400
+#define DASH_H		300
+#define BENCH_FRAMES	200
+
+static Fl_Box *G_result = 0;
+static Fl_Box *G_drawing = 0;
+static Fl_RGB_Image *G_image = 0;
+
+static uchar G_icon_pixels[48 * 48 * 4];
+
+// A round icon with a soft edge, to draw an image with alpha
+static Fl_RGB_Image *make_icon() {
+  uchar *p = G_icon_pixels;
+  for (int y = 0; y < 48; y++)
+    for (int x = 0; x < 48; x++, p += 4) {
+      int dx = x - 24, dy = y - 24, d2 = dx * dx + dy * dy;
+      p[0] = uchar(x * 5); p[1] = uchar(y * 5); p[2] = 200;
+      p[3] = d2 < 400 ? 255 : d2 < 576 ? uchar((576 - d2) * 255 / 176) : 0;
+    }
+  return new Fl_RGB_Image(G_icon_pixels, 48, 48, 4);
+}
+
+static Fl_Group *make_dashboard(int X, int Y) {
+  Fl_Group *g = new Fl_Group(X, Y, DASH_W, DASH_H);
+  g->box(FL_FLAT_BOX);
+  Fl_Box *title = new Fl_Box(X + 10, Y + 10, 260, 30, "Plant status");
+  title->box(FL_UP_BOX);
+  title->labelsize(16);
+  Fl_Box *icon = new Fl_Box(X + 280, Y + 5, 50, 50);
+  icon->image(make_icon());
+  new Fl_Light_Button(X + 340, Y + 10, 50, 30, "On");
+  Fl_Value_Slider *s = new Fl_Value_Slider(X + 10, Y + 50, 260, 20);
+  s->type(FL_HOR_NICE_SLIDER);
+  s->value(0.6);
+  Fl_Dial *d = new Fl_Dial(X + 280, Y + 60, 50, 50);
+  d->type(FL_FILL_DIAL);
+  d->value(0.3);
+  Fl_Clock_Output *c = new Fl_Clock_Output(X + 340, Y + 60, 50, 50);
+  c->value(10, 9, 30);
+  Fl_Progress *p = new Fl_Progress(X + 10, Y + 80, 260, 20, "75%");
+  p->value(75);
+  Fl_Chart *chart = new Fl_Chart(X + 10, Y + 110, 180, 100);
+  chart->type(FL_LINE_CHART);
+  Fl_Chart *pie = new Fl_Chart(X + 200, Y + 120, 190, 90);
+  pie->type(FL_PIE_CHART);
+  for (int i = 0; i < 12; i++) {
+    chart->add((i * 7) % 11, 0, FL_BLUE);
+    if (i < 5) pie->add(i + 1, 0, Fl_Color(FL_RED + i));
+  }
+  Fl_Input *in = new Fl_Input(X + 60, Y + 220, 130, 25, "Name");
+  in->value("Pump 3");
+  Fl_Hold_Browser *b = new Fl_Hold_Browser(X + 200, Y + 220, 190, 70);
+  b->add("Valve A\topen");
+  b->add("Valve B\tclosed");
+  b->add("Valve C\topen");
+  b->select(2);
+  new Fl_Button(X + 10, Y + 260, 180, 30, "Acknowledge");
+  g->end();
+  return g;
+}
+
+static void save_ppm(Fl_Framebuffer_Surface *surface, const char *name) {
+  FILE *f = fopen(name, "wb");
+  if (!f) {
+    perror(name);
+    return;
+  }
+  fprintf(f, "P6\n%d %d\n255\n", surface->w(), surface->h());
+  const unsigned *p = surface->pixels();
+  for (int i = surface->w() * surface->h(); i > 0; i--, p++) {
+    uchar rgb[3] = { uchar(*p >> 16), uchar(*p >> 8), uchar(*p) };
+    fwrite(rgb, 1, 3, f);
+  }
+  fclose(f);
+}
+
+// Draw the dashboard into memory many times, print and display the results
+static void run_benchmark(Fl_Group *dashboard, const char *ppm) {
+  static char msg[200];
+  Fl_Framebuffer_Surface *surface = new Fl_Framebuffer_Surface(DASH_W, DASH_H);
+  Fl_Surface_Device::push_current(surface);
+  clock_t t = clock();
+  for (int i = 0; i < BENCH_FRAMES; i++) surface->draw(dashboard);
+  double s = (double)(clock() - t) / CLOCKS_PER_SEC;
+  Fl_Surface_Device::pop_current();
+  sprintf(msg, "%d frames of %dx%d: %.3fs (%.2f ms per frame)",
+          BENCH_FRAMES, DASH_W, DASH_H, s, s * 1000 / BENCH_FRAMES);
+  printf("%s\n", msg);
+  if (ppm) save_ppm(surface, ppm);
+  if (G_result) {
+    G_result->label(msg);
+    delete G_image;
+    G_image = surface->image();
+    G_drawing->image(G_image);
+    G_drawing->redraw();
+  }
+  delete surface;
+}
+
+static Fl_Group *G_dashboard = 0;
+
+static void run_cb(Fl_Widget*, void*) {
+  fl_cursor(FL_CURSOR_WAIT);
+  Fl::check();
+  run_benchmark(G_dashboard, 0);
+  fl_cursor(FL_CURSOR_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+  const char *ppm = 0;
+  int quiet = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-q") == 0) quiet = 1;
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) ppm = argv[++i];
+  }
+  if (quiet) {
+    // Headless: the widgets are never shown, and are also made while the
+    // surface is current so that Fl_Browser measures its text without a display
+    Fl_Framebuffer_Surface measure(1, 1);
+    Fl_Surface_Device::push_current(&measure);
+    Fl_Group::current(0);
+    Fl_Group *dashboard = make_dashboard(0, 0);
+    Fl_Surface_Device::pop_current();
+    run_benchmark(dashboard, ppm);
+    return 0;
+  }
+
+  Fl_Double_Window win(2 * DASH_W + 30, DASH_H + 85, "Fl_Framebuffer_Surface");
+  G_dashboard = make_dashboard(10, 10);
+  G_drawing = new Fl_Box(DASH_W + 20, 10, DASH_W, DASH_H);
+  G_drawing->box(FL_NO_BOX);
+  Fl_Button *run = new Fl_Button(10, DASH_H + 20, 160, 25, "Run benchmark");
+  run->callback(run_cb);
+  G_result = new Fl_Box(10, DASH_H + 50, 2 * DASH_W + 10, 25, "Press 'Run benchmark'");
+  G_result->box(FL_DOWN_BOX);
+  G_result->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT | FL_ALIGN_TOP);
+  G_result->labelsize(12);
+  win.end();
+  win.show(argc, argv);
+  if (ppm) run_benchmark(G_dashboard, ppm);
+  return Fl::run();
+}
+
+//
+// End of "$Id$".
+//
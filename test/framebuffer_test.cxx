@@ -0,0 +1,312 @@
+//
+// "$Id$"
+//
+// Framebuffer surface test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Draws rectangles, lines, polygons, clipped and blended fills, images,
+// bitmaps and a widget into an Fl_Framebuffer_Surface, and checks the
+// pixels against the same drawing done one pixel at a time. Then checks
+// that drawing in tiles with several threads gives the same pixels.
+// No display is needed.
+//
+
+#include <FL/Fl.H>
+#include <FL/Fl_Framebuffer_Surface.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Bitmap.H>
+#include <FL/Fl_Image.H>
+#include <FL/fl_draw.H>
+#include <stdio.h>
+#include "checks.h"
+
+#define W	64
+#define H	48
+#define WHITE	0xffffffffU
+
+// What the pixels of the surface should be
+static unsigned G_ref[W * H];
+
+static unsigned rgb(int r, int g, int b) {
+  return 0xff000000U | (r << 16) | (g << 8) | b;
+}
+
+static void ref_fill(int x, int y, int w, int h, unsigned pixel) {
+  for (int j = y; j < y + h; j++)
+    for (int i = x; i < x + w; i++)
+      if (i >= 0 && i < W && j >= 0 && j < H) G_ref[j * W + i] = pixel;
+}
+
+// (c * a + d * (255 - a)) / 255, rounded, for each component
+static unsigned blend(unsigned c, unsigned d, int a) {
+  unsigned p = 0xff000000U;
+  for (int s = 0; s < 24; s += 8) {
+    int v = ((c >> s) & 255) * a + ((d >> s) & 255) * (255 - a);
+    p |= (unsigned)((v + 127) / 255) << s;
+  }
+  return p;
+}
+
+// Compares the surface with G_ref, and prints the first wrong pixel
+static void check_pixels(Fl_Framebuffer_Surface *s, const char *what) {
+  const unsigned *p = s->pixels();
+  for (int i = 0; i < W * H; i++) {
+    if (!CHECK(p[i] == G_ref[i])) {
+      fprintf(stderr, "  %s: pixel %d, %d is %08x, expected %08x\n",
+              what, i % W, i / W, p[i], G_ref[i]);
+      return;
+    }
+  }
+}
+
+static void test_shapes(Fl_Framebuffer_Surface *s) {
+  fl_color(255, 0, 0);
+  fl_rectf(3, 4, 10, 5);
+  ref_fill(3, 4, 10, 5, rgb(255, 0, 0));
+  check_pixels(s, "rectf");
+
+  fl_color(FL_BLUE);
+  uchar r, g, b;
+  Fl::get_color(FL_BLUE, r, g, b);
+  unsigned blue = rgb(r, g, b);
+  fl_rect(20, 4, 6, 5);
+  ref_fill(20, 4, 6, 1, blue);
+  ref_fill(20, 8, 6, 1, blue);
+  ref_fill(20, 4, 1, 5, blue);
+  ref_fill(25, 4, 1, 5, blue);
+  check_pixels(s, "rect");
+
+  fl_color(0, 128, 0);
+  fl_xyline(2, 12, 30);
+  fl_yxline(40, 2, 30);
+  ref_fill(2, 12, 29, 1, rgb(0, 128, 0));
+  ref_fill(40, 2, 1, 29, rgb(0, 128, 0));
+  // lines along the axes are centered on their coordinates
+  fl_line_style(FL_SOLID, 3);
+  fl_xyline(2, 16, 20);
+  fl_yxline(50, 10, 20);
+  fl_line_style(0);
+  ref_fill(2, 15, 19, 3, rgb(0, 128, 0));
+  ref_fill(49, 10, 3, 11, rgb(0, 128, 0));
+  check_pixels(s, "lines");
+
+  fl_color(10, 20, 30);
+  fl_line(0, 40, 7, 47);
+  for (int i = 0; i < 8; i++) ref_fill(i, 40 + i, 1, 1, rgb(10, 20, 30));
+  check_pixels(s, "diagonal line");
+
+  // a polygon is filled, and its outline drawn, as with X11
+  fl_color(200, 100, 0);
+  fl_polygon(10, 20, 18, 20, 18, 26, 10, 26);
+  ref_fill(10, 20, 9, 7, rgb(200, 100, 0));
+  check_pixels(s, "rectangular polygon");
+  fl_color(1, 2, 3);
+  fl_polygon(20, 20, 36, 20, 20, 36);
+  const unsigned *p = s->pixels();
+  CHECK(p[22 * W + 22] == rgb(1, 2, 3));	// inside
+  CHECK(p[33 * W + 33] == WHITE);		// beyond the long side
+  CHECK(p[20 * W + 36] == rgb(1, 2, 3));	// a corner of the outline
+  for (int j = 20; j <= 36; j++)		// G_ref is only known outside
+    for (int i = 20; i <= 36; i++)
+      if (i + j <= 57) ref_fill(i, j, 1, 1, p[j * W + i]);
+  check_pixels(s, "triangle");
+}
+
+static void test_clip(Fl_Framebuffer_Surface *s) {
+  int X, Y, Wc, Hc;
+  fl_push_clip(30, 30, 10, 10);
+  fl_push_clip(35, 25, 10, 10);
+  CHECK(fl_clip_box(0, 0, W, H, X, Y, Wc, Hc) == 1);
+  CHECK(X == 35 && Y == 30 && Wc == 5 && Hc == 5);
+  CHECK(fl_clip_box(36, 31, 2, 2, X, Y, Wc, Hc) == 0);
+  CHECK(fl_not_clipped(0, 0, 30, 30) == 0);
+  CHECK(fl_not_clipped(38, 33, 10, 10) != 0);
+  fl_color(0, 0, 255);
+  fl_rectf(0, 0, W, H);
+  fl_line(0, 0, W - 1, H - 1);
+  ref_fill(35, 30, 5, 5, rgb(0, 0, 255));
+  check_pixels(s, "nested clips");
+  fl_pop_clip();
+  // an empty clip draws nothing, fl_push_no_clip() draws everywhere
+  fl_push_clip(5, 5, 0, 0);
+  fl_rectf(0, 0, W, H);
+  fl_push_no_clip();
+  fl_rectf(60, 44, 10, 10);
+  fl_pop_clip();
+  fl_pop_clip();
+  ref_fill(60, 44, 4, 4, rgb(0, 0, 255));
+  check_pixels(s, "empty clip");
+  fl_pop_clip();
+  CHECK(fl_not_clipped(0, 0, 1, 1) != 0);
+}
+
+static void test_alpha(Fl_Framebuffer_Surface *s) {
+  static const int alphas[] = { 0, 1, 100, 128, 254, 255 };
+  for (int i = 0; i < 6; i++) {
+    int x = 42 + 3 * i;
+    fl_rectf(x, 0, 3, 9, fl_rgb_color(0, 64, 255), (uchar)alphas[i]);
+    for (int j = 0; j < 9; j++)
+      G_ref[j * W + x] = G_ref[j * W + x + 1] = G_ref[j * W + x + 2] =
+        blend(rgb(0, 64, 255), G_ref[j * W + x], alphas[i]);
+  }
+  check_pixels(s, "blended rectangles");
+}
+
+static void test_images(Fl_Framebuffer_Surface *s) {
+  uchar buf[4 * 3 * 4];
+  int i, j;
+  for (i = 0; i < (int)sizeof(buf); i++) buf[i] = (uchar)(i * 37);
+  // RGB, and every other pixel of a 4 byte image without its alpha
+  fl_draw_image(buf, 52, 12, 4, 3);
+  fl_draw_image(buf, 58, 12, 2, 3, 8, 16);
+  for (j = 0; j < 3; j++) {
+    for (i = 0; i < 4; i++) {
+      const uchar *c = buf + j * 12 + i * 3;
+      ref_fill(52 + i, 12 + j, 1, 1, rgb(c[0], c[1], c[2]));
+    }
+    for (i = 0; i < 2; i++) {
+      const uchar *c = buf + j * 16 + i * 8;
+      ref_fill(58 + i, 12 + j, 1, 1, rgb(c[0], c[1], c[2]));
+    }
+  }
+  fl_draw_image_mono(buf, 52, 16, 4, 2);
+  for (i = 0; i < 8; i++) ref_fill(52 + i % 4, 16 + i / 4, 1, 1, rgb(buf[i], buf[i], buf[i]));
+  check_pixels(s, "draw_image");
+
+  // an image with alpha is blended with what is below
+  static const uchar rgba[] = {
+    255, 0, 0, 0,   255, 0, 0, 255,   255, 0, 0, 128,
+    0, 0, 255, 1,   0, 0, 255, 254,   0, 0, 255, 77
+  };
+  Fl_RGB_Image img(rgba, 3, 2, 4);
+  img.draw(38, 40);
+  for (i = 0; i < 6; i++) {
+    const uchar *c = rgba + 4 * i;
+    int x = 38 + i % 3, y = 40 + i / 3;
+    G_ref[y * W + x] = blend(rgb(c[0], c[1], c[2]), G_ref[y * W + x], c[3]);
+  }
+  check_pixels(s, "image with alpha");
+
+  // a bitmap sets its pixels to the current color, lowest bit first
+  static const uchar bits[] = { 0x81, 0x01, 0x7e, 0x00 };
+  Fl_Bitmap bm(bits, 9, 2);
+  fl_color(50, 60, 70);
+  bm.draw(44, 44);
+  for (i = 0; i < 9; i++) {
+    if (bits[i / 8] & (1 << (i % 8))) ref_fill(44 + i, 44, 1, 1, rgb(50, 60, 70));
+    if (bits[2 + i / 8] & (1 << (i % 8))) ref_fill(44 + i, 45, 1, 1, rgb(50, 60, 70));
+  }
+  check_pixels(s, "bitmap");
+}
+
+// A widget is drawn where the surface is told, whatever its position
+static void test_widget(Fl_Framebuffer_Surface *s) {
+  Fl_Group::current(0);
+  Fl_Box box(100, 100, 5, 4);
+  box.box(FL_FLAT_BOX);
+  box.color(fl_rgb_color(9, 8, 7));
+  s->draw(&box, 28, 42);
+  ref_fill(28, 42, 5, 4, rgb(9, 8, 7));
+  check_pixels(s, "widget");
+  // the image has the same pixels
+  Fl_RGB_Image *img = s->image();
+  CHECK(img->w() == W && img->h() == H && img->d() == 3);
+  const uchar *p = (const uchar *)img->data()[0] + (43 * W + 30) * 3;
+  CHECK(p[0] == 9 && p[1] == 8 && p[2] == 7);
+  delete img;
+}
+
+// Random drawing on a surface of many tiles, with random clips, made
+// the same for each surface by starting with the same seed
+#define BIG_W	1000
+#define BIG_H	700
+
+static void draw_random(Fl_Framebuffer_Surface *s, unsigned seed) {
+  static uchar image[40 * 30 * 4];
+  static const uchar bits[] = { 0x55, 0xaa, 0x0f, 0xf0, 0x3c, 0xc3 };
+  Fl_RGB_Image rgba(image, 40, 30, 4);
+  Fl_Bitmap bm(bits, 16, 3);
+  int i, clips = 0;
+  checks_seed = seed;
+  for (i = 0; i < (int)sizeof(image); i++) image[i] = (uchar)checks_random(256);
+  Fl_Surface_Device::push_current(s);
+  for (i = 0; i < 3000; i++) {
+    int x = checks_random(BIG_W + 100) - 50, y = checks_random(BIG_H + 100) - 50;
+    int w = checks_random(400), h = checks_random(300);
+    fl_color((uchar)checks_random(256), (uchar)checks_random(256), (uchar)checks_random(256));
+    switch (checks_random(10)) {
+      case 0: fl_rectf(x, y, w, h); break;
+      case 1: fl_rectf(x, y, w, h, fl_color(), (uchar)checks_random(256)); break;
+      case 2: fl_line(x, y, x + w - 200, y + h - 150); break;
+      case 3: fl_polygon(x, y, x + w, y + h / 3, x + w / 2, y + h); break;
+      case 4: fl_pie(x, y, w, h, 30, 300); break;
+      case 5: rgba.draw(x, y); break;
+      case 6: fl_draw_image(image, x, y, 30, 30, 4, 160); break;
+      case 7: bm.draw(x, y); break;
+      case 8:
+        if (clips < 5) { fl_push_clip(x, y, w + 200, h + 200); clips++; }
+        break;
+      case 9:
+        if (clips) { fl_pop_clip(); clips--; }
+        break;
+    }
+  }
+  while (clips--) fl_pop_clip();
+  Fl_Surface_Device::pop_current();
+}
+
+// Drawing in tiles, by any number of threads, gives the same pixels as
+// drawing at once
+static void test_threads() {
+  Fl_Framebuffer_Surface *ref = new Fl_Framebuffer_Surface(BIG_W, BIG_H);
+  draw_random(ref, 7);
+  static const int threads[] = { 1, 2, 3, 8 };
+  for (int t = 0; t < 4; t++) {
+    Fl_Framebuffer_Surface *s = new Fl_Framebuffer_Surface(BIG_W, BIG_H);
+    s->threads(threads[t]);
+    CHECK(s->threads() == threads[t]);
+    draw_random(s, 7);
+    const unsigned *p = s->pixels(), *q = ref->pixels();
+    int i;
+    for (i = 0; i < BIG_W * BIG_H && p[i] == q[i]; i++) {}
+    if (!CHECK(i == BIG_W * BIG_H))
+      fprintf(stderr, "  %d threads: pixel %d, %d is %08x, expected %08x\n",
+              threads[t], i % BIG_W, i / BIG_W, p[i], q[i]);
+    delete s;
+  }
+  delete ref;
+}
+
+int main(int argc, char **argv) {
+  Fl_Framebuffer_Surface *s = new Fl_Framebuffer_Surface(W, H);
+  CHECK(s->w() == W && s->h() == H);
+  ref_fill(0, 0, W, H, WHITE);
+  check_pixels(s, "new surface");
+  Fl_Surface_Device::push_current(s);
+  test_shapes(s);
+  test_clip(s);
+  test_alpha(s);
+  test_images(s);
+  test_widget(s);
+  Fl_Surface_Device::pop_current();
+  delete s;
+  test_threads();
+  return checks_result("framebuffer_test");
+}
+
+//
+// End of "$Id$".
+//
@@ -0,0 +1,347 @@
+//
+// "$Id$"
+//
+// GIF decoding test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Writes small GIF files and checks the pixels Fl_GIF_Image decodes from
+// them: colors, transparency, interlaced rows, local color tables, and
+// the frames of an animation with each disposal mode.
+// No display is needed.
+//
+
+#include <FL/Fl.H>
+#include <FL/Fl_GIF_Image.H>
+#include <stdio.h>
+#include <string.h>
+#include "checks.h"
+
+#define TEMP_FILE	"gif_test.tmp"
+
+// The GIF file being written
+static uchar G_gif[16384];
+static int G_size;
+
+static void put(int c) {
+  if (G_size < (int)sizeof(G_gif)) G_gif[G_size++] = (uchar)c;
+}
+
+static void put_short(int v) {
+  put(v & 255);
+  put(v >> 8);
+}
+
+// Four colors, for the global and for local color tables
+static const uchar G_colors[4][3] = {
+  { 0x00, 0x00, 0x00 }, { 0xff, 0x00, 0x00 }, { 0x00, 0xc0, 0x00 }, { 0x10, 0x20, 0xff }
+};
+static const uchar G_local[4][3] = {
+  { 0x11, 0x22, 0x33 }, { 0x44, 0x55, 0x66 }, { 0x77, 0x88, 0x99 }, { 0xaa, 0xbb, 0xcc }
+};
+
+static void put_colors(const uchar colors[4][3]) {
+  for (int i = 0; i < 4; i++) { put(colors[i][0]); put(colors[i][1]); put(colors[i][2]); }
+}
+
+// Header and logical screen with the four colors
+static void begin_gif(int w, int h, int loop = -1) {
+  G_size = 0;
+  put('G'); put('I'); put('F'); put('8'); put('9'); put('a');
+  put_short(w);
+  put_short(h);
+  put(0x81);	// global color table of 4 colors
+  put(0);	// background color
+  put(0);	// aspect ratio
+  put_colors(G_colors);
+  if (loop >= 0) {
+    put(0x21); put(0xff); put(11);
+    const char *app = "NETSCAPE2.0";
+    while (*app) put(*app++);
+    put(3); put(1); put_short(loop); put(0);
+  }
+}
+
+// LZW codes of 3 bits for pixels of 2 bits. A clear code after every
+// two pixels keeps the decoder's table from growing to 4 bit codes.
+static int G_bits, G_nbits, G_block;
+
+static void put_code(int code, int bits = 3) {
+  G_bits |= code << G_nbits;
+  G_nbits += bits;
+  while (G_nbits >= 8) {
+    if (G_gif[G_block] == 255) { G_block = G_size; put(0); }
+    put(G_bits & 255);
+    G_gif[G_block]++;
+    G_bits >>= 8;
+    G_nbits -= 8;
+  }
+}
+
+// A frame of w * h pixels, the values 0 to 3 given row by row. The rows
+// are written in interlaced order if 'interlace' is set.
+static void put_frame(int x, int y, int w, int h, const char *pixels,
+                      int disposal = 0, int transparent = -1, int delay = 0,
+                      int interlace = 0, int local = 0) {
+  put(0x21); put(0xf9); put(4);
+  put((disposal << 2) | (transparent >= 0));
+  put_short(delay);
+  put(transparent >= 0 ? transparent : 0);
+  put(0);
+  put(0x2c);
+  put_short(x); put_short(y); put_short(w); put_short(h);
+  put((interlace ? 0x40 : 0) | (local ? 0x81 : 0));
+  if (local) put_colors(G_local);
+  put(2);	// LZW code size
+  G_block = G_size;
+  put(0);
+  G_bits = G_nbits = 0;
+  int n = 0;
+  static const int start[4] = { 0, 4, 2, 1 }, step[4] = { 8, 8, 4, 2 };
+  for (int pass = 0; pass < (interlace ? 4 : 1); pass++) {
+    for (int r = interlace ? start[pass] : 0; r < h; r += interlace ? step[pass] : 1) {
+      for (int c = 0; c < w; c++) {
+        if (n++ % 2 == 0) put_code(4);
+        put_code(pixels[r * w + c] - '0');
+      }
+    }
+  }
+  put_code(5);
+  if (G_nbits) {	// the rest of the last byte
+    if (G_gif[G_block] == 255) { G_block = G_size; put(0); }
+    put(G_bits);
+    G_gif[G_block]++;
+  }
+  put(0);	// end of the data blocks
+}
+
+// A 17x241 frame of 4097 pixels, all of them literal codes but the last
+// six pixels. The decoder's table of 4096 codes is full after 4091
+// pixels, and the last code is then given three times.
+static void put_full_table(char *pixels) {
+  put(0x2c);
+  put_short(0); put_short(0); put_short(17); put_short(241);
+  put(0);
+  put(2);	// LZW code size
+  G_block = G_size;
+  put(0);
+  G_bits = G_nbits = 0;
+  put_code(4);
+  int bits = 3, next = 6, i;
+  for (i = 0; i < 4091; i++) {
+    pixels[i] = (char)('0' + (i * 7 / 3) % 4);
+    put_code(pixels[i] - '0', bits);
+    if (i > 0 && next < 4096 && ++next > (1 << bits) - 1 && bits < 12) bits++;
+  }
+  for (int n = 0; n < 3; n++, i += 2) {
+    put_code(4095, bits);	// the last two literal pixels
+    pixels[i] = pixels[4089];
+    pixels[i + 1] = pixels[4090];
+  }
+  pixels[i] = 0;
+  put_code(5, bits);
+  if (G_nbits) {
+    if (G_gif[G_block] == 255) { G_block = G_size; put(0); }
+    put(G_bits);
+    G_gif[G_block]++;
+  }
+  put(0);
+}
+
+static Fl_GIF_Image *load_gif() {
+  put(0x3b);
+  FILE *fp = fopen(TEMP_FILE, "wb");
+  fwrite(G_gif, 1, G_size, fp);
+  fclose(fp);
+  Fl_GIF_Image *gif = new Fl_GIF_Image(TEMP_FILE);
+  remove(TEMP_FILE);
+  return gif;
+}
+
+// Checks the pixels of the image: each character of 'expected' is a
+// color of the global table from '0' to '3', a color of the local table
+// from 'a' to 'd', or '.' for a transparent pixel
+static void check_pixels(Fl_GIF_Image *gif, const char *expected, const char *what) {
+  int d = gif->d(), n = gif->w() * gif->h();
+  if (!CHECK((int)strlen(expected) == n)) return;
+  const uchar *p = (const uchar *)gif->data()[0];
+  for (int i = 0; i < n; i++, p += d) {
+    char e = expected[i];
+    const uchar *c = e == '.' ? 0 : e >= 'a' ? G_local[e - 'a'] : G_colors[e - '0'];
+    int ok;
+    if (!c) ok = d == 4 && p[3] == 0;
+    else ok = p[0] == c[0] && p[1] == c[1] && p[2] == c[2] && (d == 3 || p[3] == 255);
+    if (!CHECK(ok)) {
+      fprintf(stderr, "  %s: pixel %d, %d is %02x %02x %02x %02x, expected '%c'\n", what,
+              i % gif->w(), i / gif->w(), p[0], p[1], p[2], d == 4 ? p[3] : 255, e);
+      return;
+    }
+  }
+}
+
+static void test_single() {
+  // plain image, loaded without an alpha channel
+  begin_gif(3, 2);
+  put_frame(0, 0, 3, 2, "012" "321");
+  Fl_GIF_Image *gif = load_gif();
+  CHECK(gif->fail() == 0);
+  CHECK(gif->w() == 3 && gif->h() == 2 && gif->d() == 3);
+  CHECK(gif->frames() == 1 && gif->frame() == 0);
+  CHECK(gif->loop_count() == -1);
+  check_pixels(gif, "012321", "plain");
+  delete gif;
+
+  // a transparent color adds an alpha channel
+  begin_gif(3, 2);
+  put_frame(0, 0, 3, 2, "012" "323", 0, 3);
+  gif = load_gif();
+  CHECK(gif->d() == 4);
+  check_pixels(gif, "012.2.", "transparent");
+  delete gif;
+
+  // a single frame ignores its position and the screen size
+  begin_gif(10, 10);
+  put_frame(4, 5, 2, 2, "12" "30");
+  gif = load_gif();
+  CHECK(gif->w() == 2 && gif->h() == 2);
+  check_pixels(gif, "1230", "offset");
+  delete gif;
+
+  // local color table
+  begin_gif(2, 2);
+  put_frame(0, 0, 2, 2, "01" "23", 0, -1, 0, 0, 1);
+  gif = load_gif();
+  check_pixels(gif, "abcd", "local colors");
+  delete gif;
+}
+
+// Interlaced images of every height up to 17 rows, including those
+// shorter than 5 rows, whose later passes are empty
+static void test_interlace() {
+  char pixels[3 * 17 + 1], what[40];
+  for (int h = 1; h <= 17; h++) {
+    int i;
+    for (i = 0; i < 3 * h; i++) pixels[i] = (char)('0' + (i / 3 + i) % 4);
+    pixels[i] = 0;
+    begin_gif(3, h);
+    put_frame(0, 0, 3, h, pixels, 0, -1, 0, 1);
+    Fl_GIF_Image *gif = load_gif();
+    CHECK(gif->w() == 3 && gif->h() == h);
+    sprintf(what, "interlaced, %d rows", h);
+    check_pixels(gif, pixels, what);
+    delete gif;
+  }
+}
+
+// An animation on a 4x4 screen. Frame 0 fills the screen, frame 1 is
+// cleared to transparent after it is shown, frame 2 is replaced by what
+// was there before, and frame 3 has transparent pixels.
+static void test_animation() {
+  begin_gif(4, 4, 0);
+  put_frame(0, 0, 4, 4, "1111" "1111" "1111" "1111", Fl_GIF_Image::DISPOSE_NONE, -1, 10);
+  put_frame(1, 1, 2, 2, "22" "22", Fl_GIF_Image::DISPOSE_BACKGROUND, -1, 20);
+  put_frame(0, 0, 2, 2, "33" "30", Fl_GIF_Image::DISPOSE_PREVIOUS, -1, 30, 0, 1);
+  put_frame(2, 2, 2, 2, "03" "33", Fl_GIF_Image::DISPOSE_UNSPECIFIED, 3, 0);
+  static const char *frames[] = {
+    "1111" "1111" "1111" "1111",
+    "1111" "1221" "1221" "1111",
+    "dd11" "da.1" "1..1" "1111",
+    "1111" "1..1" "1.01" "1111"
+  };
+  Fl_GIF_Image *gif = load_gif();
+  CHECK(gif->fail() == 0);
+  CHECK(gif->w() == 4 && gif->h() == 4 && gif->d() == 4);
+  CHECK(gif->frames() == 4);
+  CHECK(gif->loop_count() == 0);
+  CHECK(gif->delay(0) == 0.1 && gif->delay(2) == 0.3 && gif->delay(3) == 0.0);
+  CHECK(gif->delay(4) == 0.0 && gif->delay(-1) == 0.0);
+  CHECK(gif->disposal(1) == Fl_GIF_Image::DISPOSE_BACKGROUND);
+  CHECK(gif->disposal(2) == Fl_GIF_Image::DISPOSE_PREVIOUS);
+  CHECK(gif->disposal(4) == Fl_GIF_Image::DISPOSE_UNSPECIFIED);
+  check_pixels(gif, frames[0], "frame 0");
+  char what[40];
+  int i;
+  // forwards, by next_frame()
+  for (i = 1; i < 4; i++) {
+    CHECK(gif->next_frame() == i && gif->frame() == i);
+    sprintf(what, "frame %d", i);
+    check_pixels(gif, frames[i], what);
+  }
+  CHECK(gif->next_frame() == 0);
+  check_pixels(gif, frames[0], "frame 0 again");
+  // in any order, going back starts over
+  static const int order[] = { 3, 1, 2, 2, 0, 3, 2 };
+  for (i = 0; i < (int)(sizeof(order) / sizeof(order[0])); i++) {
+    CHECK(gif->frame(order[i]) == 0 && gif->frame() == order[i]);
+    sprintf(what, "frame %d, step %d", order[i], i);
+    check_pixels(gif, frames[order[i]], what);
+  }
+  CHECK(gif->frame(4) == -1 && gif->frame(-1) == -1 && gif->frame() == 2);
+  delete gif;
+
+  // cut off in the data of the last frame, the frames before are whole
+  begin_gif(4, 4);
+  put_frame(0, 0, 4, 4, "1111" "1111" "1111" "1111");
+  put_frame(0, 0, 4, 4, "2222" "2222" "2222" "2222");
+  G_size -= 6;
+  gif = load_gif();
+  CHECK(gif->frames() == 2);
+  check_pixels(gif, frames[0], "cut off, frame 0");
+  CHECK(gif->frame(1) == 0);
+  const uchar *p = (const uchar *)gif->data()[0];
+  CHECK(p[0] == 0 && p[1] == 0xc0 && p[3] == 255);	// the first rows are there
+  delete gif;
+}
+
+static void test_errors() {
+  Fl_GIF_Image missing("gif_test.missing");
+  CHECK(missing.fail() == Fl_Image::ERR_FILE_ACCESS);
+  G_size = 0;
+  const char *text = "not a GIF file";
+  while (*text) put(*text++);
+  Fl_GIF_Image *gif = load_gif();
+  CHECK(gif->fail() == Fl_Image::ERR_FORMAT);
+  delete gif;
+  // a header without any image
+  begin_gif(4, 4);
+  gif = load_gif();
+  CHECK(gif->fail() == Fl_Image::ERR_FORMAT);
+  delete gif;
+  // codes that refer to the last code of a full table, which used to make
+  // the decoder overwrite that code with itself
+  static char pixels[4098];
+  begin_gif(17, 241);
+  put_full_table(pixels);
+  gif = load_gif();
+  CHECK(gif->fail() == 0 && gif->w() == 17 && gif->h() == 241);
+  check_pixels(gif, pixels, "full table");
+  delete gif;
+}
+
+static void no_message(const char *, ...) {}
+
+int main(int argc, char **argv) {
+  Fl::error = no_message;
+  Fl::warning = no_message;
+  test_single();
+  test_interlace();
+  test_animation();
+  test_errors();
+  return checks_result("gif_test");
+}
+
+//
+// End of "$Id$".
+//
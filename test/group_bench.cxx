@@ -0,0 +1,181 @@
+//
+// "$Id$"
+//
+// Fl_Group spatial index benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Fills a canvas group with many small widgets that light up under the
+// mouse, most of them outside of the group as if it were scrolled. Then
+// sends it mouse moves and draws small parts of the window into an
+// Fl_Framebuffer_Surface, without and with Fl_Group::spatial_index(),
+// and reports the time taken.
+// Use -q to just run the benchmark and exit without opening a window.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Group.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Check_Button.H>
+#include <FL/Fl_Framebuffer_Surface.H>
+#include <FL/fl_draw.H>
+
+#define CHILDREN	50000		// widgets in the canvas
+#define CANVAS_W	4000		// size of the area with widgets
+#define CANVAS_H	3000
+#define WIN_W		800		// size of the canvas group
+#define WIN_H		560
+#define CELL_SIZE	32		// cell size of the spatial index
+#define MOVES		20000		// mouse moves sent
+#define DRAWS		500		// parts of the canvas drawn
+#define DRAW_SIZE	100		// size of these parts
+
+static Fl_Group *G_canvas = 0;
+static Fl_Check_Button *G_index = 0;
+static Fl_Box *G_result = 0;
+
+static double seconds_since(clock_t t) {
+  return (double)(clock() - t) / CLOCKS_PER_SEC;
+}
+
+// A small box that lights up under the mouse
+class Part : public Fl_Box {
+  Fl_Color normal_;
+public:
+  Part(int X, int Y, int W, int H, Fl_Color c) : Fl_Box(FL_FLAT_BOX, X, Y, W, H, 0) {
+    normal_ = c;
+    color(c);
+  }
+  int handle(int event) {
+    switch (event) {
+      case FL_ENTER: color(FL_RED); redraw(); return 1;
+      case FL_LEAVE: color(normal_); redraw(); return 1;
+    }
+    return Fl_Box::handle(event);
+  }
+};
+
+static void fill_canvas(Fl_Group *canvas) {
+  canvas->begin();
+  srand(1);
+  for (int i = 0; i < CHILDREN; i++) {
+    int w = 10 + rand() % 21, h = 6 + rand() % 11;
+    new Part(canvas->x() + rand() % (CANVAS_W - w),
+             canvas->y() + rand() % (CANVAS_H - h),
+             w, h, fl_rgb_color(64 + rand() % 160, 64 + rand() % 160, 255));
+  }
+  canvas->end();
+}
+
+static double send_moves(Fl_Group *canvas) {
+  srand(2);
+  clock_t t = clock();
+  for (int i = 0; i < MOVES; i++) {
+    Fl::e_x = rand() % WIN_W;
+    Fl::e_y = rand() % WIN_H;
+    canvas->handle(FL_MOVE);
+  }
+  double secs = seconds_since(t);
+  Fl::belowmouse(0);
+  return secs;
+}
+
+// The canvas must be at 0,0 in its window
+static double draw_parts(Fl_Group *canvas) {
+  Fl_Framebuffer_Surface surface(WIN_W, WIN_H);
+  Fl_Surface_Device::push_current(&surface);
+  srand(3);
+  clock_t t = clock();
+  for (int i = 0; i < DRAWS; i++) {
+    fl_push_clip(rand() % (WIN_W - DRAW_SIZE), rand() % (WIN_H - DRAW_SIZE),
+                 DRAW_SIZE, DRAW_SIZE);
+    surface.draw(canvas);
+    fl_pop_clip();
+  }
+  double secs = seconds_since(t);
+  Fl_Surface_Device::pop_current();
+  return secs;
+}
+
+static void run_benchmark(Fl_Group *canvas) {
+  static char msg[1000];
+  int cell = canvas->spatial_index();
+  canvas->spatial_index(0);
+  double t_moves = send_moves(canvas);
+  double t_draws = draw_parts(canvas);
+  canvas->spatial_index(CELL_SIZE);
+  double t_moves_index = send_moves(canvas);
+  double t_draws_index = draw_parts(canvas);
+  canvas->spatial_index(cell);
+  sprintf(msg, "%d children in the canvas\n"
+               "%d mouse moves: %.3fs, with index %.3fs\n"
+               "%d draws of %dx%d: %.3fs, with index %.3fs",
+          canvas->children(), MOVES, t_moves, t_moves_index,
+          DRAWS, DRAW_SIZE, DRAW_SIZE, t_draws, t_draws_index);
+  printf("%s\n", msg);
+  if (G_result) G_result->label(msg);
+}
+
+static void run_cb(Fl_Widget*, void*) {
+  fl_cursor(FL_CURSOR_WAIT);
+  Fl::check();
+  run_benchmark(G_canvas);
+  fl_cursor(FL_CURSOR_DEFAULT);
+}
+
+static void index_cb(Fl_Widget*, void*) {
+  G_canvas->spatial_index(G_index->value() ? CELL_SIZE : 0);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "-q") == 0) {
+    // Headless: the window is never shown
+    Fl_Window win(WIN_W, WIN_H);
+    Fl_Group *canvas = new Fl_Group(0, 0, WIN_W, WIN_H);
+    fill_canvas(canvas);
+    win.end();
+    run_benchmark(canvas);
+    return 0;
+  }
+  Fl_Double_Window win(WIN_W, WIN_H + 100, "Fl_Group spatial index benchmark");
+  G_canvas = new Fl_Group(0, 0, WIN_W, WIN_H);
+  G_canvas->clip_children(1);
+  fill_canvas(G_canvas);
+  G_canvas->spatial_index(CELL_SIZE);
+  Fl_Button *run = new Fl_Button(10, WIN_H + 10, 160, 25, "Run benchmark");
+  run->callback(run_cb);
+  G_index = new Fl_Check_Button(10, WIN_H + 40, 160, 25, "Spatial index");
+  G_index->value(1);
+  G_index->callback(index_cb);
+  G_result = new Fl_Box(180, WIN_H + 10, WIN_W - 190, 80,
+                        "Move the mouse over the canvas, or press 'Run benchmark'");
+  G_result->box(FL_DOWN_BOX);
+  G_result->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT | FL_ALIGN_TOP);
+  G_result->labelsize(12);
+  win.end();
+  win.show(argc, argv);
+  return Fl::run();
+}
+
+//
+// End of "$Id$".
+//
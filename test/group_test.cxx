@@ -0,0 +1,272 @@
+//
+// "$Id$"
+//
+// Fl_Group spatial index test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Makes the same random changes to two groups with the same children,
+// one with a spatial index and one without: moves, resizes, inserts,
+// removes, hides and reorders children, reorders the array of children
+// behind the group's back, moves the group, clears it and changes the
+// size of the cells. After each change it checks that both groups send
+// FL_MOVE and FL_PUSH to the same children, the ones on top under the
+// mouse, and draw the same pixels
+// into memory with any clip, both when all of the group is damaged and
+// when only some children are.
+// No display is needed.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Window.H>
+#include <FL/Fl_Group.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Framebuffer_Surface.H>
+#include <FL/fl_draw.H>
+#include "checks.h"
+
+#define CHILDREN	5000		// children made at first
+#define ROUNDS		40		// random changes checked
+#define EVENTS		1000		// mouse positions checked after each change
+#define DRAWS		12		// clips checked after each change
+#define CANVAS_W	1000
+#define CANVAS_H	800
+
+// Gives access to draw()
+class Canvas : public Fl_Group {
+public:
+  Canvas() : Fl_Group(0, 0, CANVAS_W, CANVAS_H) { }
+  void draw_now() { draw(); }
+};
+
+static Canvas *G_group[2];		// without and with an index
+static Fl_Framebuffer_Surface *G_surface;
+static unsigned *G_pixels;
+
+// A child of random size, sometimes large, without area or hidden,
+// around and partly outside the group
+static Fl_Widget *make_child() {
+  int w = 4 + checks_random(56), h = 4 + checks_random(40);
+  int r = checks_random(1000);
+  if (r < 3) { w = 300 + checks_random(400); h = 200 + checks_random(300); }
+  else if (r < 6) w = 0;
+  int x = checks_random(CANVAS_W + 100) - 50, y = checks_random(CANVAS_H + 100) - 50;
+  Fl_Widget *o;
+  if (checks_random(10) == 0) o = new Fl_Button(x, y, w, h);
+  else o = new Fl_Box(FL_FLAT_BOX, x, y, w, h, 0);
+  o->color((Fl_Color)(checks_random(200) + 16));
+  if (checks_random(50) == 0) o->hide();
+  return o;
+}
+
+// Fills group g with n children
+static void fill(Canvas *g, int n) {
+  g->begin();
+  for (int k = 0; k < n; k++) make_child();
+  g->end();
+}
+
+// The index of the child that has the event, -1 for the group or none
+static int child_index(Canvas *g, Fl_Widget *w) {
+  return !w || w == g ? -1 : g->find(w);
+}
+
+// The index of the top child under the mouse, looking at all children,
+// or -1: boxes and buttons take FL_ENTER, only buttons take FL_PUSH
+static int top_child(Canvas *g, int buttons) {
+  for (int i = g->children(); i--;) {
+    Fl_Widget *o = g->child(i);
+    if (o->visible() && Fl::event_inside(o) && (!buttons || dynamic_cast<Fl_Button*>(o)))
+      return i;
+  }
+  return -1;
+}
+
+static void check_events(int round) {
+  for (int k = 0; k < EVENTS; k++) {
+    int result[2][2];
+    Fl::e_x = checks_random(CANVAS_W + 100) - 50;
+    Fl::e_y = checks_random(CANVAS_H + 100) - 50;
+    for (int i = 0; i < 2; i++) {
+      Canvas *g = G_group[i];
+      Fl::belowmouse(0);
+      g->handle(FL_MOVE);
+      result[i][0] = child_index(g, Fl::belowmouse());
+      Fl::pushed(g);			// as Fl::handle() does with the window
+      g->handle(FL_PUSH);
+      result[i][1] = child_index(g, Fl::pushed());
+      if (Fl::pushed() != g) g->handle(FL_RELEASE);
+      Fl::pushed(0);
+    }
+    int top = top_child(G_group[0], 0), button = top_child(G_group[0], 1);
+    if (!CHECK(result[0][0] == top && result[0][1] == button))
+      fprintf(stderr, "  at %d,%d FL_MOVE went to %d and FL_PUSH to %d, not to %d and %d in round %d\n",
+              Fl::e_x, Fl::e_y, result[0][0], result[0][1], top, button, round);
+    if (!CHECK(memcmp(result[0], result[1], sizeof(result[0])) == 0))
+      fprintf(stderr, "  at %d,%d FL_MOVE went to %d and %d, FL_PUSH to %d and %d in round %d\n",
+              Fl::e_x, Fl::e_y, result[0][0], result[1][0], result[0][1], result[1][1], round);
+  }
+}
+
+// Draws group g into the surface with a clip, after damaging all of it
+// or only 'damaged' children that are picked with 'seed'
+static void draw_group(Canvas *g, int X, int Y, int W, int H, int damaged, unsigned seed) {
+  Fl_Surface_Device::push_current(G_surface);
+  fl_color(FL_WHITE);
+  fl_rectf(0, 0, CANVAS_W, CANVAS_H);
+  fl_push_clip(X, Y, W, H);
+  if (!damaged) {
+    g->damage(FL_DAMAGE_ALL);
+  } else {
+    checks_seed = seed;
+    for (int k = 0; k < damaged; k++) g->child(checks_random(g->children()))->damage(FL_DAMAGE_ALL);
+    g->clear_damage(FL_DAMAGE_CHILD);
+  }
+  g->draw_now();
+  g->clear_damage();
+  fl_pop_clip();
+  Fl_Surface_Device::pop_current();
+}
+
+static void check_drawing(int round) {
+  for (int k = 0; k < DRAWS; k++) {
+    int big = k >= DRAWS / 2;
+    int X = checks_random(CANVAS_W) - 20, Y = checks_random(CANVAS_H) - 20;
+    int W = checks_random(big ? CANVAS_W : 100), H = checks_random(big ? CANVAS_H : 100);
+    int damaged = (k & 1) ? 300 : 0;
+    unsigned seed = checks_seed;
+    draw_group(G_group[0], X, Y, W, H, damaged, seed);
+    memcpy(G_pixels, G_surface->pixels(), CANVAS_W * CANVAS_H * sizeof(unsigned));
+    draw_group(G_group[1], X, Y, W, H, damaged, seed);
+    if (!CHECK(memcmp(G_pixels, G_surface->pixels(), CANVAS_W * CANVAS_H * sizeof(unsigned)) == 0))
+      fprintf(stderr, "  pixels differ with clip %d,%d,%d,%d and %s damaged in round %d\n",
+              X, Y, W, H, damaged ? "some children" : "all", round);
+    // the children outside of the clip are left damaged in both
+    int same = 1;
+    for (int i = 0; i < G_group[0]->children(); i++) {
+      if (G_group[0]->child(i)->damage() != G_group[1]->child(i)->damage()) same = 0;
+      G_group[0]->child(i)->clear_damage();
+      G_group[1]->child(i)->clear_damage();
+    }
+    if (!CHECK(same))
+      fprintf(stderr, "  damage of children differs after drawing in round %d\n", round);
+  }
+}
+
+static void check_groups(int round) {
+  CHECK(G_group[0]->children() == G_group[1]->children());
+  check_events(round);
+  check_drawing(round);
+}
+
+// Makes the same random changes to both groups, a different kind each round
+static void random_changes(int round) {
+  unsigned seed = checks_seed;
+  for (int i = 0; i < 2; i++) {
+    Canvas *g = G_group[i];
+    checks_seed = seed;
+    switch ((round - 1) % 10) {
+      case 0:					// move
+        for (int k = 0; k < 500; k++) {
+          Fl_Widget *o = g->child(checks_random(g->children()));
+          o->position(o->x() + checks_random(41) - 20, o->y() + checks_random(41) - 20);
+        }
+        break;
+      case 1:					// resize, also to nothing
+        for (int k = 0; k < 100; k++) {
+          Fl_Widget *o = g->child(checks_random(g->children()));
+          o->size(checks_random(80), checks_random(60));
+        }
+        break;
+      case 2:					// delete and make new ones
+        for (int k = 0; k < 200; k++) delete g->child(checks_random(g->children()));
+        Fl_Group::current(0);
+        for (int k = 0; k < 200; k++) g->insert(*make_child(), checks_random(g->children() + 1));
+        break;
+      case 3:					// remove, then delete
+        for (int k = 0; k < 50; k++) {
+          int n = checks_random(g->children());
+          Fl_Widget *o = g->child(n);
+          if (checks_random(2)) g->remove(n);
+          else g->remove(o);
+          delete o;
+        }
+        break;
+      case 4:					// move in the array
+        for (int k = 0; k < 100; k++)
+          g->insert(*g->child(checks_random(g->children())), checks_random(g->children() + 1));
+        break;
+      case 5:					// hide and show
+        for (int k = 0; k < 100; k++) {
+          Fl_Widget *o = g->child(checks_random(g->children()));
+          if (o->visible()) o->hide();
+          else o->show();
+        }
+        break;
+      case 6: {					// reorder the array behind the group's back
+        Fl_Widget **a = (Fl_Widget**)g->array();
+        for (int k = 0; k < 200; k++) {
+          int m = checks_random(g->children()), n = checks_random(g->children());
+          Fl_Widget *t = a[m]; a[m] = a[n]; a[n] = t;
+        }
+        break;
+      }
+      case 7:					// move the group and its children
+        g->resize(g->x() + checks_random(21) - 10, g->y() + checks_random(21) - 10, g->w(), g->h());
+        break;
+      case 8:					// another size of cells
+        if (g->spatial_index()) g->spatial_index(8 << checks_random(4));
+        break;
+      case 9:					// start again
+        g->clear();
+        Fl_Group::current(0);
+        fill(g, checks_random(2) ? CHILDREN / 5 : CHILDREN);
+        break;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  Fl::visible_focus(0);
+  // children are drawn into this surface, without a display
+  G_surface = new Fl_Framebuffer_Surface(CANVAS_W, CANVAS_H);
+  G_pixels = new unsigned[CANVAS_W * CANVAS_H];
+  Fl_Window *window = new Fl_Window(CANVAS_W, CANVAS_H);
+  for (int i = 0; i < 2; i++) {
+    checks_seed = 1;
+    G_group[i] = new Canvas;
+    G_group[i]->end();
+    if (i) G_group[i]->spatial_index(32);
+    fill(G_group[i], CHILDREN);
+  }
+  window->end();
+  check_groups(0);
+  for (int round = 1; round <= ROUNDS; round++) {
+    random_changes(round);
+    check_groups(round);
+  }
+  delete window;
+  delete[] G_pixels;
+  delete G_surface;
+  return checks_result("group_test");
+}
+
+//
+// End of "$Id$".
+//
@@ -0,0 +1,200 @@
+//
+// "$Id$"
+//
+// Image drawing benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Redraws a grid of many small images, like the icons of a browser,
+// and reports the time taken, and the statistics of the image cache
+// of the graphics driver if it has one. Half of the icons have alpha.
+//
+// With -shm (X11 only), draws large images with fl_draw_image() through
+// the MIT-SHM shared memory segment, and again after making XShmAttach()
+// fail like on a remote display, and checks that both give the same
+// pixels. The exit status is 1 if they don't.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Image.H>
+#include <FL/Fl_Graphics_Driver.H>
+#include <FL/fl_draw.H>
+
+#define ICONS		40
+#define BENCH_FRAMES	200
+#define BENCH_IMAGES	(12 * 24)	// images drawn per frame
+
+class ImageBenchBox : public Fl_Box {
+  int run_;
+  char result_[300];
+  Fl_RGB_Image *icons_[ICONS];
+public:
+  ImageBenchBox(int x, int y, int w, int h) : Fl_Box(x, y, w, h), run_(0) {
+    box(FL_BORDER_BOX);
+    strcpy(result_, "Press 'Run benchmark'");
+    for (int i = 0; i < ICONS; i++) {
+      int d = (i & 1) ? 4 : 3;
+      uchar *p = new uchar[16 * 16 * d];
+      for (int k = 0; k < 16 * 16; k++) {
+        int x = k % 16, y = k / 16;
+        p[k * d + 0] = uchar(i * 6);
+        p[k * d + 1] = uchar(x * 16);
+        p[k * d + 2] = uchar(y * 16);
+        if (d == 4) p[k * d + 3] = uchar((x - 8) * (x - 8) + (y - 8) * (y - 8) < 56 ? 255 : 0);
+      }
+      icons_[i] = new Fl_RGB_Image(p, 16, 16, d);
+      icons_[i]->alloc_array = 1;
+    }
+  }
+  ~ImageBenchBox() {
+    for (int i = 0; i < ICONS; i++) delete icons_[i];
+  }
+  void run() { run_ = 1; redraw(); }
+  void draw_frame(int a, int b) {
+    for (int r = 0; r < 12; r++)
+      for (int c = 0; c < 24; c++)
+        icons_[(r * 24 + c) % ICONS]->draw(a + c * 20, b + r * 20);
+  }
+  void draw() {
+    Fl_Box::draw();
+    int a = x() + 10, b = y() + 10;
+    if (run_) {
+      run_ = 0;
+      clock_t t = clock();
+      for (int i = 0; i < BENCH_FRAMES; i++) draw_frame(a, b);
+      double s = (double)(clock() - t) / CLOCKS_PER_SEC;
+      Fl_Graphics_Driver::cache_stats st;
+      int n = sprintf(result_, "%d frames of %d images: %.3fs (%.1f us per image)",
+                      BENCH_FRAMES, BENCH_IMAGES, s, s * 1e6 / (BENCH_FRAMES * BENCH_IMAGES));
+      if (fl_graphics_driver->image_cache_stats(st))
+        sprintf(result_ + n, "\ncache: %d images, %lu of %lu bytes, "
+                "%lu hits, %lu misses, %lu evictions",
+                st.entries, st.bytes, st.budget, st.hits, st.misses, st.evictions);
+      printf("%s\n", result_);
+    } else {
+      draw_frame(a, b);
+    }
+    fl_color(FL_BLACK);
+    fl_font(FL_HELVETICA, 12);
+    fl_draw(result_, a, b + 250, w() - 20, 40, FL_ALIGN_LEFT | FL_ALIGN_TOP);
+  }
+};
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+
+#include <FL/x.H>		// fl_open_display()
+
+// not part of the FLTK API, only in the static library
+#include "../src/drivers/Xlib/Fl_Xlib_Image_Converter.H"
+
+#define SHM_W	400	// big enough to be drawn through shared memory
+#define SHM_H	300
+
+static uchar *G_pixels;
+
+static void shm_line_cb(void *, int x, int y, int w, uchar *buf) {
+  memcpy(buf, G_pixels + (y * SHM_W + x) * 3, w * 3);
+}
+
+// Draws the image in one of four ways into an offscreen and reads it back
+static uchar *shm_draw(Fl_Offscreen off, int how, int *used) {
+  fl_begin_offscreen(off);
+  fl_color(FL_BLACK);
+  fl_rectf(0, 0, SHM_W, SHM_H);
+  switch (how) {
+    case 0: fl_draw_image(G_pixels, 0, 0, SHM_W, SHM_H, 3); break;
+    case 1: fl_draw_image(G_pixels, 0, 0, SHM_W, SHM_H, 4, SHM_W * 3); break;
+    case 2: fl_draw_image_mono(G_pixels, 0, 0, SHM_W, SHM_H, 3); break;
+    default: fl_draw_image(shm_line_cb, 0, 0, 0, SHM_W, SHM_H, 3); break;
+  }
+  *used = fl_xlib_shm_used();
+  uchar *p = fl_read_image(0, 0, 0, SHM_W, SHM_H);
+  fl_end_offscreen();
+  return p;
+}
+
+// Compares the pixels drawn through shared memory and without it
+static int run_shm_test() {
+  static const char *how_name[] = {
+    "RGB", "RGBx (sent unconverted)", "mono", "RGB with callback"
+  };
+  int ok = 1, shm = 0;
+  fl_open_display();
+  G_pixels = new uchar[SHM_W * SHM_H * 3];
+  for (int i = 0; i < SHM_W * SHM_H * 3; i++) G_pixels[i] = uchar((i * 7) ^ (i / 1203));
+  Fl_Offscreen off = fl_create_offscreen(SHM_W, SHM_H);
+  for (int how = 0; how < 4; how++) {
+    int used, fallback_used;
+    fl_xlib_shm_reset(1);
+    uchar *fallback = shm_draw(off, how, &fallback_used);
+    fl_xlib_shm_reset(0);
+    uchar *p = shm_draw(off, how, &used);
+    shm |= used;
+    int same = fallback && p && memcmp(fallback, p, SHM_W * SHM_H * 3) == 0;
+    printf("%s: %s, %s\n", how_name[how],
+           used ? "drawn through shared memory" : "shared memory not used",
+           same ? "same pixels as XPutImage()" : "DIFFERENT from XPutImage()");
+    if (fallback_used) {
+      printf("  shared memory still used after XShmAttach() failed\n");
+      ok = 0;
+    }
+    if (!same) ok = 0;
+    delete[] fallback;
+    delete[] p;
+  }
+  if (!shm)
+    printf("(FLTK was built without OPTION_USE_XSHM, or the X server has no "
+           "usable MIT-SHM)\n");
+  fl_xlib_shm_reset(0);
+  fl_delete_offscreen(off);
+  delete[] G_pixels;
+  return ok;
+}
+
+#endif // !_WIN32 && !__APPLE__
+
+static void run_cb(Fl_Widget*, void *v) {
+  fl_cursor(FL_CURSOR_WAIT);
+  Fl::check();
+  ((ImageBenchBox *)v)->run();
+  Fl::flush();
+  fl_cursor(FL_CURSOR_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+  Fl::visual(FL_RGB);
+#if !defined(_WIN32) && !defined(__APPLE__)
+  if (argc > 1 && strcmp(argv[1], "-shm") == 0)
+    return run_shm_test() ? 0 : 1;
+#endif // !_WIN32 && !__APPLE__
+  Fl_Double_Window win(520, 350, "Image drawing benchmark");
+  ImageBenchBox *box = new ImageBenchBox(10, 10, 500, 300);
+  Fl_Button *run = new Fl_Button(10, 315, 160, 25, "Run benchmark");
+  run->callback(run_cb, box);
+  win.end();
+  win.show(argc, argv);
+  return Fl::run();
+}
+
+//
+// End of "$Id$".
+//
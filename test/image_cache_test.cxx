@@ -0,0 +1,202 @@
+//
+// "$Id$"
+//
+// X11 image cache test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Draws, uncaches and changes the budget of the cache that the Xlib
+// graphics driver keeps the pixmaps of converted images in, with pixmaps
+// that are only numbers, and checks which pixmaps are freed, the order
+// of the entries and the statistics against a model of the cache that
+// frees the least recently drawn images first, but never the last one.
+// No display is needed.
+//
+
+#include <stdio.h>
+
+#if defined(_WIN32) || defined(__APPLE__)
+
+int main(int argc, char **argv) {
+  printf("image_cache_test: only for X11\n");
+  return 0;
+}
+
+#else
+
+#include <FL/Fl.H>
+#include "checks.h"
+
+// not part of the FLTK API, only in the static library
+#include "../src/drivers/Xlib/Fl_Xlib_Image_Cache.H"
+
+#define IMAGES	12
+#define SCALES	3
+
+static const float scales[SCALES] = { 1.0f, 1.5f, 2.0f };
+static char G_image[IMAGES];		// their addresses stand for images
+
+// The model: one slot per image and scale
+struct Model {
+  int cached;
+  Fl_Offscreen pixmap;
+  unsigned long bytes;
+  int drawn;				// when it was last drawn
+  int freed;				// frees made minus frees expected
+};
+
+static Model G_model[IMAGES][SCALES];
+static int G_clock;
+static Fl_Offscreen G_next_pixmap = 1;
+static int G_bad_free;			// pixmaps freed that the model doesn't know
+static Fl_Graphics_Driver::cache_stats G_stats;
+
+static Model *model_of(const void *img, float s) {
+  for (int i = 0; i < IMAGES; i++)
+    for (int j = 0; j < SCALES; j++)
+      if (img == &G_image[i] && s == scales[j]) return &G_model[i][j];
+  return 0;
+}
+
+static void free_pixmap(Fl_Xlib_Image_Cache::entry *e) {
+  Model *m = model_of(e->img, e->scale);
+  if (!m || m->pixmap != e->pixmap) G_bad_free++;
+  else m->freed++;
+}
+
+static Fl_Xlib_Image_Cache G_cache(free_pixmap, 0);
+
+// Frees the least recently drawn slots, but not the last one
+static void model_trim() {
+  while (G_stats.bytes > G_stats.budget && G_stats.entries > 1) {
+    Model *lru = 0;
+    for (int i = 0; i < IMAGES; i++)
+      for (int j = 0; j < SCALES; j++)
+        if (G_model[i][j].cached && (!lru || G_model[i][j].drawn < lru->drawn))
+          lru = &G_model[i][j];
+    lru->cached = 0;
+    lru->freed--;			// free_pixmap() should count it back
+    G_stats.bytes -= lru->bytes;
+    G_stats.entries--;
+    G_stats.evictions++;
+  }
+}
+
+// Draws image i at scale j: finds its entry, or adds a new pixmap
+static void draw(int i, int j) {
+  Model &m = G_model[i][j];
+  Fl_Xlib_Image_Cache::entry *e = G_cache.find(&G_image[i], scales[j]);
+  m.drawn = ++G_clock;
+  if (m.cached) {
+    G_stats.hits++;
+    if (CHECK(e != 0)) CHECK(e->pixmap == m.pixmap && e->bytes == m.bytes);
+    return;
+  }
+  CHECK(e == 0);
+  G_stats.misses++;
+  m.cached = 1;
+  m.pixmap = G_next_pixmap++;
+  m.bytes = 1000 * (1 + checks_random(20));
+  G_stats.bytes += m.bytes;
+  G_stats.entries++;
+  model_trim();
+  e = G_cache.add(&G_image[i], scales[j], m.pixmap, m.bytes);
+  CHECK(e && e->img == &G_image[i] && e->scale == scales[j] && e->pixmap == m.pixmap);
+}
+
+static void uncache(int i) {
+  G_cache.uncache(&G_image[i]);
+  for (int j = 0; j < SCALES; j++) {
+    Model &m = G_model[i][j];
+    if (!m.cached) continue;
+    m.cached = 0;
+    m.freed--;
+    G_stats.bytes -= m.bytes;
+    G_stats.entries--;
+  }
+}
+
+static void budget(unsigned long bytes) {
+  G_stats.budget = bytes;
+  G_cache.budget(bytes);
+  model_trim();
+}
+
+// Compares the cache with the model
+static void check_cache(int op) {
+  const Fl_Graphics_Driver::cache_stats &st = G_cache.stats();
+  int ok = CHECK(st.hits == G_stats.hits && st.misses == G_stats.misses);
+  ok &= CHECK(st.evictions == G_stats.evictions && st.budget == G_stats.budget);
+  ok &= CHECK(st.bytes == G_stats.bytes && st.entries == G_stats.entries);
+  ok &= CHECK(G_bad_free == 0);
+  // each slot was freed as often as the model says
+  for (int i = 0; i < IMAGES; i++)
+    for (int j = 0; j < SCALES; j++) ok &= CHECK(G_model[i][j].freed == 0);
+  // the entries from the least to the most recently drawn
+  int n = 0, last = 0;
+  Fl_Xlib_Image_Cache::entry *prev = 0;
+  for (Fl_Xlib_Image_Cache::entry *e = G_cache.oldest(); e; prev = e, e = e->newer, n++) {
+    Model *m = model_of(e->img, e->scale);
+    if (!CHECK(m && m->cached && m->pixmap == e->pixmap)) break;
+    ok &= CHECK(m->drawn > last && e->older == prev);
+    last = m->drawn;
+  }
+  ok &= CHECK(n == G_stats.entries && G_cache.newest() == prev);
+  if (!ok) fprintf(stderr, "  operation %d\n", op);
+}
+
+static void test_lru() {
+  budget(10000);
+  draw(0, 0);				// 1000 * (1 + random) bytes each
+  draw(1, 0);
+  draw(0, 0);
+  check_cache(-1);
+  // an image bigger than the budget stays while it is the last one drawn
+  budget(1);
+  check_cache(-1);
+  CHECK(G_cache.stats().entries == 1 && G_cache.newest()->img == &G_image[0]);
+  draw(2, 1);
+  check_cache(-1);
+  CHECK(G_cache.stats().entries == 1 && G_cache.newest()->img == &G_image[2]);
+  uncache(2);
+  check_cache(-1);
+  CHECK(G_cache.stats().entries == 0 && !G_cache.oldest() && !G_cache.newest());
+}
+
+static void test_random() {
+  budget(40000);
+  for (int op = 0; op < 20000; op++) {
+    int r = checks_random(20);
+    if (r < 16) draw(checks_random(IMAGES), checks_random(SCALES));
+    else if (r < 19) uncache(checks_random(IMAGES));
+    else if (checks_random(10) == 0) budget(checks_random(4) ? 1000 * checks_random(100) : 0);
+    check_cache(op);
+  }
+  for (int i = 0; i < IMAGES; i++) uncache(i);
+  check_cache(20000);
+  CHECK(G_cache.stats().entries == 0 && G_cache.stats().bytes == 0);
+}
+
+int main(int argc, char **argv) {
+  test_lru();
+  test_random();
+  return checks_result("image_cache_test");
+}
+
+#endif // _WIN32 || __APPLE__
+
+//
+// End of "$Id$".
+//
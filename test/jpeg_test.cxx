@@ -0,0 +1,150 @@
+//
+// "$Id$"
+//
+// Scaled JPEG decoding test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Writes JPEG files of smooth colors with the JPEG library, and checks
+// that Fl_JPEG_Image(filename, W, H) loads them at the smallest scale of
+// 1/8, 1/4 or 1/2 that is still W x H, and that its pixels are close to
+// the averages of the pixels of the full image.
+// No display is needed.
+//
+
+#include <FL/Fl.H>
+#include <FL/Fl_JPEG_Image.H>
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef HAVE_LIBJPEG
+
+#if defined(WIN32) && defined(__CYGWIN__)
+#  define XMD_H
+#endif // WIN32 && __CYGWIN__
+
+extern "C"
+{
+#  include <jpeglib.h>
+}
+
+#include "checks.h"
+
+#define TEMP_FILE	"jpeg_test.tmp"
+
+// Writes a w x h JPEG file of smooth colors
+static void write_jpeg(int w, int h) {
+  FILE *fp = fopen(TEMP_FILE, "wb");
+  jpeg_compress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  jpeg_stdio_dest(&cinfo, fp);
+  cinfo.image_width = w;
+  cinfo.image_height = h;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, 90, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  JSAMPLE *row = new JSAMPLE[w * 3];
+  while (cinfo.next_scanline < cinfo.image_height) {
+    int y = cinfo.next_scanline;
+    for (int x = 0; x < w; x++) {
+      row[3 * x] = (JSAMPLE)(255 * x / w);
+      row[3 * x + 1] = (JSAMPLE)(255 * y / h);
+      row[3 * x + 2] = (JSAMPLE)(128 + 100 * (x - y) / (w + h));
+    }
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  delete[] row;
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  fclose(fp);
+}
+
+// Loads the file at a reduced size for at least W x H pixels, checks the
+// size, and compares the pixels with the full image
+static void check_scaled(Fl_JPEG_Image *full, int W, int H) {
+  Fl_JPEG_Image img(TEMP_FILE, W, H);
+  CHECK(img.fail() == 0);
+  // the expected scale: the smallest that is still W x H
+  int fw = full->w(), fh = full->h(), denom = 8;
+  if (W < 1) W = 1;
+  if (H < 1) H = 1;
+  while (denom > 1 && (fw < W * denom || fh < H * denom)) denom /= 2;
+  int ew = (fw + denom - 1) / denom, eh = (fh + denom - 1) / denom;
+  if (!CHECK(img.w() == ew && img.h() == eh && img.d() == 3)) {
+    fprintf(stderr, "  %dx%d for %dx%d: %dx%d, expected %dx%d\n",
+            fw, fh, W, H, img.w(), img.h(), ew, eh);
+    return;
+  }
+  CHECK(img.w() >= W || denom == 1);
+  CHECK(img.h() >= H || denom == 1);
+  // each pixel is about the average of its denom x denom pixels
+  const uchar *s = (const uchar *)img.data()[0], *f = (const uchar *)full->data()[0];
+  int worst = 0;
+  for (int y = 0; y < fh / denom; y++) {
+    for (int x = 0; x < fw / denom; x++) {
+      for (int c = 0; c < 3; c++) {
+        int sum = 0;
+        for (int j = 0; j < denom; j++)
+          for (int i = 0; i < denom; i++)
+            sum += f[((y * denom + j) * fw + x * denom + i) * 3 + c];
+        int diff = abs(s[(y * img.w() + x) * 3 + c] - sum / (denom * denom));
+        if (diff > worst) worst = diff;
+      }
+    }
+  }
+  if (!CHECK(worst <= 12))
+    fprintf(stderr, "  %dx%d at 1/%d: pixels differ by %d\n", fw, fh, denom, worst);
+}
+
+static void test_sizes(int w, int h) {
+  write_jpeg(w, h);
+  Fl_JPEG_Image full(TEMP_FILE);
+  CHECK(full.fail() == 0);
+  if (!CHECK(full.w() == w && full.h() == h && full.d() == 3)) return;
+  static const int sizes[][2] = {
+    { 0, 0 }, { 1, 1 }, { 50, 37 }, { 51, 10 }, { 100, 75 }, { 101, 1 },
+    { 1, 76 }, { 200, 150 }, { 201, 150 }, { 0, 151 }, { 400, 300 }, { 5000, 5000 }
+  };
+  for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++)
+    check_scaled(&full, sizes[i][0], sizes[i][1]);
+}
+
+int main(int argc, char **argv) {
+  test_sizes(400, 300);
+  test_sizes(333, 211);	// not a multiple of 8, the sizes are rounded up
+  test_sizes(64, 8);
+  remove(TEMP_FILE);
+  Fl_JPEG_Image missing("jpeg_test.missing", 10, 10);
+  CHECK(missing.fail() == Fl_Image::ERR_FILE_ACCESS);
+  return checks_result("jpeg_test");
+}
+
+#else
+
+int main(int argc, char **argv) {
+  printf("jpeg_test: no JPEG library\n");
+  return 0;
+}
+
+#endif // HAVE_LIBJPEG
+
+//
+// End of "$Id$".
+//
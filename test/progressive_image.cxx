@@ -0,0 +1,220 @@
+//
+// "$Id$"
+//
+// Incremental PNG and JPEG loading test program for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Loads a PNG or JPEG file a block at a time with add_data(), the way
+// a program would load it from the network, and redraws only the rows
+// that each block added. Interlaced PNG and progressive JPEG images get
+// better with each pass. Reports the longest time a single add_data()
+// call took, which is how long the user interface is blocked, compared
+// with loading the whole file at once.
+// Use -q <file>... to just decode the files, in blocks of 8 KB and of 100
+// bytes, and exit without opening a window. The exit status is 1 if the
+// pixels of any of them are not the same as when loading the whole file.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Scroll.H>
+#include <FL/Fl_PNG_Image.H>
+#include <FL/Fl_JPEG_Image.H>
+#include <FL/Fl_File_Chooser.H>
+#include <FL/fl_draw.H>
+
+#define BLOCK_SIZE	8192
+#define SMALL_BLOCK_SIZE 100	// also tried with -q
+#define BLOCK_DELAY	0.01
+
+static Fl_Box *G_image = 0;
+static Fl_Box *G_result = 0;
+static FILE *G_file = 0;
+static Fl_RGB_Image *G_img = 0;
+static int G_png;
+static int G_block_size = BLOCK_SIZE;
+static int G_blocks, G_bands;
+static double G_max_time, G_total_time;
+
+static double seconds_since(clock_t t) {
+  return (double)(clock() - t) / CLOCKS_PER_SEC;
+}
+
+static int add_data(const unsigned char *data, int size) {
+  if (G_png) return ((Fl_PNG_Image *)G_img)->add_data(data, size);
+  return ((Fl_JPEG_Image *)G_img)->add_data(data, size);
+}
+
+static int new_rows(int &y, int &h) {
+  if (G_png) return ((Fl_PNG_Image *)G_img)->new_rows(y, h);
+  return ((Fl_JPEG_Image *)G_img)->new_rows(y, h);
+}
+
+static int pass() {
+  if (G_png) return ((Fl_PNG_Image *)G_img)->pass();
+  return ((Fl_JPEG_Image *)G_img)->pass();
+}
+
+// Open a file and make an empty image of the right type for it
+static int start_loading(const char *name) {
+  unsigned char magic[4];
+  G_file = fopen(name, "rb");
+  if (!G_file || fread(magic, 1, 4, G_file) != 4) {
+    fprintf(stderr, "Cannot read %s\n", name);
+    if (G_file) fclose(G_file);
+    G_file = 0;
+    return 0;
+  }
+  rewind(G_file);
+  G_png = (memcmp(magic, "\211PNG", 4) == 0);
+  if (G_png) G_img = new Fl_PNG_Image();
+  else G_img = new Fl_JPEG_Image();
+  G_blocks = G_bands = 0;
+  G_max_time = G_total_time = 0;
+  return 1;
+}
+
+// Decode the next block, returns 0 when done
+static int load_block() {
+  static unsigned char buf[BLOCK_SIZE];
+  int n = (int)fread(buf, 1, G_block_size, G_file);
+  clock_t t = clock();
+  int r = add_data(n > 0 ? buf : 0, n > 0 ? n : 0);
+  double s = seconds_since(t);
+  G_blocks++;
+  G_total_time += s;
+  if (s > G_max_time) G_max_time = s;
+  int y, h;
+  if (new_rows(y, h)) {
+    G_bands++;
+    if (G_image) {
+      if (!G_image->image()) {
+	G_image->image(G_img);
+	G_image->size(G_img->w(), G_img->h());
+	G_image->parent()->redraw();
+      } else {
+	// only the new band needs to be drawn again
+	G_image->damage(FL_DAMAGE_ALL, G_image->x(), G_image->y() + y,
+			G_image->w(), h);
+      }
+    }
+  }
+  if (r == 0 && n > 0) return 1;
+  fclose(G_file);
+  G_file = 0;
+  return 0;
+}
+
+// Compare with loading the whole file, returns whether the pixels are the same
+static int report(const char *name) {
+  static char msg[600];
+  clock_t t = clock();
+  Fl_RGB_Image *whole;
+  if (G_png) whole = new Fl_PNG_Image(name);
+  else whole = new Fl_JPEG_Image(name);
+  double t_whole = seconds_since(t);
+  int same = whole->w() == G_img->w() && whole->h() == G_img->h() &&
+	     whole->d() == G_img->d() && whole->w() > 0 &&
+	     memcmp(whole->array, G_img->array,
+		    whole->w() * whole->h() * whole->d()) == 0;
+  sprintf(msg, "%s, %dx%dx%d\n"
+	       "%d blocks of %d bytes: %.3fs, longest block %.1f ms\n"
+	       "%d bands redrawn, %d passes\n"
+	       "loading the whole file at once: %.3fs\n"
+	       "same pixels: %s",
+	  G_png ? "PNG" : "JPEG", G_img->w(), G_img->h(), G_img->d(),
+	  G_blocks, G_block_size, G_total_time, G_max_time * 1000.0,
+	  G_bands, pass() + 1,
+	  t_whole,
+	  same ? "yes" : "NO");
+  delete whole;
+  printf("%s\n", msg);
+  if (G_result) G_result->label(msg);
+  return same;
+}
+
+static char G_name[FL_PATH_MAX];
+
+static void load_cb(void *) {
+  if (load_block()) Fl::repeat_timeout(BLOCK_DELAY, load_cb);
+  else report(G_name);
+}
+
+static void open_cb(Fl_Widget*, void*) {
+  const char *name = fl_file_chooser("Image file?", "*.{jpg,jpeg,png}", G_name);
+  if (!name || G_file) return;
+  strncpy(G_name, name, sizeof(G_name) - 1);
+  G_image->image(0);
+  delete G_img;
+  G_img = 0;
+  if (!start_loading(G_name)) return;
+  G_result->label("Loading...");
+  G_image->parent()->redraw();
+  Fl::add_timeout(BLOCK_DELAY, load_cb);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 2 && strcmp(argv[1], "-q") == 0) {
+    // Headless: decode the files block by block as fast as possible
+    int failed = 0;
+    for (int i = 2; i < argc; i++) {
+      for (int small = 0; small < 2; small++) {
+	G_block_size = small ? SMALL_BLOCK_SIZE : BLOCK_SIZE;
+	if (!start_loading(argv[i])) {
+	  failed++;
+	  break;
+	}
+	while (load_block()) {}
+	printf("%s: ", argv[i]);
+	if (!report(argv[i])) failed++;
+	delete G_img;
+	G_img = 0;
+      }
+    }
+    return failed ? 1 : 0;
+  }
+
+  Fl_Double_Window win(660, 620, "Incremental image loading");
+  Fl_Scroll scroll(10, 10, 640, 460);
+  G_image = new Fl_Box(10, 10, 10, 10);
+  scroll.end();
+  Fl_Button *open = new Fl_Button(10, 480, 160, 25, "Open image...");
+  open->callback(open_cb);
+  G_result = new Fl_Box(180, 480, 470, 130,
+			"Open a large PNG or JPEG file to see it loaded\n"
+			"a block at a time");
+  G_result->box(FL_DOWN_BOX);
+  G_result->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT | FL_ALIGN_TOP);
+  G_result->labelsize(12);
+  win.end();
+  win.resizable(scroll);
+  win.show(1, argv);
+  if (argc > 1 && start_loading(argv[1])) {
+    strncpy(G_name, argv[1], sizeof(G_name) - 1);
+    Fl::add_timeout(BLOCK_DELAY, load_cb);
+  }
+  return Fl::run();
+}
+
+//
+// End of "$Id$".
+//
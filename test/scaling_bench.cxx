@@ -0,0 +1,272 @@
+//
+// "$Id$"
+//
+// Fl_RGB_Image::copy() scaling benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Scales a large RGB and RGBA image down and up with all Fl_RGB_Scaling
+// methods, and with the nearest and bilinear code that FLTK 1.3 used,
+// and reports the time taken. Also scales with several threads.
+// Use -q to just run the benchmark and exit without opening a window,
+// with status 1 if any scaled pixels were different.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#endif
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Image.H>
+#include <FL/fl_draw.H>
+
+#define BENCH_W		3000
+#define BENCH_H		2000
+#define BENCH_THREADS	4
+
+static Fl_Box *G_result = 0;
+static Fl_Box *G_preview = 0;
+
+// Wall clock time, so that threads are measured correctly
+static double now() {
+#ifdef _WIN32
+  return GetTickCount() / 1000.0;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+// Nearest neighbor scaling as done by Fl_RGB_Image::copy() in FLTK 1.3
+static void old_nearest(const uchar *array, int w, int h, int d, uchar *new_array,
+                        int W, int H) {
+  int line_d = w * d, dx, dy, c, sy, xerr, yerr;
+  int xmod = w % W, xstep = (w / W) * d, ymod = h % H, ystep = h / H;
+  uchar *new_ptr;
+  const uchar *old_ptr;
+  for (dy = H, sy = 0, yerr = H, new_ptr = new_array; dy > 0; dy --) {
+    for (dx = W, xerr = W, old_ptr = array + sy * line_d; dx > 0; dx --) {
+      for (c = 0; c < d; c ++) *new_ptr++ = old_ptr[c];
+      old_ptr += xstep;
+      xerr    -= xmod;
+      if (xerr <= 0) {
+        xerr    += W;
+        old_ptr += d;
+      }
+    }
+    sy   += ystep;
+    yerr -= ymod;
+    if (yerr <= 0) {
+      yerr += H;
+      sy ++;
+    }
+  }
+}
+
+// Bilinear scaling as done by Fl_RGB_Image::copy() in FLTK 1.3
+static void old_bilinear(const uchar *array, int w, int h, int d, uchar *new_array,
+                         int W, int H) {
+  int line_d = w * d;
+  const float xscale = (w - 1) / (float) W;
+  const float yscale = (h - 1) / (float) H;
+  for (int dy = 0; dy < H; dy++) {
+    float oldy = dy * yscale;
+    if (oldy >= h) oldy = float(h - 1);
+    const float yfract = oldy - (unsigned) oldy;
+    for (int dx = 0; dx < W; dx++) {
+      uchar *new_ptr = new_array + dy * W * d + dx * d;
+      float oldx = dx * xscale;
+      if (oldx >= w) oldx = float(w - 1);
+      const float xfract = oldx - (unsigned) oldx;
+      const unsigned leftx = (unsigned)oldx;
+      const unsigned lefty = (unsigned)oldy;
+      const unsigned rightx = (unsigned)(oldx + 1 >= w ? oldx : oldx + 1);
+      const unsigned righty = (unsigned)oldy;
+      const unsigned dleftx = (unsigned)oldx;
+      const unsigned dlefty = (unsigned)(oldy + 1 >= h ? oldy : oldy + 1);
+      const unsigned drightx = (unsigned)rightx;
+      const unsigned drighty = (unsigned)dlefty;
+      uchar left[4], right[4], downleft[4], downright[4];
+      memcpy(left, array + lefty * line_d + leftx * d, d);
+      memcpy(right, array + righty * line_d + rightx * d, d);
+      memcpy(downleft, array + dlefty * line_d + dleftx * d, d);
+      memcpy(downright, array + drighty * line_d + drightx * d, d);
+      int i;
+      if (d == 4) {
+        for (i = 0; i < 3; i++) {
+          left[i] = (uchar)(left[i] * left[3] / 255.0f);
+          right[i] = (uchar)(right[i] * right[3] / 255.0f);
+          downleft[i] = (uchar)(downleft[i] * downleft[3] / 255.0f);
+          downright[i] = (uchar)(downright[i] * downright[3] / 255.0f);
+        }
+      }
+      const float leftf = 1 - xfract, rightf = xfract;
+      const float upf = 1 - yfract, downf = yfract;
+      for (i = 0; i < d; i++)
+        new_ptr[i] = (uchar)((left[i] * leftf + right[i] * rightf) * upf +
+                             (downleft[i] * leftf + downright[i] * rightf) * downf);
+      if (d == 4 && new_ptr[3])
+        for (i = 0; i < 3; i++)
+          new_ptr[i] = (uchar)(new_ptr[i] / (new_ptr[3] / 255.0f));
+    }
+  }
+}
+
+// Make a test image with gradients, sharp edges and varying alpha
+static Fl_RGB_Image *make_image(int w, int h, int d) {
+  uchar *data = new uchar[w * h * d], *p = data;
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++, p += d) {
+      int check = ((x / 50) ^ (y / 50)) & 1;
+      p[0] = (uchar)(x * 255 / w);
+      if (d > 2) {
+        p[1] = (uchar)(check ? 255 : 0);
+        p[2] = (uchar)(y * 255 / h);
+      }
+      if (!(d & 1)) p[d - 1] = (uchar)((x + y) & 255);
+    }
+  Fl_RGB_Image *img = new Fl_RGB_Image(data, w, h, d);
+  img->alloc_array = 1;
+  return img;
+}
+
+static const char *method_name[] = {
+  "nearest", "bilinear", "bicubic", "Lanczos", "area"
+};
+
+// Time copy() with a method and a number of threads
+static double time_copy(Fl_RGB_Image *img, int W, int H, Fl_RGB_Scaling method,
+                        int threads, Fl_RGB_Image **result = 0) {
+  Fl_Image::RGB_scaling(method);
+  Fl_Image::RGB_scaling_threads(threads);
+  double t = now();
+  Fl_Image *copy = img->copy(W, H);
+  t = now() - t;
+  if (result) *result = (Fl_RGB_Image *)copy;
+  else delete copy;
+  return t;
+}
+
+static int G_ok;	// no different pixels so far
+
+// Scale one image, append the results to msg
+static int bench_image(char *msg, Fl_RGB_Image *img, int W, int H) {
+  int d = img->d(), n = 0, size = W * H * d;
+  uchar *ref = new uchar[size];
+  Fl_RGB_Image *copy;
+
+  double t = now();
+  old_nearest(img->array, img->w(), img->h(), d, ref, W, H);
+  double t_old = now() - t;
+  double t_new = time_copy(img, W, H, FL_RGB_SCALING_NEAREST, 1, &copy);
+  int same = memcmp(ref, copy->array, size) == 0;
+  if (!same) G_ok = 0;
+  delete copy;
+  n += sprintf(msg + n, "%dx%dx%d to %dx%d\n"
+                        "  nearest: 1.3 %.3fs, now %.3fs (%s)\n",
+               img->w(), img->h(), d, W, H,
+               t_old, t_new, same ? "same pixels" : "DIFFERENT");
+
+  t = now();
+  old_bilinear(img->array, img->w(), img->h(), d, ref, W, H);
+  t_old = now() - t;
+  n += sprintf(msg + n, "  bilinear: 1.3 %.3fs\n", t_old);
+  delete[] ref;
+
+  for (int m = FL_RGB_SCALING_BILINEAR; m <= FL_RGB_SCALING_AREA; m++) {
+    Fl_RGB_Image *mt;
+    t_new = time_copy(img, W, H, (Fl_RGB_Scaling)m, 1, &copy);
+    double t_mt = time_copy(img, W, H, (Fl_RGB_Scaling)m, BENCH_THREADS, &mt);
+    same = memcmp(copy->array, mt->array, size) == 0;
+    if (!same) G_ok = 0;
+    delete mt;
+    delete copy;
+    n += sprintf(msg + n, "  %s: %.3fs, %d threads %.3fs%s\n",
+                 method_name[m], t_new, BENCH_THREADS, t_mt,
+                 same ? "" : " (DIFFERENT)");
+  }
+  return n;
+}
+
+// Run the benchmark, print and display the results
+static void run_benchmark() {
+  static char msg[2000];
+  int n = 0;
+  G_ok = 1;
+  Fl_RGB_Image *rgb = make_image(BENCH_W, BENCH_H, 3);
+  Fl_RGB_Image *rgba = make_image(BENCH_W, BENCH_H, 4);
+  n += bench_image(msg + n, rgb, BENCH_W / 3, BENCH_H / 3);
+  n += bench_image(msg + n, rgba, BENCH_W / 3, BENCH_H / 3);
+  Fl_RGB_Image *small = (Fl_RGB_Image *)rgba->copy(BENCH_W / 4, BENCH_H / 4);
+  n += bench_image(msg + n, small, BENCH_W, BENCH_H);
+  msg[n - 1] = 0;
+  printf("%s\n", msg);
+  if (G_result) G_result->label(msg);
+  if (G_preview) {
+    // show a small image scaled up with the Lanczos filter
+    Fl_RGB_Image *crop = make_image(60, 40, 3);
+    Fl_Image::RGB_scaling(FL_RGB_SCALING_LANCZOS);
+    delete G_preview->image();
+    G_preview->image(crop->copy(G_preview->w(), G_preview->h()));
+    delete crop;
+    G_preview->redraw();
+  }
+  delete small;
+  delete rgba;
+  delete rgb;
+  Fl_Image::RGB_scaling(FL_RGB_SCALING_NEAREST);
+  Fl_Image::RGB_scaling_threads(1);
+}
+
+static void run_cb(Fl_Widget*, void*) {
+  fl_cursor(FL_CURSOR_WAIT);
+  Fl::check();
+  run_benchmark();
+  fl_cursor(FL_CURSOR_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "-q") == 0) {
+    // Headless: images are scaled in memory only
+    run_benchmark();
+    return G_ok ? 0 : 1;
+  }
+
+  Fl_Double_Window win(620, 480, "Fl_RGB_Image::copy() benchmark");
+  Fl_Button *run = new Fl_Button(10, 10, 160, 25, "Run benchmark");
+  run->callback(run_cb);
+  G_preview = new Fl_Box(10, 45, 160, 120);
+  G_preview->box(FL_DOWN_BOX);
+  G_result = new Fl_Box(180, 10, 430, 460, "Press 'Run benchmark'");
+  G_result->box(FL_DOWN_BOX);
+  G_result->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT | FL_ALIGN_TOP);
+  G_result->labelsize(12);
+  win.end();
+  win.show(argc, argv);
+  return Fl::run();
+}
+
+//
+// End of "$Id$".
+//
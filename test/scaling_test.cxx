@@ -0,0 +1,217 @@
+//
+// "$Id$"
+//
+// Fl_RGB_Image::copy() scaling test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Scales images of 1 to 4 channels up and down with every Fl_RGB_Scaling
+// method, and checks that a uniform image stays uniform, that the color
+// of fully transparent pixels does not bleed into the others, that
+// several threads give the same bytes as one, and that nearest neighbor
+// scaling picks the same pixels as FLTK 1.3 did.
+// No display is needed.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Image.H>
+#include "checks.h"
+
+static const char *method_name[] = {
+  "nearest", "bilinear", "bicubic", "Lanczos", "area"
+};
+#define METHODS	5
+
+// Sizes scaled from and to: down, up, both, and to and from one pixel
+static const int sizes[][4] = {
+  { 97, 61, 30, 20 }, { 13, 9, 80, 70 }, { 40, 7, 9, 50 },
+  { 1, 1, 5, 3 }, { 6, 5, 1, 1 }, { 250, 180, 249, 181 }
+};
+#define SIZES	(int)(sizeof(sizes) / sizeof(sizes[0]))
+
+static Fl_RGB_Image *make_image(uchar *data, int w, int h, int d) {
+  Fl_RGB_Image *img = new Fl_RGB_Image(data, w, h, d);
+  img->alloc_array = 1;
+  return img;
+}
+
+// Scales img with a method and a number of threads
+static Fl_RGB_Image *scale(Fl_RGB_Image *img, int W, int H, int method, int threads = 1) {
+  Fl_Image::RGB_scaling((Fl_RGB_Scaling)method);
+  Fl_Image::RGB_scaling_threads(threads);
+  Fl_RGB_Image *copy = (Fl_RGB_Image *)img->copy(W, H);
+  Fl_Image::RGB_scaling_threads(1);
+  return copy;
+}
+
+// All pixels of one color, with alpha from opaque to almost transparent
+static void test_uniform() {
+  static const uchar color[4] = { 200, 17, 128, 255 };
+  static const uchar alphas[] = { 255, 128, 3 };
+  for (int d = 1; d <= 4; d++)
+    for (int a = 0; a < ((d & 1) ? 1 : 3); a++)
+      for (int s = 0; s < SIZES; s++) {
+        int w = sizes[s][0], h = sizes[s][1], W = sizes[s][2], H = sizes[s][3];
+        uchar pixel[4];
+        memcpy(pixel, color, d);
+        if (!(d & 1)) pixel[d - 1] = alphas[a];
+        uchar *data = new uchar[w * h * d];
+        for (int i = 0; i < w * h; i++) memcpy(data + i * d, pixel, d);
+        Fl_RGB_Image *img = make_image(data, w, h, d);
+        for (int m = 0; m < METHODS; m++) {
+          Fl_RGB_Image *copy = scale(img, W, H, m);
+          if (!CHECK(copy->w() == W && copy->h() == H && copy->d() == d)) continue;
+          const uchar *p = copy->array;
+          for (int i = 0; i < W * H; i++, p += d)
+            if (!CHECK(memcmp(p, pixel, d) == 0)) {
+              fprintf(stderr, "  %s, %d channels, alpha %d, %dx%d to %dx%d: "
+                      "pixel %d is %d %d %d %d\n", method_name[m], d, pixel[d - 1],
+                      w, h, W, H, i, p[0], d > 1 ? p[1] : 0, d > 2 ? p[2] : 0,
+                      d > 3 ? p[3] : 0);
+              break;
+            }
+          delete copy;
+        }
+        delete img;
+      }
+}
+
+// Opaque dark pixels next to fully transparent white ones: no pixel that
+// is not fully transparent may get any of the white
+static void test_transparent() {
+  for (int d = 2; d <= 4; d += 2)
+    for (int s = 0; s < SIZES; s++) {
+      int w = sizes[s][0], h = sizes[s][1], W = sizes[s][2], H = sizes[s][3];
+      uchar *data = new uchar[w * h * d];
+      for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++) {
+          uchar *p = data + (y * w + x) * d;
+          int opaque = ((x / 3) ^ (y / 2)) & 1;
+          memset(p, opaque ? 0 : 255, d - 1);
+          if (opaque && d == 4) p[1] = 100;	// green
+          p[d - 1] = opaque ? (uchar)(255 - x) : 0;
+        }
+      Fl_RGB_Image *img = make_image(data, w, h, d);
+      for (int m = 0; m < METHODS; m++) {
+        Fl_RGB_Image *copy = scale(img, W, H, m);
+        const uchar *p = copy->array;
+        for (int i = 0; i < W * H; i++, p += d)
+          if (p[d - 1] && !CHECK(p[0] == 0 && (d == 2 || (p[1] <= 100 && p[2] == 0)))) {
+            fprintf(stderr, "  %s, %d channels, %dx%d to %dx%d: pixel %d is %d %d %d %d\n",
+                    method_name[m], d, w, h, W, H, i, p[0], p[1],
+                    d > 2 ? p[2] : 0, d > 3 ? p[3] : 0);
+            break;
+          }
+        delete copy;
+      }
+      delete img;
+    }
+}
+
+// Gradients, sharp edges and varying alpha
+static Fl_RGB_Image *make_pattern(int w, int h, int d) {
+  uchar *data = new uchar[w * h * d], *p = data;
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++, p += d) {
+      p[0] = (uchar)(x * 255 / w);
+      if (d > 2) {
+        p[1] = (uchar)((((x / 7) ^ (y / 5)) & 1) ? 255 : 0);
+        p[2] = (uchar)(y * 255 / h);
+      }
+      if (!(d & 1)) p[d - 1] = (uchar)((x * 3 + y) & 255);
+    }
+  return make_image(data, w, h, d);
+}
+
+// Images scaled in bands by several threads are the same to the byte
+static void test_threads() {
+  static const int to[][2] = { { 300, 200 }, { 90, 130 }, { 1000, 700 } };
+  for (int d = 1; d <= 4; d++) {
+    Fl_RGB_Image *img = make_pattern(311, 257, d);
+    for (int t = 0; t < 3; t++) {
+      int W = to[t][0], H = to[t][1];
+      for (int m = 1; m < METHODS; m++) {
+        Fl_RGB_Image *one = scale(img, W, H, m);
+        for (int threads = 2; threads <= 7; threads++) {
+          Fl_RGB_Image *copy = scale(img, W, H, m, threads);
+          if (!CHECK(memcmp(one->array, copy->array, W * H * d) == 0))
+            fprintf(stderr, "  %s, %d channels, to %dx%d: %d threads differ\n",
+                    method_name[m], d, W, H, threads);
+          delete copy;
+        }
+        delete one;
+      }
+    }
+    delete img;
+  }
+}
+
+// Nearest neighbor scaling as done by Fl_RGB_Image::copy() in FLTK 1.3
+static void old_nearest(const uchar *array, int w, int h, int d, uchar *new_array,
+                        int W, int H) {
+  int line_d = w * d, dx, dy, c, sy, xerr, yerr;
+  int xmod = w % W, xstep = (w / W) * d, ymod = h % H, ystep = h / H;
+  uchar *new_ptr;
+  const uchar *old_ptr;
+  for (dy = H, sy = 0, yerr = H, new_ptr = new_array; dy > 0; dy --) {
+    for (dx = W, xerr = W, old_ptr = array + sy * line_d; dx > 0; dx --) {
+      for (c = 0; c < d; c ++) *new_ptr++ = old_ptr[c];
+      old_ptr += xstep;
+      xerr    -= xmod;
+      if (xerr <= 0) {
+        xerr    += W;
+        old_ptr += d;
+      }
+    }
+    sy   += ystep;
+    yerr -= ymod;
+    if (yerr <= 0) {
+      yerr += H;
+      sy ++;
+    }
+  }
+}
+
+static void test_nearest() {
+  for (int d = 1; d <= 4; d++)
+    for (int s = 0; s < SIZES; s++) {
+      int w = sizes[s][0], h = sizes[s][1], W = sizes[s][2], H = sizes[s][3];
+      Fl_RGB_Image *img = make_pattern(w, h, d);
+      uchar *ref = new uchar[W * H * d];
+      old_nearest(img->array, w, h, d, ref, W, H);
+      Fl_RGB_Image *copy = scale(img, W, H, FL_RGB_SCALING_NEAREST, 4);
+      if (!CHECK(memcmp(ref, copy->array, W * H * d) == 0))
+        fprintf(stderr, "  %d channels, %dx%d to %dx%d: not the pixels of FLTK 1.3\n",
+                d, w, h, W, H);
+      delete copy;
+      delete[] ref;
+      delete img;
+    }
+}
+
+int main(int argc, char **argv) {
+  test_uniform();
+  test_transparent();
+  test_threads();
+  test_nearest();
+  return checks_result("scaling_test");
+}
+
+//
+// End of "$Id$".
+//
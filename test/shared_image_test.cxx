@@ -0,0 +1,240 @@
+//
+// "$Id$"
+//
+// Shared image cache test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Loads the pixmaps in test/pixmaps with Fl_Shared_Image::get() under
+// a small cache budget, and checks which released images are destroyed,
+// in which order, and the cache_used(), cache_hits(), cache_misses()
+// and cache_evictions() counters. Random gets, finds and releases are
+// checked against a model of the cache that destroys the least recently
+// released images first.
+// Must be run in the test directory. No display is needed.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Shared_Image.H>
+#include "checks.h"
+
+static const char *names[] = {
+  "pixmaps/red.xpm", "pixmaps/blue.xpm", "pixmaps/green.xpm",
+  "pixmaps/cyan.xpm", "pixmaps/gray.xpm", "pixmaps/yellow.xpm",
+  "pixmaps/magenta.xpm", "pixmaps/blast.xpm", "pixmaps/porsche.xpm",
+  "pixmaps/porsche1.xpm", "pixmaps/tile.xpm"
+};
+#define NAMES	(int)(sizeof(names) / sizeof(names[0]))
+
+#define SMALL	(32 * 32 * 4)	// bytes of a 32x32 pixmap, drawn as RGBA
+
+// The cached image of that name, without counting a hit or miss
+static Fl_Shared_Image *cached(const char *name) {
+  for (int i = 0; i < Fl_Shared_Image::num_images(); i++)
+    if (strcmp(Fl_Shared_Image::images()[i]->name(), name) == 0)
+      return Fl_Shared_Image::images()[i];
+  return 0;
+}
+
+static int check_stats(unsigned long hits, unsigned long misses,
+                       unsigned long evictions, size_t used) {
+  int ok = CHECK(Fl_Shared_Image::cache_hits() == hits);
+  ok &= CHECK(Fl_Shared_Image::cache_misses() == misses);
+  ok &= CHECK(Fl_Shared_Image::cache_evictions() == evictions);
+  ok &= CHECK(Fl_Shared_Image::cache_used() == used);
+  return ok;
+}
+
+// Five 32x32 images, a budget for three of them
+static void test_lru() {
+  Fl_Shared_Image *img[5];
+  int i;
+  // without a budget, the last release() destroys the image
+  CHECK(Fl_Shared_Image::cache_size() == 0);
+  img[0] = Fl_Shared_Image::get(names[0]);
+  if (!CHECK(img[0] && img[0]->w() == 32 && img[0]->h() == 32)) {
+    fprintf(stderr, "  can't load %s, not run in the test directory?\n", names[0]);
+    return;
+  }
+  check_stats(0, 1, 0, SMALL);
+  img[0]->release();
+  CHECK(Fl_Shared_Image::num_images() == 0);
+  check_stats(0, 1, 0, 0);
+
+  Fl_Shared_Image::reset_cache_stats();
+  Fl_Shared_Image::cache_size(3 * SMALL + 100);
+  // images in use are kept, even above the budget
+  for (i = 0; i < 5; i++) img[i] = Fl_Shared_Image::get(names[i]);
+  CHECK(Fl_Shared_Image::num_images() == 5);
+  check_stats(0, 5, 0, 5 * SMALL);
+  // released ones are destroyed until the cache fits in the budget
+  for (i = 0; i < 5; i++) img[i]->release();
+  CHECK(!cached(names[0]) && !cached(names[1]));
+  CHECK(cached(names[2]) && cached(names[3]) && cached(names[4]));
+  check_stats(0, 5, 2, 3 * SMALL);
+  // a released image is found again without loading it
+  Fl_Shared_Image *green = Fl_Shared_Image::find(names[2]);
+  CHECK(green == img[2] && green->refcount() == 1);
+  Fl_Shared_Image *blue = Fl_Shared_Image::find(names[1]);
+  CHECK(blue == 0);
+  check_stats(1, 6, 2, 3 * SMALL);
+  CHECK(Fl_Shared_Image::get(names[4]) == img[4]);
+  check_stats(2, 6, 2, 3 * SMALL);
+  // now cyan was released least recently, then green, then gray
+  green->release();
+  img[4]->release();
+  Fl_Shared_Image *yellow = Fl_Shared_Image::get(names[5]);
+  CHECK(!cached(names[3]) && cached(names[2]) && cached(names[4]));
+  check_stats(2, 7, 3, 3 * SMALL);
+  yellow->release();
+  Fl_Shared_Image::cache_size(SMALL);
+  CHECK(!cached(names[2]) && !cached(names[4]) && cached(names[5]));
+  check_stats(2, 7, 5, SMALL);
+  // releasing twice does nothing
+  yellow->release();
+  CHECK(cached(names[5]) && Fl_Shared_Image::num_images() == 1);
+  // a budget of 0 destroys all unused images
+  Fl_Shared_Image::cache_size(0);
+  CHECK(Fl_Shared_Image::num_images() == 0);
+  check_stats(2, 7, 6, 0);
+  Fl_Shared_Image::reset_cache_stats();
+  check_stats(0, 0, 0, 0);
+}
+
+// The model of the cache
+struct Model {
+  size_t bytes;		// size of the image, 0 until it is loaded
+  int refcount;		// references held by the test
+  int cached;		// whether the cache has the image
+  int released;		// when its refcount dropped to 0
+  Fl_Shared_Image *img;
+};
+
+static Model G_model[NAMES];
+static size_t G_budget;
+static int G_clock;
+static unsigned long G_hits, G_misses, G_evictions;
+
+static size_t model_used() {
+  size_t used = 0;
+  for (int i = 0; i < NAMES; i++) if (G_model[i].cached) used += G_model[i].bytes;
+  return used;
+}
+
+static void model_trim() {
+  while (model_used() > G_budget) {
+    int lru = -1;
+    for (int i = 0; i < NAMES; i++)
+      if (G_model[i].cached && G_model[i].refcount == 0 &&
+          (lru < 0 || G_model[i].released < G_model[lru].released)) lru = i;
+    if (lru < 0) break;
+    G_model[lru].cached = 0;
+    G_evictions++;
+  }
+}
+
+static void random_operation(int op) {
+  int i = checks_random(NAMES);
+  switch (checks_random(5)) {
+    case 0: {					// get
+      Model &m = G_model[i];
+      Fl_Shared_Image *img = Fl_Shared_Image::get(names[i]);
+      if (!CHECK(img != 0)) return;
+      if (m.cached) {
+        CHECK(img == m.img);
+        G_hits++;
+      } else {
+        G_misses++;
+        m.bytes = (size_t)img->w() * img->h() * 4;
+        m.cached = 1;
+        m.img = img;
+      }
+      m.refcount++;
+      CHECK(img->refcount() == m.refcount);
+      model_trim();
+      break;
+    }
+    case 1: {					// find
+      Model &m = G_model[i];
+      Fl_Shared_Image *img = Fl_Shared_Image::find(names[i]);
+      CHECK((img != 0) == m.cached);
+      if (!img) {
+        G_misses++;
+        break;
+      }
+      CHECK(img == m.img);
+      G_hits++;
+      m.refcount++;
+      break;
+    }
+    case 2:					// release an image in use
+    case 3: {
+      int n;
+      for (n = 0; n < NAMES && G_model[i].refcount == 0; n++) i = (i + 1) % NAMES;
+      if (n == NAMES) break;
+      Model &m = G_model[i];
+      m.img->release();
+      if (--m.refcount == 0) {
+        if (G_budget) m.released = ++G_clock;
+        else m.cached = 0;
+      }
+      model_trim();
+      break;
+    }
+    case 4:					// new budget
+      if (checks_random(20) == 0) {
+        G_budget = checks_random(4) ? SMALL * checks_random(20) : 0;
+        Fl_Shared_Image::cache_size(G_budget);
+        model_trim();
+      }
+      break;
+  }
+  for (int j = 0; j < NAMES; j++) {
+    Fl_Shared_Image *img = cached(names[j]);
+    if (!CHECK((img != 0) == G_model[j].cached))
+      fprintf(stderr, "  operation %d: %s %s\n", op, names[j],
+              img ? "is still cached" : "is not cached");
+    if (img) CHECK(img == G_model[j].img && img->refcount() == G_model[j].refcount);
+  }
+  check_stats(G_hits, G_misses, G_evictions, model_used());
+}
+
+static void test_random() {
+  Fl_Shared_Image::reset_cache_stats();
+  G_budget = 4 * SMALL;
+  Fl_Shared_Image::cache_size(G_budget);
+  for (int op = 0; op < 5000; op++) random_operation(op);
+  for (int i = 0; i < NAMES; i++)
+    while (G_model[i].refcount > 0) {
+      G_model[i].img->release();
+      G_model[i].refcount--;
+    }
+  Fl_Shared_Image::cache_size(0);
+  CHECK(Fl_Shared_Image::num_images() == 0);
+  CHECK(Fl_Shared_Image::cache_used() == 0);
+}
+
+int main(int argc, char **argv) {
+  test_lru();
+  test_random();
+  return checks_result("shared_image_test");
+}
+
+//
+// End of "$Id$".
+//
@@ -0,0 +1,239 @@
+//
+// "$Id$"
+//
+// Fl_Table scrolling benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Scrolls a 10 million row table with non-uniform row heights from top to
+// bottom, resizes rows while scrolled, and reports the time taken.
+// Then does the same with a 500 million row table in uniform row height
+// mode, whose virtual height (10 billion pixels) does not fit in an int.
+// Use -q to just run the benchmark and exit without opening a window,
+// with status 1 if the top row was wrong at any scroll position.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Box.H>
+#include <FL/fl_draw.H>
+#include <FL/Fl_Table.H>
+
+#define BENCH_ROWS  10000000
+#define BENCH_STEPS 5000
+#define UNIFORM_ROWS 500000000
+
+class BenchTable : public Fl_Table
+{
+protected:
+    void draw_cell(TableContext context,
+    		   int R=0, int C=0, int X=0, int Y=0, int W=0, int H=0);
+public:
+    BenchTable(int x, int y, int w, int h, const char *l=0) : Fl_Table(x,y,w,h,l)
+    {
+	end();
+    }
+    // Scroll to pixel offset 'pos', the way a scrollbar drag does
+    void scroll_to(double pos)
+    {
+	vscrollbar->Fl_Slider::value(pos);
+	table_scrolled();
+    }
+    double scroll_max() const { return vscrollbar->maximum(); }
+    double scroll_pos() const { return vscrollbar->Fl_Slider::value(); }
+    double row_offset(int R) { return row_scroll_position(R); }
+    double virtual_height() const { return table_h; }
+    int top_row() const { return toprow; }
+    int bottom_row() const { return botrow; }
+};
+
+void BenchTable::draw_cell(TableContext context,
+			   int R, int C, int X, int Y, int W, int H)
+{
+    static char s[40];
+    switch ( context )
+    {
+	case CONTEXT_STARTPAGE:
+	    fl_font(FL_HELVETICA, 12);
+	    return;
+
+	case CONTEXT_ROW_HEADER:
+	case CONTEXT_COL_HEADER:
+	    sprintf(s, "%d", (context == CONTEXT_ROW_HEADER) ? R : C);
+	    fl_push_clip(X, Y, W, H);
+	    fl_draw_box(FL_THIN_UP_BOX, X, Y, W, H, color());
+	    fl_color(FL_BLACK);
+	    fl_draw(s, X, Y, W, H, FL_ALIGN_CENTER);
+	    fl_pop_clip();
+	    return;
+
+	case CONTEXT_CELL:
+	    sprintf(s, "%d/%d", R, C);
+	    fl_push_clip(X, Y, W, H);
+	    fl_color(FL_WHITE); fl_rectf(X, Y, W, H);
+	    fl_color(FL_BLACK); fl_draw(s, X, Y, W, H, FL_ALIGN_CENTER);
+	    fl_color(FL_LIGHT2); fl_rect(X, Y, W, H);
+	    fl_pop_clip();
+	    return;
+
+	default:
+	    return;
+    }
+}
+
+static BenchTable *G_table = 0;
+static Fl_Box *G_result = 0;
+
+// Does the top row contain the scroll position?
+static int top_row_ok(BenchTable *table) {
+    int r = table->top_row();
+    double pos = table->scroll_pos();
+    return table->row_offset(r) <= pos &&
+	   (r == table->rows() - 1 || pos < table->row_offset(r + 1));
+}
+
+static int G_wrong = 0;	// scroll positions with the wrong top row
+
+static double seconds_since(clock_t t) {
+    return (double)(clock() - t) / CLOCKS_PER_SEC;
+}
+
+// Run the benchmark, print and display the results
+static void run_benchmark(BenchTable *table) {
+    static char msg[800];
+    clock_t t = clock();
+    table->rows(BENCH_ROWS);
+    table->row_height_all(20);
+    for ( int r=0; r<BENCH_ROWS; r+=7 )		// make heights non-uniform
+	table->row_height(r, 31);
+    double t_setup = seconds_since(t);
+
+    // Scroll top to bottom in BENCH_STEPS steps
+    double max = table->scroll_max();
+    G_wrong = 0;
+    t = clock();
+    for ( int i=0; i<=BENCH_STEPS; i++ ) {
+	table->scroll_to(max * i / BENCH_STEPS);
+	if ( !top_row_ok(table) ) G_wrong++;
+    }
+    double t_scroll = seconds_since(t);
+
+    // Random access: jump to rows, then look up their pixel positions
+    t = clock();
+    unsigned int seed = 1;
+    for ( int i=0; i<BENCH_STEPS; i++ ) {
+	seed = seed * 1103515245 + 12345;
+	int r = (int)((seed >> 1) % BENCH_ROWS);
+	table->row_position(r);
+	if ( !top_row_ok(table) ) G_wrong++;
+    }
+    double t_jump = seconds_since(t);
+
+    // Resize single rows while scrolled to the bottom
+    t = clock();
+    for ( int i=0; i<BENCH_STEPS; i++ )
+	table->row_height((i * 1999) % BENCH_ROWS, 20 + (i & 7));
+    double t_resize = seconds_since(t);
+
+    int n = sprintf(msg, "%d rows: setup %.3fs\n"
+		 "%d scroll steps: %.3fs (%.1f us/step)\n"
+		 "%d row_position() jumps: %.3fs\n"
+		 "%d row_height() changes: %.3fs\n"
+		 "(last visible rows %d..%d)\n",
+	    BENCH_ROWS, t_setup,
+	    BENCH_STEPS, t_scroll, t_scroll * 1e6 / BENCH_STEPS,
+	    BENCH_STEPS, t_jump,
+	    BENCH_STEPS, t_resize,
+	    table->top_row(), table->bottom_row());
+
+    // Uniform row height mode: no per-row storage, 64-bit virtual height
+    t = clock();
+    table->uniform_row_height(20);
+    table->rows(UNIFORM_ROWS);
+    for ( int i=0; i<BENCH_STEPS; i++ )		// sparse exceptions
+	table->row_height((int)((double)UNIFORM_ROWS * i / BENCH_STEPS), 31);
+    t_setup = seconds_since(t);
+    max = table->scroll_max();
+    t = clock();
+    for ( int i=0; i<=BENCH_STEPS; i++ ) {
+	table->scroll_to(max * i / BENCH_STEPS);
+	if ( !top_row_ok(table) ) G_wrong++;
+    }
+    t_scroll = seconds_since(t);
+    n += sprintf(msg + n, "\n%d uniform rows (%.0f pixels): setup %.3fs\n"
+		 "%d scroll steps: %.3fs (%.1f us/step)\n"
+		 "(last visible rows %d..%d)",
+	    UNIFORM_ROWS, table->virtual_height(), t_setup,
+	    BENCH_STEPS, t_scroll, t_scroll * 1e6 / BENCH_STEPS,
+	    table->top_row(), table->bottom_row());
+    if ( G_wrong )
+	sprintf(msg + n, "\nWRONG top row at %d scroll positions", G_wrong);
+    table->rows(BENCH_ROWS);
+    table->uniform_row_height(0);
+    printf("%s\n", msg);
+    if ( G_result ) G_result->label(msg);
+    table->redraw();
+}
+
+static void run_cb(Fl_Widget*, void*) {
+    fl_cursor(FL_CURSOR_WAIT);
+    Fl::check();
+    run_benchmark(G_table);
+    fl_cursor(FL_CURSOR_DEFAULT);
+}
+
+int main(int argc, char **argv)
+{
+    if ( argc > 1 && strcmp(argv[1], "-q") == 0 ) {
+	// Headless: table is never shown, but all lookups still run
+	Fl_Group grp(0, 0, 600, 400);
+	BenchTable table(0, 0, 600, 400);
+	table.cols(10);
+	table.col_width_all(60);
+	grp.end();
+	run_benchmark(&table);
+	return G_wrong ? 1 : 0;
+    }
+
+    Fl_Double_Window win(700, 620, "Fl_Table scroll benchmark");
+    G_table = new BenchTable(10, 10, 680, 400);
+    G_table->row_header(1);
+    G_table->row_header_width(80);
+    G_table->col_header(1);
+    G_table->cols(10);
+    G_table->col_width_all(60);
+    G_table->rows(100);
+    G_table->row_height_all(20);
+
+    Fl_Button *run = new Fl_Button(10, 420, 160, 25, "Run benchmark");
+    run->callback(run_cb);
+    G_result = new Fl_Box(180, 420, 510, 190, "Press 'Run benchmark'");
+    G_result->box(FL_DOWN_BOX);
+    G_result->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT | FL_ALIGN_TOP);
+    G_result->labelsize(12);
+    win.end();
+    win.resizable(G_table);
+    win.show(argc, argv);
+    return Fl::run();
+}
+
+//
+// End of "$Id$".
+//
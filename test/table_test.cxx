@@ -0,0 +1,326 @@
+//
+// "$Id$"
+//
+// Fl_Table row and column lookup test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Changes row heights, column widths, rows() and cols() of a table at
+// random, scrolls it, and after each change checks the scroll positions,
+// the visible rows and columns and find_cell() against plain sums of a
+// model of the heights and widths. Does the same in uniform row height
+// mode with up to 500 million rows.
+// No display is needed.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Group.H>
+#include <FL/Fl_Scrollbar.H>
+#include <FL/Fl_Table.H>
+#include "checks.h"
+
+#define MAX_ROWS	200000	// rows of the model with one height per row
+#define MAX_COLS	3000
+#define MAX_EXCEPTIONS	200	// rows of another height in uniform row mode
+#define BIG_ROWS	500000000
+
+// Gives the test access to the protected members
+class TestTable : public Fl_Table {
+public:
+  TestTable(int x, int y, int w, int h) : Fl_Table(x, y, w, h) { end(); }
+  void scroll_v(double pos) { vscrollbar->Fl_Slider::value(pos); table_scrolled(); }
+  void scroll_h(double pos) { hscrollbar->Fl_Slider::value(pos); table_scrolled(); }
+  double voff() const { return vscrollbar->Fl_Slider::value(); }
+  double hoff() const { return hscrollbar->Fl_Slider::value(); }
+  double vmax() const { return vscrollbar->maximum(); }
+  double hmax() const { return hscrollbar->maximum(); }
+  using Fl_Table::toprow;
+  using Fl_Table::botrow;
+  using Fl_Table::leftcol;
+  using Fl_Table::rightcol;
+  using Fl_Table::toprow_scrollpos;
+  using Fl_Table::leftcol_scrollpos;
+  using Fl_Table::table_h;
+  using Fl_Table::table_w;
+  using Fl_Table::tix;
+  using Fl_Table::tiy;
+  using Fl_Table::tiw;
+  using Fl_Table::tih;
+  using Fl_Table::find_cell;
+  using Fl_Table::row_at;
+  using Fl_Table::row_scroll_position;
+  using Fl_Table::col_scroll_position;
+};
+
+// The model: one height per row, or in uniform row height mode a default
+// height and a list of the rows of another height
+static int G_rows, G_cols;
+static int *G_height, *G_width;
+static double *G_row_sum, *G_col_sum;	// sums of the first n heights and widths
+static int G_uniform;
+static int G_exc_row[MAX_EXCEPTIONS], G_exc_height[MAX_EXCEPTIONS], G_exceptions;
+
+static int model_height(int r) {
+  if (!G_uniform) return G_height[r];
+  for (int i = 0; i < G_exceptions; i++) if (G_exc_row[i] == r) return G_exc_height[i];
+  return G_uniform;
+}
+
+// Adds up the heights and widths after a change
+static void model_sums() {
+  G_row_sum[0] = G_col_sum[0] = 0;
+  if (!G_uniform)
+    for (int r = 0; r < G_rows; r++) G_row_sum[r + 1] = G_row_sum[r] + G_height[r];
+  for (int c = 0; c < G_cols; c++) G_col_sum[c + 1] = G_col_sum[c] + G_width[c];
+}
+
+// Sum of the heights of the first n rows
+static double row_sum(int n) {
+  if (!G_uniform) return G_row_sum[n];
+  double sum = (double)n * G_uniform;
+  for (int i = 0; i < G_exceptions; i++)
+    if (G_exc_row[i] < n) sum += G_exc_height[i] - G_uniform;
+  return sum;
+}
+
+static double col_sum(int n) {
+  return G_col_sum[n];
+}
+
+// First of n rows or columns that ends below pos, n if none does
+static int first_below(double (*sum)(int), int n, double pos) {
+  int lo = 0, hi = n;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (sum(mid + 1) > pos) hi = mid;
+    else lo = mid + 1;
+  }
+  return lo;
+}
+
+static void set_height(int r, int h) {
+  if (!G_uniform) {
+    G_height[r] = h;
+    return;
+  }
+  int i;
+  for (i = 0; i < G_exceptions && G_exc_row[i] != r; i++) {}
+  if (h == G_uniform) {
+    if (i < G_exceptions) {
+      G_exceptions--;
+      G_exc_row[i] = G_exc_row[G_exceptions];
+      G_exc_height[i] = G_exc_height[G_exceptions];
+    }
+    return;
+  }
+  if (i == G_exceptions) G_exceptions++;
+  G_exc_row[i] = r;
+  G_exc_height[i] = h;
+}
+
+static void set_rows(int n) {
+  if (G_uniform) {
+    for (int i = 0; i < G_exceptions; i++)
+      if (G_exc_row[i] >= n) set_height(G_exc_row[i--], G_uniform);
+  } else {
+    int h = G_rows ? G_height[G_rows - 1] : 25;
+    for (int r = G_rows; r < n; r++) G_height[r] = h;
+  }
+  G_rows = n;
+}
+
+static void set_cols(int n) {
+  int w = G_cols ? G_width[G_cols - 1] : 80;
+  for (int c = G_cols; c < n; c++) G_width[c] = w;
+  G_cols = n;
+}
+
+// A number from 0 up to but not including 1
+static double random_fraction() {
+  return (checks_random(1 << 24) * (double)(1 << 24) + checks_random(1 << 24)) /
+         ((double)(1 << 24) * (1 << 24));
+}
+
+// A number from 0 to n-1, also for n of more than 24 bits
+static int big_random(int n) {
+  return (int)(random_fraction() * n);
+}
+
+// Compares the table with the model
+static void check_table(TestTable &t, int op) {
+  model_sums();
+  int ok = CHECK(t.rows() == G_rows && t.cols() == G_cols);
+  ok &= CHECK(t.table_h == row_sum(G_rows));
+  ok &= CHECK(t.table_w == col_sum(G_cols));
+  for (int k = 0; k < 10; k++) {
+    int r = big_random(G_rows + 1), c = checks_random(G_cols + 1);
+    ok &= CHECK(t.row_scroll_position(r) == row_sum(r));
+    ok &= CHECK(t.col_scroll_position(c) == col_sum(c));
+    if (r < G_rows) ok &= CHECK(t.row_height(r) == model_height(r));
+    if (c < G_cols) ok &= CHECK(t.col_width(c) == G_width[c]);
+    double start, pos = random_fraction() * (t.table_h + 2);
+    int row = t.row_at(pos, start);
+    ok &= CHECK(row == first_below(row_sum, G_rows, pos) && start == row_sum(row));
+  }
+  // the rows and columns in view
+  double voff = t.voff(), hoff = t.hoff();
+  int top = first_below(row_sum, G_rows, voff);
+  if (top >= G_rows) top = G_rows - 1;
+  int bot = first_below(row_sum, G_rows, voff + t.tih - 1);
+  if (bot < top) bot = top;
+  if (bot >= G_rows) bot = G_rows - 1;
+  int left = first_below(col_sum, G_cols, hoff);
+  if (left >= G_cols) left = G_cols - 1;
+  int right = first_below(col_sum, G_cols, hoff + t.tiw - 1);
+  if (right < left) right = left;
+  if (right >= G_cols) right = G_cols - 1;
+  ok &= CHECK(t.toprow == top && t.botrow == bot);
+  ok &= CHECK(t.leftcol == left && t.rightcol == right);
+  ok &= CHECK(t.toprow_scrollpos == row_sum(top));
+  ok &= CHECK(t.leftcol_scrollpos == col_sum(left));
+  // the cells in view and a few others
+  for (int k = 0; k < 6; k++) {
+    int r = k < 3 ? top + checks_random(bot - top + 1) : big_random(G_rows);
+    int c = k < 3 ? left + checks_random(right - left + 1) : checks_random(G_cols);
+    int X, Y, W, H;
+    ok &= CHECK(t.find_cell(Fl_Table::CONTEXT_CELL, r, c, X, Y, W, H) == 0);
+    ok &= CHECK(X == (int)(col_sum(c) - hoff) + t.tix && W == G_width[c]);
+    ok &= CHECK(Y == (int)(row_sum(r) - voff) + t.tiy && H == model_height(r));
+  }
+  int X, Y, W, H;
+  ok &= CHECK(t.find_cell(Fl_Table::CONTEXT_CELL, G_rows, 0, X, Y, W, H) == -1);
+  if (!ok)
+    fprintf(stderr, "  operation %d: %d rows%s, %d cols, scrolled to %g,%g\n", op,
+            G_rows, G_uniform ? " of uniform height" : "", G_cols, voff, hoff);
+}
+
+static void random_operation(TestTable &t, int max_rows) {
+  switch (checks_random(10)) {
+    case 0:
+    case 1: {					// row height
+      int r = big_random(G_rows), h = checks_random(8) ? 10 + checks_random(30) : 0;
+      if (G_uniform && checks_random(3) == 0) h = G_uniform;
+      if (G_uniform && G_exceptions == MAX_EXCEPTIONS && model_height(r) == G_uniform) break;
+      t.row_height(r, h);
+      set_height(r, h);
+      break;
+    }
+    case 2: {					// column width
+      int c = checks_random(G_cols), w = checks_random(8) ? 20 + checks_random(100) : 0;
+      t.col_width(c, w);
+      G_width[c] = w;
+      break;
+    }
+    case 3: {					// number of rows
+      int n = 1 + (checks_random(3) ? big_random(max_rows) : checks_random(40));
+      t.rows(n);
+      set_rows(n);
+      break;
+    }
+    case 4: {					// number of columns
+      int n = 1 + (checks_random(3) ? checks_random(MAX_COLS) : checks_random(10));
+      t.cols(n);
+      set_cols(n);
+      break;
+    }
+    case 5:					// scrolling
+      if (t.vmax() > 0) t.scroll_v(random_fraction() * t.vmax());
+      break;
+    case 6:
+      if (t.hmax() > 0) t.scroll_h(random_fraction() * t.hmax());
+      break;
+    case 7:
+      t.row_position(big_random(G_rows));
+      break;
+    case 8:
+      t.col_position(checks_random(G_cols));
+      break;
+    case 9:					// all rows or columns
+      if (checks_random(4)) break;
+      if (checks_random(2)) {
+        int w = 20 + checks_random(100);
+        t.col_width_all(w);
+        for (int c = 0; c < G_cols; c++) G_width[c] = w;
+      } else {
+        int h = 10 + checks_random(30);
+        t.row_height_all(h);
+        if (G_uniform) {
+          G_uniform = h;
+          G_exceptions = 0;
+        } else {
+          for (int r = 0; r < G_rows; r++) G_height[r] = h;
+        }
+      }
+      break;
+  }
+}
+
+static void test_random(TestTable &t, int uniform, int max_rows, int ops) {
+  G_rows = 10000;
+  G_cols = 200;
+  if (uniform) {
+    t.uniform_row_height(uniform);
+    G_uniform = uniform;
+    G_exceptions = 0;
+  } else {
+    G_uniform = 0;
+    for (int r = 0; r < G_rows; r++) G_height[r] = 20;
+  }
+  t.rows(G_rows);
+  t.cols(G_cols);
+  if (!uniform) t.row_height_all(20);
+  t.col_width_all(80);
+  for (int c = 0; c < G_cols; c++) G_width[c] = 80;
+  check_table(t, -1);
+  for (int op = 0; op < ops; op++) {
+    random_operation(t, max_rows);
+    check_table(t, op);
+  }
+  // leaving uniform row height mode keeps the heights
+  if (uniform) {
+    int rows = G_rows < MAX_ROWS ? G_rows : MAX_ROWS;
+    t.rows(rows);
+    set_rows(rows);
+    for (int r = 0; r < rows; r++) G_height[r] = model_height(r);
+    t.uniform_row_height(0);
+    G_uniform = 0;
+    check_table(t, ops);
+  }
+}
+
+int main(int argc, char **argv) {
+  G_height = (int *)malloc(MAX_ROWS * sizeof(int));
+  G_width = (int *)malloc(MAX_COLS * sizeof(int));
+  G_row_sum = (double *)malloc((MAX_ROWS + 1) * sizeof(double));
+  G_col_sum = (double *)malloc((MAX_COLS + 1) * sizeof(double));
+  Fl_Group group(0, 0, 600, 400);
+  TestTable table(0, 0, 600, 400);
+  group.end();
+  test_random(table, 0, MAX_ROWS, 2000);
+  test_random(table, 20, BIG_ROWS, 3000);
+  free(G_col_sum);
+  free(G_row_sum);
+  free(G_width);
+  free(G_height);
+  return checks_result("table_test");
+}
+
+//
+// End of "$Id$".
+//
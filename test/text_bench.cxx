@@ -0,0 +1,165 @@
+//
+// "$Id$"
+//
+// Fl_Text_Display wrapping benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Fills an Fl_Text_Display with a 100k line document in a proportional
+// font, turns on wrapping at the widget bounds, changes the widget width
+// a few times so that all lines are wrapped again, and reports the time
+// taken. Also measures the string widths of all lines with fl_width().
+// Use -q to just run the benchmark and exit without showing a window
+// (this still needs a connection to the display to measure text).
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Text_Display.H>
+#include <FL/fl_draw.H>
+#include <FL/x.H>		// fl_open_display()
+
+#define BENCH_LINES	100000
+#define BENCH_WIDTHS	4
+
+static Fl_Text_Display *G_disp = 0;
+static Fl_Box *G_result = 0;
+
+static double seconds_since(clock_t t) {
+  return (double)(clock() - t) / CLOCKS_PER_SEC;
+}
+
+// Make a document of lines of random words, some with non-ASCII letters
+static char *make_document() {
+  static const char *words[] = {
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+    "Wrapping", "proportional", "text", "\xc3\xa9t\xc3\xa9", "na\xc3\xafve",
+    "\xce\xb1\xce\xb2\xce\xb3", "measure", "FLTK", "widget", "i", "mm", "W"
+  };
+  const int nwords = sizeof(words) / sizeof(words[0]);
+  int size = BENCH_LINES * 120, n = 0;
+  char *doc = (char *)malloc(size);
+  unsigned int seed = 1;
+  for (int i = 0; i < BENCH_LINES; i++) {
+    seed = seed * 1103515245 + 12345;
+    int len = (seed >> 8) % 100;		// characters, about
+    while (len > 0) {
+      seed = seed * 1103515245 + 12345;
+      const char *w = words[(seed >> 8) % nwords];
+      int l = (int)strlen(w);
+      memcpy(doc + n, w, l); n += l;
+      doc[n++] = ' ';
+      len -= l + 1;
+    }
+    doc[n++] = '\n';
+  }
+  doc[n] = 0;
+  return doc;
+}
+
+// Run the benchmark, print and display the results
+static void run_benchmark(Fl_Text_Display *disp) {
+  static char msg[600];
+  Fl_Text_Buffer *buf = disp->buffer();
+  char *doc = make_document();
+  buf->text(doc);
+  free(doc);
+
+  // Widths of all lines, one call per line
+  fl_font(FL_HELVETICA, 14);
+  clock_t t = clock();
+  double total = 0;
+  int pos = 0;
+  while (pos < buf->length()) {
+    int end = buf->line_end(pos);
+    char *line = buf->text_range(pos, end);
+    total += fl_width(line, end - pos);
+    free(line);
+    pos = end + 1;
+  }
+  double t_width = seconds_since(t);
+
+  // Wrap everything, then reflow at different widths
+  t = clock();
+  disp->wrap_mode(Fl_Text_Display::WRAP_AT_BOUNDS, 0);
+  double t_wrap = seconds_since(t);
+  t = clock();
+  for (int i = 0; i < BENCH_WIDTHS; i++)
+    disp->resize(disp->x(), disp->y(), disp->w() - 40 * (i & 1 ? -1 : 1),
+                 disp->h());
+  double t_reflow = seconds_since(t);
+  disp->wrap_mode(Fl_Text_Display::WRAP_NONE, 0);
+
+  sprintf(msg, "%d lines, %d bytes\n"
+               "fl_width() of all lines: %.3fs (%.0f pixels)\n"
+               "wrap_mode(WRAP_AT_BOUNDS): %.3fs\n"
+               "%d reflows after resize(): %.3fs (%.3fs each)",
+          BENCH_LINES, buf->length(),
+          t_width, total,
+          t_wrap,
+          BENCH_WIDTHS, t_reflow, t_reflow / BENCH_WIDTHS);
+  printf("%s\n", msg);
+  if (G_result) G_result->label(msg);
+  disp->redraw();
+}
+
+static void run_cb(Fl_Widget*, void*) {
+  fl_cursor(FL_CURSOR_WAIT);
+  Fl::check();
+  run_benchmark(G_disp);
+  fl_cursor(FL_CURSOR_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "-q") == 0) {
+    // Headless: the display is never shown, but all text is measured
+    fl_open_display();
+    Fl_Group grp(0, 0, 600, 400);
+    Fl_Text_Display disp(0, 0, 600, 400);
+    disp.buffer(new Fl_Text_Buffer());
+    disp.textfont(FL_HELVETICA);
+    disp.textsize(14);
+    grp.end();
+    run_benchmark(&disp);
+    return 0;
+  }
+
+  Fl_Double_Window win(640, 560, "Fl_Text_Display wrapping benchmark");
+  G_disp = new Fl_Text_Display(10, 10, 620, 400);
+  G_disp->buffer(new Fl_Text_Buffer());
+  G_disp->textfont(FL_HELVETICA);
+  G_disp->textsize(14);
+  Fl_Button *run = new Fl_Button(10, 420, 160, 25, "Run benchmark");
+  run->callback(run_cb);
+  G_result = new Fl_Box(180, 420, 450, 130, "Press 'Run benchmark'");
+  G_result->box(FL_DOWN_BOX);
+  G_result->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT | FL_ALIGN_TOP);
+  G_result->labelsize(12);
+  win.end();
+  win.resizable(G_disp);
+  win.show(argc, argv);
+  return Fl::run();
+}
+
+//
+// End of "$Id$".
+//
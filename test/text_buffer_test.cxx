@@ -0,0 +1,653 @@
+//
+// "$Id$"
+//
+// Fl_Text_Buffer test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Makes the same random changes to a buffer stored in a gap buffer and
+// to one stored in a piece table, and checks that the text, the undo
+// and the arguments of the modify and predelete callbacks are the same.
+// Then searches texts and counts their lines, with the gap or the ends
+// of pieces inside of the matches, and checks the results against
+// simple loops over the text.
+// Then loads files with random bytes and checks the text against
+// a simple transcoding of each character.
+// No display is needed.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Text_Buffer.H>
+#include <FL/fl_utf8.h>
+#include "checks.h"
+
+#ifndef _WIN32
+#  include <unistd.h>
+#  include <sys/stat.h>
+#  include <pthread.h>
+#endif
+
+#define ROUNDS		3000		// rounds of random changes
+#define ROUND_CHANGES	8		// at most this many changes per round
+
+// ASCII, newlines and 2, 3 and 4 byte UTF-8 characters
+static const char *G_chars[] = {
+  "a", "b", "c", "x", " ", " ", "\n", "\n", "\t", "\xc3\xa9", "\xe2\x82\xac",
+  "\xf0\x9f\x98\x80"
+};
+
+// Makes a string of n random characters
+static char *random_text(int n) {
+  char *s = (char*)malloc(4 * n + 1), *p = s;
+  for (int i = 0; i < n; i++) {
+    const char *c = G_chars[checks_random(sizeof(G_chars) / sizeof(G_chars[0]))];
+    while (*c) *p++ = *c++;
+  }
+  *p = 0;
+  return s;
+}
+
+// A random position at a character boundary
+static int random_position(Fl_Text_Buffer &b) {
+  return b.utf8_align(checks_random(b.length() + 1));
+}
+
+// Records the calls of the modify and predelete callbacks of a buffer
+struct Callback_Log {
+  char *text;
+  int length, size;
+  Callback_Log() : text(0), length(0), size(0) { }
+  ~Callback_Log() { free(text); }
+  void add(const char *s, int n) {
+    if (length + n + 1 > size) {
+      size = 2 * size + n + 1000;
+      text = (char*)realloc(text, size);
+    }
+    memcpy(text + length, s, n);
+    length += n;
+    text[length] = 0;
+  }
+  void clear() { length = 0; }
+};
+
+static void modify_cb(int pos, int nInserted, int nDeleted, int nRestyled,
+                      const char *deletedText, void *data) {
+  Callback_Log *log = (Callback_Log*)data;
+  char s[100];
+  log->add(s, sprintf(s, "modify %d +%d -%d ~%d [", pos, nInserted, nDeleted, nRestyled));
+  if (deletedText && nDeleted > 0) log->add(deletedText, nDeleted);
+  log->add("]\n", 2);
+}
+
+static void predelete_cb(int pos, int nDeleted, void *data) {
+  Callback_Log *log = (Callback_Log*)data;
+  char s[100];
+  log->add(s, sprintf(s, "predelete %d -%d\n", pos, nDeleted));
+}
+
+// A change of the buffers, made at random once and then repeated
+struct Change {
+  enum { INSERT, REMOVE, REPLACE, COPY, UNDO, TEXT } type;
+  int start, end;	// the range changed, or copied
+  int self, to;		// COPY: from the buffer itself, and where to
+  int result, cursor;	// UNDO: what undo() returned
+  char *text;
+};
+
+static Fl_Text_Buffer *G_other = 0;	// the text that COPY copies from
+static Fl_Text_Buffer *G_scratch = 0;	// takes the undo state from the others
+
+// The undo state is shared by all buffers; this makes it belong to none
+// of the buffers that are compared
+static void forget_undo() {
+  G_scratch->text("");
+  G_scratch->insert(0, "x");
+}
+
+static void make_change(Fl_Text_Buffer &b, Change &c) {
+  switch (c.type) {
+    case Change::INSERT:  b.insert(c.start, c.text); break;
+    case Change::REMOVE:  b.remove(c.start, c.end); break;
+    case Change::REPLACE: b.replace(c.start, c.end, c.text); break;
+    case Change::COPY:    b.copy(c.self ? &b : G_other, c.start, c.end, c.to); break;
+    case Change::TEXT:    b.text(c.text); forget_undo(); break;	// undo() can't undo text()
+    case Change::UNDO:
+      c.cursor = -1;
+      c.result = b.undo(&c.cursor);
+      break;
+  }
+}
+
+// Makes a random change of b, and remembers it in c
+static void random_change(Fl_Text_Buffer &b, Change &c) {
+  int r = checks_random(100);
+  c.text = 0;
+  c.start = random_position(b);
+  c.end = random_position(b);
+  if (c.end < c.start) { int t = c.start; c.start = c.end; c.end = t; }
+  if (c.end - c.start > 200 && r < 90) c.end = b.utf8_align(c.start + checks_random(200));
+  if (r < 35) {
+    c.type = Change::INSERT;
+    c.text = random_text(checks_random(10) ? checks_random(20) + 1 : 2000);
+  } else if (r < 60) {
+    c.type = Change::REMOVE;
+  } else if (r < 75) {
+    c.type = Change::REPLACE;
+    c.text = random_text(checks_random(30));
+  } else if (r < 85) {
+    // from the other text or from the buffer itself, to anywhere
+    c.type = Change::COPY;
+    c.self = checks_random(2);
+    Fl_Text_Buffer &from = c.self ? b : *G_other;
+    c.start = from.utf8_align(checks_random(from.length() + 1));
+    c.end = from.utf8_align(c.start + checks_random(from.length() - c.start + 1) % 300);
+    c.to = random_position(b);
+  } else if (r < 99) {
+    c.type = Change::UNDO;
+  } else {
+    c.type = Change::TEXT;
+    c.text = random_text(checks_random(3000));
+  }
+  make_change(b, c);
+}
+
+// Checks that the buffers have the same text, and that the piece table
+// answers queries the same way
+static void compare_buffers(Fl_Text_Buffer &a, Fl_Text_Buffer &b, int all) {
+  if (!CHECK(a.length() == b.length())) return;
+  int n = a.length();
+  if (all) {
+    char *ta = a.text(), *tb = b.text();
+    CHECK(strcmp(ta, tb) == 0);
+    free(ta); free(tb);
+  }
+  for (int i = 0; i < 10; i++) {
+    int start = random_position(a), end = random_position(a);
+    if (end < start) { int t = start; start = end; end = t; }
+    char *ta = a.text_range(start, end), *tb = b.text_range(start, end);
+    CHECK(strcmp(ta, tb) == 0);
+    free(ta); free(tb);
+    if (n == 0) continue;
+    int pos = checks_random(n);
+    CHECK(a.byte_at(pos) == b.byte_at(pos));
+    pos = a.utf8_align(pos);
+    // address() is valid for at least the whole character
+    int len = a.next_char(pos) - pos;
+    CHECK(memcmp(a.address(pos), b.address(pos), len) == 0);
+    CHECK(a.char_at(pos) == b.char_at(pos));
+    CHECK(a.line_start(pos) == b.line_start(pos));
+    CHECK(a.line_end(pos) == b.line_end(pos));
+    CHECK(a.count_lines(start, end) == b.count_lines(start, end));
+  }
+}
+
+static void test_piece_table() {
+  Fl_Text_Buffer a, b;
+  Fl_Text_Buffer other;
+  G_other = &other;
+  char *t = random_text(5000);
+  other.text(t);
+  a.text(t);
+  b.text(t);
+  free(t);
+  b.storage(Fl_Text_Buffer::PIECE_TABLE);
+  CHECK(b.storage() == Fl_Text_Buffer::PIECE_TABLE);
+  CHECK(a.storage() == Fl_Text_Buffer::GAP_BUFFER);
+
+  Callback_Log log_a, log_b;
+  a.add_modify_callback(modify_cb, &log_a);
+  a.add_predelete_callback(predelete_cb, &log_a);
+  b.add_modify_callback(modify_cb, &log_b);
+  b.add_predelete_callback(predelete_cb, &log_b);
+
+  // Each buffer makes all changes of a round, including undo(), before
+  // the other one repeats them
+  Fl_Text_Buffer scratch;
+  G_scratch = &scratch;
+  Change changes[ROUND_CHANGES];
+  for (int round = 0; round < ROUNDS; round++) {
+    int i, n = checks_random(ROUND_CHANGES) + 1;
+    forget_undo();
+    for (i = 0; i < n; i++) random_change(a, changes[i]);
+    forget_undo();
+    for (i = 0; i < n; i++) {
+      Change c = changes[i];
+      make_change(b, c);
+      if (c.type == Change::UNDO)
+        CHECK(c.result == changes[i].result && c.cursor == changes[i].cursor);
+      free(changes[i].text);
+    }
+    CHECK(log_a.length == log_b.length && memcmp(log_a.text, log_b.text, log_a.length) == 0);
+    log_a.clear();
+    log_b.clear();
+    compare_buffers(a, b, round % 100 == 0);
+    if (round == ROUNDS / 2) {
+      // change the storage of a buffer with many pieces, and back
+      b.storage(Fl_Text_Buffer::GAP_BUFFER);
+      compare_buffers(a, b, 1);
+      b.storage(Fl_Text_Buffer::PIECE_TABLE);
+    }
+  }
+  compare_buffers(a, b, 1);
+}
+
+
+//------- searching and counting lines -------
+
+#define SEARCH_ROUNDS	400		// texts searched
+
+// Few different characters, so that the search strings are found often:
+// upper and lower case ASCII and UTF-8, 2 and 3 byte characters
+static const char *G_search_chars[] = {
+  "a", "A", "b", "B", "\n", "\xc3\xa9", "\xc3\x89", "\xe2\x82\xac"
+};
+
+static char *random_search_text(int n) {
+  char *s = (char*)malloc(3 * n + 1), *p = s;
+  for (int i = 0; i < n; i++) {
+    const char *c = G_search_chars[checks_random(sizeof(G_search_chars) / sizeof(G_search_chars[0]))];
+    while (*c) *p++ = *c++;
+  }
+  *p = 0;
+  return s;
+}
+
+// Compares the needle s with the text at pos, one character at a time,
+// as search_forward() did before it searched bytes
+static int reference_match(const char *text, int length, int pos, const char *s,
+                           int matchCase) {
+  if (matchCase) {
+    int n = (int) strlen(s);
+    return pos + n <= length && memcmp(text + pos, s, n) == 0;
+  }
+  while (*s) {
+    if (pos >= length) return 0;
+    int lt, ls;
+    unsigned t = fl_utf8decode(text + pos, text + length, &lt);
+    unsigned c = fl_utf8decode(s, 0, &ls);
+    if (fl_tolower(t) != fl_tolower(c)) return 0;
+    pos += lt;
+    s += ls;
+  }
+  return 1;
+}
+
+static int reference_forward(const char *text, int length, int start,
+                             const char *s, int matchCase) {
+  for (int pos = start; pos < length; pos += fl_utf8len1(text[pos]))
+    if (reference_match(text, length, pos, s, matchCase)) return pos;
+  return -1;
+}
+
+static int reference_backward(const char *text, int length, int start,
+                              const char *s, int matchCase) {
+  for (int pos = start; pos >= 0; pos--)
+    if ((text[pos] & 0xc0) != 0x80 && reference_match(text, length, pos, s, matchCase))
+      return pos;
+  return -1;
+}
+
+// Searches b for s in both directions from 'start' and checks the
+// results against the text
+static void check_search(Fl_Text_Buffer &b, const char *text, int start,
+                         const char *s, int matchCase) {
+  int length = b.length(), found = -1;
+  int expected = reference_forward(text, length, start, s, matchCase);
+  int result = b.search_forward(start, s, &found, matchCase);
+  if (!CHECK(result == (expected >= 0) && (!result || found == expected)))
+    fprintf(stderr, "  search_forward(%d, \"%s\", %d): %d at %d, expected %d\n",
+            start, s, matchCase, result, found, expected);
+  if (start >= length) return;
+  found = -1;
+  expected = reference_backward(text, length, start, s, matchCase);
+  result = b.search_backward(start, s, &found, matchCase);
+  if (!CHECK(result == (expected >= 0) && (!result || found == expected)))
+    fprintf(stderr, "  search_backward(%d, \"%s\", %d): %d at %d, expected %d\n",
+            start, s, matchCase, result, found, expected);
+}
+
+// Checks the line functions against loops over the bytes of the text
+static void check_lines(Fl_Text_Buffer &b, const char *text, int start, int end) {
+  int length = b.length(), pos, count = 0;
+  for (pos = start; pos < end; pos++)
+    if (text[pos] == '\n') count++;
+  CHECK(b.count_lines(start, end) == count);
+  for (int n = 0; n < 4; n++) {
+    // skip_lines(): after the n-th newline from start
+    pos = start;
+    for (count = 0; n && pos < length; )
+      if (text[pos++] == '\n' && ++count == n) break;
+    CHECK(b.skip_lines(start, n) == pos);
+    // rewind_lines(): after the (n+1)-th newline before start
+    int line = 0;
+    if (start > 1)
+      for (pos = start - 1, count = -1; pos >= 0; pos--)
+        if (text[pos] == '\n' && ++count >= n) { line = pos + 1; break; }
+    CHECK(b.rewind_lines(start, n) == line);
+  }
+  // findchar_forward() and findchar_backward(), through line_end() and
+  // line_start()
+  for (pos = start; pos < length && text[pos] != '\n'; pos++) { }
+  CHECK(b.line_end(start) == pos);
+  for (pos = start; pos > 0 && text[pos - 1] != '\n'; pos--) { }
+  CHECK(b.line_start(start) == pos);
+  int found;
+  unsigned c = 0x20ac;	// the Euro sign
+  for (pos = start; pos < length && strncmp(text + pos, "\xe2\x82\xac", 3); pos++) { }
+  CHECK(b.findchar_forward(start, c, &found) == (pos < length) && found == pos);
+  for (pos = start - 1; pos >= 0 && strncmp(text + pos, "\xe2\x82\xac", 3); pos--) { }
+  CHECK(b.findchar_backward(start, c, &found) == (pos >= 0) && found == (pos >= 0 ? pos : 0));
+}
+
+// Makes the text of b from pieces inserted at the start, so that the
+// piece table has a piece for each, and moves the gap of the gap buffer
+// to 'gap'
+static void set_search_text(Fl_Text_Buffer &b, const char *text, int gap) {
+  b.text("");
+  int length = (int) strlen(text), end = length;
+  while (end > 0) {
+    int start = end - 1 - checks_random(40);
+    if (start < 0) start = 0;
+    while (start > 0 && (text[start] & 0xc0) == 0x80) start--;
+    char *piece = (char*)malloc(end - start + 1);
+    memcpy(piece, text + start, end - start);
+    piece[end - start] = 0;
+    b.insert(0, piece);
+    free(piece);
+    end = start;
+  }
+  b.insert(gap, "x");
+  b.remove(gap, gap + 1);
+}
+
+static void test_search() {
+  Fl_Text_Buffer b;
+  for (int round = 0; round < SEARCH_ROUNDS; round++) {
+    b.storage(round & 1 ? Fl_Text_Buffer::PIECE_TABLE : Fl_Text_Buffer::GAP_BUFFER);
+    char *text = random_search_text(checks_random(round < 20 ? 10 : 600) + 1);
+    int length = (int) strlen(text);
+    // characters start where the byte isn't a continuation byte
+    int gap = checks_random(length + 1);
+    while (gap < length && (text[gap] & 0xc0) == 0x80) gap++;
+    set_search_text(b, text, gap);
+    char *t = b.text();
+    if (!CHECK(strcmp(t, text) == 0)) { free(t); free(text); continue; }
+    free(t);
+
+    char *needles[7];
+    // across the gap, or where a piece may end
+    int s = b.utf8_align(gap > 4 ? gap - 1 - checks_random(4) : 0);
+    int e = gap + 1 + checks_random(4);
+    while (e < length && (text[e] & 0xc0) == 0x80) e++;
+    needles[0] = b.text_range(s, e > length ? length : e);
+    // the first and the last bytes of the text
+    e = checks_random(length) + 1;
+    while (e < length && (text[e] & 0xc0) == 0x80) e++;
+    needles[1] = b.text_range(0, e);
+    needles[2] = b.text_range(b.prev_char(b.prev_char(length)), length);
+    // random strings, found or not
+    needles[3] = random_search_text(1);
+    needles[4] = random_search_text(2);
+    needles[5] = random_search_text(checks_random(5) + 3);
+    needles[6] = random_search_text(0);	// found at the start position
+
+    for (int i = 0; i < 7; i++) {
+      for (int matchCase = 0; matchCase < 2; matchCase++) {
+        check_search(b, text, 0, needles[i], matchCase);
+        check_search(b, text, length, needles[i], matchCase);
+        check_search(b, text, b.prev_char(length), needles[i], matchCase);
+        check_search(b, text, gap, needles[i], matchCase);
+        check_search(b, text, random_position(b), needles[i], matchCase);
+      }
+      free(needles[i]);
+    }
+
+    for (int i = 0; i < 5; i++) {
+      int start = random_position(b), end = random_position(b);
+      if (i == 0) start = 0;
+      if (i == 1) end = length;
+      if (end < start) { int tmp = start; start = end; end = tmp; }
+      check_lines(b, text, start, end);
+    }
+    free(text);
+  }
+
+  // count_lines() adds up the newlines of up to 255 words at once, which
+  // must not overflow when all bytes are newlines
+  char *text = (char*)malloc(300000 + 1);
+  int i;
+  for (i = 0; i < 300000; i++) text[i] = (i < 100000 || checks_random(3)) ? '\n' : 'a';
+  text[i] = 0;
+  b.storage(Fl_Text_Buffer::GAP_BUFFER);
+  set_search_text(b, text, 150001);
+  for (i = 0; i < 10; i++) {
+    int start = checks_random(300000), end = checks_random(300000);
+    if (end < start) { int tmp = start; start = end; end = tmp; }
+    check_lines(b, text, start, end);
+  }
+  check_lines(b, text, 0, 300000);
+  free(text);
+}
+
+
+//------- loading files -------
+
+#define TEMP_FILE	"text_buffer_test.tmp"
+#define TEMP_FIFO	"text_buffer_test.fifo"
+#define MAPPED_CHUNK	(1024 * 1024)	// as in Fl_Text_Buffer.cxx
+
+static void write_file(const char *name, const char *data, int n) {
+  FILE *fp = fl_fopen(name, "wb");
+  fwrite(data, 1, n, fp);
+  fclose(fp);
+}
+
+// What insertfile() makes of n bytes, one character at a time: valid
+// UTF-8 is kept, other bytes are read as CP1252, nul bytes are dropped.
+// 'out' must hold 3 bytes per input byte. Sets 'changed' if the text is
+// not the input, and returns the length of the text.
+static int reference_transcode(const char *p, int n, char *out, int &changed) {
+  const char *end = p + n;
+  char *q = out;
+  changed = 0;
+  while (p < end) {
+    int l = fl_utf8len1(*p), lp;
+    if (end - p < l) l = (int)(end - p);
+    while (l > 0) {
+      char multibyte[8];
+      unsigned u = fl_utf8decode(p, p + l, &lp);
+      int lq = fl_utf8encode(u, multibyte);
+      if (lp != l || lq != l || !u) changed = 1;
+      if (u) { memcpy(q, multibyte, lq); q += lq; }
+      p += lp;
+      l -= lp;
+    }
+  }
+  return (int)(q - out);
+}
+
+// Random bytes, or UTF-8 text with some invalid bytes. In the text, the
+// invalid bytes are followed by ASCII, so that reading it in blocks
+// never splits a sequence of bytes that are transcoded together.
+static void random_bytes(char *s, int n, int text, int nul) {
+  int i = 0;
+  while (i < n) {
+    int r = checks_random(100);
+    if (!text) {
+      s[i++] = (char)checks_random(256);
+    } else if (r < 70) {
+      s[i++] = (r % 20) ? (char)(' ' + checks_random(95)) : '\n';
+    } else if (r < 90) {
+      const char *c = G_chars[checks_random(sizeof(G_chars) / sizeof(G_chars[0]))];
+      while (*c && i < n) s[i++] = *c++;
+    } else {
+      // a continuation byte, a lead byte, or an overlong or 5 byte sequence
+      static const char *bad[] = { "\x80", "\xbf", "\xe2\x82", "\xf0", "\xc0\x80", "\xf8" };
+      const char *c = bad[checks_random(6)];
+      while (*c && i < n) s[i++] = *c++;
+      for (int j = 0; j < 5 && i < n; j++) s[i++] = 'a' + j;
+    }
+    if (!nul && i > 0 && !s[i - 1]) s[i - 1] = '0';
+  }
+}
+
+static int G_progress_done, G_progress_size;
+
+static void progress_cb(int done, int size, void *) {
+  G_progress_done = done;
+  G_progress_size = size;
+}
+
+// Inserts the file into a buffer with some text, at position 2 or at the
+// end, and checks the buffer against the text expected of the file
+static void check_insertfile(const char *name, int storage, int append, int buflen,
+                             const char *expected, int length, int changed) {
+  Fl_Text_Buffer b;
+  b.transcoding_warning_action = 0;	// no dialog
+  b.text("ab\ncd");
+  b.storage(storage);
+  int r = append ? b.appendfile(name, buflen) : b.insertfile(name, 2, buflen);
+  CHECK(r == 0);
+  if (!CHECK(b.length() == length + 5)) return;
+  int pos = append ? 5 : 2;
+  char *t = b.text_range(pos, pos + length);
+  CHECK(memcmp(t, expected, length) == 0);
+  free(t);
+  t = b.text();
+  CHECK(append ? memcmp(t, "ab\ncd", 5) == 0 : (memcmp(t, "ab", 2) == 0 && strcmp(t + 2 + length, "\ncd") == 0));
+  free(t);
+  CHECK(b.input_file_was_transcoded == changed);
+}
+
+#ifndef _WIN32
+// Writes a file into the fifo, which insertfile() reads in blocks
+struct Fifo_Data { const char *data; int n; };
+
+static void *fifo_writer(void *p) {
+  Fifo_Data *f = (Fifo_Data*)p;
+  FILE *fp = fopen(TEMP_FIFO, "wb");
+  fwrite(f->data, 1, f->n, fp);
+  fclose(fp);
+  return 0;
+}
+
+static void check_streamed(const char *data, int n, int buflen, const char *expected,
+                           int length, int changed) {
+  Fifo_Data f = { data, n };
+  pthread_t thread;
+  pthread_create(&thread, 0, fifo_writer, &f);
+  check_insertfile(TEMP_FIFO, Fl_Text_Buffer::GAP_BUFFER, checks_random(2), buflen,
+                   expected, length, changed);
+  pthread_join(thread, 0);
+}
+#endif // !_WIN32
+
+static void test_files() {
+  int size = MAPPED_CHUNK + 100;
+  char *data = (char*)malloc(size), *expected = (char*)malloc(3 * size);
+  int i, changed, length;
+
+  // Random bytes in memory mapped files
+  for (i = 0; i < 300; i++) {
+    int n = checks_random(i < 200 ? 64 : 5000) + 1;
+    random_bytes(data, n, i % 3, 1);
+    write_file(TEMP_FILE, data, n);
+    length = reference_transcode(data, n, expected, changed);
+    int storage = checks_random(2) ? Fl_Text_Buffer::PIECE_TABLE : Fl_Text_Buffer::GAP_BUFFER;
+    check_insertfile(TEMP_FILE, storage, i & 1, 128 * 1024, expected, length, changed);
+  }
+
+  // Sequences at the end of a mapped block
+  static const char *seams[] = {
+    "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xc3\xa9", "\x80", "\xe2\x82", "", "\0"
+  };
+  for (i = 0; i < (int)(sizeof(seams) / sizeof(seams[0])); i++) {
+    for (int at = MAPPED_CHUNK - 3; at <= MAPPED_CHUNK; at++) {
+      memset(data, 'x', size);
+      memcpy(data + at, seams[i], strlen(seams[i]) + (seams[i][0] == 0 && i == 6));
+      write_file(TEMP_FILE, data, size);
+      length = reference_transcode(data, size, expected, changed);
+      Fl_Text_Buffer b;
+      b.transcoding_warning_action = 0;
+      b.progress_callback(progress_cb);
+      G_progress_done = G_progress_size = -1;
+      CHECK(b.insertfile(TEMP_FILE, 0) == 0);
+      CHECK(G_progress_done == size && G_progress_size == size);
+      if (!CHECK(b.length() == length)) continue;
+      char *t = b.text();
+      CHECK(memcmp(t, expected, length) == 0);
+      free(t);
+      CHECK(b.input_file_was_transcoded == changed);
+    }
+  }
+
+  // Empty and missing files
+  write_file(TEMP_FILE, data, 0);
+  check_insertfile(TEMP_FILE, Fl_Text_Buffer::GAP_BUFFER, 0, 128 * 1024, "", 0, 0);
+  check_insertfile(TEMP_FILE, Fl_Text_Buffer::PIECE_TABLE, 1, 128 * 1024, "", 0, 0);
+  Fl_Text_Buffer b;
+  CHECK(b.insertfile("text_buffer_test.missing", 0) == 1);
+  CHECK(b.length() == 0);
+  remove(TEMP_FILE);
+
+#ifndef _WIN32
+  // Files that can't be mapped are read in blocks of 'buflen' bytes,
+  // with the same result, also when the file size is around 'buflen'.
+  // They end with ASCII: an incomplete sequence at the end of these
+  // files is dropped, as it always was.
+  remove(TEMP_FIFO);
+  if (mkfifo(TEMP_FIFO, 0600) == 0) {
+    for (i = 0; i < 200; i++) {
+      int buflen = 16 + checks_random(3) * 16;
+      int n = i < 100 ? buflen - 2 + checks_random(5) : checks_random(2000) + 10;
+      random_bytes(data, n, 1, 0);
+      memset(data + n - 6, '.', 6);
+      length = reference_transcode(data, n, expected, changed);
+      check_streamed(data, n, buflen, expected, length, changed);
+    }
+    // Nul bytes are dropped, also at the start and end of a block
+    for (i = 0; i < 100; i++) {
+      int buflen = 16 + checks_random(3) * 16;
+      int n = checks_random(500) + 10;
+      random_bytes(data, n, 1, 0);
+      memset(data + n - 6, '.', 6);
+      for (int j = checks_random(4) + 1; j > 0; j--)
+        data[(i < 20 ? (i % 3) * buflen / 2 : checks_random(n)) % n] = 0;
+      length = reference_transcode(data, n, expected, changed);
+      CHECK(changed);
+      check_streamed(data, n, buflen, expected, length, changed);
+    }
+    remove(TEMP_FIFO);
+  }
+#endif // !_WIN32
+
+  free(data);
+  free(expected);
+}
+
+int main(int argc, char **argv) {
+  test_piece_table();
+  test_search();
+  test_files();
+  return checks_result("text_buffer_test");
+}
+
+//
+// End of "$Id$".
+//
@@ -0,0 +1,142 @@
+//
+// "$Id$"
+//
+// Fl::add_timeout() benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Adds many timeouts with random times, looks them up, removes half of
+// them, and then runs a lot of repeating timeouts the way animated
+// widgets do, and reports the time taken.
+// Use -q to just run the benchmark and exit without opening a window.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Box.H>
+#include <FL/fl_draw.H>
+
+#define BENCH_TIMEOUTS	100000
+#define BENCH_REPEATERS	1000
+#define BENCH_REPEATS	100
+
+static Fl_Box *G_result = 0;
+static long G_calls = 0;
+static int G_repeats[BENCH_REPEATERS];
+
+static double seconds_since(clock_t t) {
+  return (double)(clock() - t) / CLOCKS_PER_SEC;
+}
+
+static void idle_cb(void *) {
+  // never called: all of these are removed before they expire
+}
+
+static void repeat_cb(void *data) {
+  int *count = (int *)data;
+  G_calls++;
+  if (--(*count) > 0) Fl::repeat_timeout(0.0, repeat_cb, data);
+}
+
+// Run the benchmark, print and display the results
+static void run_benchmark() {
+  static char msg[600];
+  static char args[BENCH_TIMEOUTS];
+  int i;
+
+  // Add timeouts far in the future, in random order
+  clock_t t = clock();
+  unsigned int seed = 1;
+  for (i = 0; i < BENCH_TIMEOUTS; i++) {
+    seed = seed * 1103515245 + 12345;
+    Fl::add_timeout(1000.0 + (seed >> 8) % 100000 / 100.0, idle_cb, args + i);
+  }
+  double t_add = seconds_since(t);
+
+  // Look all of them up
+  int found = 0;
+  t = clock();
+  for (i = 0; i < BENCH_TIMEOUTS; i++)
+    found += Fl::has_timeout(idle_cb, args + i);
+  double t_has = seconds_since(t);
+
+  // Remove every other one, then the rest
+  t = clock();
+  for (i = 0; i < BENCH_TIMEOUTS; i += 2)
+    Fl::remove_timeout(idle_cb, args + i);
+  for (i = 1; i < BENCH_TIMEOUTS; i += 2)
+    Fl::remove_timeout(idle_cb, args + i);
+  double t_remove = seconds_since(t);
+
+  // Repeating timeouts, with the long ones still pending
+  for (i = 0; i < BENCH_TIMEOUTS; i++)
+    Fl::add_timeout(1000.0, idle_cb, args + i);
+  G_calls = 0;
+  for (i = 0; i < BENCH_REPEATERS; i++) {
+    G_repeats[i] = BENCH_REPEATS;
+    Fl::add_timeout(0.0, repeat_cb, G_repeats + i);
+  }
+  t = clock();
+  while (G_calls < BENCH_REPEATERS * BENCH_REPEATS) Fl::wait(0.0);
+  double t_repeat = seconds_since(t);
+  Fl::remove_timeout(idle_cb);
+
+  sprintf(msg, "%d add_timeout(): %.3fs\n"
+               "%d has_timeout(): %.3fs (%d found)\n"
+               "%d remove_timeout(): %.3fs\n"
+               "%ld repeat_timeout() callbacks with %d pending: %.3fs\n"
+               "(%.2f us per callback)",
+          BENCH_TIMEOUTS, t_add,
+          BENCH_TIMEOUTS, t_has, found,
+          BENCH_TIMEOUTS, t_remove,
+          G_calls, BENCH_TIMEOUTS, t_repeat, t_repeat * 1e6 / G_calls);
+  printf("%s\n", msg);
+  if (G_result) G_result->label(msg);
+}
+
+static void run_cb(Fl_Widget*, void*) {
+  fl_cursor(FL_CURSOR_WAIT);
+  Fl::check();
+  run_benchmark();
+  fl_cursor(FL_CURSOR_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "-q") == 0) {
+    // Headless: timeouts are processed by Fl::wait() without a window
+    run_benchmark();
+    return 0;
+  }
+
+  Fl_Double_Window win(500, 180, "Fl::add_timeout() benchmark");
+  Fl_Button *run = new Fl_Button(10, 10, 160, 25, "Run benchmark");
+  run->callback(run_cb);
+  G_result = new Fl_Box(10, 45, 480, 125, "Press 'Run benchmark'");
+  G_result->box(FL_DOWN_BOX);
+  G_result->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT | FL_ALIGN_TOP);
+  G_result->labelsize(12);
+  win.end();
+  win.show(argc, argv);
+  return Fl::run();
+}
+
+//
+// End of "$Id$".
+//
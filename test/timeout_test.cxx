@@ -0,0 +1,248 @@
+//
+// "$Id$"
+//
+// Timeout test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Adds timeouts with Fl::add_timeout() and Fl::repeat_timeout(), removes
+// some of them, also from the callbacks of others, and checks that
+// Fl::wait() calls the others once each, not before they are due, and in
+// the order they are due, and those added with the same delay in the
+// order they were added.
+// No display is needed.
+//
+
+#include <config.h>
+#include <stdio.h>
+
+#if defined(USE_X11)
+
+#include <FL/Fl.H>
+#include <time.h>
+#include <sys/time.h>
+#include "checks.h"
+
+#define TIMERS	300	// timeouts added at once
+
+struct Timer {
+  int id;
+  double delay;
+  double due_lo, due_hi;	// when it is due, at the earliest and the latest
+  int removed;			// removed before it was called
+  int calls;
+  double called;		// time of the last call
+  int remove;			// timer this one removes when called, or -1
+  int repeats;			// repeat_timeout() calls still to make
+};
+
+static Timer G_timer[TIMERS];
+static int G_order[TIMERS];	// timers in the order they were called
+static int G_called;
+
+static double now() {
+#ifdef CLOCK_MONOTONIC
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec/1000000000.0;
+#else
+  struct timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec + t.tv_usec/1000000.0;
+#endif
+}
+
+static void timer_cb(void *v);
+
+static void add_timer(Timer &t, double delay) {
+  t.delay = delay;
+  t.due_lo = now() + delay;
+  Fl::add_timeout(delay, timer_cb, &t);
+  t.due_hi = now() + delay;
+}
+
+static void remove_timer(Timer &t) {
+  if (Fl::has_timeout(timer_cb, &t)) t.removed = 1;
+  Fl::remove_timeout(timer_cb, &t);
+  CHECK(!Fl::has_timeout(timer_cb, &t));
+}
+
+static void timer_cb(void *v) {
+  Timer &t = *(Timer*)v;
+  t.called = now();
+  if (!CHECK(!t.removed))
+    fprintf(stderr, "  timer %d was removed\n", t.id);
+  if (!CHECK(t.called >= t.due_lo - 1e-6))
+    fprintf(stderr, "  timer %d is %gs early\n", t.id, t.due_lo - t.called);
+  t.calls++;
+  if (G_called < TIMERS) G_order[G_called++] = t.id;
+  if (t.remove >= 0) remove_timer(G_timer[t.remove]);
+  if (t.repeats > 0) {
+    t.repeats--;
+    t.due_lo += t.delay;
+    t.due_hi += t.delay;
+    Fl::repeat_timeout(t.delay, timer_cb, &t);
+  }
+}
+
+static void init(int n) {
+  for (int i = 0; i < n; i++) {
+    Timer &t = G_timer[i];
+    t.id = i;
+    t.removed = t.calls = t.repeats = 0;
+    t.remove = -1;
+  }
+  G_called = 0;
+}
+
+// Waits until the timers have been called
+static void run(int n) {
+  double end = now() + 10.0;
+  for (;;) {
+    int pending = 0;
+    for (int i = 0; i < n; i++)
+      if (Fl::has_timeout(timer_cb, &G_timer[i])) pending++;
+    if (!pending || now() > end) break;
+    Fl::wait(0.01);
+  }
+  for (int i = 0; i < n; i++) {
+    Timer &t = G_timer[i];
+    if (!CHECK(t.removed ? t.calls == 0 || t.repeats : t.calls > 0 && !t.repeats))
+      fprintf(stderr, "  timer %d: %d calls, removed %d\n", i, t.calls, t.removed);
+    CHECK(!Fl::has_timeout(timer_cb, &t));
+  }
+}
+
+// Checks the order in which the timers were called
+static void check_order() {
+  for (int k = 1; k < G_called; k++) {
+    Timer &a = G_timer[G_order[k-1]], &b = G_timer[G_order[k]];
+    if (!CHECK(a.due_lo <= b.due_hi))
+      fprintf(stderr, "  timer %d (%gs) called after timer %d (%gs)\n",
+              b.id, b.delay, a.id, a.delay);
+  }
+  for (int k = 0; k < G_called; k++)
+    for (int j = k + 1; j < G_called; j++) {
+      Timer &a = G_timer[G_order[k]], &b = G_timer[G_order[j]];
+      if (a.delay == b.delay && !CHECK(a.id < b.id))
+        fprintf(stderr, "  timer %d called before timer %d\n", a.id, b.id);
+    }
+}
+
+// Timeouts of a few delays, many with the same delay, some removed before
+// Fl::wait() and some by the callbacks of others
+static void test_order() {
+  for (int round = 0; round < 10; round++) {
+    init(TIMERS);
+    for (int i = 0; i < TIMERS; i++) {
+      add_timer(G_timer[i], checks_random(5) * 0.01);
+      if (checks_random(8) == 0) G_timer[i].remove = checks_random(TIMERS);
+    }
+    for (int i = 0; i < TIMERS; i++)
+      CHECK(Fl::has_timeout(timer_cb, &G_timer[i]));
+    for (int n = checks_random(TIMERS / 4); n > 0; n--)
+      remove_timer(G_timer[checks_random(TIMERS)]);
+    run(TIMERS);
+    for (int i = 0; i < TIMERS; i++) CHECK(G_timer[i].calls == !G_timer[i].removed);
+    check_order();
+  }
+}
+
+// Timeouts that are due at the same time, when the first one removes the
+// second and the last one
+static void test_remove_in_callback() {
+  init(3);
+  add_timer(G_timer[0], 0.0);
+  add_timer(G_timer[1], 0.0);
+  add_timer(G_timer[2], 0.0);
+  G_timer[0].remove = 1;
+  G_timer[1].remove = 2;
+  Fl::wait(0.0);
+  CHECK(G_timer[0].calls == 1);
+  CHECK(G_timer[1].calls == 0 && G_timer[1].removed);
+  CHECK(G_timer[2].calls == 1);
+  // a timeout that removes itself and adds itself again is called again
+  init(2);
+  add_timer(G_timer[0], 0.0);
+  G_timer[0].remove = 0;
+  G_timer[0].repeats = 1;
+  add_timer(G_timer[1], 0.005);
+  run(2);
+  CHECK(G_timer[0].calls == 2 && G_timer[1].calls == 1);
+}
+
+// Repeated timeouts of different periods, and one stopped by another
+static void test_repeat() {
+  init(4);
+  for (int i = 0; i < 4; i++) {
+    add_timer(G_timer[i], 0.003 + i * 0.002);
+    G_timer[i].repeats = 9;
+  }
+  run(4);
+  for (int i = 0; i < 4; i++) CHECK(G_timer[i].calls == 10);
+  // timer 0 stops timer 3 on its fifth call
+  init(4);
+  for (int i = 0; i < 4; i++) {
+    add_timer(G_timer[i], 0.003 + i * 0.002);
+    G_timer[i].repeats = 9;
+  }
+  while (G_timer[0].calls < 4) Fl::wait(0.01);
+  G_timer[0].remove = 3;
+  int calls = G_timer[3].calls;
+  run(3);
+  CHECK(G_timer[3].removed && G_timer[3].calls <= calls + 1);
+  for (int i = 0; i < 3; i++) CHECK(G_timer[i].calls == 10);
+}
+
+static void other_cb(void *) {
+  CHECK(0);
+}
+
+// Removing the timeouts of a callback with any argument keeps the others
+static void test_remove_all() {
+  Fl::remove_timeout(other_cb);			// nothing to remove
+  init(20);
+  for (int i = 0; i < 20; i++) {
+    Fl::add_timeout(0.0, other_cb, &G_timer[i]);
+    add_timer(G_timer[i], 0.001);
+  }
+  Fl::add_timeout(0.0, other_cb);
+  CHECK(Fl::has_timeout(other_cb, &G_timer[7]));
+  Fl::remove_timeout(other_cb);
+  CHECK(!Fl::has_timeout(other_cb, &G_timer[7]) && !Fl::has_timeout(other_cb));
+  for (int i = 0; i < 20; i++) CHECK(Fl::has_timeout(timer_cb, &G_timer[i]));
+  run(20);
+}
+
+int main(int argc, char **argv) {
+  test_order();
+  test_remove_in_callback();
+  test_repeat();
+  test_remove_all();
+  return checks_result("timeout_test");
+}
+
+#else
+
+int main(int argc, char **argv) {
+  printf("timeout_test: only for X11\n");
+  return 0;
+}
+
+#endif // USE_X11
+
+//
+// End of "$Id$".
+//
@@ -0,0 +1,190 @@
+//
+// "$Id$"
+//
+// Fl_Tree population benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Fills an Fl_Tree from a list of file system like paths, one path at a
+// time and then all at once with the bulk add(), unsorted and sorted,
+// looks all the paths up with find_item() and reports the time taken.
+// One directory of the list has many entries, as some real ones do.
+// Then scrolls through the fully opened tree, drawing it into memory and
+// finding the items under the mouse, while opening and closing a directory.
+// Use -q to just run the benchmark and exit without opening a window.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Tree.H>
+#include <FL/Fl_Framebuffer_Surface.H>
+
+#define TOP_DIRS	20
+#define SUB_DIRS	50
+#define DIR_FILES	100		// TOP_DIRS * SUB_DIRS * DIR_FILES files
+#define BIG_DIR_FILES	30000		// and this many in one directory
+#define SCROLLS		500		// scroll positions drawn
+#define CLICKS		20		// items found at each position
+
+static Fl_Tree *G_tree = 0;
+static Fl_Box *G_result = 0;
+
+static char **G_paths = 0;
+static int G_npaths = 0;
+
+static double seconds_since(clock_t t) {
+  return (double)(clock() - t) / CLOCKS_PER_SEC;
+}
+
+// Make the paths in the order of a recursive directory listing,
+// with names that are not in alphabetical order within a directory
+static void make_paths() {
+  G_paths = new char*[TOP_DIRS * SUB_DIRS * DIR_FILES + BIG_DIR_FILES];
+  char s[100];
+  for (int d = 0; d < TOP_DIRS; d++)
+    for (int e = 0; e < SUB_DIRS; e++)
+      for (int f = 0; f < DIR_FILES; f++) {
+        sprintf(s, "project%02d/module%03d/file%04d.c", d, (e * 37) % SUB_DIRS,
+                (f * 7919) % DIR_FILES);
+        G_paths[G_npaths++] = strdup(s);
+      }
+  for (int f = 0; f < BIG_DIR_FILES; f++) {
+    sprintf(s, "spool/msg%06d", (int)((f * 7919L) % BIG_DIR_FILES));
+    G_paths[G_npaths++] = strdup(s);
+  }
+}
+
+// Count the items below 'item'
+static int count_items(Fl_Tree_Item *item) {
+  int n = item->children();
+  for (int t = 0; t < item->children(); t++) n += count_items(item->child(t));
+  return n;
+}
+
+static double add_one_by_one(Fl_Tree *tree, Fl_Tree_Sort order) {
+  tree->clear();
+  tree->sortorder(order);
+  clock_t t = clock();
+  for (int i = 0; i < G_npaths; i++) tree->add(G_paths[i]);
+  return seconds_since(t);
+}
+
+static double add_all(Fl_Tree *tree, Fl_Tree_Sort order) {
+  tree->clear();
+  tree->sortorder(order);
+  clock_t t = clock();
+  tree->add(G_paths, G_npaths);
+  return seconds_since(t);
+}
+
+// Draw the tree at evenly spaced scroll positions, find the item under
+// the mouse at a few places of each, and close and reopen a directory now
+// and then, as a user would when browsing the tree
+static double scroll_draw_click(Fl_Tree *tree, int *clicked) {
+  Fl_Framebuffer_Surface surface(tree->w(), tree->h());
+  Fl_Surface_Device::push_current(&surface);
+  clock_t t = clock();
+  surface.draw(tree);			// lays out the tree
+  tree->vposition(0x7fffffff);
+  int range = tree->vposition();
+  Fl_Tree_Item *dir = tree->find_item("project05");
+  *clicked = 0;
+  for (int s = 0; s < SCROLLS; s++) {
+    tree->vposition((int)((long)range * s / (SCROLLS - 1)));
+    if (dir && s % 50 == 25) { dir->close(); surface.draw(tree); dir->open(); }
+    surface.draw(tree);
+    for (int c = 0; c < CLICKS; c++) {
+      Fl::e_x = tree->x() + tree->w() / 2;
+      Fl::e_y = tree->y() + tree->h() * c / CLICKS;
+      if (tree->find_clicked()) (*clicked)++;
+    }
+  }
+  double secs = seconds_since(t);
+  Fl_Surface_Device::pop_current();
+  return secs;
+}
+
+static void run_benchmark(Fl_Tree *tree) {
+  static char msg[1000];
+  if (!G_paths) make_paths();
+  double t_one = add_one_by_one(tree, FL_TREE_SORT_NONE);
+  double t_one_sorted = add_one_by_one(tree, FL_TREE_SORT_ASCENDING);
+  double t_all = add_all(tree, FL_TREE_SORT_NONE);
+  double t_all_sorted = add_all(tree, FL_TREE_SORT_ASCENDING);
+  clock_t t = clock();
+  int found = 0;
+  for (int i = 0; i < G_npaths; i++)
+    if (tree->find_item(G_paths[i])) found++;
+  double t_find = seconds_since(t);
+  int clicked;
+  double t_scroll = scroll_draw_click(tree, &clicked);
+  sprintf(msg, "%d paths, %d items in the tree\n"
+               "add() one by one: %.3fs, sorted %.3fs\n"
+               "add() all at once: %.3fs, sorted %.3fs\n"
+               "find_item() of each path: %.3fs (%d found)\n"
+               "draw() at %d scroll positions: %.3fs (%d clicked)",
+          G_npaths, count_items(tree->root()),
+          t_one, t_one_sorted, t_all, t_all_sorted, t_find, found,
+          SCROLLS, t_scroll, clicked);
+  printf("%s\n", msg);
+  if (G_result) {
+    // Close the top directories so that the tree is quick to draw
+    for (int t = 0; t < tree->root()->children(); t++) tree->root()->child(t)->close();
+    G_result->label(msg);
+    tree->redraw();
+  }
+}
+
+static void run_cb(Fl_Widget*, void*) {
+  fl_cursor(FL_CURSOR_WAIT);
+  Fl::check();
+  run_benchmark(G_tree);
+  fl_cursor(FL_CURSOR_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "-q") == 0) {
+    // Headless: the tree is never shown
+    Fl_Tree tree(0, 0, 400, 400);
+    tree.end();
+    run_benchmark(&tree);
+    return 0;
+  }
+  Fl_Double_Window win(400, 575, "Fl_Tree population benchmark");
+  G_tree = new Fl_Tree(10, 10, 380, 400);
+  G_tree->showroot(0);
+  G_tree->end();
+  Fl_Button *run = new Fl_Button(10, 420, 160, 25, "Run benchmark");
+  run->callback(run_cb);
+  G_result = new Fl_Box(10, 455, 380, 110, "Press 'Run benchmark'");
+  G_result->box(FL_DOWN_BOX);
+  G_result->align(FL_ALIGN_INSIDE | FL_ALIGN_LEFT | FL_ALIGN_TOP);
+  G_result->labelsize(12);
+  win.end();
+  win.resizable(G_tree);
+  win.show(argc, argv);
+  return Fl::run();
+}
+
+//
+// End of "$Id$".
+//
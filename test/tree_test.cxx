@@ -0,0 +1,426 @@
+//
+// "$Id$"
+//
+// Fl_Tree layout test for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2017 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+//
+// Changes an Fl_Tree at random: scrolls it, opens and closes items, adds,
+// removes, relabels and moves them and changes its preferences. After each
+// change the tree is drawn into memory, and its pixels, its scrollbars,
+// the items found by find_clicked() and the positions of the open items
+// are checked against the same tree after recalc_tree(), which lays out
+// all the items again instead of only those that changed. The items found
+// by find_clicked() are also checked against a search of all the open
+// items, the widgets of items against the positions of their items, and
+// the pixels against the tree scrolled by a few pixels, which must only
+// move them.
+// The labels found among many children are checked against a search of
+// all the children, and Fl_Tree::add(paths, npaths) against adding the
+// same paths one by one.
+// No display is needed.
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include <FL/Fl.H>
+#include <FL/Fl_Tree.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Scrollbar.H>
+#include <FL/Fl_Framebuffer_Surface.H>
+#include "checks.h"
+
+#define OPERATIONS	2000		// random changes made
+#define MAX_ITEMS	2000		// items are removed above this
+#define CLICKS		160		// find_clicked() positions checked
+
+// Gives access to the scrollbars and to the area inside them
+class TestTree : public Fl_Tree {
+public:
+  TestTree() : Fl_Tree(10, 10, 300, 400) { }
+  int vmax() const { return _vscroll->visible() ? (int)_vscroll->maximum() : -1; }
+  int hmax() const { return _hscroll->visible() ? (int)_hscroll->maximum() : -1; }
+  void inner(int &X, int &Y, int &W, int &H) const { X = _tix; Y = _tiy; W = _tiw; H = _tih; }
+};
+
+// What the tree shows after it was drawn
+struct Result {
+  unsigned *pixels;
+  int vmax, hmax;
+  Fl_Tree_Item *clicked[2][CLICKS];	// find_clicked(0) and find_clicked(1)
+  int items;				// open items, in order, and their positions
+  Fl_Tree_Item *item[MAX_ITEMS + 100];
+  int xywh[MAX_ITEMS + 100][8];
+};
+
+static Fl_Framebuffer_Surface *G_surface;
+static TestTree *G_tree;
+static Result G_result[2];
+
+// Where find_clicked() is tried: the whole height of the tree, and more
+static int click_x(int i) { return 20 + i % 7 * 40; }
+static int click_y(int i) { return i * 3 - 40; }
+
+static void get_result(Result &r) {
+  Fl_Surface_Device::push_current(G_surface);
+  G_surface->draw(G_tree);
+  Fl_Surface_Device::pop_current();
+  memcpy(r.pixels, G_surface->pixels(), G_surface->w() * G_surface->h() * sizeof(unsigned));
+  r.vmax = G_tree->vmax();
+  r.hmax = G_tree->hmax();
+  for (int yonly = 0; yonly < 2; yonly++) {
+    for (int i = 0; i < CLICKS; i++) {
+      Fl::e_x = click_x(i);
+      Fl::e_y = click_y(i);
+      r.clicked[yonly][i] = G_tree->find_clicked(yonly);
+    }
+  }
+  // displayed() brings the items that were not drawn up to date
+  r.items = 0;
+  for (Fl_Tree_Item *i = G_tree->first_visible_item(); i; i = G_tree->next_visible_item(i, FL_Down)) {
+    int *p = r.xywh[r.items];
+    p[6] = G_tree->displayed(i);
+    p[0] = i->x(); p[1] = i->y(); p[2] = i->w(); p[3] = i->h();
+    p[4] = i->label_x(); p[5] = i->label_w(); p[7] = i->label_y();
+    r.item[r.items++] = i;
+  }
+}
+
+// Checks find_clicked() and the widgets against the positions of the items
+static void check_items(const Result &r, int operation) {
+  for (int yonly = 0; yonly < 2; yonly++) {
+    for (int c = 0; c < CLICKS; c++) {
+      int ex = click_x(c), ey = click_y(c);
+      Fl_Tree_Item *found = 0;
+      for (int i = 0; i < r.items && !found; i++) {
+        const int *p = r.xywh[i];
+        if (yonly ? (ey >= p[1] && ey <= p[1] + p[3])
+                  : (ex >= p[0] && ex < p[0] + p[2] && ey >= p[1] && ey < p[1] + p[3]))
+          found = r.item[i];
+      }
+      if (!CHECK(r.clicked[yonly][c] == found))
+        fprintf(stderr, "  find_clicked(%d) at %d,%d found %s, expected %s after operation %d\n",
+                yonly, ex, ey, r.clicked[yonly][c] ? r.clicked[yonly][c]->label() : "nothing",
+                found ? found->label() : "nothing", operation);
+    }
+  }
+  for (int i = 0; i < r.items; i++) {
+    Fl_Widget *w = r.item[i]->widget();
+    if (w && !CHECK(w->visible() && w->y() == r.xywh[i][7]))
+      fprintf(stderr, "  widget of %s at y %d, expected %d after operation %d\n",
+              r.item[i]->label(), w->y(), r.xywh[i][7], operation);
+  }
+}
+
+// Checks that scrolling down by a few pixels from the tree drawn in
+// 'pixels' moves what is inside the scrollbars up by as many pixels
+static void check_scrolling(const unsigned *pixels, int operation) {
+  int v = G_tree->vposition(), d = 2;	// even, for the dotted connectors
+  if (G_tree->vmax() < v + d) return;
+  G_tree->vposition(v + d);
+  Fl_Surface_Device::push_current(G_surface);
+  G_surface->draw(G_tree);
+  Fl_Surface_Device::pop_current();
+  const unsigned *moved = G_surface->pixels();
+  int X, Y, W, H, sw = G_surface->w();
+  G_tree->inner(X, Y, W, H);
+  X -= G_tree->x(); Y -= G_tree->y();		// where the tree is in the surface
+  for (int y = Y; y < Y + H - d; y++) {
+    if (!CHECK(memcmp(moved + y * sw + X, pixels + (y + d) * sw + X, W * sizeof(unsigned)) == 0)) {
+      fprintf(stderr, "  row %d differs after scrolling from %d to %d after operation %d\n",
+              y, v, v + d, operation);
+      break;
+    }
+  }
+  G_tree->vposition(v);
+}
+
+// Checks the tree as drawn against the tree with all of its items laid out again
+static void check_layout(int operation) {
+  Result &a = G_result[0], &b = G_result[1];
+  get_result(a);
+  check_items(a, operation);
+  check_scrolling(a.pixels, operation);
+  G_tree->recalc_tree();
+  get_result(b);
+  int size = G_surface->w() * G_surface->h() * sizeof(unsigned);
+  if (!CHECK(memcmp(a.pixels, b.pixels, size) == 0))
+    fprintf(stderr, "  pixels differ after operation %d\n", operation);
+  if (!CHECK(a.vmax == b.vmax && a.hmax == b.hmax))
+    fprintf(stderr, "  scrollbars %d %d, expected %d %d after operation %d\n",
+            a.vmax, a.hmax, b.vmax, b.hmax, operation);
+  if (!CHECK(memcmp(a.clicked, b.clicked, sizeof(a.clicked)) == 0))
+    fprintf(stderr, "  find_clicked() differs after operation %d\n", operation);
+  if (!CHECK(a.items == b.items && memcmp(a.item, b.item, a.items * sizeof(a.item[0])) == 0))
+    fprintf(stderr, "  open items differ after operation %d\n", operation);
+  else {
+    for (int i = 0; i < a.items; i++) {
+      if (!CHECK(memcmp(a.xywh[i], b.xywh[i], sizeof(a.xywh[i])) == 0)) {
+        fprintf(stderr, "  item %s at %d,%d, expected %d,%d after operation %d\n",
+                a.item[i]->label(), a.xywh[i][0], a.xywh[i][1], b.xywh[i][0], b.xywh[i][1], operation);
+        break;
+      }
+    }
+  }
+}
+
+static int count_items() {
+  int n = 0;
+  for (Fl_Tree_Item *i = G_tree->first(); i; i = G_tree->next(i)) n++;
+  return n;
+}
+
+// A random item other than the root, or 0
+static Fl_Tree_Item *random_item() {
+  int n = count_items();
+  if (n < 2) return 0;
+  Fl_Tree_Item *i = G_tree->first();
+  for (int k = checks_random(n - 1) + 1; k > 0; k--) i = G_tree->next(i);
+  return i;
+}
+
+// Whether the item or one below it has a widget
+static int has_widget(Fl_Tree_Item *item) {
+  if (item->widget()) return 1;
+  for (int t = 0; t < item->children(); t++)
+    if (has_widget(item->child(t))) return 1;
+  return 0;
+}
+
+static void random_operation() {
+  char path[100];
+  Fl_Tree_Item *item = random_item();
+  switch (checks_random(14)) {
+    case 0:					// scroll
+    case 1:
+      G_tree->vposition(checks_random(G_tree->vmax() > 0 ? G_tree->vmax() + 1 : 1));
+      break;
+    case 2:
+      G_tree->hposition(checks_random(G_tree->hmax() > 0 ? G_tree->hmax() + 1 : 1));
+      break;
+    case 3:					// open or close
+    case 4:
+      if (item && item->has_children()) {
+        if (item->is_open()) G_tree->close(item, 0);
+        else G_tree->open(item, 0);
+      }
+      break;
+    case 5:					// add
+      for (int n = checks_random(20) + 1; n > 0 && count_items() < MAX_ITEMS; n--) {
+        sprintf(path, "dir%d/sub%02d/new%d", checks_random(6), checks_random(40), checks_random(100));
+        G_tree->add(path);
+      }
+      break;
+    case 6:					// remove
+      if (item && !has_widget(item)) G_tree->remove(item);
+      break;
+    case 7:					// relabel
+      if (item) {
+        sprintf(path, "%.*s", checks_random(60) + 1,
+                "relabelled item with a label that is longer than the tree is wide");
+        item->label(path);
+      }
+      break;
+    case 8:					// font size
+      if (item) item->labelsize(checks_random(3) == 0 ? 24 : 14);
+      break;
+    case 9:					// activate, deactivate
+      if (item) item->activate(!item->is_active());
+      break;
+    case 10:					// move children
+      if (item && item->children() > 1) {
+        int a = checks_random(item->children()), b = checks_random(item->children());
+        if (checks_random(2)) item->swap_children(a, b);
+        else item->move(a, b);
+      }
+      break;
+    case 11:					// show an item
+      if (item) {
+        if (checks_random(2)) G_tree->show_item_middle(item);
+        else G_tree->show_item(item);
+      }
+      break;
+    case 12:					// preferences
+      switch (checks_random(5)) {
+        case 0: G_tree->showroot(!G_tree->showroot()); break;
+        case 1: G_tree->linespacing(checks_random(4)); break;
+        case 2: G_tree->openchild_marginbottom(checks_random(6)); break;
+        case 3: G_tree->marginleft(checks_random(10)); break;
+        case 4: G_tree->connectorstyle(checks_random(2) ? FL_TREE_CONNECTOR_SOLID
+                                                        : FL_TREE_CONNECTOR_DOTTED); break;
+      }
+      break;
+    case 13:					// a change that only redraws
+      if (item) item->select(!item->is_selected());
+      break;
+  }
+}
+
+// Changes the children of one item at random, and checks that
+// find_child() finds the first child with each label, as comparing
+// the labels of all the children would
+static void test_label_index() {
+  Fl_Group::current(0);
+  Fl_Tree *tree = new Fl_Tree(0, 0, 100, 100);
+  Fl_Tree_Item *parent = tree->add("parent");
+  char label[20];
+  for (int op = 0; op < 3000; op++) {
+    int n = parent->children();
+    Fl_Tree_Item *child = n ? parent->child(checks_random(n)) : 0;
+    sprintf(label, "n%d", checks_random(60));
+    switch (checks_random(n > 100 ? 9 : 3)) {
+      case 0:
+        tree->add(parent, label);
+        break;
+      case 1:
+        tree->insert(parent, label, checks_random(n + 1));
+        break;
+      case 2:
+      case 3:
+        if (child) tree->remove(child);
+        break;
+      case 4:
+        if (child) child->label(checks_random(20) ? label : 0);
+        break;
+      case 5:
+        if (n > 1) parent->move(checks_random(n), checks_random(n));
+        break;
+      case 6:
+        if (n > 1) parent->swap_children(checks_random(n), checks_random(n));
+        break;
+      case 7:
+        if (n > 1) {
+          child = parent->deparent(checks_random(n));
+          parent->reparent(child, checks_random(n));
+        }
+        break;
+      case 8:
+        if (checks_random(50) == 0) tree->clear_children(parent);
+        break;
+    }
+    for (int l = 0; l <= 60; l++) {
+      sprintf(label, "n%d", l);		// "n60" is never a label
+      int first = -1;
+      for (int t = 0; t < parent->children() && first < 0; t++)
+        if (parent->child(t)->label() && strcmp(parent->child(t)->label(), label) == 0)
+          first = t;
+      if (!CHECK(parent->find_child(label) == first))
+        fprintf(stderr, "  operation %d, %d children: %s found at %d, not %d\n",
+                op, parent->children(), label, parent->find_child(label), first);
+      CHECK(parent->find_child_item(label) == (first < 0 ? 0 : parent->child(first)));
+    }
+  }
+  delete tree;
+}
+
+static int count_below(Fl_Tree_Item *item) {
+  int n = item->children();
+  for (int t = 0; t < item->children(); t++) n += count_below(item->child(t));
+  return n;
+}
+
+// Whether two items have the same labels below them, in the same order
+static int same_items(Fl_Tree_Item *a, Fl_Tree_Item *b) {
+  if (a->children() != b->children()) return 0;
+  for (int t = 0; t < a->children(); t++) {
+    if (strcmp(a->child(t)->label(), b->child(t)->label()) != 0) return 0;
+    if (!same_items(a->child(t), b->child(t))) return 0;
+  }
+  return 1;
+}
+
+// Adds random lists of paths with add(paths, npaths) and one by one,
+// in all sort orders, and compares the trees and the number of new items
+static void test_bulk_add() {
+  static const Fl_Tree_Sort orders[] = {
+    FL_TREE_SORT_NONE, FL_TREE_SORT_ASCENDING, FL_TREE_SORT_DESCENDING
+  };
+  char text[500][40];
+  const char *paths[500];
+  for (int o = 0; o < 3; o++) {
+    Fl_Group::current(0);
+    Fl_Tree *one = new Fl_Tree(0, 0, 100, 100), *bulk = new Fl_Tree(0, 0, 100, 100);
+    one->sortorder(orders[o]);
+    bulk->sortorder(orders[o]);
+    for (int round = 0; round < 20; round++) {
+      int n = checks_random(500);
+      for (int i = 0; i < n; i++) {
+        if (i && checks_random(10) == 0) {	// the same path again
+          strcpy(text[i], text[i-1]);
+        } else {				// paths of few and of many siblings
+          int depth = checks_random(4) + 1;
+          text[i][0] = 0;
+          for (int d = 0; d < depth; d++)
+            sprintf(text[i] + strlen(text[i]), "%s%c%d", d ? "/" : "",
+                    'a' + checks_random(3), checks_random(d == 1 ? 40 : 3));
+        }
+        paths[i] = text[i];
+      }
+      int before = count_below(one->root());
+      for (int i = 0; i < n; i++) one->add(paths[i]);
+      int added = bulk->add(paths, n);
+      if (!CHECK(added == count_below(one->root()) - before))
+        fprintf(stderr, "  sort order %d, round %d: %d items added, not %d\n",
+                o, round, added, count_below(one->root()) - before);
+      CHECK(same_items(one->root(), bulk->root()));
+      CHECK(bulk->add(paths, n) == 0);	// they are all there now
+      CHECK(same_items(one->root(), bulk->root()));
+    }
+    delete one;
+    delete bulk;
+  }
+}
+
+int main(int argc, char **argv) {
+  // the items are measured and drawn into this surface, without a display
+  G_surface = new Fl_Framebuffer_Surface(320, 420);
+  for (int i = 0; i < 2; i++)
+    G_result[i].pixels = new unsigned[G_surface->w() * G_surface->h()];
+  Fl_Surface_Device::push_current(G_surface);
+  Fl_Group::current(0);
+  G_tree = new TestTree;
+  char path[100];
+  for (int a = 0; a < 6; a++)
+    for (int b = 0; b < 30; b++)
+      for (int c = 0; c < (b % 5) * 3; c++) {
+        sprintf(path, "dir%d/sub%02d/file%02d", a, b, c);
+        G_tree->add(path);
+      }
+  // widgets of items are moved with the items
+  G_tree->begin();
+  for (int i = 0; i < 3; i++) {
+    sprintf(path, "dir2/sub%02d/file00", i * 7 + 2);
+    G_tree->find_item(path)->widget(new Fl_Button(0, 0, 60, 20, "button"));
+  }
+  G_tree->end();
+  Fl_Surface_Device::pop_current();
+
+  check_layout(0);
+  for (int i = 1; i <= OPERATIONS; i++) {
+    random_operation();
+    check_layout(i);
+  }
+  delete G_tree;
+  for (int i = 0; i < 2; i++) delete[] G_result[i].pixels;
+  delete G_surface;
+  test_label_index();
+  test_bulk_add();
+  return checks_result("tree_test");
+}
+
+//
+// End of "$Id$".
+//
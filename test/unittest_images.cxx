@@ -21,6 +21,7 @@
 #include <FL/Fl_Radio_Button.H>
 #include <FL/Fl_Check_Button.H>
 #include <FL/fl_draw.H>
+#include <FL/Fl_Graphics_Driver.H>
 
 // Note: currently (March 2010) fl_draw_image() supports transparency with
 //	 alpha channel only on Apple (Mac OS X), but Fl_RGB_Image->draw()
@@ -295,6 +296,107 @@ Fl_RGB_Image *ImageTest::i_rgba = 0;
 
 UnitTest images("drawing images", ImageTest::create);
 
+//
+//------- test the bookkeeping of the cache of drawn images ----------
+//
+#define CACHE_ICONS 4
+
+class ImageCacheTest : public Fl_Box {
+  Fl_RGB_Image *icons_[CACHE_ICONS];
+  char failure_[100];
+  int checks_, failed_;
+  // Draws an icon, and checks the cache statistics that change.
+  // 'evictions' is -1 if other images may be evicted.
+  void draw_icon(int i, int hit, int evictions, int entries) {
+    Fl_Graphics_Driver::cache_stats before, after;
+    fl_graphics_driver->image_cache_stats(before);
+    icons_[i]->draw(x() + 10 + i * 20, y() + 60);
+    fl_graphics_driver->image_cache_stats(after);
+    check(after.hits - before.hits == (unsigned long)hit &&
+          after.misses - before.misses == (unsigned long)!hit &&
+          (evictions < 0 || after.evictions - before.evictions == (unsigned long)evictions) &&
+          after.entries == entries, i, "drawing");
+  }
+  void check(int ok, int i, const char *what) {
+    checks_++;
+    if (!ok && !failed_++)
+      sprintf(failure_, "\nFirst failure: %s icon %d, check %d", what, i, checks_);
+  }
+public:
+  static Fl_Widget *create() {
+    return new ImageCacheTest(TESTAREA_X, TESTAREA_Y, TESTAREA_W, TESTAREA_H);
+  }
+  ImageCacheTest(int x, int y, int w, int h) : Fl_Box(x, y, w, h) {
+    label("testing the cache of images converted for the display\n"
+          "The budget of the cache is set to hold 3 of the 4 icons, "
+          "and the hits, misses and evictions are checked while they "
+          "are drawn. Afterwards the cache is empty and has its old budget.");
+    align(FL_ALIGN_INSIDE|FL_ALIGN_BOTTOM|FL_ALIGN_LEFT|FL_ALIGN_WRAP);
+    box(FL_BORDER_BOX);
+    for (int i = 0; i < CACHE_ICONS; i++) {
+      uchar *p = new uchar[16 * 16 * 3];
+      for (int k = 0; k < 16 * 16; k++) {
+        p[k * 3 + 0] = uchar(i * 60);
+        p[k * 3 + 1] = uchar((k % 16) * 16);
+        p[k * 3 + 2] = uchar((k / 16) * 16);
+      }
+      icons_[i] = new Fl_RGB_Image(p, 16, 16, 3);
+      icons_[i]->alloc_array = 1;
+    }
+  }
+  ~ImageCacheTest() {
+    for (int i = 0; i < CACHE_ICONS; i++) delete icons_[i];
+  }
+  void draw() {
+    Fl_Box::draw();
+    char result[200];
+    Fl_Graphics_Driver::cache_stats st;
+    checks_ = failed_ = 0;
+    failure_[0] = 0;
+    if (!fl_graphics_driver->image_cache_stats(st)) {
+      strcpy(result, "This graphics driver has no image cache.");
+      for (int i = 0; i < CACHE_ICONS; i++) icons_[i]->draw(x() + 10 + i * 20, y() + 60);
+    } else {
+      unsigned long budget = fl_graphics_driver->image_cache_budget();
+      // Images that are clipped away are not converted, so the icons
+      // are drawn without the clip of this redraw
+      fl_push_no_clip();
+      int i;
+      for (i = 0; i < CACHE_ICONS; i++) icons_[i]->uncache();
+      // the most recently drawn image stays, even over budget
+      fl_graphics_driver->image_cache_budget(0);
+      draw_icon(0, 0, -1, 1);
+      fl_graphics_driver->image_cache_stats(st);
+      unsigned long icon_bytes = st.bytes;
+      fl_graphics_driver->image_cache_budget(3 * icon_bytes);
+      draw_icon(0, 1, 0, 1);
+      draw_icon(1, 0, 0, 2);
+      draw_icon(2, 0, 0, 3);
+      draw_icon(3, 0, 1, 3);			// 0 is evicted
+      draw_icon(1, 1, 0, 3);			// 2 is the oldest now
+      draw_icon(0, 0, 1, 3);			// 2 is evicted
+      draw_icon(3, 1, 0, 3);
+      draw_icon(2, 0, 1, 3);			// 1 is evicted
+      fl_graphics_driver->image_cache_stats(st);
+      check(st.bytes == 3 * icon_bytes, 0, "bytes after drawing");
+      icons_[2]->uncache();
+      fl_graphics_driver->image_cache_stats(st);
+      check(st.entries == 2 && st.bytes == 2 * icon_bytes, 2, "uncache() of");
+      for (i = 0; i < CACHE_ICONS; i++) icons_[i]->uncache();
+      fl_graphics_driver->image_cache_budget(budget);
+      fl_graphics_driver->image_cache_stats(st);
+      check(st.entries == 0 && st.bytes == 0 && st.budget == budget, 0, "uncache() of all, last");
+      fl_pop_clip();
+      sprintf(result, "Image cache: %d checks, %d failed%s", checks_, failed_, failure_);
+    }
+    fl_color(failed_ ? FL_RED : FL_BLACK);
+    fl_font(FL_HELVETICA, 12);
+    fl_draw(result, x() + 10, y() + 10, w() - 20, 40, FL_ALIGN_LEFT | FL_ALIGN_TOP);
+  }
+};
+
+UnitTest imagecache("image cache", ImageCacheTest::create);
+
 //
 // End of "$Id$"
 //
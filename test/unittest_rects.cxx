@@ -17,7 +17,13 @@
 //
 
 #include <FL/Fl_Box.H>
+#include <FL/Fl_Group.H>
+#include <FL/Fl_Check_Button.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Graphics_Driver.H>
 #include <FL/fl_draw.H>		// fl_text_extents()
+#include <FL/math.h>
+#include <time.h>
 
 //
 //------- test the rectangle drawing capabilities of this implementation ----------
@@ -52,6 +58,254 @@ public:
 
 UnitTest rects("rectangles", RectTest::create);
 
+//
+//------- test the clip stack with fl_clip_box() and fl_not_clipped() ----------
+//
+class ClipTest : public Fl_Box {
+  char failure_[200];
+  int checks_, failed_;
+  unsigned seed_;
+  int random(int n) {
+    seed_ = seed_ * 1103515245 + 12345;
+    return (int)((seed_ >> 8) % (unsigned)n);
+  }
+  // Checks the driver's answers for rectangle rx,ry,rw,rh against the
+  // clip X,Y,W,H that it should have
+  void check(int rx, int ry, int rw, int rh, int X, int Y, int W, int H) {
+    int r = rx + rw < X + W ? rx + rw : X + W, b = ry + rh < Y + H ? ry + rh : Y + H;
+    int ex = rx > X ? rx : X, ey = ry > Y ? ry : Y, ew = r - ex, eh = b - ey;
+    int cx, cy, cw, ch;
+    int result = fl_clip_box(rx, ry, rw, rh, cx, cy, cw, ch);
+    int visible = fl_not_clipped(rx, ry, rw, rh) != 0;
+    int ok;
+    if (ew <= 0 || eh <= 0) // where cx and cy are left is not defined
+      ok = result != 0 && (cw <= 0 || ch <= 0) && !visible;
+    else
+      ok = cx == ex && cy == ey && cw == ew && ch == eh && visible &&
+           result == (ex != rx || ey != ry || ew != rw || eh != rh);
+    checks_++;
+    if (!ok && !failed_++)
+      sprintf(failure_, "\nFirst failure: clip %d,%d,%d,%d, rectangle %d,%d,%d,%d:\n"
+              "fl_clip_box() = %d: %d,%d,%d,%d, fl_not_clipped() = %d",
+              X - x(), Y - y(), W, H, rx - x(), ry - y(), rw, rh,
+              result, cx - x(), cy - y(), cw, ch, visible);
+  }
+  // Pushes random nested clips inside of X,Y,W,H and checks them
+  void check_nested(int X, int Y, int W, int H, int depth) {
+    for (int i = 0; i < 8; i++)
+      check(X - 20 + random(W + 40), Y - 20 + random(H + 40),
+            random(W / 2 + 10) + 1, random(H / 2 + 10) + 1, X, Y, W, H);
+    if (depth == 0) return;
+    for (int i = 0; i < 3; i++) {
+      int x = X - 20 + random(W + 40), y = Y - 20 + random(H + 40);
+      int w = random(W + 10) - 5, h = random(H + 10) - 5;
+      fl_push_clip(x, y, w, h);
+      int r = x + w < X + W ? x + w : X + W, b = y + h < Y + H ? y + h : Y + H;
+      x = x > X ? x : X; y = y > Y ? y : Y;
+      if (w <= 0 || h <= 0 || r <= x || b <= y) r = x, b = y;
+      check_nested(x, y, r - x, b - y, depth - 1);
+      fl_pop_clip();
+      // the clip is back
+      if (W > 0 && H > 0) check(X, Y, W, H, X, Y, W, H);
+    }
+  }
+public: 
+  static Fl_Widget *create() {
+    return new ClipTest(TESTAREA_X, TESTAREA_Y, TESTAREA_W, TESTAREA_H);
+  }
+  ClipTest(int x, int y, int w, int h) : Fl_Box(x, y, w, h) {
+    label("testing fl_push_clip(), fl_clip_box() and fl_not_clipped()\n"
+          "No red pixels should be visible. "
+          "The red squares are clipped to the green squares in them.");
+    align(FL_ALIGN_INSIDE|FL_ALIGN_BOTTOM|FL_ALIGN_LEFT|FL_ALIGN_WRAP);
+    box(FL_BORDER_BOX);
+  }
+  void draw() {
+    Fl_Box::draw();
+    int a = x() + 10, b = y() + 10;
+    // Nested clips, without the clip that draw() is called with, so
+    // that they don't depend on what is redrawn. The outermost clip can
+    // be smaller than asked for where the device ends.
+    checks_ = failed_ = 0;
+    seed_ = 1;
+    failure_[0] = 0;
+    fl_push_no_clip();
+    fl_push_clip(a, b, 300, 200);
+    int X, Y, W, H;
+    fl_clip_box(a, b, 300, 200, X, Y, W, H);
+    if (W > 0 && H > 0) {
+      check_nested(X, Y, W, H, 4);
+      fl_push_clip(X + 10, Y + 10, 0, 50); // nothing is visible
+      check(X, Y, W, H, X + 10, Y + 10, 0, 0);
+      fl_pop_clip();
+    }
+    fl_pop_clip();
+    fl_pop_clip();
+    char result[300];
+    sprintf(result, "Nested clips: %d checks, %d failed%s", checks_, failed_, failure_);
+    fl_color(failed_ ? FL_RED : FL_BLACK);
+    fl_font(FL_HELVETICA, 12);
+    fl_draw(result, a, b, w() - 20, 60, FL_ALIGN_LEFT | FL_ALIGN_TOP);
+    // Each red fill is clipped to the green square around it
+    for (int i = 0; i < 3; i++) {
+      int cx = a + i * 60, cy = b + 80;
+      fl_push_clip(cx, cy, 50, 50);
+      fl_push_clip(cx + 10, cy + 10, 50, 50); // clipped to 40x40 by the outer clip
+      fl_color(FL_RED); fl_rectf(cx - 10, cy - 10, 80, 80);
+      fl_pop_clip();
+      fl_pop_clip();
+      fl_color(FL_GREEN); fl_rectf(cx + 10, cy + 10, 40, 40);
+      fl_color(FL_BLACK); fl_rect(cx, cy, 50, 50);
+    }
+  }
+};
+
+UnitTest clip("clipping", ClipTest::create);
+
+//
+//------- time nested clipping the way deep widget trees use it ----------
+//
+class ClipBenchBox : public Fl_Box {
+  int run_;
+  char result_[200];
+public:
+  ClipBenchBox(int x, int y, int w, int h) : Fl_Box(x, y, w, h), run_(0) {
+    label("A grid of \"widgets\", each clipping its children 5 levels deep.\n"
+          "'Run clip benchmark' draws it 500 times and shows the time taken.");
+    align(FL_ALIGN_INSIDE|FL_ALIGN_BOTTOM|FL_ALIGN_LEFT|FL_ALIGN_WRAP);
+    box(FL_BORDER_BOX);
+    result_[0] = 0;
+  }
+  void run() { run_ = 1; redraw(); }
+  // One frame: a grid of 200 "widgets" of 6 nested clips
+  int draw_frame(int a, int b) {
+    int n = 0, X, Y, W, H;
+    for (int r = 0; r < 10; r++) {
+      for (int c = 0; c < 20; c++) {
+        int cx = a + c * 24, cy = b + r * 20;
+        fl_push_clip(cx, cy, 24, 20);
+        int d;
+        for (d = 1; d <= 5; d++) {
+          if (!fl_not_clipped(cx + d, cy + d, 24 - d, 20 - d)) break;
+          fl_push_clip(cx + d, cy + d, 22 - 2 * d, 18 - 2 * d);
+          n += fl_clip_box(cx, cy, 24, 20, X, Y, W, H);
+          fl_color(d & 1 ? FL_WHITE : FL_LIGHT2);
+          fl_rectf(X, Y, W, H);
+        }
+        while (--d > 0) fl_pop_clip();
+        fl_pop_clip();
+      }
+    }
+    return n;
+  }
+  void draw() {
+    Fl_Box::draw();
+    int a = x() + 10, b = y() + 10;
+    if (run_) {
+      run_ = 0;
+      const int frames = 500;
+      clock_t t = clock();
+      int n = 0;
+      for (int i = 0; i < frames; i++) n += draw_frame(a, b);
+      double s = (double)(clock() - t) / CLOCKS_PER_SEC;
+      sprintf(result_, "%d frames of %d clips and fills: %.3fs (%.2f us per push/pop)",
+              frames, 200 * 6, s, s * 1e6 / (frames * 200 * 6));
+      printf("%s (%d)\n", result_, n);
+    } else {
+      draw_frame(a, b);
+    }
+    fl_color(FL_BLACK);
+    fl_font(FL_HELVETICA, 12);
+    fl_draw(result_, a, b + 220);
+  }
+};
+
+class ClipBenchTest : public Fl_Group {
+  static void run_cb(Fl_Widget*, void *v) {
+    fl_cursor(FL_CURSOR_WAIT);
+    Fl::check();
+    ((ClipBenchBox *)v)->run();
+    Fl::flush();
+    fl_cursor(FL_CURSOR_DEFAULT);
+  }
+public:
+  static Fl_Widget *create() {
+    return new ClipBenchTest(TESTAREA_X, TESTAREA_Y, TESTAREA_W, TESTAREA_H);
+  }
+  ClipBenchTest(int x, int y, int w, int h) : Fl_Group(x, y, w, h) {
+    Fl_Box *box = new ClipBenchBox(x, y, w, h - 35);
+    Fl_Button *run = new Fl_Button(x, y + h - 25, 160, 25, "Run clip benchmark");
+    run->callback(run_cb, box);
+    end();
+  }
+};
+
+UnitTest clipbench("clipping speed", ClipBenchTest::create);
+
+//
+//------- test blended rectangles and antialiased polygons ----------
+//
+class BlendBox : public Fl_Box {
+public:
+  BlendBox(int x, int y, int w, int h) : Fl_Box(x, y, w, h) {
+    label("Each colored bar should show the black and white stripes\n"
+          "below it, less and less from left to right.\n"
+          "With antialiasing on, the edges of the stars are smooth,\n"
+          "and the X server blends the bars on X11.");
+    align(FL_ALIGN_INSIDE|FL_ALIGN_BOTTOM|FL_ALIGN_LEFT|FL_ALIGN_WRAP);
+    box(FL_BORDER_BOX);
+  }
+  void draw() {
+    Fl_Box::draw();
+    int a = x() + 10, b = y() + 10;
+    for (int i = 0; i < 16; i++) {
+      fl_color(i & 1 ? FL_WHITE : FL_BLACK);
+      fl_rectf(a + i * 20, b, 20, 120);
+    }
+    static const Fl_Color colors[3] = { FL_RED, FL_GREEN, FL_BLUE };
+    for (int c = 0; c < 3; c++)
+      for (int i = 0; i < 8; i++)
+        fl_rectf(a + i * 40, b + 10 + c * 35, 40, 30, colors[c], uchar(32 * i + 31));
+    for (int s = 0; s < 3; s++) {
+      double cx = a + 360.5 + s * 0.33, cy = b + 60 + s * 80, r = 35;
+      fl_color(FL_DARK_BLUE);
+      fl_begin_complex_polygon();
+      for (int i = 0; i < 5; i++) { // a pentagram, the middle is not filled
+        double t = M_PI / 2 + i * 4 * M_PI / 5;
+        fl_vertex(cx + r * cos(t), cy - r * sin(t));
+      }
+      fl_end_complex_polygon();
+    }
+    fl_color(FL_DARK_RED);
+    fl_polygon(a + 420, b + 20, a + 490, b + 40, a + 440, b + 90);
+  }
+};
+
+class BlendTest : public Fl_Group {
+  Fl_Check_Button *button_;
+  static void antialias_cb(Fl_Widget *w, void *v) {
+    fl_graphics_driver->antialias(((Fl_Check_Button *)w)->value());
+    ((Fl_Widget *)v)->redraw();
+  }
+public:
+  static Fl_Widget *create() {
+    return new BlendTest(TESTAREA_X, TESTAREA_Y, TESTAREA_W, TESTAREA_H);
+  }
+  BlendTest(int x, int y, int w, int h) : Fl_Group(x, y, w, h) {
+    Fl_Box *box = new BlendBox(x, y, w, h - 35);
+    button_ = new Fl_Check_Button(x, y + h - 25, 160, 25, "Antialiasing");
+    button_->callback(antialias_cb, box);
+    end();
+  }
+  void hide() { // the other tests draw without antialiasing
+    button_->value(0);
+    fl_graphics_driver->antialias(0);
+    Fl_Group::hide();
+  }
+};
+
+UnitTest blend("blending", BlendTest::create);
+
 //
 // End of "$Id$"
 //
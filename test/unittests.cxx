@@ -29,7 +29,16 @@
 #include <FL/Fl_Help_View.H>
 #include <FL/Fl_Group.H>
 #include <FL/Fl_Box.H>
+#include <FL/Fl_Framebuffer_Surface.H>
 #include <FL/fl_draw.H>		// fl_text_extents()
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#endif
 
 // WINDOW/WIDGET SIZES
 #define MAINWIN_W	700				// main window w()
@@ -66,6 +75,9 @@ public:
   const char *label() {
     return fLabel;
   }
+  Fl_Widget *widget() {
+    return fWidget;
+  }
   void create() {
     fWidget = fCreate();
     if (fWidget) fWidget->hide();
@@ -167,9 +179,89 @@ void Browser_CB(Fl_Widget*, void*) {
 }
 
 
+//------- drawing the tests into memory with several threads -------
+
+#define BENCH_W		7680	// an 8K framebuffer
+#define BENCH_H		4320
+#define BENCH_FRAMES	5
+
+static Fl_Widget *bench_tests[200];
+static int bench_count = 0;
+
+// Wall clock time, so that threads are measured correctly
+static double now() {
+#ifdef _WIN32
+  return GetTickCount() / 1000.0;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+// Fills the surface with the tests side by side, and returns the time
+// of one frame in seconds
+static double draw_tests(Fl_Framebuffer_Surface *surface, int threads) {
+  surface->threads(threads);
+  Fl_Surface_Device::push_current(surface);
+  double t = now();
+  for (int f = 0; f < BENCH_FRAMES; f++) {
+    int i = 0;
+    for (int y = 0; y < BENCH_H; y += TESTAREA_H)
+      for (int x = 0; x < BENCH_W; x += TESTAREA_W, i++)
+        surface->draw(bench_tests[i % bench_count], x, y);
+    surface->pixels(); // draws what was recorded
+  }
+  t = (now() - t) / BENCH_FRAMES;
+  Fl_Surface_Device::pop_current();
+  return t;
+}
+
+// Draws the tests into an Fl_Framebuffer_Surface at once, then in tiles
+// with 1 to max_threads threads, and checks that the pixels are the same.
+// No display is needed.
+static int framebuffer_benchmark(int max_threads) {
+  Fl_Framebuffer_Surface *surface = new Fl_Framebuffer_Surface(BENCH_W, BENCH_H);
+  // the tests measure text when made, with the surface's font
+  Fl_Surface_Device::push_current(surface);
+  mainwin = new MainWindow(MAINWIN_W, MAINWIN_H, "Fltk Unit Tests");
+  for (int i = 0; i < UnitTest::numTest(); i++) {
+    UnitTest *t = UnitTest::test(i);
+    // the schemes test shows a subwindow, which needs a display
+    if (strcmp(t->label(), "schemes test") == 0) continue;
+    t->create();
+    t->show();
+    if (t->widget()) bench_tests[bench_count++] = t->widget();
+  }
+  mainwin->end();
+  Fl_Surface_Device::pop_current();
+
+  int status = 0;
+  size_t size = BENCH_W * BENCH_H * sizeof(unsigned);
+  unsigned *reference = (unsigned*)malloc(size);
+  double t1 = draw_tests(surface, 0);
+  memcpy(reference, surface->pixels(), size);
+  printf("%dx%d pixels, %d tests, %d frames\n", BENCH_W, BENCH_H, bench_count, BENCH_FRAMES);
+  printf("  at once:       %7.1f ms per frame\n", t1 * 1000);
+  for (int n = 1; n <= max_threads; n++) {
+    double t = draw_tests(surface, n);
+    int same = memcmp(reference, surface->pixels(), size) == 0;
+    printf("  tiles, %2d %s %7.1f ms per frame, %.2fx%s\n", n, n > 1 ? "threads:" : "thread: ",
+           t * 1000, t1 / t, same ? "" : ", PIXELS DIFFER");
+    if (!same) status = 1;
+  }
+  free(reference);
+  delete surface;
+  return status;
+}
+
+
 // this is the main call. It creates the window and adds all previously
 // registered tests to the browser widget.
+// With -b [threads] it runs framebuffer_benchmark() instead.
 int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "-b") == 0)
+    return framebuffer_benchmark(argc > 2 ? atoi(argv[2]) : 8);
   Fl::args(argc,argv);
   Fl::get_system_colors();
   Fl::scheme(Fl::scheme()); // init scheme before instantiating tests